@@ -111,6 +111,55 @@ extern "C" {
  */
   int eXosip_message_send_answer (struct eXosip_t *excontext, int tid, int status, osip_message_t * answer);
 
+  struct eXosip_request_template;
+
+/**
+ * Prepare a template for requests sent repeatedly to the same target.
+ *
+ * The To, From and route are parsed once: each request built from the
+ * template is a copy with a new Call-ID, From tag, Via branch and CSeq.
+ * A template is not thread safe: use it under eXosip_lock or from one
+ * thread only.
+ *
+ * @param excontext    eXosip_t instance.
+ * @param tpl       Pointer for the template to create.
+ * @param method    request method. (like "MESSAGE" or "NOTIFY"...)
+ * @param to        SIP url for callee.
+ * @param from      SIP url for caller.
+ * @param route     Route header for request. (optional)
+ */
+  int eXosip_request_template_new (struct eXosip_t *excontext, struct eXosip_request_template **tpl, const char *method, const char *to, const char *from, const char *route);
+
+/**
+ * Add a header to all requests built from a template.
+ *
+ * @param tpl       template.
+ * @param hname     header name.
+ * @param hvalue    header value.
+ */
+  int eXosip_request_template_set_header (struct eXosip_request_template *tpl, const char *hname, const char *hvalue);
+
+/**
+ * Build a request from a template.
+ *
+ * The request can be sent with eXosip_message_send_request.
+ *
+ * @param excontext    eXosip_t instance.
+ * @param tpl          template.
+ * @param message      Pointer for the SIP request to build.
+ * @param content_type Content-Type of the body. (optional)
+ * @param body         body of the request. (optional)
+ * @param length       length of the body.
+ */
+  int eXosip_request_template_build (struct eXosip_t *excontext, struct eXosip_request_template *tpl, osip_message_t ** message, const char *content_type, const char *body, size_t length);
+
+/**
+ * Free a template.
+ *
+ * @param tpl       template.
+ */
+  void eXosip_request_template_free (struct eXosip_request_template *tpl);
+
 /** @} */
 
 
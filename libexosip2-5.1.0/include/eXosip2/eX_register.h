@@ -122,6 +122,86 @@ extern "C" {
 
 /** @} */
 
+/**
+ * @defgroup eXosip2_registrar eXosip2 Registrar and location service
+ * @ingroup eXosip2_msg
+ * @{
+ */
+
+/**
+ * Binding of an address of record to a contact.
+ *
+ * The contact is used as request-uri to reach the registered user agent;
+ * route is not empty when the REGISTER was received from another address
+ * than the one of the contact (NAT) and can be given as route to the
+ * eXosip_*_build_request methods to send the request on the same flow.
+ */
+  struct eXosip_registrar_binding {
+    char aor[256];                /**< address of record (user@host) */
+    char contact[256];            /**< registered contact uri */
+    char route[128];              /**< route to the source of the REGISTER ("" when it is the contact) */
+    char username[64];            /**< authenticated username ("" without authentication) */
+    char received_ip[65];         /**< source ip address of the last REGISTER */
+    int received_port;            /**< source port of the last REGISTER */
+    char transport[10];           /**< transport of the last REGISTER (UDP, TCP, TLS, DTLS-UDP) */
+    int expires;                  /**< seconds before expiration (0 when removed or expired) */
+  };
+
+#ifdef WIN32
+  typedef int (__stdcall * CbSipRegistrarPassword) (struct eXosip_t * excontext, const char *username, const char *realm, char *passwd, int size, void *arg);
+  typedef void (__stdcall * CbSipRegistrarBinding) (struct eXosip_t * excontext, const struct eXosip_registrar_binding * binding, void *arg);
+#else
+  typedef int (*CbSipRegistrarPassword) (struct eXosip_t * excontext, const char *username, const char *realm, char *passwd, int size, void *arg);
+  typedef void (*CbSipRegistrarBinding) (struct eXosip_t * excontext, const struct eXosip_registrar_binding * binding, void *arg);
+#endif
+
+/**
+ * Configuration of the registrar. (see EXOSIP_OPT_SET_REGISTRAR)
+ *
+ * REGISTER requests are answered by eXosip without any event. With a
+ * get_password callback, they are challenged with a digest (MD5, qop=auth)
+ * in the realm configured: the callback fills passwd and returns 0 for a
+ * known user, or returns -1 to answer 403. The digest username must be
+ * the user part of the To header (403 otherwise), and each nonce is
+ * accepted with increasing nonce counts only. Once max_nonces challenges
+ * are pending, a new one replaces the oldest of its slot set, and the
+ * answer to the replaced one is challenged again. Only the first Contact of a
+ * REGISTER is kept: each address of record has one binding.
+ *
+ * Callbacks are called with the eXosip lock held: they must not call
+ * eXosip API.
+ */
+  struct eXosip_registrar {
+    char realm[128];              /**< realm of the digest challenge */
+    int min_expires;              /**< shorter registrations are answered with 423 (default 60) */
+    int max_expires;              /**< longer registrations are shortened (default 3600) */
+    CbSipRegistrarPassword get_password;        /**< password of a user (NULL: no authentication) */
+    CbSipRegistrarBinding binding_changed;      /**< binding added, modified, removed or expired (optional) */
+    void *arg;                    /**< argument given to the callbacks */
+    int max_nonces;               /**< challenges kept waiting for their answer (default 1024) */
+  };
+
+/**
+ * Find the binding of an address of record.
+ *
+ * @param excontext    eXosip_t instance.
+ * @param aor          address of record ("sip:user@host" or "user@host").
+ * @param binding      binding to fill.
+ * @return OSIP_SUCCESS or OSIP_NOTFOUND.
+ */
+  int eXosip_registrar_lookup (struct eXosip_t *excontext, const char *aor, struct eXosip_registrar_binding *binding);
+
+/**
+ * Remove the binding of an address of record.
+ *
+ * @param excontext    eXosip_t instance.
+ * @param aor          address of record ("sip:user@host" or "user@host").
+ * @return OSIP_SUCCESS or OSIP_NOTFOUND.
+ */
+  int eXosip_registrar_remove (struct eXosip_t *excontext, const char *aor);
+
+/** @} */
+
 
 #ifdef __cplusplus
 }
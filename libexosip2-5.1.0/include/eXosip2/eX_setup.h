@@ -48,6 +48,7 @@ extern "C" {
 #endif
 
   struct eXosip_t;
+  struct eXosip_loop;
   struct osip_srv_record;
   struct osip_naptr;
 
@@ -108,6 +109,38 @@ extern "C" {
  */
   int eXosip_execute (struct eXosip_t *excontext);
 
+/**
+ * Allocate an event loop shared by several eXosip contexts.
+ * A context attached with EXOSIP_OPT_SET_EVENT_LOOP, before
+ * eXosip_listen_addr or eXosip_set_socket, starts no thread: its sockets
+ * are waited for and its timers are run by one of the threads of the
+ * loop, always the same one. Each thread runs its contexts one after the
+ * other: a callback blocking a context delays the others of its thread.
+ * eXosip_execute must not be called for an attached context.
+ *
+ * The loop waits with select: eXosip_listen_addr and eXosip_set_socket
+ * fail for an attached context when one of its sockets is above
+ * FD_SETSIZE.
+ *
+ * A thread of the loop holds its own mutex while it runs its contexts,
+ * callbacks included, and eXosip_listen_addr, eXosip_set_socket and
+ * eXosip_quit take this mutex for an attached context: these functions
+ * must not be called from a callback for a context of the same loop
+ * (deadlock).
+ * 
+ * @param loop         new event loop.
+ * @param threads      number of threads of the loop.
+ */
+  int eXosip_loop_new (struct eXosip_loop **loop, int threads);
+
+/**
+ * Stop and release an event loop.
+ * The contexts attached must have been released with eXosip_quit.
+ * 
+ * @param loop         event loop.
+ */
+  int eXosip_loop_free (struct eXosip_loop *loop);
+
 #define EXOSIP_OPT_BASE_OPTION 0
 #define EXOSIP_OPT_UDP_KEEP_ALIVE (EXOSIP_OPT_BASE_OPTION+1) /**< int *: interval for keep alive packets (UDP, TCP, TLS, DTLS) */
 #define EXOSIP_OPT_AUTO_MASQUERADE_CONTACT (EXOSIP_OPT_BASE_OPTION+2) /**< int *: specific re-usage of "rport" */
@@ -137,6 +170,16 @@ extern "C" {
 #define EXOSIP_OPT_SET_MAX_READ_TIMEOUT (EXOSIP_OPT_BASE_OPTION+30) /**< long int: set the period in nano seconds during we read for sip message. (high load traffic use-case: DO NOT USE FOR COMMON USAGE)*/
 #define EXOSIP_OPT_SET_DEFAULT_CONTACT_DISPLAYNAME (EXOSIP_OPT_BASE_OPTION+31) /**< char *: define a display name to be added in Contact headers  (example: "john Doe") */
 #define EXOSIP_OPT_SET_SESSIONTIMERS_FORCE (EXOSIP_OPT_BASE_OPTION+32) /**< int *: 0 (default): activate "session timers" if supported on both side, 1: if remote side (UAS) do not indicate support for "session timers", activate feature on UAC (local) side */
+#define EXOSIP_OPT_SET_ROUTE_CACHE_TTL (EXOSIP_OPT_BASE_OPTION+33) /**< int *: number of seconds the local ip found for a destination is kept in cache (default 30, 0 to disable). On linux, the cache is also flushed on route or address changes */
+#define EXOSIP_OPT_SET_OVERLOAD_CONTROL (EXOSIP_OPT_BASE_OPTION+34) /**< struct eXosip_overload_control *: thresholds above which new out of dialog requests are rejected with 503 or dropped */
+#define EXOSIP_OPT_SET_SOURCE_RATE_LIMIT (EXOSIP_OPT_BASE_OPTION+35) /**< struct eXosip_rate_limit *: maximum rate of incoming messages per source ip address (messages above are dropped before parsing) */
+#define EXOSIP_OPT_SET_INBOUND_PRIORITY (EXOSIP_OPT_BASE_OPTION+36) /**< struct eXosip_inbound_priority *: process responses, ACK, CANCEL, BYE and in-dialog requests before new requests (NULL or batch=0 to disable) */
+#define EXOSIP_OPT_SET_ADAPTIVE_T1 (EXOSIP_OPT_BASE_OPTION+37) /**< struct eXosip_adaptive_t1 *: seed T1 of UDP client transactions with the round trip time measured per destination (NULL or t1_max=0 to disable) */
+#define EXOSIP_OPT_SET_PEER_HEALTH (EXOSIP_OPT_BASE_OPTION+38) /**< struct eXosip_peer_health *: fail new requests at once to a destination which stopped answering (NULL or max_failures=0 to disable) */
+#define EXOSIP_OPT_SET_EVENT_WORKERS (EXOSIP_OPT_BASE_OPTION+39) /**< int *: number of threads running the callbacks set with eXosip_set_event_callback (0 to queue all events for eXosip_event_wait); not from a callback */
+#define EXOSIP_OPT_SET_REFRESH_JITTER (EXOSIP_OPT_BASE_OPTION+40) /**< int *: percentage (0-50, default 0) of the refresh delay of registrations, subscriptions and publications removed at random for each object, to spread refreshes over the refresh window */
+#define EXOSIP_OPT_SET_REGISTRAR (EXOSIP_OPT_BASE_OPTION+41) /**< struct eXosip_registrar *: answer REGISTER requests and keep the bindings (NULL to disable and remove all bindings) */
+#define EXOSIP_OPT_SET_EVENT_LOOP (EXOSIP_OPT_BASE_OPTION+42) /**< struct eXosip_loop *: run the context in the threads of a loop created with eXosip_loop_new instead of its own thread (before eXosip_listen_addr) */
 
 #define EXOSIP_OPT_SET_TLS_VERIFY_CERTIFICATE (EXOSIP_OPT_BASE_OPTION+500) /**< int *: enable verification of certificate for TLS connection */
 #define EXOSIP_OPT_SET_TLS_CERTIFICATES_INFO (EXOSIP_OPT_BASE_OPTION+501) /**< eXosip_tls_ctx_t *: client and/or server certificate/ca-root/key info */
@@ -148,6 +191,7 @@ extern "C" {
 #define EXOSIP_OPT_SET_TSC_SERVER (EXOSIP_OPT_BASE_OPTION+1001) /**< void*: set the tsc tunnel handle */
 
 #define EXOSIP_OPT_GET_STATISTICS (EXOSIP_OPT_BASE_OPTION+2000) /**< struct eXosip_stats*: retreive numerous statistics about transactions, registrations, calls, publications and subscriptions... */
+#define EXOSIP_OPT_GET_REFRESH_PER_SECOND (EXOSIP_OPT_BASE_OPTION+2001) /**< int[EXOSIP_REFRESH_WINDOW]: automatic refreshes sent in each of the last seconds ([0] is the current second) */
 
  /**
   * structure used to for inserting a DNS cache entry and avoid DNS resolution.
@@ -158,6 +202,86 @@ extern "C" {
     char ip[256];
   };
 
+  /**
+   * structure used to configure the overload control.
+   * When one threshold is reached, new out of dialog requests are answered
+   * with 503 (or dropped) while in-dialog requests and responses are still
+   * processed. A threshold set to 0 is not checked.
+   * @struct eXosip_overload_control
+   */
+  struct eXosip_overload_control {
+    int max_events;               /**< number of events waiting to be read by eXosip_event_wait */
+    int max_server_transactions;  /**< number of IST and NIST transactions */
+    int max_loop_lag;             /**< delay (ms) of the eXosip_execute loop over its timers */
+    int retry_after;              /**< Retry-After value (seconds) in 503 answers, 0 for none */
+    int drop;                     /**< 1 to drop requests instead of answering 503 */
+  };
+
+  /**
+   * structure used to configure the rate limit of incoming messages
+   * per source ip address (token bucket).
+   * @struct eXosip_rate_limit
+   */
+  struct eXosip_rate_limit {
+    int rate;                     /**< messages per second accepted from one source (0 to disable) */
+    int burst;                    /**< messages accepted at once from one source */
+  };
+
+  /**
+   * structure used to configure the priority of incoming messages.
+   * Messages readable at once (up to batch) are parsed, then processed
+   * in this order: responses, ACK, CANCEL and BYE first, then other
+   * in-dialog requests, then new requests. Requests with the same Call-ID
+   * are processed in the order they were read. A waiting class is processed
+   * after starvation_limit messages of higher classes.
+   * @struct eXosip_inbound_priority
+   */
+  struct eXosip_inbound_priority {
+    int batch;                    /**< maximum number of messages read before processing (0 to disable) */
+    int starvation_limit;         /**< messages of higher classes processed before one of a waiting class (0 for none) */
+  };
+
+  /**
+   * structure used to configure the adaptive T1 of client transactions.
+   * RFC3261 only allows a T1 below 500ms within closed private networks.
+   * @struct eXosip_adaptive_t1
+   */
+  struct eXosip_adaptive_t1 {
+    int t1_min;                   /**< minimum value of T1 (ms), at least 1 */
+    int t1_max;                   /**< maximum value of T1 (ms), 0 to disable */
+  };
+
+  /**
+   * structure used to configure the health tracking of destinations.
+   * After max_failures consecutive failures (transaction timeouts,
+   * transport errors, ICMP errors, TCP resets) without any message
+   * received from a destination, new requests to it fail at once.
+   * After retry_interval seconds, one request at a time is sent as a
+   * probe until a message is received from the destination.
+   * Destinations are tracked by ip address (or host name) and port. ICMP
+   * errors are only received on UDP sockets opened after this option is set.
+   * @struct eXosip_peer_health
+   */
+  struct eXosip_peer_health {
+    int max_failures;             /**< consecutive failures before the destination is down (0 to disable) */
+    int retry_interval;           /**< seconds before a probe is sent to a destination down */
+  };
+
+#define EXOSIP_PEER_UP      0     /**< requests are sent to the destination */
+#define EXOSIP_PEER_DOWN    1     /**< new requests to the destination fail at once */
+#define EXOSIP_PEER_PROBING 2     /**< one request at a time is sent to the destination */
+
+  /**
+   * structure used to retrieve the messages dropped for one source
+   * ip address by the rate limit.
+   * @struct eXosip_source_stats
+   */
+  struct eXosip_source_stats {
+    char ip[65];                  /**< source ip address */
+    unsigned int received;        /**< number of messages received */
+    unsigned int dropped;         /**< number of messages dropped */
+  };
+
   struct eXosip_account_info {
     char proxy[1024];
     char nat_ip[256];
@@ -173,6 +297,8 @@ extern "C" {
   };
 
 #ifndef MINISIZE
+#define EXOSIP_REFRESH_WINDOW 60  /**< number of seconds returned by EXOSIP_OPT_GET_REFRESH_PER_SECOND */
+
   /**
    * Structure used to retrieve eXosip internal statistics.
    * Total numbers are provided since last start or restart of eXosip.
@@ -194,8 +320,14 @@ extern "C" {
     float average_subscriptions;    /**< average number of new outgoing subscriptions/hour. (default period: 1 hour) */
     int allocated_insubscriptions;     /**< current number of allocated incoming subscriptions. */
     float average_insubscriptions;  /**< average number of new incoming subscriptions/hour. (default period: 1 hour) */
-
-    int reserved1[20];               /**< reserved for future usage without breaking ABI */
+    int overload_rejected;             /**< number of requests answered with 503 by the overload control. */
+    int overload_dropped;              /**< number of requests dropped by the overload control. */
+    int rate_limited;                  /**< number of messages dropped by the rate limit per source. */
+    int peer_fast_failed;              /**< number of requests failed at once because the destination was down. */
+    int refreshes;                     /**< number of automatic refreshes of registrations, subscriptions and publications. */
+    int refresh_max_per_second;        /**< highest number of refreshes sent within one second over the last EXOSIP_REFRESH_WINDOW seconds. */
+
+    int reserved1[14];               /**< reserved for future usage without breaking ABI */
   };
 #endif
 
@@ -368,6 +500,53 @@ extern "C" {
  */
   int eXosip_set_cbsip_message (struct eXosip_t *excontext, CbSipCallback cbsipCallback);
 
+#ifdef WIN32
+  typedef int (__stdcall * CbSipStateless) (struct eXosip_t * excontext, osip_message_t * request, void *arg);
+#else
+  typedef int (*CbSipStateless) (struct eXosip_t * excontext, osip_message_t * request, void *arg);
+#endif
+
+/**
+ * Set a callback to answer out of dialog requests without a transaction.
+ *
+ * The callback is called for each new non-INVITE request (keepalive MESSAGE,
+ * OPTIONS...) which does not belong to a dialog. When it returns a status code
+ * (200 to 699), the answer is sent immediately and no transaction, dialog or
+ * event is created. When it returns 0, the request is processed as usual.
+ * Retransmissions of an answered request are answered again from a small
+ * cache, without calling the callback.
+ *
+ * The callback is called with the eXosip lock held: it must not call
+ * eXosip API.
+ *
+ * @param excontext    eXosip_t instance.
+ * @param cbsipStateless the callback (NULL to disable).
+ * @param arg          argument given to the callback.
+ */
+  int eXosip_set_cbsip_stateless (struct eXosip_t *excontext, CbSipStateless cbsipStateless, void *arg);
+
+/**
+ * Get the counters of the sources tracked by the rate limit.
+ * (see EXOSIP_OPT_SET_SOURCE_RATE_LIMIT)
+ *
+ * @param excontext    eXosip_t instance.
+ * @param stats        array to fill.
+ * @param size         number of elements in stats.
+ * @return the number of elements filled.
+ */
+  int eXosip_get_source_stats (struct eXosip_t *excontext, struct eXosip_source_stats *stats, int size);
+
+/**
+ * Get the health state of a destination.
+ * (see EXOSIP_OPT_SET_PEER_HEALTH)
+ *
+ * @param excontext    eXosip_t instance.
+ * @param host         ip address (or host name) of the destination.
+ * @param port         port of the destination.
+ * @return EXOSIP_PEER_UP, EXOSIP_PEER_DOWN or EXOSIP_PEER_PROBING.
+ */
+  int eXosip_get_peer_state (struct eXosip_t *excontext, const char *host, int port);
+
 /**
  * This method is used to replace contact address with
  * the public address of your NAT. The ip address should
@@ -167,6 +167,9 @@ extern "C" {
 
 /**
  * Generate random string:
+ * The string is made of base32 characters taken from a per thread
+ * cryptographic generator: up to 26 characters (128 bits) are written,
+ * less if buf_size is smaller. No lock is taken and nothing is allocated.
  *
  * @param buf	        destination buffer for random string.
  * @param buf_size      size of destination buffer
@@ -393,14 +396,52 @@ extern "C" {
  */
   eXosip_event_t *eXosip_event_wait (struct eXosip_t *excontext, int tv_s, int tv_ms);
 
+/**
+ * Wait for eXosip events and return up to max_events of them at once.
+ * 
+ * @param excontext    eXosip_t instance.
+ * @param events    array receiving the events (each one must be freed).
+ * @param max_events size of the array.
+ * @param tv_s      timeout value (seconds).
+ * @param tv_ms     timeout value (mseconds).
+ * @return number of events returned (0 on timeout) or a negative error.
+ */
+  int eXosip_event_wait_batch (struct eXosip_t *excontext, eXosip_event_t ** events, int max_events, int tv_s, int tv_ms);
+
+#ifdef WIN32
+  typedef void (__stdcall * CbSipEvent) (struct eXosip_t * excontext, eXosip_event_t * evt, void *arg);
+#else
+  typedef void (*CbSipEvent) (struct eXosip_t * excontext, eXosip_event_t * evt, void *arg);
+#endif
+
+/**
+ * Set a callback for one type of event.
+ *
+ * When worker threads are started (see EXOSIP_OPT_SET_EVENT_WORKERS),
+ * events of this type are given to the callback instead of being queued
+ * for eXosip_event_wait. Events of the same call, registration or
+ * subscription are always given to the same thread in order, while
+ * events of different calls run in parallel.
+ *
+ * The callback runs without the eXosip lock: it may call eXosip API
+ * (with eXosip_lock/eXosip_unlock as usual), except eXosip_set_option
+ * with EXOSIP_OPT_SET_EVENT_WORKERS and eXosip_quit, which wait for the
+ * workers to complete their queue. The event is freed by eXosip when
+ * the callback returns.
+ *
+ * @param excontext    eXosip_t instance.
+ * @param type         type of event, or -1 for all types without a callback.
+ * @param cbsipEvent   the callback (NULL to remove it).
+ * @param arg          argument given to the callback.
+ */
+  int eXosip_set_event_callback (struct eXosip_t *excontext, int type, CbSipEvent cbsipEvent, void *arg);
+
 
 /**
  * Wait for next eXosip event.
  * **DEPRECATED API**
  * This API will block - You should use eXosip_event_wait instead which is
  * more convenient.
- * limitation: This method will not process automatic 200ok retransmission
- * for INVITE transaction.
  *
  * @param excontext    eXosip_t instance.
  */
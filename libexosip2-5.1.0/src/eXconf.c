@@ -46,7 +46,11 @@
 
 #ifndef OSIP_MONOTHREAD
 static void *_eXosip_thread (void *arg);
+static int _eXosip_thread_start (struct eXosip_t *excontext);
+static void _eXosip_loop_detach (struct eXosip_t *excontext);
+static void _eXosip_execute_timeout (struct eXosip_t *excontext, struct timeval *lower_tv);
 #endif
+static void _eXosip_execute_steps (struct eXosip_t *excontext, struct timeval *expected);
 static void _eXosip_keep_alive (struct eXosip_t *excontext);
 
 const char *
@@ -62,6 +66,50 @@ eXosip_set_cbsip_message (struct eXosip_t *excontext, CbSipCallback cbsipCallbac
   return 0;
 }
 
+int
+eXosip_set_cbsip_stateless (struct eXosip_t *excontext, CbSipStateless cbsipStateless, void *arg)
+{
+  eXosip_lock (excontext);
+  excontext->cbsipStateless = cbsipStateless;
+  excontext->cbsipStatelessArg = arg;
+  if (cbsipStateless == NULL)
+    _eXosip_stateless_cache_flush (excontext);
+  eXosip_unlock (excontext);
+  return OSIP_SUCCESS;
+}
+
+int
+eXosip_get_source_stats (struct eXosip_t *excontext, struct eXosip_source_stats *stats, int size)
+{
+  int pos;
+  int count = 0;
+
+  eXosip_lock (excontext);
+  for (pos = 0; pos < EXOSIP_RATE_LIMIT_SETS * EXOSIP_RATE_LIMIT_WAYS && count < size; pos++) {
+    struct eXosip_source_bucket *bucket = &excontext->rate_limit_table[pos];
+
+    if (bucket->ip[0] == '\0')
+      continue;
+    osip_strncpy (stats[count].ip, bucket->ip, sizeof (stats[count].ip) - 1);
+    stats[count].received = bucket->received;
+    stats[count].dropped = bucket->dropped;
+    count++;
+  }
+  eXosip_unlock (excontext);
+  return count;
+}
+
+int
+eXosip_get_peer_state (struct eXosip_t *excontext, const char *host, int port)
+{
+  int state;
+
+  eXosip_lock (excontext);
+  state = _eXosip_peer_health_state (excontext, host, port);
+  eXosip_unlock (excontext);
+  return state;
+}
+
 void
 eXosip_masquerade_contact (struct eXosip_t *excontext, const char *public_address, int port)
 {
@@ -127,8 +175,10 @@ _eXosip_is_public_address (const char *c_address)
 void
 eXosip_set_user_agent (struct eXosip_t *excontext, const char *user_agent)
 {
+  _eXosip_config_wrlock (excontext);
   osip_free (excontext->user_agent);
   excontext->user_agent = osip_strdup (user_agent);
+  _eXosip_config_wrunlock (excontext);
 }
 
 static void
@@ -177,7 +227,9 @@ eXosip_quit (struct eXosip_t *excontext)
   eXosip_wakeup_event (excontext);
 
 #ifndef OSIP_MONOTHREAD
-  if (excontext->j_thread != NULL) {
+  if (excontext->loop_shard != NULL)
+    _eXosip_loop_detach (excontext);
+  else if (excontext->j_thread != NULL) {
     i = osip_thread_join ((struct osip_thread *) excontext->j_thread);
     if (i != 0) {
       OSIP_TRACE (osip_trace (__FILE__, __LINE__, OSIP_ERROR, NULL, "eXosip: can't terminate thread!\n"));
@@ -185,8 +237,13 @@ eXosip_quit (struct eXosip_t *excontext)
     osip_free ((struct osip_thread *) excontext->j_thread);
   }
 
+  /* the callbacks of queued events may still use the context */
+  _eXosip_event_workers_start (excontext, 0);
+
   jpipe_close (excontext->j_socketctl);
+  excontext->j_socketctl = NULL;
   jpipe_close (excontext->j_socketctl_event);
+  excontext->j_socketctl_event = NULL;
 #endif
 
   osip_free (excontext->user_agent);
@@ -210,6 +267,9 @@ eXosip_quit (struct eXosip_t *excontext)
 
 #ifndef OSIP_MONOTHREAD
   osip_mutex_destroy ((struct osip_mutex *) excontext->j_mutexlock);
+  osip_mutex_destroy ((struct osip_mutex *) excontext->route_cache_mutex);
+  osip_mutex_destroy ((struct osip_mutex *) excontext->config_readers_mutex);
+  osip_sem_destroy ((struct osip_sem *) excontext->config_writer_sem);
 #if !defined (_WIN32_WCE)
   osip_cond_destroy ((struct osip_cond *) excontext->j_cond);
 #endif
@@ -227,6 +287,11 @@ eXosip_quit (struct eXosip_t *excontext)
   }
 #endif
 
+  osip_free (excontext->j_deadlines);
+  excontext->j_deadlines = NULL;
+  excontext->j_deadlines_count = 0;
+  excontext->j_deadlines_size = 0;
+
   while (!osip_list_eol (&excontext->j_transactions, 0)) {
     osip_transaction_t *tr = (osip_transaction_t *) osip_list_get (&excontext->j_transactions, 0);
 
@@ -274,6 +339,15 @@ eXosip_quit (struct eXosip_t *excontext)
   if (excontext->eXtl_transport.tl_free != NULL)
     excontext->eXtl_transport.tl_free (excontext);
 
+  if (excontext->route_netlink_sock >= 0)
+    _eXosip_closesocket (excontext->route_netlink_sock);
+  if (excontext->route_cache != NULL)
+    osip_free (excontext->route_cache);
+  excontext->route_cache = NULL;
+  _eXosip_registrar_start (excontext, NULL);
+  _eXosip_stateless_cache_flush (excontext);
+  _eXosip_inbound_flush (excontext);
+
   _eXosip_counters_free (&excontext->average_transactions);
   _eXosip_counters_free (&excontext->average_registrations);
   _eXosip_counters_free (&excontext->average_calls);
@@ -319,13 +393,10 @@ eXosip_set_socket (struct eXosip_t *excontext, int transport, int socket, int po
     return OSIP_BADPARAMETER;
 
 #ifndef OSIP_MONOTHREAD
-  excontext->j_thread = (void *) osip_thread_create (20000, _eXosip_thread, excontext);
-  if (excontext->j_thread == NULL) {
-    OSIP_TRACE (osip_trace (__FILE__, __LINE__, OSIP_ERROR, NULL, "eXosip: Cannot start thread!\n"));
-    return OSIP_UNDEFINED_ERROR;
-  }
-#endif
+  return _eXosip_thread_start (excontext);
+#else
   return OSIP_SUCCESS;
+#endif
 }
 
 #ifdef IPV6_V6ONLY
@@ -615,16 +686,10 @@ eXosip_listen_addr (struct eXosip_t *excontext, int transport, const char *addr,
     snprintf (excontext->transport, sizeof (excontext->transport), "%s", "TLS");
 
 #ifndef OSIP_MONOTHREAD
-  if (excontext->j_thread == NULL) {
-    excontext->j_thread = (void *) osip_thread_create (20000, _eXosip_thread, excontext);
-    if (excontext->j_thread == NULL) {
-      OSIP_TRACE (osip_trace (__FILE__, __LINE__, OSIP_ERROR, NULL, "eXosip: Cannot start thread!\n"));
-      return OSIP_UNDEFINED_ERROR;
-    }
-  }
-#endif
-
+  return _eXosip_thread_start (excontext);
+#else
   return OSIP_SUCCESS;
+#endif
 }
 
 int
@@ -667,6 +732,8 @@ eXosip_init (struct eXosip_t *excontext)
   excontext->max_message_to_read = 1;
   excontext->dscp = 0x1A;
   excontext->implicit_subscription_expires = 60;
+  excontext->route_cache_ttl = 30;
+  excontext->route_netlink_sock = -1;
 
   snprintf (excontext->ipv4_for_gateway, 256, "%s", "217.12.3.11");
   snprintf (excontext->ipv6_for_gateway, 256, "%s", "2001:638:500:101:2e0:81ff:fe24:37c6");
@@ -714,6 +781,42 @@ eXosip_init (struct eXosip_t *excontext)
 #if !defined (_WIN32_WCE)
     osip_cond_destroy ((struct osip_cond *) excontext->j_cond);
     excontext->j_cond = NULL;
+#endif
+    return OSIP_NOMEM;
+  }
+
+  excontext->route_cache_mutex = (struct osip_mutex *) osip_mutex_init ();
+  if (excontext->route_cache_mutex == NULL) {
+    osip_free (excontext->user_agent);
+    excontext->user_agent = NULL;
+    osip_mutex_destroy ((struct osip_mutex *) excontext->j_mutexlock);
+    excontext->j_mutexlock = NULL;
+#if !defined (_WIN32_WCE)
+    osip_cond_destroy ((struct osip_cond *) excontext->j_cond);
+    excontext->j_cond = NULL;
+#endif
+    return OSIP_NOMEM;
+  }
+
+  excontext->config_readers_mutex = (struct osip_mutex *) osip_mutex_init ();
+  excontext->config_writer_sem = (struct osip_sem *) osip_sem_init (1);
+  excontext->config_readers = 0;
+  if (excontext->config_readers_mutex == NULL || excontext->config_writer_sem == NULL) {
+    osip_free (excontext->user_agent);
+    excontext->user_agent = NULL;
+    if (excontext->config_readers_mutex != NULL)
+      osip_mutex_destroy ((struct osip_mutex *) excontext->config_readers_mutex);
+    excontext->config_readers_mutex = NULL;
+    if (excontext->config_writer_sem != NULL)
+      osip_sem_destroy ((struct osip_sem *) excontext->config_writer_sem);
+    excontext->config_writer_sem = NULL;
+    osip_mutex_destroy ((struct osip_mutex *) excontext->route_cache_mutex);
+    excontext->route_cache_mutex = NULL;
+    osip_mutex_destroy ((struct osip_mutex *) excontext->j_mutexlock);
+    excontext->j_mutexlock = NULL;
+#if !defined (_WIN32_WCE)
+    osip_cond_destroy ((struct osip_cond *) excontext->j_cond);
+    excontext->j_cond = NULL;
 #endif
     return OSIP_NOMEM;
   }
@@ -764,44 +867,33 @@ eXosip_init (struct eXosip_t *excontext)
 }
 
 
-int
-eXosip_execute (struct eXosip_t *excontext)
-{
-  struct timeval lower_tv;
-  int i;
-
 #ifndef OSIP_MONOTHREAD
+/* delay until the timers of the context must run again */
+static void
+_eXosip_execute_timeout (struct eXosip_t *excontext, struct timeval *lower_tv)
+{
   if (excontext->max_read_timeout > 0) {
-    lower_tv.tv_sec = 0;
-    lower_tv.tv_usec = excontext->max_read_timeout;
+    lower_tv->tv_sec = 0;
+    lower_tv->tv_usec = excontext->max_read_timeout;
   }
   else {
-    osip_timers_gettimeout (excontext->j_osip, &lower_tv);
-    if (lower_tv.tv_sec > 10) {
-      eXosip_reg_t *jr;
+    osip_timers_gettimeout (excontext->j_osip, lower_tv);
+    if (lower_tv->tv_sec > 10) {
       time_t now;
 
       osip_compensatetime ();
 
       now = osip_getsystemtime (NULL);
 
-      lower_tv.tv_sec = 10;
+      lower_tv->tv_sec = 10;
 
+      /* next refresh or retry of a registration, subscription or publication */
       eXosip_lock (excontext);
-      for (jr = excontext->j_reg; jr != NULL; jr = jr->next) {
-        if (jr->r_id >= 1 && jr->r_last_tr != NULL) {
-          if (jr->r_reg_period == 0) {
-            /* skip refresh! */
-          }
-          else if (now - jr->r_last_tr->birth_time > jr->r_reg_period - (jr->r_reg_period / 10)) {
-            /* automatic refresh at "timeout - 10%" */
-            lower_tv.tv_sec = 1;
-          }
-        }
-      }
+      if (excontext->j_deadlines_count > 0 && excontext->j_deadlines[0].due - now < 10)
+        lower_tv->tv_sec = 1;
       eXosip_unlock (excontext);
 
-      if (lower_tv.tv_sec == 1) {
+      if (lower_tv->tv_sec == 1) {
         OSIP_TRACE (osip_trace (__FILE__, __LINE__, OSIP_INFO2, NULL, "eXosip: Reseting timer to 1s before waking up!\n"));
       }
       else {
@@ -810,37 +902,65 @@ eXosip_execute (struct eXosip_t *excontext)
     }
     else {
       /* add a small amount of time on windows to avoid waking up too early. (probably a bad time precision) */
-      if (lower_tv.tv_usec < 990000)
-        lower_tv.tv_usec += 10000;      /* add 10ms */
+      if (lower_tv->tv_usec < 990000)
+        lower_tv->tv_usec += 10000;     /* add 10ms */
       else {
-        lower_tv.tv_usec = 10000;       /* add 10ms */
-        lower_tv.tv_sec++;
+        lower_tv->tv_usec = 10000;      /* add 10ms */
+        lower_tv->tv_sec++;
       }
     }
 #if 0
-    OSIP_TRACE (osip_trace (__FILE__, __LINE__, OSIP_INFO2, NULL, "eXosip: timer sec:%i usec:%i!\n", lower_tv.tv_sec, lower_tv.tv_usec));
+    OSIP_TRACE (osip_trace (__FILE__, __LINE__, OSIP_INFO2, NULL, "eXosip: timer sec:%i usec:%i!\n", lower_tv->tv_sec, lower_tv->tv_usec));
 #endif
   }
-#else
-  lower_tv.tv_sec = 0;
-  lower_tv.tv_usec = 0;
+  if (excontext->lost200ok_timer > 0) {
+    /* the scan retransmits once the timer is over */
+    long int wait = (long int) (excontext->lost200ok_timer + 1 - osip_getsystemtime (NULL));
+
+    if (wait < 0)
+      wait = 0;
+    if (lower_tv->tv_sec >= wait) {
+      lower_tv->tv_sec = wait;
+      lower_tv->tv_usec = 0;
+    }
+  }
+}
 #endif
-  i = _eXosip_read_message (excontext, excontext->max_message_to_read, (int) lower_tv.tv_sec, (int) lower_tv.tv_usec);
 
-  if (i == -2000) {
-    return -2000;
-  }
+/* everything but the sockets: timers, transactions, refreshes... */
+static void
+_eXosip_execute_steps (struct eXosip_t *excontext, struct timeval *expected)
+{
+  struct timeval now;
+  int i;
 
+  /* the lock is released between each step: application threads waiting
+     for it do not have to wait for the complete loop. */
   eXosip_lock (excontext);
   osip_timers_ict_execute (excontext->j_osip);
   osip_timers_nict_execute (excontext->j_osip);
   osip_timers_ist_execute (excontext->j_osip);
   osip_timers_nist_execute (excontext->j_osip);
+  eXosip_unlock (excontext);
 
+  eXosip_lock (excontext);
   osip_nist_execute (excontext->j_osip);
+  eXosip_unlock (excontext);
+
+  eXosip_lock (excontext);
   osip_nict_execute (excontext->j_osip);
+  eXosip_unlock (excontext);
+
+  eXosip_lock (excontext);
   osip_ist_execute (excontext->j_osip);
+  eXosip_unlock (excontext);
+
+  eXosip_lock (excontext);
   osip_ict_execute (excontext->j_osip);
+  eXosip_unlock (excontext);
+
+  eXosip_lock (excontext);
+  excontext->lost200ok_timer = _eXosip_retransmit_lost200ok (excontext);
 
   /* free all Calls that are in the TERMINATED STATE? */
   _eXosip_release_terminated_calls (excontext);
@@ -850,7 +970,10 @@ eXosip_execute (struct eXosip_t *excontext)
   _eXosip_release_terminated_subscriptions (excontext);
   _eXosip_release_terminated_in_subscriptions (excontext);
 #endif
+  _eXosip_registrar_expire (excontext, osip_getsystemtime (NULL));
+  eXosip_unlock (excontext);
 
+  eXosip_lock (excontext);
   if (excontext->cbsipWakeLock != NULL && excontext->outgoing_wake_lock_state == 0) {
     int count = osip_list_size (&excontext->j_osip->osip_ict_transactions);
 
@@ -873,8 +996,44 @@ eXosip_execute (struct eXosip_t *excontext)
 
   _eXosip_keep_alive (excontext);
 
+  /* lag: time spent over the expected wake up time */
+  osip_gettimeofday (&now, NULL);
+  i = (int) ((now.tv_sec - expected->tv_sec) * 1000 + (now.tv_usec - expected->tv_usec) / 1000);
+  excontext->loop_lag = (i > 0) ? i : 0;
+
   eXosip_unlock (excontext);
 
+}
+
+int
+eXosip_execute (struct eXosip_t *excontext)
+{
+  struct timeval lower_tv;
+  struct timeval expected;
+  int i;
+
+#ifndef OSIP_MONOTHREAD
+  if (excontext->loop_shard != NULL)
+    return OSIP_WRONG_STATE;    /* run by the event loop */
+  _eXosip_execute_timeout (excontext, &lower_tv);
+#else
+  lower_tv.tv_sec = 0;
+  lower_tv.tv_usec = 0;
+#endif
+  osip_gettimeofday (&expected, NULL);
+  i = _eXosip_read_message (excontext, excontext->max_message_to_read, (int) lower_tv.tv_sec, (int) lower_tv.tv_usec);
+
+  if (i == -2000) {
+    return -2000;
+  }
+
+  expected.tv_sec += lower_tv.tv_sec;
+  expected.tv_usec += lower_tv.tv_usec;
+  if (expected.tv_usec >= 1000000) {
+    expected.tv_usec -= 1000000;
+    expected.tv_sec++;
+  }
+  _eXosip_execute_steps (excontext, &expected);
   return OSIP_SUCCESS;
 }
 
@@ -1034,17 +1193,21 @@ eXosip_set_option (struct eXosip_t *excontext, int opt, const void *value)
 
   case EXOSIP_OPT_SET_IPV4_FOR_GATEWAY:
     tmp = (char *) value;
+    _eXosip_config_wrlock (excontext);
     memset (excontext->ipv4_for_gateway, '\0', sizeof (excontext->ipv4_for_gateway));
     if (tmp != NULL && tmp[0] != '\0')
       osip_strncpy (excontext->ipv4_for_gateway, tmp, sizeof (excontext->ipv4_for_gateway) - 1);
+    _eXosip_config_wrunlock (excontext);
     OSIP_TRACE (osip_trace (__FILE__, __LINE__, OSIP_INFO1, NULL, "eXosip option set: ipv4_for_gateway:%s!\n", excontext->ipv4_for_gateway));
     break;
 #ifndef MINISIZE
   case EXOSIP_OPT_SET_IPV6_FOR_GATEWAY:
     tmp = (char *) value;
+    _eXosip_config_wrlock (excontext);
     memset (excontext->ipv6_for_gateway, '\0', sizeof (excontext->ipv6_for_gateway));
     if (tmp != NULL && tmp[0] != '\0')
       osip_strncpy (excontext->ipv6_for_gateway, tmp, sizeof (excontext->ipv6_for_gateway) - 1);
+    _eXosip_config_wrunlock (excontext);
     OSIP_TRACE (osip_trace (__FILE__, __LINE__, OSIP_INFO1, NULL, "eXosip option set: ipv6_for_gateway:%s!\n", excontext->ipv6_for_gateway));
     break;
 #endif
@@ -1060,9 +1223,11 @@ eXosip_set_option (struct eXosip_t *excontext, int opt, const void *value)
     break;
   case EXOSIP_OPT_SET_SIP_INSTANCE:
     tmp = (char *) value;
+    _eXosip_config_wrlock (excontext);
     memset (excontext->sip_instance, '\0', sizeof (excontext->sip_instance));
     if (tmp != NULL && tmp[0] != '\0')
       osip_strncpy (excontext->sip_instance, tmp, sizeof (excontext->sip_instance) - 1);
+    _eXosip_config_wrunlock (excontext);
     OSIP_TRACE (osip_trace (__FILE__, __LINE__, OSIP_INFO1, NULL, "eXosip option set: +sip.instance:%s!\n", excontext->sip_instance));
     break;
   case EXOSIP_OPT_SET_DEFAULT_CONTACT_DISPLAYNAME:
@@ -1076,6 +1241,90 @@ eXosip_set_option (struct eXosip_t *excontext, int opt, const void *value)
     val = *((int *) value);
     excontext->opt_sessiontimers_force = val;
     break;
+  case EXOSIP_OPT_SET_ROUTE_CACHE_TTL:
+    val = *((int *) value);
+    excontext->route_cache_ttl = (val < 0) ? 0 : val;
+    _eXosip_route_cache_flush (excontext);
+    break;
+  case EXOSIP_OPT_SET_OVERLOAD_CONTROL:
+    eXosip_lock (excontext);
+    if (value == NULL)
+      memset (&excontext->overload, 0, sizeof (struct eXosip_overload_control));
+    else
+      memcpy (&excontext->overload, value, sizeof (struct eXosip_overload_control));
+    eXosip_unlock (excontext);
+    break;
+  case EXOSIP_OPT_SET_SOURCE_RATE_LIMIT:
+    eXosip_lock (excontext);
+    if (value == NULL)
+      memset (&excontext->rate_limit, 0, sizeof (struct eXosip_rate_limit));
+    else
+      memcpy (&excontext->rate_limit, value, sizeof (struct eXosip_rate_limit));
+    if (excontext->rate_limit.burst < 1)
+      excontext->rate_limit.burst = 1;
+    memset (excontext->rate_limit_table, 0, sizeof (excontext->rate_limit_table));
+    eXosip_unlock (excontext);
+    break;
+  case EXOSIP_OPT_SET_INBOUND_PRIORITY:
+    eXosip_lock (excontext);
+    if (value == NULL)
+      memset (&excontext->inbound_priority, 0, sizeof (struct eXosip_inbound_priority));
+    else
+      memcpy (&excontext->inbound_priority, value, sizeof (struct eXosip_inbound_priority));
+    if (excontext->inbound_priority.batch < 0)
+      excontext->inbound_priority.batch = 0;
+    eXosip_unlock (excontext);
+    break;
+  case EXOSIP_OPT_SET_ADAPTIVE_T1:
+    {
+      const struct eXosip_adaptive_t1 *adaptive = (const struct eXosip_adaptive_t1 *) value;
+
+      if (adaptive == NULL)
+        return osip_set_adaptive_t1 (excontext->j_osip, 0, 0);
+      return osip_set_adaptive_t1 (excontext->j_osip, adaptive->t1_min, adaptive->t1_max);
+    }
+  case EXOSIP_OPT_SET_PEER_HEALTH:
+    eXosip_lock (excontext);
+    if (value == NULL)
+      memset (&excontext->peer_health, 0, sizeof (struct eXosip_peer_health));
+    else
+      memcpy (&excontext->peer_health, value, sizeof (struct eXosip_peer_health));
+    if (excontext->peer_health.retry_interval < 0)
+      excontext->peer_health.retry_interval = 0;
+    memset (excontext->peer_table, 0, sizeof (excontext->peer_table));
+    eXosip_unlock (excontext);
+    break;
+  case EXOSIP_OPT_SET_EVENT_WORKERS:
+#ifndef OSIP_MONOTHREAD
+    val = *((int *) value);
+    return _eXosip_event_workers_start (excontext, val);
+#else
+    return OSIP_WRONG_STATE;
+#endif
+  case EXOSIP_OPT_SET_EVENT_LOOP:
+#ifndef OSIP_MONOTHREAD
+    if (excontext->j_thread != NULL || excontext->loop_shard != NULL)
+      return OSIP_WRONG_STATE;
+    excontext->loop = (struct eXosip_loop *) value;
+    break;
+#else
+    return OSIP_WRONG_STATE;
+#endif
+  case EXOSIP_OPT_SET_REFRESH_JITTER:
+    val = *((int *) value);
+    if (val < 0 || val > 50)
+      return OSIP_BADPARAMETER;
+    eXosip_lock (excontext);
+    excontext->refresh_jitter = val;
+    _eXosip_deadline_reset (excontext, osip_getsystemtime (NULL));
+    eXosip_unlock (excontext);
+    _eXosip_wakeup (excontext);
+    break;
+  case EXOSIP_OPT_SET_REGISTRAR:
+    eXosip_lock (excontext);
+    val = _eXosip_registrar_start (excontext, (const struct eXosip_registrar *) value);
+    eXosip_unlock (excontext);
+    return val;
   case EXOSIP_OPT_SET_DSCP:
     val = *((int *) value);
     /* 0x1A by default */
@@ -1089,11 +1338,13 @@ eXosip_set_option (struct eXosip_t *excontext, int opt, const void *value)
     {
       const char *user_agent = (const char *) value;
 
+      _eXosip_config_wrlock (excontext);
       osip_free (excontext->user_agent);
       if (user_agent == NULL || user_agent[0] == '\0')
         excontext->user_agent = osip_strdup ("eXosip/" EXOSIP_VERSION);
       else
         excontext->user_agent = osip_strdup (user_agent);
+      _eXosip_config_wrunlock (excontext);
     }
     break;
   case EXOSIP_OPT_ENABLE_DNS_CACHE:
@@ -1147,9 +1398,11 @@ eXosip_set_option (struct eXosip_t *excontext, int opt, const void *value)
     break;
   case EXOSIP_OPT_SET_OC_LOCAL_ADDRESS:
     tmp = (char *) value;
+    _eXosip_config_wrlock (excontext);
     memset (excontext->oc_local_address, '\0', sizeof (excontext->oc_local_address));
     if (tmp != NULL && tmp[0] != '\0')
       osip_strncpy (excontext->oc_local_address, tmp, sizeof (excontext->oc_local_address) - 1);
+    _eXosip_config_wrunlock (excontext);
     OSIP_TRACE (osip_trace (__FILE__, __LINE__, OSIP_INFO1, NULL, "eXosip option set: oc_local_address:%s!\n", excontext->oc_local_address));
     break;
   case EXOSIP_OPT_SET_OC_PORT_RANGE:
@@ -1188,8 +1441,25 @@ eXosip_set_option (struct eXosip_t *excontext, int opt, const void *value)
       excontext->statistics.average_publications = excontext->average_publications.current_average;
       excontext->statistics.average_subscriptions = excontext->average_subscriptions.current_average;
       excontext->statistics.average_insubscriptions = excontext->average_insubscriptions.current_average;
+      {
+        int refresh_per_second[EXOSIP_REFRESH_WINDOW];
+        int i;
+
+        _eXosip_refresh_window_get (excontext, refresh_per_second);
+        excontext->statistics.refresh_max_per_second = 0;
+        for (i = 0; i < EXOSIP_REFRESH_WINDOW; i++) {
+          if (refresh_per_second[i] > excontext->statistics.refresh_max_per_second)
+            excontext->statistics.refresh_max_per_second = refresh_per_second[i];
+        }
+      }
       memcpy (stats, &excontext->statistics, sizeof (struct eXosip_stats));
     }
+    break;
+  case EXOSIP_OPT_GET_REFRESH_PER_SECOND:
+    if (value == NULL)
+      return OSIP_BADPARAMETER;
+    _eXosip_refresh_window_get (excontext, (int *) value);
+    break;
   default:
     return OSIP_BADPARAMETER;
   }
@@ -1259,7 +1529,277 @@ _eXosip_thread (void *arg)
   return NULL;
 }
 
+/* one select for the sockets of all the contexts of the thread: a
+   context is run when a message was received, when it was woken up or
+   when its timers are due. */
+static void *
+_eXosip_loop_thread (void *arg)
+{
+  struct eXosip_loop_shard *shard = (struct eXosip_loop_shard *) arg;
+  int wakeup_socket = jpipe_get_read_descr (shard->wakeup);
+
+  osip_mutex_lock ((struct osip_mutex *) shard->mutex);
+  while (shard->stop == 0) {
+    struct eXosip_t *excontext;
+    fd_set osip_fdset;
+    fd_set osip_wrset;
+    struct timeval now;
+    struct timeval tv;
+    int max = wakeup_socket;
+    int i;
+
+    FD_ZERO (&osip_fdset);
+    FD_ZERO (&osip_wrset);
+    eXFD_SET (wakeup_socket, &osip_fdset);
+    tv.tv_sec = 10;
+    tv.tv_usec = 0;
+    osip_gettimeofday (&now, NULL);
+    for (excontext = shard->contexts; excontext != NULL; excontext = excontext->loop_next) {
+      struct timeval wait;
+      int fd_max = -1;
+
+      if (excontext->j_stop_ua != 0)
+        continue;
+      /* a socket above FD_SETSIZE (a connection opened after the context
+         was attached) is not set: the sockets of the context are not read
+         until it is closed, only its timers are run */
+      excontext->eXtl_transport.tl_set_fdset (excontext, &osip_fdset, &osip_wrset, &fd_max);
+      if (!eXFD_VALID (fd_max) && fd_max >= 0 && eXFD_VALID (excontext->loop_fd_max))
+        OSIP_TRACE (osip_trace (__FILE__, __LINE__, OSIP_ERROR, NULL, "eXosip: socket %i above FD_SETSIZE: not read by the event loop\n", fd_max));
+      excontext->loop_fd_max = fd_max;
+      if (eXFD_VALID (fd_max) && fd_max > max)
+        max = fd_max;
+      wait.tv_sec = excontext->loop_due.tv_sec - now.tv_sec;
+      wait.tv_usec = excontext->loop_due.tv_usec - now.tv_usec;
+      if (wait.tv_usec < 0) {
+        wait.tv_usec += 1000000;
+        wait.tv_sec--;
+      }
+      if (wait.tv_sec < 0) {
+        wait.tv_sec = 0;
+        wait.tv_usec = 0;
+      }
+      if (osip_timercmp (&wait, &tv, <))
+        tv = wait;
+    }
+    osip_mutex_unlock ((struct osip_mutex *) shard->mutex);
+
+    i = select (max + 1, &osip_fdset, &osip_wrset, NULL, &tv);
+    if (i > 0 && FD_ISSET (wakeup_socket, &osip_fdset)) {
+      char buf2[500];
+
+      jpipe_read (shard->wakeup, buf2, 499);
+    }
+    osip_compensatetime ();
+
+    /* i<0: interrupted, or a socket of a context which left was closed:
+       only the timers are run */
+    osip_mutex_lock ((struct osip_mutex *) shard->mutex);
+    osip_gettimeofday (&now, NULL);
+    for (excontext = shard->contexts; excontext != NULL; excontext = excontext->loop_next) {
+      struct timeval lower_tv;
+
+      if (excontext->j_stop_ua != 0)
+        continue;
+      if (i > 0 && eXFD_VALID (excontext->loop_fd_max))
+        _eXosip_read_sockets (excontext, &osip_fdset, &osip_wrset);
+      if (excontext->loop_wakeup == 0 && excontext->loop_activity == 0 && osip_timercmp (&now, &excontext->loop_due, <))
+        continue;
+
+      excontext->loop_wakeup = 0;
+      excontext->loop_activity = 0;
+      _eXosip_execute_steps (excontext, &excontext->loop_due);
+
+      _eXosip_execute_timeout (excontext, &lower_tv);
+      osip_gettimeofday (&excontext->loop_due, NULL);
+      excontext->loop_due.tv_sec += lower_tv.tv_sec;
+      excontext->loop_due.tv_usec += lower_tv.tv_usec;
+      if (excontext->loop_due.tv_usec >= 1000000) {
+        excontext->loop_due.tv_usec -= 1000000;
+        excontext->loop_due.tv_sec++;
+      }
+    }
+  }
+  osip_mutex_unlock ((struct osip_mutex *) shard->mutex);
+  return NULL;
+}
+
+/* start the thread of the context, or give it to a thread of its loop */
+static int
+_eXosip_thread_start (struct eXosip_t *excontext)
+{
+  struct eXosip_loop_shard *shard;
+  int pos;
+
+  if (excontext->j_thread != NULL || excontext->loop_shard != NULL)
+    return OSIP_SUCCESS;
+
+  /* the sockets of a tunnel are not selected by the loop */
+  if (excontext->loop == NULL || excontext->tunnel_handle != NULL) {
+    excontext->j_thread = (void *) osip_thread_create (20000, _eXosip_thread, excontext);
+    if (excontext->j_thread == NULL) {
+      OSIP_TRACE (osip_trace (__FILE__, __LINE__, OSIP_ERROR, NULL, "eXosip: Cannot start thread!\n"));
+      return OSIP_UNDEFINED_ERROR;
+    }
+    return OSIP_SUCCESS;
+  }
+
+  /* the loop selects the sockets of the context: refuse a descriptor
+     which does not fit in a fd_set */
+  {
+    fd_set osip_fdset;
+    fd_set osip_wrset;
+    int fd_max = -1;
+
+    FD_ZERO (&osip_fdset);
+    FD_ZERO (&osip_wrset);
+    excontext->eXtl_transport.tl_set_fdset (excontext, &osip_fdset, &osip_wrset, &fd_max);
+    if (fd_max >= 0 && !eXFD_VALID (fd_max)) {
+      OSIP_TRACE (osip_trace (__FILE__, __LINE__, OSIP_ERROR, NULL, "eXosip: socket %i above FD_SETSIZE: cannot use the event loop\n", fd_max));
+      return OSIP_UNDEFINED_ERROR;
+    }
+    excontext->loop_fd_max = fd_max;
+  }
+
+  /* least loaded thread: the count is read without lock, only a hint */
+  shard = &excontext->loop->shards[0];
+  for (pos = 1; pos < excontext->loop->count; pos++) {
+    if (excontext->loop->shards[pos].count < shard->count)
+      shard = &excontext->loop->shards[pos];
+  }
+
+  osip_mutex_lock ((struct osip_mutex *) shard->mutex);
+  osip_gettimeofday (&excontext->loop_due, NULL);
+  excontext->loop_next = shard->contexts;
+  shard->contexts = excontext;
+  shard->count++;
+  excontext->loop_shard = shard;
+  /* _eXosip_wakeup now uses the socket of the loop */
+  jpipe_close (excontext->j_socketctl);
+  excontext->j_socketctl = NULL;
+  osip_mutex_unlock ((struct osip_mutex *) shard->mutex);
+
+  jpipe_write (shard->wakeup, "w", 1);
+  return OSIP_SUCCESS;
+}
+
+static void
+_eXosip_loop_detach (struct eXosip_t *excontext)
+{
+  struct eXosip_loop_shard *shard = excontext->loop_shard;
+  struct eXosip_t **prev;
+
+  /* once the lock is obtained, the thread does not run the context */
+  osip_mutex_lock ((struct osip_mutex *) shard->mutex);
+  for (prev = &shard->contexts; *prev != NULL; prev = &(*prev)->loop_next) {
+    if (*prev == excontext) {
+      *prev = excontext->loop_next;
+      shard->count--;
+      break;
+    }
+  }
+  excontext->loop_next = NULL;
+  /* later wakeups of the context (rest of eXosip_quit) must not use the loop */
+  excontext->loop_shard = NULL;
+  excontext->loop = NULL;
+  osip_mutex_unlock ((struct osip_mutex *) shard->mutex);
+
+  /* select may still wait on the sockets of the context */
+  jpipe_write (shard->wakeup, "w", 1);
+}
+
+#endif
+
+int
+eXosip_loop_new (struct eXosip_loop **loop, int threads)
+{
+#ifndef OSIP_MONOTHREAD
+  struct eXosip_loop *ptr;
+  int pos;
+
+  if (loop == NULL)
+    return OSIP_BADPARAMETER;
+  *loop = NULL;
+  if (threads <= 0)
+    return OSIP_BADPARAMETER;
+
+  ptr = (struct eXosip_loop *) osip_malloc (sizeof (struct eXosip_loop));
+  if (ptr == NULL)
+    return OSIP_NOMEM;
+  memset (ptr, 0, sizeof (struct eXosip_loop));
+  ptr->shards = (struct eXosip_loop_shard *) osip_malloc (sizeof (struct eXosip_loop_shard) * threads);
+  if (ptr->shards == NULL) {
+    osip_free (ptr);
+    return OSIP_NOMEM;
+  }
+  memset (ptr->shards, 0, sizeof (struct eXosip_loop_shard) * threads);
+  ptr->count = threads;
+
+  for (pos = 0; pos < threads; pos++) {
+    struct eXosip_loop_shard *shard = &ptr->shards[pos];
+
+    shard->mutex = (void *) osip_mutex_init ();
+    if (shard->mutex == NULL)
+      break;
+    shard->wakeup = jpipe ();
+    if (shard->wakeup == NULL || !eXFD_VALID (jpipe_get_read_descr (shard->wakeup)))
+      break;
+    shard->thread = (void *) osip_thread_create (20000, _eXosip_loop_thread, shard);
+    if (shard->thread == NULL)
+      break;
+  }
+  if (pos < threads) {
+    OSIP_TRACE (osip_trace (__FILE__, __LINE__, OSIP_ERROR, NULL, "eXosip: Cannot start event loop!\n"));
+    eXosip_loop_free (ptr);
+    return OSIP_UNDEFINED_ERROR;
+  }
+
+  *loop = ptr;
+  return OSIP_SUCCESS;
+#else
+  return OSIP_WRONG_STATE;
+#endif
+}
+
+int
+eXosip_loop_free (struct eXosip_loop *loop)
+{
+#ifndef OSIP_MONOTHREAD
+  int pos;
+
+  if (loop == NULL)
+    return OSIP_BADPARAMETER;
+
+  for (pos = 0; pos < loop->count; pos++) {
+    if (loop->shards[pos].count > 0) {
+      OSIP_TRACE (osip_trace (__FILE__, __LINE__, OSIP_ERROR, NULL, "eXosip: event loop still used by %i contexts\n", loop->shards[pos].count));
+      return OSIP_WRONG_STATE;
+    }
+  }
+
+  for (pos = 0; pos < loop->count; pos++) {
+    struct eXosip_loop_shard *shard = &loop->shards[pos];
+
+    if (shard->thread != NULL) {
+      osip_mutex_lock ((struct osip_mutex *) shard->mutex);
+      shard->stop = 1;
+      osip_mutex_unlock ((struct osip_mutex *) shard->mutex);
+      jpipe_write (shard->wakeup, "w", 1);
+      osip_thread_join ((struct osip_thread *) shard->thread);
+      osip_free (shard->thread);
+    }
+    if (shard->wakeup != NULL)
+      jpipe_close (shard->wakeup);
+    if (shard->mutex != NULL)
+      osip_mutex_destroy ((struct osip_mutex *) shard->mutex);
+  }
+  osip_free (loop->shards);
+  osip_free (loop);
+  return OSIP_SUCCESS;
+#else
+  return OSIP_WRONG_STATE;
 #endif
+}
 
 #ifndef MINISIZE
 
@@ -177,3 +177,123 @@ eXosip_message_send_answer (struct eXosip_t *excontext, int tid, int status, osi
   _eXosip_wakeup (excontext);
   return OSIP_SUCCESS;
 }
+
+struct eXosip_request_template {
+  osip_message_t *request;      /* copied for each request */
+  int cseq;
+};
+
+int
+eXosip_request_template_new (struct eXosip_t *excontext, struct eXosip_request_template **tpl, const char *method, const char *to, const char *from, const char *route)
+{
+  struct eXosip_request_template *t;
+  int i;
+
+  *tpl = NULL;
+  t = (struct eXosip_request_template *) osip_malloc (sizeof (struct eXosip_request_template));
+  if (t == NULL)
+    return OSIP_NOMEM;
+  memset (t, 0, sizeof (struct eXosip_request_template));
+
+  i = eXosip_message_build_request (excontext, &t->request, method, to, from, route);
+  if (i != 0) {
+    osip_free (t);
+    return i;
+  }
+  t->cseq = osip_atoi (t->request->cseq->number);
+  *tpl = t;
+  return OSIP_SUCCESS;
+}
+
+int
+eXosip_request_template_set_header (struct eXosip_request_template *tpl, const char *hname, const char *hvalue)
+{
+  if (tpl == NULL || hname == NULL)
+    return OSIP_BADPARAMETER;
+  return osip_message_set_header (tpl->request, hname, hvalue);
+}
+
+/* replace the value of a parameter */
+static int
+_eXosip_request_template_param (osip_generic_param_t * param, char *value)
+{
+  if (value == NULL)
+    return OSIP_NOMEM;
+  if (param == NULL) {
+    osip_free (value);
+    return OSIP_SYNTAXERROR;
+  }
+  osip_free (param->gvalue);
+  param->gvalue = value;
+  return OSIP_SUCCESS;
+}
+
+int
+eXosip_request_template_build (struct eXosip_t *excontext, struct eXosip_request_template *tpl, osip_message_t ** message, const char *content_type, const char *body, size_t length)
+{
+  osip_message_t *request;
+  osip_generic_param_t *tag = NULL;
+  osip_generic_param_t *br = NULL;
+  osip_via_t *via;
+  char *value;
+  int i;
+
+  *message = NULL;
+  if (tpl == NULL)
+    return OSIP_BADPARAMETER;
+  if (excontext->eXtl_transport.enabled <= 0)
+    return OSIP_NO_NETWORK;
+
+  i = osip_message_clone (tpl->request, &request);
+  if (i != 0)
+    return i;
+
+  osip_free (request->call_id->number);
+  request->call_id->number = _eXosip_malloc_new_random ();
+
+  osip_from_get_tag (request->from, &tag);
+  i = _eXosip_request_template_param (tag, _eXosip_malloc_new_random ());
+
+  via = (osip_via_t *) osip_list_get (&request->vias, 0);
+  if (i == 0 && via != NULL) {
+    osip_via_param_get_byname (via, "branch", &br);
+    i = _eXosip_request_template_param (br, _eXosip_malloc_new_branch ());
+  }
+
+  if (i == 0) {
+    value = (char *) osip_malloc (11 + 1);
+    if (value != NULL) {
+      tpl->cseq++;
+      snprintf (value, 11 + 1, "%i", tpl->cseq);
+      osip_free (request->cseq->number);
+      request->cseq->number = value;
+    }
+    else
+      i = OSIP_NOMEM;
+  }
+
+  if (i == 0 && request->call_id->number == NULL)
+    i = OSIP_NOMEM;
+  if (i == 0 && body != NULL) {
+    i = osip_message_set_body (request, body, length);
+    if (i == 0 && content_type != NULL)
+      i = osip_message_set_content_type (request, content_type);
+  }
+  if (i != 0) {
+    osip_message_free (request);
+    return i;
+  }
+
+  osip_message_force_update (request);
+  *message = request;
+  return OSIP_SUCCESS;
+}
+
+void
+eXosip_request_template_free (struct eXosip_request_template *tpl)
+{
+  if (tpl == NULL)
+    return;
+  osip_message_free (tpl->request);
+  osip_free (tpl);
+}
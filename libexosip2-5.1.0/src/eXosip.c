@@ -51,11 +51,23 @@
 
 /* Private functions */
 static jauthinfo_t *eXosip_find_authentication_info (struct eXosip_t *excontext, const char *username, const char *realm);
+static int _eXosip_remove_authentication_info (struct eXosip_t *excontext, const char *username, const char *realm);
+static int _eXosip_add_authentication_information_locked (struct eXosip_t *excontext, osip_message_t * req, osip_message_t * last_response);
 
 void
 _eXosip_wakeup (struct eXosip_t *excontext)
 {
 #ifndef OSIP_MONOTHREAD
+  struct eXosip_loop_shard *shard = excontext->loop_shard;
+
+  if (shard != NULL) {
+    /* one write is enough until the loop runs the context */
+    if (excontext->loop_wakeup == 0) {
+      excontext->loop_wakeup = 1;
+      jpipe_write (shard->wakeup, "w", 1);
+    }
+    return;
+  }
   jpipe_write (excontext->j_socketctl, "w", 1);
 #endif
 }
@@ -88,6 +100,58 @@ eXosip_unlock (struct eXosip_t *excontext)
 #endif
 }
 
+/* reader preference lock on the configuration (user agent, gateways,
+   sip instance, local address, credentials): readers only block each
+   other while a setter copies a new value in. */
+void
+_eXosip_config_rdlock (struct eXosip_t *excontext)
+{
+#ifndef OSIP_MONOTHREAD
+  osip_mutex_lock ((struct osip_mutex *) excontext->config_readers_mutex);
+  excontext->config_readers++;
+  if (excontext->config_readers == 1)
+    osip_sem_wait ((struct osip_sem *) excontext->config_writer_sem);
+  osip_mutex_unlock ((struct osip_mutex *) excontext->config_readers_mutex);
+#endif
+}
+
+void
+_eXosip_config_rdunlock (struct eXosip_t *excontext)
+{
+#ifndef OSIP_MONOTHREAD
+  osip_mutex_lock ((struct osip_mutex *) excontext->config_readers_mutex);
+  excontext->config_readers--;
+  if (excontext->config_readers == 0)
+    osip_sem_post ((struct osip_sem *) excontext->config_writer_sem);
+  osip_mutex_unlock ((struct osip_mutex *) excontext->config_readers_mutex);
+#endif
+}
+
+/* copy a configuration string set with eXosip_set_option */
+void
+_eXosip_config_get (struct eXosip_t *excontext, const char *value, char *buf, size_t size)
+{
+  _eXosip_config_rdlock (excontext);
+  osip_strncpy (buf, value, size - 1);
+  _eXosip_config_rdunlock (excontext);
+}
+
+void
+_eXosip_config_wrlock (struct eXosip_t *excontext)
+{
+#ifndef OSIP_MONOTHREAD
+  osip_sem_wait ((struct osip_sem *) excontext->config_writer_sem);
+#endif
+}
+
+void
+_eXosip_config_wrunlock (struct eXosip_t *excontext)
+{
+#ifndef OSIP_MONOTHREAD
+  osip_sem_post ((struct osip_sem *) excontext->config_writer_sem);
+#endif
+}
+
 int
 _eXosip_transaction_init (struct eXosip_t *excontext, osip_transaction_t ** transaction, osip_fsm_type_t ctx_type, osip_t * osip, osip_message_t * message)
 {
@@ -123,10 +187,158 @@ _eXosip_transaction_init (struct eXosip_t *excontext, osip_transaction_t ** tran
   return OSIP_SUCCESS;
 }
 
+void
+_eXosip_wire_cache_free (osip_transaction_t * tr)
+{
+  struct eXosip_wire_cache *cache = (struct eXosip_wire_cache *) osip_transaction_get_reserved6 (tr);
+
+  if (cache == NULL)
+    return;
+  osip_free (cache->host);
+  osip_free (cache);
+  osip_transaction_set_reserved6 (tr, NULL);
+}
+
+/* Health of the destinations: a destination is down after max_failures
+   consecutive failures without any message received from it. New
+   requests to a destination down fail at once; after retry_interval
+   seconds, one request at a time is sent as a probe. Only destinations
+   with failures are kept in the table, by host and port: several
+   servers may share one address. eXosip_lock must be held. */
+
+static struct eXosip_peer_state *
+_eXosip_peer_health_find (struct eXosip_t *excontext, const char *host, int port, int create)
+{
+  struct eXosip_peer_state *set;
+  struct eXosip_peer_state *lru;
+  unsigned int hash = 2166136261U;
+  const char *p;
+  int way;
+
+  for (p = host; *p != '\0'; p++)
+    hash = (hash ^ (unsigned char) *p) * 16777619U;
+  hash = (hash ^ (unsigned int) port) * 16777619U;
+
+  set = &excontext->peer_table[(hash % EXOSIP_PEER_HEALTH_SETS) * EXOSIP_PEER_HEALTH_WAYS];
+  lru = set;
+  for (way = 0; way < EXOSIP_PEER_HEALTH_WAYS; way++) {
+    if (set[way].host[0] != '\0' && set[way].hash == hash && set[way].port == port && osip_strcasecmp (set[way].host, host) == 0)
+      return &set[way];
+    if (lru->host[0] != '\0' && (set[way].host[0] == '\0' || set[way].last < lru->last))
+      lru = &set[way];
+  }
+  if (create == 0)
+    return NULL;
+
+  memset (lru, 0, sizeof (struct eXosip_peer_state));
+  osip_strncpy (lru->host, host, sizeof (lru->host) - 1);
+  lru->port = port;
+  lru->hash = hash;
+  lru->state = EXOSIP_PEER_UP;
+  return lru;
+}
+
+/* return OSIP_SUCCESS when a new request (transaction tid) can be sent */
+int
+_eXosip_peer_health_check (struct eXosip_t *excontext, const char *host, int port, int tid)
+{
+  struct eXosip_peer_state *peer;
+  time_t now;
+
+  if (excontext->peer_health.max_failures <= 0 || host == NULL)
+    return OSIP_SUCCESS;
+  peer = _eXosip_peer_health_find (excontext, host, port, 0);
+  if (peer == NULL || peer->state == EXOSIP_PEER_UP)
+    return OSIP_SUCCESS;
+
+  now = osip_getsystemtime (NULL);
+  peer->last = now;
+  if (peer->state == EXOSIP_PEER_DOWN && now - peer->down_time >= excontext->peer_health.retry_interval) {
+    peer->state = EXOSIP_PEER_PROBING;
+    peer->probe_tid = 0;
+  }
+  /* a probe without answer after timer F is replaced */
+  if (peer->state == EXOSIP_PEER_PROBING && (peer->probe_tid == 0 || now - peer->probe_time > 64 * DEFAULT_T1 / 1000)) {
+    OSIP_TRACE (osip_trace (__FILE__, __LINE__, OSIP_INFO1, NULL, "eXosip: %s:%i is down, probe with transaction %i\n", host, port, tid));
+    peer->probe_tid = tid;
+    peer->probe_time = now;
+    return OSIP_SUCCESS;
+  }
+
+  OSIP_TRACE (osip_trace (__FILE__, __LINE__, OSIP_INFO1, NULL, "eXosip: %s:%i is down, transaction %i failed at once\n", host, port, tid));
+#ifndef MINISIZE
+  excontext->statistics.peer_fast_failed++;
+#endif
+  return OSIP_NO_NETWORK;
+}
+
+/* tid is 0 when the failure is not related to a transaction (ICMP, TCP reset) */
+void
+_eXosip_peer_health_failure (struct eXosip_t *excontext, const char *host, int port, int tid)
+{
+  struct eXosip_peer_state *peer;
+  time_t now;
+
+  if (excontext->peer_health.max_failures <= 0 || host == NULL || host[0] == '\0')
+    return;
+  peer = _eXosip_peer_health_find (excontext, host, port, 1);
+  now = osip_getsystemtime (NULL);
+  peer->last = now;
+
+  if (peer->state == EXOSIP_PEER_DOWN)
+    return;                     /* requests failed at once */
+  if (peer->state == EXOSIP_PEER_PROBING) {
+    if (tid != 0 && tid != peer->probe_tid)
+      return;
+  }
+  else {
+    peer->failures++;
+    if (peer->failures < excontext->peer_health.max_failures)
+      return;
+  }
+
+  OSIP_TRACE (osip_trace (__FILE__, __LINE__, OSIP_WARNING, NULL, "eXosip: %s:%i is down (%i failures)\n", host, port, peer->failures));
+  peer->state = EXOSIP_PEER_DOWN;
+  peer->down_time = now;
+  peer->probe_tid = 0;
+}
+
+void
+_eXosip_peer_health_alive (struct eXosip_t *excontext, const char *host, int port)
+{
+  struct eXosip_peer_state *peer;
+
+  if (excontext->peer_health.max_failures <= 0 || host == NULL)
+    return;
+  peer = _eXosip_peer_health_find (excontext, host, port, 0);
+  if (peer == NULL)
+    return;
+  if (peer->state != EXOSIP_PEER_UP)
+    OSIP_TRACE (osip_trace (__FILE__, __LINE__, OSIP_WARNING, NULL, "eXosip: %s:%i is up\n", host, port));
+  peer->state = EXOSIP_PEER_UP;
+  peer->failures = 0;
+  peer->probe_tid = 0;
+  peer->last = osip_getsystemtime (NULL);
+}
+
+int
+_eXosip_peer_health_state (struct eXosip_t *excontext, const char *host, int port)
+{
+  struct eXosip_peer_state *peer;
+
+  if (host == NULL)
+    return EXOSIP_PEER_UP;
+  peer = _eXosip_peer_health_find (excontext, host, port, 0);
+  if (peer == NULL)
+    return EXOSIP_PEER_UP;
+  return peer->state;
+}
+
 void
 _eXosip_transaction_free (struct eXosip_t *excontext, osip_transaction_t * transaction)
 {
   _eXosip_delete_reserved (transaction);
+  _eXosip_wire_cache_free (transaction);
   eXosip_dnsutils_release (transaction->naptr_record);
   transaction->naptr_record = NULL;
   osip_transaction_free (transaction);
@@ -509,7 +721,9 @@ _eXosip_retry_publish_with_auth (struct eXosip_t *excontext, eXosip_event_t * je
     return i;
   }
 
-  return _eXosip_retry_with_auth (excontext, NULL, &jp->p_last_tr, NULL);
+  i = _eXosip_retry_with_auth (excontext, NULL, &jp->p_last_tr, NULL);
+  _eXosip_deadline_set (excontext, EXOSIP_DEADLINE_PUBLISH, jp, osip_getsystemtime (NULL));
+  return i;
 }
 
 static int
@@ -612,12 +826,14 @@ eXosip_default_action (struct eXosip_t *excontext, eXosip_event_t * je)
 
 #endif
 
-void
+/* returns the time of the next retransmission, 0 if no 2xx is pending */
+time_t
 _eXosip_retransmit_lost200ok (struct eXosip_t *excontext)
 {
   eXosip_call_t *jc;
   eXosip_dialog_t *jd;
   time_t now;
+  time_t next = 0;
 
   now = osip_getsystemtime (NULL);
 
@@ -651,11 +867,477 @@ _eXosip_retransmit_lost200ok (struct eXosip_t *excontext)
             /* TU retransmission */
             _eXosip_snd_message (excontext, NULL, jd->d_200Ok, NULL, 0, -1);
           }
+          if (jd->d_200Ok != NULL && (next == 0 || jd->d_timer < next))
+            next = jd->d_timer;
         }
       }
     }
   }
-  return;
+  return next;
+}
+
+static int *
+_eXosip_deadline_pos (int type, void *object)
+{
+  if (type == EXOSIP_DEADLINE_REGISTER)
+    return &((eXosip_reg_t *) object)->r_deadline;
+#ifndef MINISIZE
+  if (type == EXOSIP_DEADLINE_SUBSCRIBE)
+    return &((eXosip_subscribe_t *) object)->s_deadline;
+  if (type == EXOSIP_DEADLINE_PUBLISH)
+    return &((eXosip_pub_t *) object)->p_deadline;
+#endif
+  return NULL;
+}
+
+static void
+_eXosip_deadline_swap (struct eXosip_t *excontext, int a, int b)
+{
+  struct eXosip_deadline tmp = excontext->j_deadlines[a];
+
+  excontext->j_deadlines[a] = excontext->j_deadlines[b];
+  excontext->j_deadlines[b] = tmp;
+  *_eXosip_deadline_pos (excontext->j_deadlines[a].type, excontext->j_deadlines[a].object) = a + 1;
+  *_eXosip_deadline_pos (excontext->j_deadlines[b].type, excontext->j_deadlines[b].object) = b + 1;
+}
+
+/* restore the heap order around pos: returns the final position */
+static int
+_eXosip_deadline_sift (struct eXosip_t *excontext, int pos)
+{
+  struct eXosip_deadline *heap = excontext->j_deadlines;
+
+  while (pos > 0 && heap[(pos - 1) / 2].due > heap[pos].due) {
+    _eXosip_deadline_swap (excontext, pos, (pos - 1) / 2);
+    pos = (pos - 1) / 2;
+  }
+  for (;;) {
+    int child = 2 * pos + 1;
+
+    if (child >= excontext->j_deadlines_count)
+      break;
+    if (child + 1 < excontext->j_deadlines_count && heap[child + 1].due < heap[child].due)
+      child++;
+    if (heap[pos].due <= heap[child].due)
+      break;
+    _eXosip_deadline_swap (excontext, pos, child);
+    pos = child;
+  }
+  return pos;
+}
+
+/* schedule (or move) the next automatic action of an object */
+int
+_eXosip_deadline_set (struct eXosip_t *excontext, int type, void *object, time_t due)
+{
+  int *pos = _eXosip_deadline_pos (type, object);
+
+  if (pos == NULL)
+    return OSIP_BADPARAMETER;
+  if (*pos > 0) {
+    excontext->j_deadlines[*pos - 1].due = due;
+    _eXosip_deadline_sift (excontext, *pos - 1);
+    return OSIP_SUCCESS;
+  }
+
+  if (excontext->j_deadlines_count == excontext->j_deadlines_size) {
+    int size = (excontext->j_deadlines_size > 0) ? excontext->j_deadlines_size * 2 : 64;
+    struct eXosip_deadline *heap = (struct eXosip_deadline *) osip_realloc (excontext->j_deadlines, sizeof (struct eXosip_deadline) * size);
+
+    if (heap == NULL)
+      return OSIP_NOMEM;
+    excontext->j_deadlines = heap;
+    excontext->j_deadlines_size = size;
+  }
+  excontext->j_deadlines[excontext->j_deadlines_count].due = due;
+  excontext->j_deadlines[excontext->j_deadlines_count].type = type;
+  excontext->j_deadlines[excontext->j_deadlines_count].object = object;
+  *pos = ++excontext->j_deadlines_count;
+  _eXosip_deadline_sift (excontext, excontext->j_deadlines_count - 1);
+  return OSIP_SUCCESS;
+}
+
+void
+_eXosip_deadline_remove (struct eXosip_t *excontext, int type, void *object)
+{
+  int *pos = _eXosip_deadline_pos (type, object);
+  int last;
+
+  if (pos == NULL || *pos == 0)
+    return;
+  last = --excontext->j_deadlines_count;
+  if (*pos - 1 != last) {
+    int hole = *pos - 1;
+
+    excontext->j_deadlines[hole] = excontext->j_deadlines[last];
+    *_eXosip_deadline_pos (excontext->j_deadlines[hole].type, excontext->j_deadlines[hole].object) = hole + 1;
+    _eXosip_deadline_sift (excontext, hole);
+  }
+  *pos = 0;
+}
+
+/* check every object on the next run: the inputs of their refresh
+   delays have changed (refresh jitter) */
+void
+_eXosip_deadline_reset (struct eXosip_t *excontext, time_t due)
+{
+  int pos;
+
+  for (pos = 0; pos < excontext->j_deadlines_count; pos++)
+    excontext->j_deadlines[pos].due = due;
+}
+
+/* earliest of the thresholds which are still in the future */
+static time_t
+_eXosip_deadline_min (time_t due, time_t threshold, time_t now)
+{
+  if (threshold <= now)
+    return due;
+  if (due == 0 || threshold < due)
+    return threshold;
+  return due;
+}
+
+static int
+_eXosip_transaction_pending (osip_transaction_t * tr)
+{
+  return (tr->state != ICT_TERMINATED && tr->state != NICT_TERMINATED && tr->state != ICT_COMPLETED && tr->state != NICT_COMPLETED);
+}
+
+/* refresh at "timeout - 10%" or 6 seconds before expiration */
+#define EXOSIP_REFRESH_DELAY(period) ((period) - ((period) / 10) < (period) - 6 ? (period) - ((period) / 10) : (period) - 6)
+
+/* shorten a refresh delay by the share of the jitter drawn for the object */
+static int
+_eXosip_refresh_delay (struct eXosip_t *excontext, int delay, int draw)
+{
+  return delay - delay * excontext->refresh_jitter / 100 * draw / 1000;
+}
+
+#ifndef MINISIZE
+
+/* forget the refreshes counted more than EXOSIP_REFRESH_WINDOW seconds ago */
+static void
+_eXosip_refresh_window_update (struct eXosip_t *excontext, time_t now)
+{
+  time_t t;
+
+  if (now - excontext->refresh_second >= EXOSIP_REFRESH_WINDOW)
+    memset (excontext->refresh_per_second, 0, sizeof (excontext->refresh_per_second));
+  else {
+    for (t = excontext->refresh_second + 1; t <= now; t++)
+      excontext->refresh_per_second[t % EXOSIP_REFRESH_WINDOW] = 0;
+  }
+  if (now > excontext->refresh_second)
+    excontext->refresh_second = now;
+}
+
+/* copy the refreshes of the last EXOSIP_REFRESH_WINDOW seconds, current second first */
+void
+_eXosip_refresh_window_get (struct eXosip_t *excontext, int *refresh_per_second)
+{
+  time_t now = osip_getsystemtime (NULL);
+  int i;
+
+  _eXosip_refresh_window_update (excontext, now);
+  for (i = 0; i < EXOSIP_REFRESH_WINDOW; i++)
+    refresh_per_second[i] = (now - i >= 0) ? excontext->refresh_per_second[(now - i) % EXOSIP_REFRESH_WINDOW] : 0;
+}
+
+#endif
+
+static void
+_eXosip_refresh_count (struct eXosip_t *excontext, time_t now)
+{
+#ifndef MINISIZE
+  _eXosip_refresh_window_update (excontext, now);
+  excontext->refresh_per_second[now % EXOSIP_REFRESH_WINDOW]++;
+  excontext->statistics.refreshes++;
+#endif
+}
+
+static int
+_eXosip_register_automatic_action (struct eXosip_t *excontext, eXosip_reg_t * jr, time_t now)
+{
+  int acted = 0;
+
+  if (jr->r_id >= 1 && jr->r_last_tr != NULL) {
+    acted = 1;
+    if (jr->r_reg_period != 0 && now - jr->r_last_tr->birth_time > _eXosip_refresh_delay (excontext, 900, jr->r_jitter)) {
+      /* automatic refresh */
+      eXosip_register_send_register (excontext, jr->r_id, NULL);
+      _eXosip_refresh_count (excontext, now);
+    }
+    else if (jr->r_reg_period != 0 && now - jr->r_last_tr->birth_time > _eXosip_refresh_delay (excontext, EXOSIP_REFRESH_DELAY (jr->r_reg_period), jr->r_jitter)) {
+      /* automatic refresh */
+      eXosip_register_send_register (excontext, jr->r_id, NULL);
+      _eXosip_refresh_count (excontext, now);
+    }
+    else if (jr->r_reg_period != 0 && now - jr->r_last_tr->birth_time > TRANSACTION_TIMEOUT_RETRY && (jr->r_last_tr->last_response == NULL || (!MSG_IS_STATUS_2XX (jr->r_last_tr->last_response)))) {
+      /* automatic refresh */
+      eXosip_register_send_register (excontext, jr->r_id, NULL);
+    }
+    else if (now - jr->r_last_tr->birth_time < 120 &&
+             jr->r_last_tr->orig_request != NULL && (jr->r_last_tr->last_response != NULL && (jr->r_last_tr->last_response->status_code == 401 || jr->r_last_tr->last_response->status_code == 407
+                                                                                              || jr->r_last_tr->last_response->status_code == 423 || jr->r_last_tr->last_response->status_code == 606))) {
+      if (jr->r_retry < 3) {
+        /* TODO: improve support for several retries when
+           several credentials are needed */
+        eXosip_register_send_register (excontext, jr->r_id, NULL);
+        jr->r_retry++;
+      }
+      else
+        acted = 0;
+    }
+    else if (jr->registration_step == RS_DELETIONREQUIRED && jr->r_last_tr->orig_request != NULL && jr->r_last_tr->last_response != NULL && MSG_IS_STATUS_2XX (jr->r_last_tr->last_response)) {
+      jr->registration_step = RS_DELETIONPROCEEDING;
+      if (OSIP_SUCCESS != eXosip_register_send_register (excontext, jr->r_id, NULL)) {
+        jr->registration_step = RS_DELETIONREQUIRED;
+      }
+    }
+    else if (jr->registration_step == RS_MASQUERADINGREQUIRED && jr->r_last_tr->orig_request != NULL && jr->r_last_tr->last_response != NULL && MSG_IS_STATUS_2XX (jr->r_last_tr->last_response)) {
+      jr->registration_step = RS_MASQUERADINGPROCEEDING;
+      if (OSIP_SUCCESS != eXosip_register_send_register (excontext, jr->r_id, NULL)) {
+        jr->registration_step = RS_MASQUERADINGREQUIRED;
+      }
+    }
+    else
+      acted = 0;
+  }
+
+  if (jr->r_last_deletion != 0 && jr->r_last_deletion + 60 < now)
+    jr->r_last_deletion = 0;    /* automasquerading may happen later than 1 minutes after previous one, to avoid loop (happens with bad NAT) */
+  return acted;
+}
+
+/* time of the next condition checked by _eXosip_register_automatic_action */
+static time_t
+_eXosip_register_next_check (struct eXosip_t *excontext, eXosip_reg_t * jr, time_t now)
+{
+  osip_transaction_t *tr = jr->r_last_tr;
+  time_t due = 0;
+
+  if (jr->r_last_deletion != 0)
+    due = _eXosip_deadline_min (due, jr->r_last_deletion + 61, now);
+  if (jr->r_id < 1 || tr == NULL)
+    return due;
+  if (_eXosip_transaction_pending (tr))
+    return now + 1;             /* the answer may require an action */
+  if (jr->r_reg_period != 0) {
+    due = _eXosip_deadline_min (due, tr->birth_time + _eXosip_refresh_delay (excontext, 900, jr->r_jitter) + 1, now);
+    due = _eXosip_deadline_min (due, tr->birth_time + _eXosip_refresh_delay (excontext, EXOSIP_REFRESH_DELAY (jr->r_reg_period), jr->r_jitter) + 1, now);
+    if (tr->last_response == NULL || !MSG_IS_STATUS_2XX (tr->last_response))
+      due = _eXosip_deadline_min (due, tr->birth_time + TRANSACTION_TIMEOUT_RETRY + 1, now);
+  }
+  return due;
+}
+
+#ifndef MINISIZE
+
+static int
+_eXosip_subscription_automatic_action (struct eXosip_t *excontext, eXosip_subscribe_t * js, time_t now)
+{
+  eXosip_dialog_t *jd;
+  int acted = 0;
+
+  if (js->s_id < 1) {
+  }
+  else if (js->s_dialogs == NULL) {
+    osip_transaction_t *out_tr = NULL;
+
+    out_tr = js->s_out_tr;
+
+    if (out_tr != NULL
+        && (out_tr->state == NICT_TERMINATED
+            || out_tr->state == NICT_COMPLETED) &&
+        now - out_tr->birth_time < TRANSACTION_TIMEOUT_RETRY && out_tr->orig_request != NULL && out_tr->last_response != NULL && (out_tr->last_response->status_code == 401 || out_tr->last_response->status_code == 407
+                                                                                                                                  || out_tr->last_response->status_code == 423)) {
+      /* retry with credential */
+      if (js->s_retry < 3) {
+        int i;
+
+        i = _eXosip_subscription_send_request_with_credential (excontext, js, NULL, out_tr);
+        if (i != 0) {
+          OSIP_TRACE (osip_trace (__FILE__, __LINE__, OSIP_ERROR, NULL, "eXosip: could not clone msg for authentication\n"));
+        }
+        js->s_retry++;
+        acted = 1;
+      }
+    }
+  }
+
+  for (jd = js->s_dialogs; jd != NULL; jd = jd->next) {
+    if (jd->d_dialog != NULL) { /* finished call */
+      if (jd->d_id >= 1) {
+        osip_transaction_t *out_tr = NULL;
+
+        out_tr = osip_list_get (jd->d_out_trs, 0);
+        if (out_tr == NULL)
+          out_tr = js->s_out_tr;
+
+        if (out_tr != NULL
+            && (out_tr->state == NICT_TERMINATED
+                || out_tr->state == NICT_COMPLETED) && now - out_tr->birth_time < TRANSACTION_TIMEOUT_RETRY && out_tr->orig_request != NULL && out_tr->last_response != NULL && (out_tr->last_response->status_code == 401
+                                                                                                                                                                                 || out_tr->last_response->status_code == 407)) {
+          /* retry with credential */
+          if (jd->d_retry < 3) {
+            int i;
+
+            i = _eXosip_subscription_send_request_with_credential (excontext, js, jd, out_tr);
+            if (i != 0) {
+              OSIP_TRACE (osip_trace (__FILE__, __LINE__, OSIP_ERROR, NULL, "eXosip: could not clone suscbribe for authentication\n"));
+            }
+            jd->d_retry++;
+            acted = 1;
+          }
+        }
+        else if (js->s_reg_period == 0 || out_tr == NULL) {
+        }
+        else if ((out_tr->state == NICT_TERMINATED || out_tr->state == NICT_COMPLETED) && out_tr->orig_request != NULL && out_tr->last_response != NULL && (out_tr->last_response->status_code >= 300)) {
+          /* refresh are not authorized after an error */
+        }
+        else if ((out_tr->state == NICT_TERMINATED || out_tr->state == NICT_COMPLETED) && now - out_tr->birth_time > _eXosip_refresh_delay (excontext, EXOSIP_REFRESH_DELAY (js->s_reg_period), js->s_jitter)) {     /* will expires in js->s_reg_period/10 sec OR 6 seconds: send refresh! */
+          int i;
+
+          if (out_tr->orig_request != NULL && MSG_IS_REFER (out_tr->orig_request)) {
+            OSIP_TRACE (osip_trace (__FILE__, __LINE__, OSIP_ERROR, NULL, "eXosip: subscription for REFER is expired\n"));
+          }
+          else {
+            i = _eXosip_subscription_automatic_refresh (excontext, js, jd, out_tr);
+            if (i != 0) {
+              OSIP_TRACE (osip_trace (__FILE__, __LINE__, OSIP_ERROR, NULL, "eXosip: could not clone subscribe for refresh\n"));
+            }
+            _eXosip_refresh_count (excontext, now);
+            acted = 1;
+          }
+        }
+      }
+    }
+  }
+  return acted;
+}
+
+/* time of the next condition checked by _eXosip_subscription_automatic_action */
+static time_t
+_eXosip_subscription_next_check (struct eXosip_t *excontext, eXosip_subscribe_t * js, time_t now)
+{
+  eXosip_dialog_t *jd;
+  time_t due = 0;
+
+  if (js->s_id < 1)
+    return now + 1;
+  if (js->s_out_tr != NULL && _eXosip_transaction_pending (js->s_out_tr))
+    return now + 1;
+  for (jd = js->s_dialogs; jd != NULL; jd = jd->next) {
+    osip_transaction_t *out_tr = osip_list_get (jd->d_out_trs, 0);
+
+    if (out_tr == NULL)
+      out_tr = js->s_out_tr;
+    if (out_tr == NULL)
+      continue;
+    if (_eXosip_transaction_pending (out_tr) || (jd->d_dialog != NULL && jd->d_id < 1))
+      return now + 1;
+    /* an early dialog may be confirmed later by a NOTIFY */
+    if (js->s_reg_period != 0 && (out_tr->last_response == NULL || out_tr->last_response->status_code < 300))
+      due = _eXosip_deadline_min (due, out_tr->birth_time + _eXosip_refresh_delay (excontext, EXOSIP_REFRESH_DELAY (js->s_reg_period), js->s_jitter) + 1, now);
+  }
+  return due;
+}
+
+static int
+_eXosip_publication_automatic_action (struct eXosip_t *excontext, eXosip_pub_t * jpub, time_t now)
+{
+  if (jpub->p_id >= 1 && jpub->p_last_tr != NULL) {
+    if (jpub->p_period != 0 && now - jpub->p_last_tr->birth_time > _eXosip_refresh_delay (excontext, 900, jpub->p_jitter)) {
+      /* automatic refresh */
+      _eXosip_publish_refresh (excontext, NULL, &jpub->p_last_tr, NULL);
+      _eXosip_refresh_count (excontext, now);
+      return 1;
+    }
+    else if (jpub->p_period != 0 && now - jpub->p_last_tr->birth_time > _eXosip_refresh_delay (excontext, jpub->p_period - (jpub->p_period / 10), jpub->p_jitter)) {
+      /* automatic refresh */
+      _eXosip_publish_refresh (excontext, NULL, &jpub->p_last_tr, NULL);
+      _eXosip_refresh_count (excontext, now);
+      return 1;
+    }
+    else if (jpub->p_period != 0 && now - jpub->p_last_tr->birth_time > 120 && (jpub->p_last_tr->last_response == NULL || (!MSG_IS_STATUS_2XX (jpub->p_last_tr->last_response)))) {
+      /* automatic refresh */
+      _eXosip_publish_refresh (excontext, NULL, &jpub->p_last_tr, NULL);
+      return 1;
+    }
+    else if (now - jpub->p_last_tr->birth_time < 120 && jpub->p_last_tr->orig_request != NULL && (jpub->p_last_tr->last_response != NULL && (jpub->p_last_tr->last_response->status_code == 401 || jpub->p_last_tr->last_response->status_code == 407))) {
+      if (jpub->p_retry < 3) {
+        /* TODO: improve support for several retries when
+           several credentials are needed */
+        _eXosip_retry_with_auth (excontext, NULL, &jpub->p_last_tr, NULL);
+        jpub->p_retry++;
+        return 1;
+      }
+    }
+    else if (now - jpub->p_last_tr->birth_time < 120 && jpub->p_last_tr->orig_request != NULL && (jpub->p_last_tr->last_response != NULL && (jpub->p_last_tr->last_response->status_code == 412 || jpub->p_last_tr->last_response->status_code == 423))) {
+      _eXosip_publish_refresh (excontext, NULL, &jpub->p_last_tr, NULL);
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/* time of the next condition checked by _eXosip_publication_automatic_action */
+static time_t
+_eXosip_publication_next_check (struct eXosip_t *excontext, eXosip_pub_t * jpub, time_t now)
+{
+  osip_transaction_t *tr = jpub->p_last_tr;
+  time_t due = 0;
+
+  if (jpub->p_id < 1 || tr == NULL)
+    return 0;
+  if (_eXosip_transaction_pending (tr))
+    return now + 1;
+  if (jpub->p_period != 0) {
+    due = _eXosip_deadline_min (due, tr->birth_time + _eXosip_refresh_delay (excontext, 900, jpub->p_jitter) + 1, now);
+    due = _eXosip_deadline_min (due, tr->birth_time + _eXosip_refresh_delay (excontext, jpub->p_period - (jpub->p_period / 10), jpub->p_jitter) + 1, now);
+    if (tr->last_response == NULL || !MSG_IS_STATUS_2XX (tr->last_response))
+      due = _eXosip_deadline_min (due, tr->birth_time + 121, now);
+  }
+  return due;
+}
+
+#endif
+
+/* run the automatic actions of the objects which are due, and schedule
+   their next check */
+static void
+_eXosip_deadline_execute (struct eXosip_t *excontext, time_t now)
+{
+  while (excontext->j_deadlines_count > 0 && excontext->j_deadlines[0].due <= now) {
+    int type = excontext->j_deadlines[0].type;
+    void *object = excontext->j_deadlines[0].object;
+    time_t due = 0;
+
+    _eXosip_deadline_remove (excontext, type, object);
+    if (type == EXOSIP_DEADLINE_REGISTER) {
+      if (_eXosip_register_automatic_action (excontext, (eXosip_reg_t *) object, now))
+        due = now + 1;
+      else
+        due = _eXosip_register_next_check (excontext, (eXosip_reg_t *) object, now);
+    }
+#ifndef MINISIZE
+    else if (type == EXOSIP_DEADLINE_SUBSCRIBE) {
+      if (_eXosip_subscription_automatic_action (excontext, (eXosip_subscribe_t *) object, now))
+        due = now + 1;
+      else
+        due = _eXosip_subscription_next_check (excontext, (eXosip_subscribe_t *) object, now);
+    }
+    else if (type == EXOSIP_DEADLINE_PUBLISH) {
+      if (_eXosip_publication_automatic_action (excontext, (eXosip_pub_t *) object, now))
+        due = now + 1;
+      else
+        due = _eXosip_publication_next_check (excontext, (eXosip_pub_t *) object, now);
+    }
+#endif
+    if (due > 0)
+      _eXosip_deadline_set (excontext, type, object, due);
+  }
 }
 
 void
@@ -665,13 +1347,9 @@ eXosip_automatic_action (struct eXosip_t *excontext)
   eXosip_dialog_t *jd;
 
 #ifndef MINISIZE
-  eXosip_subscribe_t *js;
   eXosip_notify_t *jn;
-  eXosip_pub_t *jpub;
 #endif
 
-  eXosip_reg_t *jr;
-
   time_t now;
 
   now = osip_getsystemtime (NULL);
@@ -848,124 +1526,10 @@ eXosip_automatic_action (struct eXosip_t *excontext)
     }
   }
 
-  for (jr = excontext->j_reg; jr != NULL; jr = jr->next) {
-    if (jr->r_id >= 1 && jr->r_last_tr != NULL) {
-      if (jr->r_reg_period != 0 && now - jr->r_last_tr->birth_time > 900) {
-        /* automatic refresh */
-        eXosip_register_send_register (excontext, jr->r_id, NULL);
-      }
-      else if (jr->r_reg_period != 0 && (now - jr->r_last_tr->birth_time > jr->r_reg_period - (jr->r_reg_period / 10) || now - jr->r_last_tr->birth_time > jr->r_reg_period - 6)) {
-        /* automatic refresh */
-        eXosip_register_send_register (excontext, jr->r_id, NULL);
-      }
-      else if (jr->r_reg_period != 0 && now - jr->r_last_tr->birth_time > TRANSACTION_TIMEOUT_RETRY && (jr->r_last_tr->last_response == NULL || (!MSG_IS_STATUS_2XX (jr->r_last_tr->last_response)))) {
-        /* automatic refresh */
-        eXosip_register_send_register (excontext, jr->r_id, NULL);
-      }
-      else if (now - jr->r_last_tr->birth_time < 120 &&
-               jr->r_last_tr->orig_request != NULL && (jr->r_last_tr->last_response != NULL && (jr->r_last_tr->last_response->status_code == 401 || jr->r_last_tr->last_response->status_code == 407
-                                                                                                || jr->r_last_tr->last_response->status_code == 423 || jr->r_last_tr->last_response->status_code == 606))) {
-        if (jr->r_retry < 3) {
-          /* TODO: improve support for several retries when
-             several credentials are needed */
-          eXosip_register_send_register (excontext, jr->r_id, NULL);
-          jr->r_retry++;
-        }
-      }
-      else if (jr->registration_step == RS_DELETIONREQUIRED && jr->r_last_tr->orig_request != NULL && jr->r_last_tr->last_response != NULL && MSG_IS_STATUS_2XX (jr->r_last_tr->last_response)) {
-        jr->registration_step = RS_DELETIONPROCEEDING;
-        if (OSIP_SUCCESS != eXosip_register_send_register (excontext, jr->r_id, NULL)) {
-          jr->registration_step = RS_DELETIONREQUIRED;
-        }
-      }
-      else if (jr->registration_step == RS_MASQUERADINGREQUIRED && jr->r_last_tr->orig_request != NULL && jr->r_last_tr->last_response != NULL && MSG_IS_STATUS_2XX (jr->r_last_tr->last_response)) {
-        jr->registration_step = RS_MASQUERADINGPROCEEDING;
-        if (OSIP_SUCCESS != eXosip_register_send_register (excontext, jr->r_id, NULL)) {
-          jr->registration_step = RS_MASQUERADINGREQUIRED;
-        }
-      }
-    }
-
-    if (jr->r_last_deletion != 0 && jr->r_last_deletion + 60 < now)
-      jr->r_last_deletion = 0;  /* automasquerading may happen later than 1 minutes after previous one, to avoid loop (happens with bad NAT) */
-  }
+  _eXosip_deadline_execute (excontext, now);
 
 #ifndef MINISIZE
 
-  for (js = excontext->j_subscribes; js != NULL; js = js->next) {
-    if (js->s_id < 1) {
-    }
-    else if (js->s_dialogs == NULL) {
-      osip_transaction_t *out_tr = NULL;
-
-      out_tr = js->s_out_tr;
-
-      if (out_tr != NULL
-          && (out_tr->state == NICT_TERMINATED
-              || out_tr->state == NICT_COMPLETED) &&
-          now - out_tr->birth_time < TRANSACTION_TIMEOUT_RETRY && out_tr->orig_request != NULL && out_tr->last_response != NULL && (out_tr->last_response->status_code == 401 || out_tr->last_response->status_code == 407
-                                                                                                                                    || out_tr->last_response->status_code == 423)) {
-        /* retry with credential */
-        if (js->s_retry < 3) {
-          int i;
-
-          i = _eXosip_subscription_send_request_with_credential (excontext, js, NULL, out_tr);
-          if (i != 0) {
-            OSIP_TRACE (osip_trace (__FILE__, __LINE__, OSIP_ERROR, NULL, "eXosip: could not clone msg for authentication\n"));
-          }
-          js->s_retry++;
-        }
-      }
-    }
-
-    for (jd = js->s_dialogs; jd != NULL; jd = jd->next) {
-      if (jd->d_dialog != NULL) {       /* finished call */
-        if (jd->d_id >= 1) {
-          osip_transaction_t *out_tr = NULL;
-
-          out_tr = osip_list_get (jd->d_out_trs, 0);
-          if (out_tr == NULL)
-            out_tr = js->s_out_tr;
-
-          if (out_tr != NULL
-              && (out_tr->state == NICT_TERMINATED
-                  || out_tr->state == NICT_COMPLETED) && now - out_tr->birth_time < TRANSACTION_TIMEOUT_RETRY && out_tr->orig_request != NULL && out_tr->last_response != NULL && (out_tr->last_response->status_code == 401
-                                                                                                                                                                                   || out_tr->last_response->status_code == 407)) {
-            /* retry with credential */
-            if (jd->d_retry < 3) {
-              int i;
-
-              i = _eXosip_subscription_send_request_with_credential (excontext, js, jd, out_tr);
-              if (i != 0) {
-                OSIP_TRACE (osip_trace (__FILE__, __LINE__, OSIP_ERROR, NULL, "eXosip: could not clone suscbribe for authentication\n"));
-              }
-              jd->d_retry++;
-            }
-          }
-          else if (js->s_reg_period == 0 || out_tr == NULL) {
-          }
-          else if ((out_tr->state == NICT_TERMINATED || out_tr->state == NICT_COMPLETED) && out_tr->orig_request != NULL && out_tr->last_response != NULL && (out_tr->last_response->status_code >= 300)) {
-            /* refresh are not authorized after an error */
-          }
-          else if ((out_tr->state == NICT_TERMINATED || out_tr->state == NICT_COMPLETED) && (now - out_tr->birth_time > js->s_reg_period - (js->s_reg_period / 10) || now - out_tr->birth_time > js->s_reg_period - 6)) {       /* will expires in js->s_reg_period/10 sec OR 6 seconds: send refresh! */
-            int i;
-
-            if (out_tr->orig_request != NULL && MSG_IS_REFER (out_tr->orig_request)) {
-              OSIP_TRACE (osip_trace (__FILE__, __LINE__, OSIP_ERROR, NULL, "eXosip: subscription for REFER is expired\n"));
-            }
-            else {
-              i = _eXosip_subscription_automatic_refresh (excontext, js, jd, out_tr);
-              if (i != 0) {
-                OSIP_TRACE (osip_trace (__FILE__, __LINE__, OSIP_ERROR, NULL, "eXosip: could not clone subscribe for refresh\n"));
-              }
-            }
-          }
-        }
-      }
-    }
-  }
-
-
   for (jn = excontext->j_notifies; jn != NULL; jn = jn->next) {
     for (jd = jn->n_dialogs; jd != NULL; jd = jd->next) {
       if (jd->d_dialog != NULL) {       /* finished call */
@@ -993,42 +1557,31 @@ eXosip_automatic_action (struct eXosip_t *excontext)
       }
     }
   }
-
-  for (jpub = excontext->j_pub; jpub != NULL; jpub = jpub->next) {
-    if (jpub->p_id >= 1 && jpub->p_last_tr != NULL) {
-      if (jpub->p_period != 0 && now - jpub->p_last_tr->birth_time > 900) {
-        /* automatic refresh */
-        _eXosip_publish_refresh (excontext, NULL, &jpub->p_last_tr, NULL);
-      }
-      else if (jpub->p_period != 0 && now - jpub->p_last_tr->birth_time > jpub->p_period - (jpub->p_period / 10)) {
-        /* automatic refresh */
-        _eXosip_publish_refresh (excontext, NULL, &jpub->p_last_tr, NULL);
-      }
-      else if (jpub->p_period != 0 && now - jpub->p_last_tr->birth_time > 120 && (jpub->p_last_tr->last_response == NULL || (!MSG_IS_STATUS_2XX (jpub->p_last_tr->last_response)))) {
-        /* automatic refresh */
-        _eXosip_publish_refresh (excontext, NULL, &jpub->p_last_tr, NULL);
-      }
-      else if (now - jpub->p_last_tr->birth_time < 120 && jpub->p_last_tr->orig_request != NULL && (jpub->p_last_tr->last_response != NULL && (jpub->p_last_tr->last_response->status_code == 401 || jpub->p_last_tr->last_response->status_code == 407))) {
-        if (jpub->p_retry < 3) {
-          /* TODO: improve support for several retries when
-             several credentials are needed */
-          _eXosip_retry_with_auth (excontext, NULL, &jpub->p_last_tr, NULL);
-          jpub->p_retry++;
-        }
-      }
-      else if (now - jpub->p_last_tr->birth_time < 120 && jpub->p_last_tr->orig_request != NULL && (jpub->p_last_tr->last_response != NULL && (jpub->p_last_tr->last_response->status_code == 412 || jpub->p_last_tr->last_response->status_code == 423))) {
-        _eXosip_publish_refresh (excontext, NULL, &jpub->p_last_tr, NULL);
-      }
-    }
-  }
 #endif
 
 }
 
+/* ids are unique in a context and allocated without the eXosip lock */
+int
+_eXosip_id_new (struct eXosip_t *excontext)
+{
+  long id;
+
+  do {
+#if defined(__GNUC__)
+    id = __sync_add_and_fetch (&excontext->j_id_counter, 1) & INT_MAX;
+#elif defined(WIN32) || defined(_WIN32_WCE)
+    id = InterlockedIncrement (&excontext->j_id_counter) & INT_MAX;
+#else
+    id = ++excontext->j_id_counter & INT_MAX;
+#endif
+  } while (id == 0);            /* keep it positive on loop */
+  return (int) id;
+}
+
 void
 _eXosip_update (struct eXosip_t *excontext)
 {
-  static int static_id = 1;
   eXosip_call_t *jc;
 
 #ifndef MINISIZE
@@ -1037,19 +1590,14 @@ _eXosip_update (struct eXosip_t *excontext)
 #endif
   eXosip_dialog_t *jd;
 
-  if (static_id == INT_MAX)
-    static_id = 1;              /* loop */
-
   for (jc = excontext->j_calls; jc != NULL; jc = jc->next) {
     if (jc->c_id < 1) {
-      jc->c_id = static_id;
-      static_id++;
+      jc->c_id = _eXosip_id_new (excontext);
     }
     for (jd = jc->c_dialogs; jd != NULL; jd = jd->next) {
       if (jd->d_dialog != NULL) {       /* finished call */
         if (jd->d_id < 1) {
-          jd->d_id = static_id;
-          static_id++;
+          jd->d_id = _eXosip_id_new (excontext);
         }
       }
       else
@@ -1060,14 +1608,12 @@ _eXosip_update (struct eXosip_t *excontext)
 #ifndef MINISIZE
   for (js = excontext->j_subscribes; js != NULL; js = js->next) {
     if (js->s_id < 1) {
-      js->s_id = static_id;
-      static_id++;
+      js->s_id = _eXosip_id_new (excontext);
     }
     for (jd = js->s_dialogs; jd != NULL; jd = jd->next) {
       if (jd->d_dialog != NULL) {       /* finished call */
         if (jd->d_id < 1) {
-          jd->d_id = static_id;
-          static_id++;
+          jd->d_id = _eXosip_id_new (excontext);
         }
       }
       else
@@ -1077,14 +1623,12 @@ _eXosip_update (struct eXosip_t *excontext)
 
   for (jn = excontext->j_notifies; jn != NULL; jn = jn->next) {
     if (jn->n_id < 1) {
-      jn->n_id = static_id;
-      static_id++;
+      jn->n_id = _eXosip_id_new (excontext);
     }
     for (jd = jn->n_dialogs; jd != NULL; jd = jd->next) {
       if (jd->d_dialog != NULL) {       /* finished call */
         if (jd->d_id < 1) {
-          jd->d_id = static_id;
-          static_id++;
+          jd->d_id = _eXosip_id_new (excontext);
         }
       }
       else
@@ -1134,10 +1678,12 @@ eXosip_clear_authentication_info (struct eXosip_t *excontext)
 {
   jauthinfo_t *jauthinfo;
 
+  _eXosip_config_wrlock (excontext);
   for (jauthinfo = excontext->authinfos; jauthinfo != NULL; jauthinfo = excontext->authinfos) {
     REMOVE_ELEMENT (excontext->authinfos, jauthinfo);
     osip_free (jauthinfo);
   }
+  _eXosip_config_wrunlock (excontext);
   return OSIP_SUCCESS;
 }
 
@@ -1163,7 +1709,8 @@ eXosip_add_authentication_info (struct eXosip_t *excontext, const char *username
     return OSIP_NOMEM;
   memset (authinfos, 0, sizeof (jauthinfo_t));
 
-  eXosip_remove_authentication_info (excontext, username, realm);
+  _eXosip_config_wrlock (excontext);
+  _eXosip_remove_authentication_info (excontext, username, realm);
 
   snprintf (authinfos->username, 50, "%s", username);
   snprintf (authinfos->userid, 50, "%s", userid);
@@ -1175,17 +1722,30 @@ eXosip_add_authentication_info (struct eXosip_t *excontext, const char *username
     snprintf (authinfos->realm, 50, "%s", realm);
 
   ADD_ELEMENT (excontext->authinfos, authinfos);
+  _eXosip_config_wrunlock (excontext);
   return OSIP_SUCCESS;
 }
 
 int
 eXosip_remove_authentication_info (struct eXosip_t *excontext, const char *username, const char *realm)
 {
-  jauthinfo_t *authinfo;
+  int i;
 
   if (username == NULL || username[0] == '\0')
     return OSIP_BADPARAMETER;
 
+  _eXosip_config_wrlock (excontext);
+  i = _eXosip_remove_authentication_info (excontext, username, realm);
+  _eXosip_config_wrunlock (excontext);
+  return i;
+}
+
+/* called with the configuration write lock held */
+static int
+_eXosip_remove_authentication_info (struct eXosip_t *excontext, const char *username, const char *realm)
+{
+  jauthinfo_t *authinfo;
+
   for (authinfo = excontext->authinfos; authinfo != NULL; authinfo = authinfo->next) {
     if (osip_strcasecmp (username, authinfo->username) == 0) {
       if (realm != NULL && osip_strcasecmp (realm, authinfo->realm) != 0)
@@ -1202,6 +1762,18 @@ eXosip_remove_authentication_info (struct eXosip_t *excontext, const char *usern
 
 int
 _eXosip_add_authentication_information (struct eXosip_t *excontext, osip_message_t * req, osip_message_t * last_response)
+{
+  int i;
+
+  _eXosip_config_rdlock (excontext);
+  i = _eXosip_add_authentication_information_locked (excontext, req, last_response);
+  _eXosip_config_rdunlock (excontext);
+  return i;
+}
+
+/* called with the configuration read lock held */
+static int
+_eXosip_add_authentication_information_locked (struct eXosip_t *excontext, osip_message_t * req, osip_message_t * last_response)
 {
   osip_authorization_t *aut = NULL;
   osip_www_authenticate_t *wwwauth = NULL;
@@ -1363,8 +1935,6 @@ _eXosip_add_authentication_information (struct eXosip_t *excontext, osip_message
 int
 _eXosip_update_top_via (struct eXosip_t *excontext, osip_message_t * sip)
 {
-  unsigned int number;
-  char tmp[40];
   osip_generic_param_t *br = NULL;
   osip_via_t *via = (osip_via_t *) osip_list_get (&sip->vias, 0);
 
@@ -1388,10 +1958,9 @@ _eXosip_update_top_via (struct eXosip_t *excontext, osip_message_t * sip)
   }
 
   osip_free (br->gvalue);
-  number = osip_build_random_number ();
-
-  snprintf (tmp, 40, "z9hG4bK%u", number);
-  br->gvalue = osip_strdup (tmp);
+  br->gvalue = _eXosip_malloc_new_branch ();
+  if (br->gvalue == NULL)
+    return OSIP_NOMEM;
   return OSIP_SUCCESS;
 }
 
@@ -1401,10 +1970,12 @@ _eXosip_mark_all_registrations_expired (struct eXosip_t *excontext)
 {
   eXosip_reg_t *jr;
   int wakeup = 0;
+  time_t now = osip_getsystemtime (NULL);
 
   for (jr = excontext->j_reg; jr != NULL; jr = jr->next) {
     if (jr->r_id >= 1 && jr->r_last_tr != NULL) {
       jr->r_last_tr->birth_time -= jr->r_reg_period;
+      _eXosip_deadline_set (excontext, EXOSIP_DEADLINE_REGISTER, jr, now);
       wakeup = 1;
     }
   }
@@ -1442,6 +2013,7 @@ _eXosip_mark_registration_expired (struct eXosip_t *excontext, const char *call_
       if (jr->r_retryfailover < 60)
         jr->r_retryfailover++;
       jr->r_last_tr->birth_time += jr->r_retryfailover; /* wait "RETRY" (counter) seconds before retrying: avoid flooding */
+      _eXosip_deadline_set (excontext, EXOSIP_DEADLINE_REGISTER, jr, now);
       wakeup = 1;
     }
   }
@@ -265,6 +265,18 @@ extern "C" {
 #endif
 
   void _eXosip_update (struct eXosip_t *excontext);
+  int _eXosip_id_new (struct eXosip_t *excontext);
+  void _eXosip_config_rdlock (struct eXosip_t *excontext);
+  void _eXosip_config_rdunlock (struct eXosip_t *excontext);
+  void _eXosip_config_get (struct eXosip_t *excontext, const char *value, char *buf, size_t size);
+  void _eXosip_config_wrlock (struct eXosip_t *excontext);
+  void _eXosip_config_wrunlock (struct eXosip_t *excontext);
+  int _eXosip_deadline_set (struct eXosip_t *excontext, int type, void *object, time_t due);
+  void _eXosip_deadline_reset (struct eXosip_t *excontext, time_t due);
+  void _eXosip_deadline_remove (struct eXosip_t *excontext, int type, void *object);
+#ifndef MINISIZE
+  void _eXosip_refresh_window_get (struct eXosip_t *excontext, int *refresh_per_second);
+#endif
   void _eXosip_wakeup (struct eXosip_t *excontext);
 
 #ifndef DEFINE_SOCKADDR_STORAGE
@@ -306,10 +318,24 @@ extern "C" {
 
     time_t implicit_subscription_expire_time;
 
+    char *d_callid;             /* key in the dialog index (Call-ID) */
+    unsigned int d_callid_hash;
+    int d_owner_type;           /* EXOSIP_DIALOG_OWNER_* */
+    void *d_owner;              /* eXosip_call_t, eXosip_subscribe_t or eXosip_notify_t */
+    eXosip_dialog_t *d_index_next;
+
     eXosip_dialog_t *next;
     eXosip_dialog_t *parent;
   };
 
+#define EXOSIP_DIALOG_OWNER_CALL      1
+#define EXOSIP_DIALOG_OWNER_SUBSCRIBE 2
+#define EXOSIP_DIALOG_OWNER_NOTIFY    3
+
+#ifndef EXOSIP_DIALOG_INDEX_SIZE
+#define EXOSIP_DIALOG_INDEX_SIZE 1024   /* must be a power of 2 */
+#endif
+
   typedef struct eXosip_call_t eXosip_call_t;
 
   struct eXosip_call_t {
@@ -358,6 +384,8 @@ extern "C" {
     struct __eXosip_sockaddr addr;
     socklen_t len;
 
+    int r_deadline;             /* position in the deadline queue (0 if not queued) */
+    int r_jitter;               /* random draw (0-999) applied to the refresh jitter */
     eXosip_reg_t *next;
     eXosip_reg_t *parent;
   };
@@ -378,6 +406,8 @@ extern "C" {
     int s_retry;                /* avoid too many unsuccessful retry */
     osip_transaction_t *s_inc_tr;
     osip_transaction_t *s_out_tr;
+    int s_deadline;             /* position in the deadline queue (0 if not queued) */
+    int s_jitter;               /* random draw (0-999) applied to the refresh jitter */
 
     eXosip_subscribe_t *next;
     eXosip_subscribe_t *parent;
@@ -413,6 +443,8 @@ extern "C" {
 
     osip_transaction_t *p_last_tr;
     int p_retry;
+    int p_deadline;             /* position in the deadline queue (0 if not queued) */
+    int p_jitter;               /* random draw (0-999) applied to the refresh jitter */
     eXosip_pub_t *next;
     eXosip_pub_t *parent;
   };
@@ -439,6 +471,13 @@ extern "C" {
 
   int _eXosip_create_proxy_authorization_header (osip_proxy_authenticate_t * wa, const char *rquri, const char *username, const char *passwd, const char *ha1, osip_proxy_authorization_t ** auth, const char *method, const char *pszCNonce, int iNonceCount);
   int _eXosip_store_nonce (struct eXosip_t *excontext, const char *call_id, osip_proxy_authenticate_t * wa, int answer_code);
+  char *_eXosip_digest_param (const char *value, char *buf, size_t size);
+/* nonce of _eXosip_digest_nonce_create: creation time and salt (16 hex
+   digits) and MD5 (32 hex digits) */
+#define EXOSIP_DIGEST_NONCE_LEN 48
+  void _eXosip_digest_nonce_create (const char *secret, time_t now, char *nonce, size_t size);
+  int _eXosip_digest_nonce_check (const char *secret, const char *nonce, time_t now, int lifetime);
+  int _eXosip_digest_check (osip_authorization_t * auth, const char *method, osip_uri_t * req_uri, int qop_offered, const char *passwd);
   int _eXosip_delete_nonce (struct eXosip_t *excontext, const char *call_id);
 
   eXosip_event_t *_eXosip_event_init_for_call (int type, eXosip_call_t * jc, eXosip_dialog_t * jd, osip_transaction_t * tr);
@@ -455,6 +494,7 @@ extern "C" {
   void _eXosip_report_call_event (struct eXosip_t *excontext, int evt, eXosip_call_t * jc, eXosip_dialog_t * jd, osip_transaction_t * tr);
   void _eXosip_report_event (struct eXosip_t *excontext, eXosip_event_t * je, osip_message_t * sip);
   int _eXosip_event_add (struct eXosip_t *excontext, eXosip_event_t * je);
+  int _eXosip_event_workers_start (struct eXosip_t *excontext, int count);
 
   typedef void (*eXosip_callback_t) (int type, eXosip_event_t *);
 
@@ -477,6 +517,24 @@ extern "C" {
 #define MAX_EXOSIP_HTTP_AUTH 100
 #endif
 
+#ifndef MAX_EXOSIP_ROUTE_CACHE
+#define MAX_EXOSIP_ROUTE_CACHE 1024
+#endif
+#define EXOSIP_ROUTE_CACHE_WAYS 4
+
+  /* local source address used to reach a destination (see eXutils.c), in
+     a set associative table of MAX_EXOSIP_ROUTE_CACHE entries hashed on
+     the destination: a new entry replaces an expired one, or the one
+     expiring first in its set */
+  struct eXosip_route_cache {
+    int family;
+    int has_bind;               /* 1 when the lookup was made for a socket bound on bind_addr */
+    struct sockaddr_storage bind_addr;
+    char destination[65];
+    char address[65];
+    time_t expire;
+  };
+
   struct eXosip_counters {
     float current_average;
     unsigned int num_entries;
@@ -490,6 +548,182 @@ extern "C" {
 
   typedef struct eXosip_t eXosip_t;
 
+/* characters of a generated identifier: 128 bits in base32 */
+#define EXOSIP_ID_LEN 26
+
+  /* answer sent without a transaction, kept to answer retransmissions */
+  struct eXosip_stateless_answer {
+    unsigned int hash;
+    char *branch;
+    time_t expire;
+    osip_message_t *answer;
+  };
+
+#define EXOSIP_STATELESS_CACHE_SIZE 128
+
+/* slots of one second in the expiry wheel of the registrar */
+#define EXOSIP_REGISTRAR_WHEEL 1024
+#define EXOSIP_REGISTRAR_NONCE_LIFETIME 300
+/* nonces given in challenges, with the last nonce count received, in a
+   set associative table of max_nonces entries: a new nonce replaces an
+   expired one, or the oldest of its set */
+#define EXOSIP_REGISTRAR_NONCES 1024   /* default max_nonces */
+#define EXOSIP_REGISTRAR_NONCE_WAYS 4
+
+  struct eXosip_registrar_nonce {
+    char nonce[EXOSIP_DIGEST_NONCE_LEN + 1];
+    unsigned int nc;            /* highest nonce count accepted (0: none) */
+    time_t created;             /* 0: free */
+  };
+
+  struct eXosip_registrar_entry {
+    struct eXosip_registrar_binding binding;
+    time_t expire;
+    unsigned int hash;
+    struct eXosip_registrar_entry *next;        /* in the hash bucket */
+    struct eXosip_registrar_entry *wnext;       /* in the wheel slot */
+    struct eXosip_registrar_entry *wprev;
+  };
+
+  /* bindings in a hash table on the address of record, and in a timing
+     wheel on their expiration */
+  struct eXosip_registrar_table {
+    struct eXosip_registrar config;
+    char secret[33];            /* key of the nonces */
+    struct eXosip_registrar_entry **buckets;
+    int size;                   /* number of buckets (power of 2) */
+    int count;
+    struct eXosip_registrar_entry *wheel[EXOSIP_REGISTRAR_WHEEL];
+    time_t wheel_time;          /* last second expired */
+    struct eXosip_registrar_nonce *nonces;      /* nonce_sets sets of EXOSIP_REGISTRAR_NONCE_WAYS */
+    int nonce_sets;
+  };
+
+  /* message parsed and waiting for its priority class to be processed */
+  struct eXosip_inbound_message {
+    osip_event_t *evt;
+    int socket;
+    struct eXosip_inbound_message *next;
+  };
+
+  /* health of a destination (circuit breaker) */
+  struct eXosip_peer_state {
+    char host[65];
+    int port;
+    unsigned int hash;
+    int state;                  /* EXOSIP_PEER_UP, EXOSIP_PEER_DOWN or EXOSIP_PEER_PROBING */
+    int failures;               /* consecutive failures */
+    time_t down_time;           /* last transition to EXOSIP_PEER_DOWN */
+    int probe_tid;              /* transaction sent as a probe */
+    time_t probe_time;
+    time_t last;                /* LRU eviction */
+  };
+
+#define EXOSIP_PEER_HEALTH_SETS 64
+#define EXOSIP_PEER_HEALTH_WAYS 4
+
+#define EXOSIP_INBOUND_CLASSES 3 /* responses/ACK/CANCEL/BYE, in-dialog requests, new requests */
+
+  struct eXosip_inbound_queue {
+    struct eXosip_inbound_message *head;
+    struct eXosip_inbound_message *tail;
+    int skipped;                /* messages of higher classes processed while waiting */
+  };
+
+#define EXOSIP_DEADLINE_REGISTER  1
+#define EXOSIP_DEADLINE_SUBSCRIBE 2
+#define EXOSIP_DEADLINE_PUBLISH   3
+
+  /* next automatic action (refresh, retry) of a registration, subscription
+     or publication */
+  struct eXosip_deadline {
+    time_t due;
+    int type;                   /* EXOSIP_DEADLINE_* */
+    void *object;
+  };
+
+  struct eXosip_event_handler {
+    CbSipEvent cb;
+    void *arg;
+  };
+
+  /* an event waiting for its callback */
+  struct eXosip_event_job {
+    eXosip_event_t *je;
+    struct eXosip_event_handler handler;
+  };
+
+  /* events of one call/subscription are always run by the same worker */
+  struct eXosip_event_worker {
+    struct eXosip_t *excontext;
+    osip_fifo_t *jobs;
+    void *thread;
+    void *start;                /* posted once the previous pool is stopped */
+    volatile int stop;
+    struct eXosip_event_job stop_job;   /* queued after the last job */
+  };
+
+#ifndef OSIP_MONOTHREAD
+  /* a thread of an event loop and the contexts it runs */
+  struct eXosip_loop_shard {
+    void *thread;
+    void *mutex;
+    jpipe_t *wakeup;
+    struct eXosip_t *contexts;  /* linked with loop_next */
+    int count;
+    int stop;
+  };
+
+  /* event loop shared by several contexts (EXOSIP_OPT_SET_EVENT_LOOP) */
+  struct eXosip_loop {
+    struct eXosip_loop_shard *shards;
+    int count;
+  };
+#endif
+
+  /* token bucket of a source ip address */
+  struct eXosip_source_bucket {
+    char ip[65];
+    unsigned int hash;
+    double tokens;
+    struct timeval last;        /* last message: refill and LRU eviction */
+    unsigned int received;
+    unsigned int dropped;
+  };
+
+/* set associative table: a source is in one set and evicts the least
+   recently used entry of its set */
+#define EXOSIP_RATE_LIMIT_SETS 64
+#define EXOSIP_RATE_LIMIT_WAYS 4
+
+/*
+ * Lock order:
+ * 1. the mutex of an event loop thread (struct eXosip_loop_shard) is held
+ *    while it runs its contexts, so it is taken before eXosip_lock: a
+ *    context is attached (eXosip_listen_addr, eXosip_set_socket) and
+ *    detached (eXosip_quit) without eXosip_lock held, and never from a
+ *    callback run by a thread of the same loop.
+ * 2. eXosip_lock (j_mutexlock) protects the calls, dialogs, registrations,
+ *    subscriptions, publications and osip transactions. Application threads
+ *    hold it around the API; the eXosip thread holds it for each step of
+ *    eXosip_execute, never while waiting on sockets. osip and transport
+ *    callbacks (cbsipStateless and registrar callbacks included) run with
+ *    it held.
+ * 3. osip mutexes (transaction lists, peer rtt table), the fifo mutexes
+ *    (j_events, event workers), the local ip cache mutex and the
+ *    configuration lock (_eXosip_config_rdlock) may be taken with
+ *    eXosip_lock held, never the other way around.
+ * Ids are allocated with an atomic counter (_eXosip_id_new) and callbacks
+ * set with eXosip_set_event_callback run without any lock.
+ * The configuration strings (user agent, gateways, sip instance, outgoing
+ * local address) and the credentials are read under the configuration
+ * read lock; eXosip_set_option, eXosip_set_user_agent and the
+ * *_authentication_info functions take its write lock without eXosip_lock.
+ * There is no per-object lock: calls, registrations and subscriptions are
+ * protected by eXosip_lock, because the osip callbacks modify them from the
+ * FSM execution. tools/sip_stress measures how long application threads
+ * wait for it.
+ */
   struct eXosip_t {
 #ifndef MINISIZE
     struct eXosip_stats statistics;
@@ -513,19 +747,33 @@ extern "C" {
     char *user_agent;
 
     eXosip_reg_t *j_reg;        /* my registrations */
+    struct eXosip_deadline *j_deadlines;        /* min-heap on due */
+    int j_deadlines_count;
+    int j_deadlines_size;
+    int refresh_jitter;         /* percentage of the refresh delay removed at random (0 to disable) */
+#ifndef MINISIZE
+    int refresh_per_second[EXOSIP_REFRESH_WINDOW];      /* refreshes sent, indexed by second modulo the window */
+    time_t refresh_second;      /* last second counted in refresh_per_second */
+#endif
     eXosip_call_t *j_calls;     /* my calls        */
 #ifndef MINISIZE
     eXosip_subscribe_t *j_subscribes;   /* my friends      */
     eXosip_notify_t *j_notifies;        /* my susbscribers */
     eXosip_pub_t *j_pub;        /* my publications  */
 #endif
+    eXosip_dialog_t *j_dialog_index[EXOSIP_DIALOG_INDEX_SIZE];  /* dialogs hashed by Call-ID */
     osip_list_t j_transactions;
 
     osip_t *j_osip;
     int j_stop_ua;
+    volatile long j_id_counter;  /* last id given to a call, dialog, registration... */
 #ifndef OSIP_MONOTHREAD
     void *j_cond;
     void *j_mutexlock;
+    void *route_cache_mutex;    /* protects route_cache and route_netlink_sock */
+    void *config_readers_mutex; /* protects config_readers */
+    void *config_writer_sem;    /* held by a setter or by the first reader */
+    int config_readers;
     void *j_thread;
     jpipe_t *j_socketctl;
     jpipe_t *j_socketctl_event;
@@ -534,6 +782,20 @@ extern "C" {
     long int max_read_timeout;
 
     osip_fifo_t *j_events;
+    struct eXosip_event_handler event_handlers[EXOSIP_EVENT_COUNT];
+    struct eXosip_event_handler event_handler_default;
+#ifndef OSIP_MONOTHREAD
+    struct eXosip_event_worker *event_workers;
+    int event_workers_count;
+
+    struct eXosip_loop *loop;   /* shared event loop, replaces j_thread */
+    struct eXosip_loop_shard *loop_shard;       /* thread of the loop running the context */
+    struct eXosip_t *loop_next;
+    struct timeval loop_due;    /* next run of the timers */
+    volatile int loop_wakeup;   /* set by _eXosip_wakeup */
+    int loop_activity;          /* a message was received */
+    int loop_fd_max;            /* highest socket of the context (-1: none) */
+#endif
 
     jauthinfo_t *authinfos;
 
@@ -557,6 +819,9 @@ extern "C" {
     struct eXosip_dns_cache dns_entries[MAX_EXOSIP_DNS_ENTRY];
     struct eXosip_account_info account_entries[MAX_EXOSIP_ACCOUNT_INFO];
     struct eXosip_http_auth http_auths[MAX_EXOSIP_HTTP_AUTH];
+    struct eXosip_route_cache *route_cache;     /* allocated on first use */
+    int route_cache_ttl;        /* 0 to disable the cache */
+    int route_netlink_sock;     /* linux: route/address change notifications */
 
     /* udp pre-config */
     char udp_firewall_ip[64];
@@ -577,6 +842,20 @@ extern "C" {
     char dtls_firewall_port[10];
 
     CbSipCallback cbsipCallback;
+    struct eXosip_overload_control overload;
+    struct eXosip_rate_limit rate_limit;
+    struct eXosip_source_bucket rate_limit_table[EXOSIP_RATE_LIMIT_SETS * EXOSIP_RATE_LIMIT_WAYS];
+    int loop_lag;               /* last delay (ms) of eXosip_execute over its timers */
+    time_t lost200ok_timer;     /* next 2xx retransmission (0 when none is pending) */
+    struct eXosip_peer_health peer_health;
+    struct eXosip_peer_state peer_table[EXOSIP_PEER_HEALTH_SETS * EXOSIP_PEER_HEALTH_WAYS];
+    struct eXosip_inbound_priority inbound_priority;
+    struct eXosip_inbound_queue inbound[EXOSIP_INBOUND_CLASSES];
+    int inbound_queued;
+    CbSipStateless cbsipStateless;
+    void *cbsipStatelessArg;
+    struct eXosip_stateless_answer stateless_answers[EXOSIP_STATELESS_CACHE_SIZE];
+    struct eXosip_registrar_table *registrar;   /* NULL when disabled */
     int masquerade_via;
     int auto_masquerade_contact;
     int reuse_tcp_port;
@@ -598,20 +877,51 @@ extern "C" {
   int _eXosip_guess_ip_for_via (struct eXosip_t *excontext, int family, char *address, int size);
   int _eXosip_guess_ip_for_destination (struct eXosip_t *excontext, int family, char *destination, char *address, int size);
   int _eXosip_guess_ip_for_destinationsock (struct eXosip_t *excontext, int family, int proto, struct sockaddr_storage *udp_local_bind, int sock, char *destination, char *address, int size);
+  void _eXosip_route_cache_flush (struct eXosip_t *excontext);
+  void _eXosip_stateless_cache_flush (struct eXosip_t *excontext);
+  int _eXosip_registrar_start (struct eXosip_t *excontext, const struct eXosip_registrar *config);
+  int _eXosip_registrar_answer (struct eXosip_t *excontext, osip_message_t * request, osip_message_t ** answer);
+  void _eXosip_registrar_expire (struct eXosip_t *excontext, time_t now);
+  void _eXosip_inbound_flush (struct eXosip_t *excontext);
 
   int _eXosip_closesocket (SOCKET_TYPE sock);
   int _eXosip_getnameinfo (const struct sockaddr *sa, socklen_t salen, char *host, socklen_t hostlen, char *serv, socklen_t servlen, int flags);
   int _eXosip_getport (const struct sockaddr *sa, socklen_t salen);
   int _eXosip_get_addrinfo (struct eXosip_t *excontext, struct addrinfo **addrinfo, const char *hostname, int service, int protocol);
 
+  /* destination of the last message sent by a transaction: retransmissions
+     of the same, unmodified, message skip resolution and serialization. */
+  struct eXosip_wire_cache {
+    osip_message_t *sip;        /* message sent */
+    unsigned long serial;       /* sip->message_serial when it was sent */
+    char *host;                 /* destination set in the ict/nict context */
+    int port;
+    int sock;
+    struct sockaddr_storage addr;
+    socklen_t addrlen;
+    int srv_index;              /* naptr_record->sipudp_record.index when it was sent */
+  };
+
+  void _eXosip_wire_cache_free (osip_transaction_t * tr);
+  int _eXosip_peer_health_check (struct eXosip_t *excontext, const char *host, int port, int tid);
+  void _eXosip_peer_health_failure (struct eXosip_t *excontext, const char *host, int port, int tid);
+  void _eXosip_peer_health_alive (struct eXosip_t *excontext, const char *host, int port);
+  int _eXosip_peer_health_state (struct eXosip_t *excontext, const char *host, int port);
   int _eXosip_set_callbacks (osip_t * osip);
   int _eXosip_snd_message (struct eXosip_t *excontext, osip_transaction_t * tr, osip_message_t * sip, char *host, int port, int out_socket);
   char *_eXosip_malloc_new_random (void);
+  char *_eXosip_malloc_new_branch (void);
+  int _eXosip_id_format (char *buf, size_t size);
+  void _eXosip_random_bytes (unsigned char *out, size_t len);
   void _eXosip_delete_reserved (osip_transaction_t * transaction);
 
   int _eXosip_dialog_init_as_uac (eXosip_dialog_t ** jd, osip_message_t * _200Ok);
   int _eXosip_dialog_init_as_uas (eXosip_dialog_t ** jd, osip_message_t * _invite, osip_message_t * _200Ok);
   void _eXosip_dialog_free (struct eXosip_t *excontext, eXosip_dialog_t * jd);
+  int _eXosip_dialog_index_add (struct eXosip_t *excontext, eXosip_dialog_t * jd, int owner_type, void *owner);
+  eXosip_dialog_t *_eXosip_dialog_index_first (struct eXosip_t *excontext, int owner_type, osip_call_id_t * callid);
+  eXosip_dialog_t *_eXosip_dialog_index_next (eXosip_dialog_t * jd, int owner_type, osip_call_id_t * callid);
+  eXosip_dialog_t *_eXosip_dialog_index_find_as_uas (struct eXosip_t *excontext, int owner_type, osip_message_t * request);
 
   int _eXosip_generating_request_out_of_dialog (struct eXosip_t *excontext, osip_message_t ** dest, const char *method, const char *to, const char *from, const char *proxy);
   int _eXosip_generating_publish (struct eXosip_t *excontext, osip_message_t ** message, const char *to, const char *from, const char *route);
@@ -662,6 +972,7 @@ extern "C" {
   void _eXosip_call_free (struct eXosip_t *excontext, eXosip_call_t * jc);
   void _eXosip_call_remove_dialog_reference_in_call (eXosip_call_t * jc, eXosip_dialog_t * jd);
   int _eXosip_read_message (struct eXosip_t *excontext, int max_message_nb, int sec_max, int usec_max);
+  void _eXosip_read_sockets (struct eXosip_t *excontext, fd_set * osip_fdset, fd_set * osip_wrset);
   void _eXosip_release_terminated_calls (struct eXosip_t *excontext);
   void _eXosip_release_terminated_registrations (struct eXosip_t *excontext);
   void _eXosip_release_terminated_publications (struct eXosip_t *excontext);
@@ -695,7 +1006,7 @@ extern "C" {
 
   int _eXosip_is_public_address (const char *addr);
 
-  void _eXosip_retransmit_lost200ok (struct eXosip_t *excontext);
+  time_t _eXosip_retransmit_lost200ok (struct eXosip_t *excontext);
   int _eXosip_dialog_add_contact (struct eXosip_t *excontext, osip_message_t * request);
 
   int _eXosip_transaction_init (struct eXosip_t *excontext, osip_transaction_t ** transaction, osip_fsm_type_t ctx_type, osip_t * osip, osip_message_t * message);
@@ -169,6 +169,7 @@ eXosip_publish (struct eXosip_t *excontext, osip_message_t * message, const char
   if (pub->p_last_tr != NULL)
     osip_list_add (&excontext->j_transactions, pub->p_last_tr, 0);
   pub->p_last_tr = transaction;
+  _eXosip_deadline_set (excontext, EXOSIP_DEADLINE_PUBLISH, pub, osip_getsystemtime (NULL));
 
   sipevent = osip_new_outgoing_sipmessage (message);
   sipevent->transactionid = transaction->transactionid;
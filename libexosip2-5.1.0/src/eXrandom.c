@@ -0,0 +1,323 @@
+/*
+  eXosip - This is the eXtended osip library.
+  Copyright (C) 2001-2015 Aymeric MOIZARD amoizard@antisip.com
+  
+  eXosip is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+  
+  eXosip is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+  In addition, as a special exception, the copyright holders give
+  permission to link the code of portions of this program with the
+  OpenSSL library under certain conditions as described in each
+  individual source file, and distribute linked combinations
+  including the two.
+  You must obey the GNU General Public License in all respects
+  for all of the code used other than OpenSSL.  If you modify
+  file(s) with this exception, you may extend this exception to your
+  version of the file(s), but you are not obligated to do so.  If you
+  do not wish to do so, delete this exception statement from your
+  version.  If you delete this exception statement from all source
+  files in the program, then also delete it here.
+*/
+
+
+#include "eXosip2.h"
+
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#ifdef HAVE_FCNTL_H
+#include <fcntl.h>
+#endif
+
+#ifdef HAVE_WINCRYPT_H
+#include <wincrypt.h>
+#endif
+
+#if !defined(WIN32) && !defined(_WIN32_WCE) && defined(HAVE_PTHREAD) && !defined(OSIP_MONOTHREAD)
+#include <pthread.h>
+#define EXOSIP_RANDOM_ATFORK
+#endif
+
+/* Identifiers (Call-ID, tags, branches) are taken from a ChaCha20 stream
+   using "fast key erasure": each refill produces EXOSIP_RANDOM_BUFSIZE
+   bytes, the first 32 of them replace the key and the rest is handed
+   out then wiped. Each thread owns its generator, so no lock is taken.
+   The key is reseeded from the system after EXOSIP_RANDOM_RESEED bytes
+   and, with the buffered bytes dropped, in the child of a fork. */
+
+#define EXOSIP_RANDOM_BUFSIZE 512
+#define EXOSIP_RANDOM_RESEED (1024 * 1024)
+
+#if defined(OSIP_MONOTHREAD)
+#define EXOSIP_THREAD_LOCAL
+#elif defined(_MSC_VER)
+#define EXOSIP_THREAD_LOCAL __declspec(thread)
+#elif defined(__GNUC__) || defined(__clang__) || defined(__SUNPRO_C) || defined(__INTEL_COMPILER)
+#define EXOSIP_THREAD_LOCAL __thread
+#elif defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L && !defined(__STDC_NO_THREADS__)
+#define EXOSIP_THREAD_LOCAL _Thread_local
+#else
+/* no thread local storage: one shared generator, callers must serialize */
+#define EXOSIP_THREAD_LOCAL
+#endif
+
+struct eXosip_random {
+  unsigned int key[8];
+  unsigned char buf[EXOSIP_RANDOM_BUFSIZE];
+  int pos;
+  int seeded;
+  unsigned long generated;
+  unsigned int fork_generation;
+};
+
+static EXOSIP_THREAD_LOCAL struct eXosip_random random_state;
+
+#ifdef EXOSIP_RANDOM_ATFORK
+static volatile unsigned int random_fork_generation;
+static pthread_once_t random_atfork_once = PTHREAD_ONCE_INIT;
+
+static void
+_eXosip_random_atfork_child (void)
+{
+  random_fork_generation++;
+}
+
+static void
+_eXosip_random_atfork_register (void)
+{
+  pthread_atfork (NULL, NULL, _eXosip_random_atfork_child);
+}
+
+#define RANDOM_FORK_GENERATION() random_fork_generation
+#elif !defined(WIN32) && !defined(_WIN32_WCE) && defined(HAVE_UNISTD_H)
+#define RANDOM_FORK_GENERATION() ((unsigned int) getpid ())
+#else
+#define RANDOM_FORK_GENERATION() 0
+#endif
+
+static const char id_alphabet[] = "abcdefghijklmnopqrstuvwxyz234567";
+
+#define ROTL32(v, n) (((v) << (n)) | ((v) >> (32 - (n))))
+#define QUARTERROUND(a, b, c, d) \
+  a += b; d ^= a; d = ROTL32 (d, 16); \
+  c += d; b ^= c; b = ROTL32 (b, 12); \
+  a += b; d ^= a; d = ROTL32 (d, 8); \
+  c += d; b ^= c; b = ROTL32 (b, 7)
+
+static void
+_eXosip_chacha20_block (const unsigned int key[8], unsigned int counter, unsigned char out[64])
+{
+  unsigned int in[16];
+  unsigned int x[16];
+  int i;
+
+  in[0] = 0x61707865;
+  in[1] = 0x3320646e;
+  in[2] = 0x79622d32;
+  in[3] = 0x6b206574;
+  for (i = 0; i < 8; i++)
+    in[4 + i] = key[i];
+  in[12] = counter;
+  in[13] = 0;
+  in[14] = 0;
+  in[15] = 0;
+
+  memcpy (x, in, sizeof (x));
+  for (i = 0; i < 10; i++) {
+    QUARTERROUND (x[0], x[4], x[8], x[12]);
+    QUARTERROUND (x[1], x[5], x[9], x[13]);
+    QUARTERROUND (x[2], x[6], x[10], x[14]);
+    QUARTERROUND (x[3], x[7], x[11], x[15]);
+    QUARTERROUND (x[0], x[5], x[10], x[15]);
+    QUARTERROUND (x[1], x[6], x[11], x[12]);
+    QUARTERROUND (x[2], x[7], x[8], x[13]);
+    QUARTERROUND (x[3], x[4], x[9], x[14]);
+  }
+
+  for (i = 0; i < 16; i++) {
+    unsigned int v = x[i] + in[i];
+
+    out[4 * i] = (unsigned char) v;
+    out[4 * i + 1] = (unsigned char) (v >> 8);
+    out[4 * i + 2] = (unsigned char) (v >> 16);
+    out[4 * i + 3] = (unsigned char) (v >> 24);
+  }
+}
+
+/* mix fresh entropy into the key: a weak source never lowers what is
+   already there. */
+static void
+_eXosip_random_seed (struct eXosip_random *rs)
+{
+  unsigned int seed[8];
+  struct timeval now;
+  int i;
+
+  memset (seed, 0, sizeof (seed));
+
+#if defined(HAVE_WINCRYPT_H)
+  {
+    HCRYPTPROV crypto;
+
+    if (CryptAcquireContext (&crypto, NULL, NULL, PROV_RSA_FULL, CRYPT_VERIFYCONTEXT)) {
+      CryptGenRandom (crypto, sizeof (seed), (BYTE *) seed);
+      CryptReleaseContext (crypto, 0);
+    }
+  }
+#elif defined(HAVE_FCNTL_H) && defined(HAVE_UNISTD_H)
+  {
+    int fd = open ("/dev/urandom", O_RDONLY);
+
+    if (fd >= 0) {
+      if (read (fd, seed, sizeof (seed)) != (ssize_t) sizeof (seed))
+        OSIP_TRACE (osip_trace (__FILE__, __LINE__, OSIP_WARNING, NULL, "short read on /dev/urandom\n"));
+      close (fd);
+    }
+  }
+#endif
+
+  osip_gettimeofday (&now, NULL);
+  seed[0] ^= (unsigned int) now.tv_sec;
+  seed[1] ^= (unsigned int) now.tv_usec;
+  seed[2] ^= osip_build_random_number ();
+  seed[3] ^= (unsigned int) (size_t) rs;
+#if !defined(WIN32) && !defined(_WIN32_WCE) && defined(HAVE_UNISTD_H)
+  seed[4] ^= (unsigned int) getpid ();
+#endif
+#ifdef EXOSIP_RANDOM_ATFORK
+  pthread_once (&random_atfork_once, _eXosip_random_atfork_register);
+#endif
+  rs->fork_generation = RANDOM_FORK_GENERATION ();
+
+  for (i = 0; i < 8; i++)
+    rs->key[i] ^= seed[i];
+  memset (seed, 0, sizeof (seed));
+
+  rs->generated = 0;
+  rs->pos = 0;
+  rs->seeded = 1;
+}
+
+static void
+_eXosip_random_refill (struct eXosip_random *rs)
+{
+  int i;
+
+  if (rs->generated >= EXOSIP_RANDOM_RESEED)
+    _eXosip_random_seed (rs);
+
+  for (i = 0; i < EXOSIP_RANDOM_BUFSIZE / 64; i++)
+    _eXosip_chacha20_block (rs->key, (unsigned int) i, rs->buf + 64 * i);
+
+  /* the first 32 bytes become the next key and are never handed out */
+  for (i = 0; i < 8; i++)
+    rs->key[i] = (unsigned int) rs->buf[4 * i] | ((unsigned int) rs->buf[4 * i + 1] << 8) | ((unsigned int) rs->buf[4 * i + 2] << 16) | ((unsigned int) rs->buf[4 * i + 3] << 24);
+  memset (rs->buf, 0, 32);
+  rs->pos = 32;
+  rs->generated += EXOSIP_RANDOM_BUFSIZE - 32;
+}
+
+void
+_eXosip_random_bytes (unsigned char *out, size_t len)
+{
+  struct eXosip_random *rs = &random_state;
+
+  if (rs->seeded == 0 || rs->fork_generation != RANDOM_FORK_GENERATION ())
+    _eXosip_random_seed (rs);
+
+  while (len > 0) {
+    size_t avail;
+
+    if (rs->pos == 0 || rs->pos >= EXOSIP_RANDOM_BUFSIZE)
+      _eXosip_random_refill (rs);
+
+    avail = EXOSIP_RANDOM_BUFSIZE - rs->pos;
+    if (avail > len)
+      avail = len;
+    memcpy (out, rs->buf + rs->pos, avail);
+    memset (rs->buf + rs->pos, 0, avail);
+    rs->pos += (int) avail;
+    out += avail;
+    len -= avail;
+  }
+}
+
+int
+_eXosip_id_format (char *buf, size_t size)
+{
+  unsigned char raw[16];
+  unsigned int acc = 0;
+  int bits = 0;
+  size_t len;
+  size_t i;
+  size_t j = 0;
+
+  if (buf == NULL || size == 0)
+    return OSIP_BADPARAMETER;
+
+  len = size - 1;
+  if (len > EXOSIP_ID_LEN)
+    len = EXOSIP_ID_LEN;
+
+  _eXosip_random_bytes (raw, sizeof (raw));
+
+  /* 5 bits per character, 128 bits for EXOSIP_ID_LEN characters */
+  for (i = 0; i < len; i++) {
+    if (bits < 5) {
+      acc = (acc << 8) | (j < sizeof (raw) ? raw[j++] : 0);
+      bits += 8;
+    }
+    bits -= 5;
+    buf[i] = id_alphabet[(acc >> bits) & 0x1f];
+  }
+  buf[len] = '\0';
+  memset (raw, 0, sizeof (raw));
+  return (int) len;
+}
+
+char *
+_eXosip_malloc_new_random (void)
+{
+  char *tmp = (char *) osip_malloc (EXOSIP_ID_LEN + 1);
+
+  if (tmp == NULL)
+    return NULL;
+
+  _eXosip_id_format (tmp, EXOSIP_ID_LEN + 1);
+  return tmp;
+}
+
+char *
+_eXosip_malloc_new_branch (void)
+{
+  char *tmp = (char *) osip_malloc (7 + EXOSIP_ID_LEN + 1);
+
+  if (tmp == NULL)
+    return NULL;
+
+  memcpy (tmp, "z9hG4bK", 7);
+  _eXosip_id_format (tmp + 7, EXOSIP_ID_LEN + 1);
+  return tmp;
+}
+
+int
+eXosip_generate_random (char *buf, int buf_size)
+{
+  if (buf == NULL || buf_size <= 0)
+    return OSIP_BADPARAMETER;
+
+  _eXosip_id_format (buf, (size_t) buf_size);
+  return OSIP_SUCCESS;
+}
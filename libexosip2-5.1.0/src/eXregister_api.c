@@ -135,12 +135,17 @@ _eXosip_register_add_contact (struct eXosip_t *excontext, eXosip_reg_t * jreg, o
   if (jreg->r_qvalue[0] != 0)
     osip_contact_param_add (new_contact, osip_strdup ("q"), osip_strdup (jreg->r_qvalue));
 
-  if (excontext->sip_instance[0] != 0) {
-    char *sip_instance = (char *) osip_malloc (50);     /* "<urn:uuid:f81d4fae-7dec-11d0-a765-00a0c91e6bf6>" */
+  {
+    char instance[sizeof (excontext->sip_instance)];
+
+    _eXosip_config_get (excontext, excontext->sip_instance, instance, sizeof (instance));
+    if (instance[0] != 0) {
+      char *sip_instance = (char *) osip_malloc (50);   /* "<urn:uuid:f81d4fae-7dec-11d0-a765-00a0c91e6bf6>" */
 
-    if (sip_instance != NULL) {
-      snprintf (sip_instance, 50, "\"<urn:uuid:%s>\"", excontext->sip_instance);
-      osip_contact_param_add (new_contact, osip_strdup ("+sip.instance"), sip_instance);
+      if (sip_instance != NULL) {
+        snprintf (sip_instance, 50, "\"<urn:uuid:%s>\"", instance);
+        osip_contact_param_add (new_contact, osip_strdup ("+sip.instance"), sip_instance);
+      }
     }
   }
   /* If the address-of-record in the To header field of a REGISTER request
@@ -514,6 +519,7 @@ eXosip_register_send_register (struct eXosip_t *excontext, int rid, osip_message
   }
 
   jr->r_last_tr = transaction;
+  _eXosip_deadline_set (excontext, EXOSIP_DEADLINE_REGISTER, jr, osip_getsystemtime (NULL));
 
   /* send REGISTER */
   sipevent = osip_new_outgoing_sipmessage (reg);
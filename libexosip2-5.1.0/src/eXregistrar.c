@@ -0,0 +1,642 @@
+/*
+  eXosip - This is the eXtended osip library.
+  Copyright (C) 2001-2015 Aymeric MOIZARD amoizard@antisip.com
+  
+  eXosip is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+  
+  eXosip is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+  In addition, as a special exception, the copyright holders give
+  permission to link the code of portions of this program with the
+  OpenSSL library under certain conditions as described in each
+  individual source file, and distribute linked combinations
+  including the two.
+  You must obey the GNU General Public License in all respects
+  for all of the code used other than OpenSSL.  If you modify
+  file(s) with this exception, you may extend this exception to your
+  version of the file(s), but you are not obligated to do so.  If you
+  do not wish to do so, delete this exception statement from your
+  version.  If you delete this exception statement from all source
+  files in the program, then also delete it here.
+*/
+
+#include "eXosip2.h"
+
+#include <ctype.h>
+
+/* "user@host" with the host in lower case, from "sip:user@host:port;..." */
+static void
+_eXosip_registrar_key (const char *aor, char *key, size_t size)
+{
+  const char *at;
+  size_t end;
+  size_t len = 0;
+  size_t i;
+
+  while (*aor == ' ' || *aor == '<')
+    aor++;
+  if (osip_strncasecmp (aor, "sips:", 5) == 0)
+    aor += 5;
+  else if (osip_strncasecmp (aor, "sip:", 4) == 0)
+    aor += 4;
+  end = strcspn (aor, ";>? ");
+  at = memchr (aor, '@', end);
+  for (i = 0; i < end && len < size - 1; i++) {
+    if (at != NULL && aor + i <= at)
+      key[len++] = aor[i];
+    else if (aor[i] == ':')
+      break;                    /* port */
+    else
+      key[len++] = (char) tolower ((unsigned char) aor[i]);
+  }
+  key[len] = '\0';
+}
+
+static unsigned int
+_eXosip_registrar_hash (const char *key)
+{
+  unsigned int hash = 2166136261U;
+
+  for (; *key != '\0'; key++)
+    hash = (hash ^ (unsigned char) *key) * 16777619U;
+  return hash;
+}
+
+static struct eXosip_registrar_entry *
+_eXosip_registrar_find (struct eXosip_registrar_table *reg, const char *key, unsigned int hash)
+{
+  struct eXosip_registrar_entry *entry;
+
+  for (entry = reg->buckets[hash & (reg->size - 1)]; entry != NULL; entry = entry->next) {
+    if (entry->hash == hash && strcmp (entry->binding.aor, key) == 0)
+      return entry;
+  }
+  return NULL;
+}
+
+static void
+_eXosip_registrar_wheel_add (struct eXosip_registrar_table *reg, struct eXosip_registrar_entry *entry)
+{
+  struct eXosip_registrar_entry **slot = &reg->wheel[entry->expire % EXOSIP_REGISTRAR_WHEEL];
+
+  entry->wprev = NULL;
+  entry->wnext = *slot;
+  if (*slot != NULL)
+    (*slot)->wprev = entry;
+  *slot = entry;
+}
+
+static void
+_eXosip_registrar_wheel_remove (struct eXosip_registrar_table *reg, struct eXosip_registrar_entry *entry)
+{
+  if (entry->wprev != NULL)
+    entry->wprev->wnext = entry->wnext;
+  else
+    reg->wheel[entry->expire % EXOSIP_REGISTRAR_WHEEL] = entry->wnext;
+  if (entry->wnext != NULL)
+    entry->wnext->wprev = entry->wprev;
+  entry->wnext = NULL;
+  entry->wprev = NULL;
+}
+
+/* double the number of buckets when there are more bindings than buckets */
+static void
+_eXosip_registrar_grow (struct eXosip_registrar_table *reg)
+{
+  struct eXosip_registrar_entry **buckets;
+  struct eXosip_registrar_entry *entry;
+  int size = reg->size * 2;
+  int i;
+
+  buckets = (struct eXosip_registrar_entry **) osip_malloc (size * sizeof (struct eXosip_registrar_entry *));
+  if (buckets == NULL)
+    return;                     /* keep longer chains */
+  memset (buckets, 0, size * sizeof (struct eXosip_registrar_entry *));
+  for (i = 0; i < reg->size; i++) {
+    while ((entry = reg->buckets[i]) != NULL) {
+      reg->buckets[i] = entry->next;
+      entry->next = buckets[entry->hash & (size - 1)];
+      buckets[entry->hash & (size - 1)] = entry;
+    }
+  }
+  osip_free (reg->buckets);
+  reg->buckets = buckets;
+  reg->size = size;
+}
+
+static void
+_eXosip_registrar_notify (struct eXosip_t *excontext, struct eXosip_registrar_entry *entry, time_t now)
+{
+  struct eXosip_registrar_table *reg = excontext->registrar;
+
+  entry->binding.expires = (entry->expire > now) ? (int) (entry->expire - now) : 0;
+  if (reg->config.binding_changed != NULL)
+    reg->config.binding_changed (excontext, &entry->binding, reg->config.arg);
+}
+
+/* remove a binding from the table and the wheel, and free it */
+static void
+_eXosip_registrar_delete (struct eXosip_t *excontext, struct eXosip_registrar_entry *entry, time_t now, int notify)
+{
+  struct eXosip_registrar_table *reg = excontext->registrar;
+  struct eXosip_registrar_entry **prev = &reg->buckets[entry->hash & (reg->size - 1)];
+
+  while (*prev != entry)
+    prev = &(*prev)->next;
+  *prev = entry->next;
+  _eXosip_registrar_wheel_remove (reg, entry);
+  reg->count--;
+  if (notify) {
+    entry->expire = now;
+    _eXosip_registrar_notify (excontext, entry, now);
+  }
+  osip_free (entry);
+}
+
+static void
+_eXosip_registrar_free (struct eXosip_registrar_table *reg)
+{
+  struct eXosip_registrar_entry *entry;
+  int i;
+
+  for (i = 0; i < reg->size; i++) {
+    while ((entry = reg->buckets[i]) != NULL) {
+      reg->buckets[i] = entry->next;
+      osip_free (entry);
+    }
+  }
+  osip_free (reg->buckets);
+  osip_free (reg->nonces);
+  osip_free (reg);
+}
+
+int
+_eXosip_registrar_start (struct eXosip_t *excontext, const struct eXosip_registrar *config)
+{
+  struct eXosip_registrar_table *reg = excontext->registrar;
+  struct eXosip_registrar_nonce *nonces = NULL;
+  int max_nonces;
+  int sets;
+
+  if (config == NULL) {
+    if (reg != NULL) {
+      excontext->registrar = NULL;
+      _eXosip_registrar_free (reg);
+      _eXosip_stateless_cache_flush (excontext);
+    }
+    return OSIP_SUCCESS;
+  }
+
+  max_nonces = (config->max_nonces > 0) ? config->max_nonces : EXOSIP_REGISTRAR_NONCES;
+  sets = (max_nonces + EXOSIP_REGISTRAR_NONCE_WAYS - 1) / EXOSIP_REGISTRAR_NONCE_WAYS;
+  if (reg == NULL || sets != reg->nonce_sets) {
+    /* pending challenges are lost: their answers are challenged again */
+    nonces = (struct eXosip_registrar_nonce *) osip_malloc (sets * EXOSIP_REGISTRAR_NONCE_WAYS * sizeof (struct eXosip_registrar_nonce));
+    if (nonces == NULL)
+      return OSIP_NOMEM;
+    memset (nonces, 0, sets * EXOSIP_REGISTRAR_NONCE_WAYS * sizeof (struct eXosip_registrar_nonce));
+  }
+
+  if (reg == NULL) {
+    reg = (struct eXosip_registrar_table *) osip_malloc (sizeof (struct eXosip_registrar_table));
+    if (reg == NULL) {
+      osip_free (nonces);
+      return OSIP_NOMEM;
+    }
+    memset (reg, 0, sizeof (struct eXosip_registrar_table));
+    reg->size = 1024;
+    reg->buckets = (struct eXosip_registrar_entry **) osip_malloc (reg->size * sizeof (struct eXosip_registrar_entry *));
+    if (reg->buckets == NULL) {
+      osip_free (nonces);
+      osip_free (reg);
+      return OSIP_NOMEM;
+    }
+    memset (reg->buckets, 0, reg->size * sizeof (struct eXosip_registrar_entry *));
+    _eXosip_id_format (reg->secret, sizeof (reg->secret));
+    reg->wheel_time = osip_getsystemtime (NULL);
+    excontext->registrar = reg;
+  }
+  if (nonces != NULL) {
+    osip_free (reg->nonces);
+    reg->nonces = nonces;
+    reg->nonce_sets = sets;
+  }
+
+  memcpy (&reg->config, config, sizeof (struct eXosip_registrar));
+  reg->config.max_nonces = max_nonces;
+  if (reg->config.min_expires <= 0)
+    reg->config.min_expires = 60;
+  if (reg->config.max_expires <= 0)
+    reg->config.max_expires = 3600;
+  if (reg->config.max_expires < reg->config.min_expires)
+    reg->config.max_expires = reg->config.min_expires;
+  return OSIP_SUCCESS;
+}
+
+/* remove the bindings expired since the last call */
+void
+_eXosip_registrar_expire (struct eXosip_t *excontext, time_t now)
+{
+  struct eXosip_registrar_table *reg = excontext->registrar;
+  struct eXosip_registrar_entry *entry;
+  struct eXosip_registrar_entry *next;
+  time_t t;
+
+  if (reg == NULL || now <= reg->wheel_time)
+    return;
+  t = reg->wheel_time + 1;
+  if (now - reg->wheel_time > EXOSIP_REGISTRAR_WHEEL)
+    t = now - EXOSIP_REGISTRAR_WHEEL + 1;
+  for (; t <= now; t++) {
+    for (entry = reg->wheel[t % EXOSIP_REGISTRAR_WHEEL]; entry != NULL; entry = next) {
+      next = entry->wnext;
+      if (entry->expire <= now) {
+        OSIP_TRACE (osip_trace (__FILE__, __LINE__, OSIP_INFO2, NULL, "eXosip: registrar binding expired (%s)\n", entry->binding.aor));
+        _eXosip_registrar_delete (excontext, entry, now, 1);
+      }
+    }
+  }
+  reg->wheel_time = now;
+}
+
+/* slot of a nonce given in a challenge, NULL when it was replaced */
+static struct eXosip_registrar_nonce *
+_eXosip_registrar_nonce_find (struct eXosip_registrar_table *reg, const char *nonce)
+{
+  struct eXosip_registrar_nonce *set = &reg->nonces[(_eXosip_registrar_hash (nonce) % reg->nonce_sets) * EXOSIP_REGISTRAR_NONCE_WAYS];
+  int way;
+
+  for (way = 0; way < EXOSIP_REGISTRAR_NONCE_WAYS; way++) {
+    if (set[way].created != 0 && strcmp (set[way].nonce, nonce) == 0)
+      return &set[way];
+  }
+  return NULL;
+}
+
+/* keep a new nonce in a free or expired slot of its set, or in place of
+   the oldest one */
+static void
+_eXosip_registrar_nonce_add (struct eXosip_registrar_table *reg, const char *nonce, time_t now)
+{
+  struct eXosip_registrar_nonce *set = &reg->nonces[(_eXosip_registrar_hash (nonce) % reg->nonce_sets) * EXOSIP_REGISTRAR_NONCE_WAYS];
+  struct eXosip_registrar_nonce *slot = set;
+  int way;
+
+  for (way = 0; way < EXOSIP_REGISTRAR_NONCE_WAYS; way++) {
+    if (set[way].created == 0 || set[way].created + EXOSIP_REGISTRAR_NONCE_LIFETIME <= now) {
+      slot = &set[way];
+      break;
+    }
+    if (set[way].created < slot->created)
+      slot = &set[way];
+  }
+  if (way == EXOSIP_REGISTRAR_NONCE_WAYS)
+    OSIP_TRACE (osip_trace (__FILE__, __LINE__, OSIP_INFO2, NULL, "eXosip: registrar: pending challenge replaced (max_nonces=%i)\n", reg->config.max_nonces));
+  osip_strncpy (slot->nonce, nonce, sizeof (slot->nonce) - 1);
+  slot->nc = 0;
+  slot->created = now;
+}
+
+/* 200: authenticated, 401: (new) challenge required, 403: rejected.
+   Each nonce is accepted with increasing nonce counts only: a replayed
+   request, or a nonce no longer in the table, gets a stale challenge. */
+static int
+_eXosip_registrar_authenticate (struct eXosip_t *excontext, osip_message_t * request, time_t now, char *username, size_t size, int *stale)
+{
+  struct eXosip_registrar_table *reg = excontext->registrar;
+  struct eXosip_registrar_nonce *slot;
+  osip_authorization_t *auth = NULL;
+  char realm[128];
+  char nonce[EXOSIP_DIGEST_NONCE_LEN + 2];      /* a longer nonce is not truncated to a valid one */
+  char nc[16];
+  char passwd[128];
+  unsigned int count;
+  int pos;
+  int i;
+
+  *stale = 0;
+  for (pos = 0; osip_message_get_authorization (request, pos, &auth) >= 0; pos++) {
+    if (auth->realm != NULL && strcmp (_eXosip_digest_param (auth->realm, realm, sizeof (realm)), reg->config.realm) == 0)
+      break;
+    auth = NULL;
+  }
+  if (auth == NULL || auth->username == NULL || auth->nonce == NULL)
+    return 401;
+
+  i = _eXosip_digest_nonce_check (reg->secret, _eXosip_digest_param (auth->nonce, nonce, sizeof (nonce)), now, EXOSIP_REGISTRAR_NONCE_LIFETIME);
+  if (i == OSIP_WRONG_STATE)
+    *stale = 1;
+  if (i != OSIP_SUCCESS)
+    return 401;
+  slot = _eXosip_registrar_nonce_find (reg, nonce);
+  if (slot == NULL) {
+    *stale = 1;                 /* replaced by a newer challenge */
+    return 401;
+  }
+
+  _eXosip_digest_param (auth->username, username, size);
+  passwd[0] = '\0';
+  if (reg->config.get_password (excontext, username, reg->config.realm, passwd, sizeof (passwd), reg->config.arg) != 0) {
+    OSIP_TRACE (osip_trace (__FILE__, __LINE__, OSIP_WARNING, NULL, "eXosip: registrar: unknown user (%s)\n", username));
+    return 403;
+  }
+  if (_eXosip_digest_check (auth, "REGISTER", request->req_uri, 1, passwd) != OSIP_SUCCESS) {
+    OSIP_TRACE (osip_trace (__FILE__, __LINE__, OSIP_WARNING, NULL, "eXosip: registrar: wrong credentials (%s)\n", username));
+    return 403;
+  }
+
+  count = (unsigned int) strtoul (_eXosip_digest_param (auth->nonce_count, nc, sizeof (nc)), NULL, 16);
+  if (count <= slot->nc) {
+    OSIP_TRACE (osip_trace (__FILE__, __LINE__, OSIP_WARNING, NULL, "eXosip: registrar: replayed nonce count %s (%s)\n", nc, username));
+    *stale = 1;
+    return 401;
+  }
+  slot->nc = count;
+
+  /* a user registers its own address of record only */
+  if (request->to->url->username == NULL || strcmp (request->to->url->username, username) != 0) {
+    OSIP_TRACE (osip_trace (__FILE__, __LINE__, OSIP_WARNING, NULL, "eXosip: registrar: %s cannot register %s@%s\n", username, request->to->url->username != NULL ? request->to->url->username : "", request->to->url->host));
+    return 403;
+  }
+  return 200;
+}
+
+static int
+_eXosip_registrar_challenge (struct eXosip_t *excontext, osip_message_t * answer, time_t now, int stale)
+{
+  struct eXosip_registrar_table *reg = excontext->registrar;
+  char nonce[EXOSIP_DIGEST_NONCE_LEN + 1];
+  char challenge[256];
+
+  _eXosip_digest_nonce_create (reg->secret, now, nonce, sizeof (nonce));
+  _eXosip_registrar_nonce_add (reg, nonce, now);
+  snprintf (challenge, sizeof (challenge), "Digest realm=\"%s\", nonce=\"%s\", algorithm=MD5, qop=\"auth\"%s", reg->config.realm, nonce, stale ? ", stale=true" : "");
+  return osip_message_set_www_authenticate (answer, challenge);
+}
+
+/* source of the request, from the received and rport parameters set on
+   the top Via by the transport layer */
+static void
+_eXosip_registrar_flow (osip_message_t * request, osip_uri_t * contact, struct eXosip_registrar_binding *binding)
+{
+  osip_via_t *via = NULL;
+  osip_generic_param_t *received = NULL;
+  osip_generic_param_t *rport = NULL;
+  const char *ip;
+  int port;
+
+  binding->route[0] = '\0';
+  osip_message_get_via (request, 0, &via);
+  if (via == NULL || via->host == NULL)
+    return;
+  osip_via_param_get_byname (via, "received", &received);
+  osip_via_param_get_byname (via, "rport", &rport);
+  ip = (received != NULL && received->gvalue != NULL) ? received->gvalue : via->host;
+  port = 5060;
+  if (rport != NULL && rport->gvalue != NULL)
+    port = osip_atoi (rport->gvalue);
+  else if (via->port != NULL)
+    port = osip_atoi (via->port);
+  snprintf (binding->received_ip, sizeof (binding->received_ip), "%s", ip);
+  binding->received_port = port;
+  snprintf (binding->transport, sizeof (binding->transport), "%s", via->protocol != NULL ? via->protocol : "UDP");
+
+  if (contact->host != NULL && osip_strcasecmp (contact->host, ip) == 0 && (contact->port != NULL ? osip_atoi (contact->port) : 5060) == port)
+    return;
+  snprintf (binding->route, sizeof (binding->route), strchr (ip, ':') != NULL ? "<sip:[%s]:%i%s%s;lr>" : "<sip:%s:%i%s%s;lr>", ip, port, osip_strcasecmp (binding->transport, "UDP") == 0 ? "" : ";transport=", osip_strcasecmp (binding->transport, "UDP") == 0 ? "" : binding->transport);
+}
+
+/* delta-seconds of an Expires header or parameter, -1 when malformed */
+static int
+_eXosip_registrar_expires (const char *value)
+{
+  long expires = 0;
+
+  while (*value == ' ' || *value == '\t')
+    value++;
+  if (*value < '0' || *value > '9')
+    return -1;
+  for (; *value >= '0' && *value <= '9'; value++) {
+    if (expires < 0x7fffffff / 10)
+      expires = expires * 10 + (*value - '0');
+  }
+  while (*value == ' ' || *value == '\t')
+    value++;
+  return (*value == '\0') ? (int) expires : -1;
+}
+
+/* add or refresh the binding of an address of record */
+static int
+_eXosip_registrar_update (struct eXosip_t *excontext, osip_message_t * request, osip_contact_t * contact, const char *key, unsigned int hash, const char *username, time_t now, int expires, struct eXosip_registrar_entry **dest)
+{
+  struct eXosip_registrar_table *reg = excontext->registrar;
+  struct eXosip_registrar_entry *entry = *dest;
+  struct eXosip_registrar_binding previous;
+  char *uri = NULL;
+  int i;
+
+  i = osip_uri_to_str (contact->url, &uri);
+  if (i != 0)
+    return i;
+
+  if (entry == NULL) {
+    entry = (struct eXosip_registrar_entry *) osip_malloc (sizeof (struct eXosip_registrar_entry));
+    if (entry == NULL) {
+      osip_free (uri);
+      return OSIP_NOMEM;
+    }
+    memset (entry, 0, sizeof (struct eXosip_registrar_entry));
+    snprintf (entry->binding.aor, sizeof (entry->binding.aor), "%s", key);
+    entry->hash = hash;
+    if (reg->count >= reg->size)
+      _eXosip_registrar_grow (reg);
+    entry->next = reg->buckets[hash & (reg->size - 1)];
+    reg->buckets[hash & (reg->size - 1)] = entry;
+    reg->count++;
+  }
+  else
+    _eXosip_registrar_wheel_remove (reg, entry);
+
+  memcpy (&previous, &entry->binding, sizeof (previous));
+  snprintf (entry->binding.contact, sizeof (entry->binding.contact), "%s", uri);
+  snprintf (entry->binding.username, sizeof (entry->binding.username), "%s", username);
+  _eXosip_registrar_flow (request, contact->url, &entry->binding);
+  osip_free (uri);
+  entry->expire = now + expires;
+  _eXosip_registrar_wheel_add (reg, entry);
+
+  if (*dest == NULL || strcmp (previous.contact, entry->binding.contact) != 0 || strcmp (previous.received_ip, entry->binding.received_ip) != 0 || previous.received_port != entry->binding.received_port
+      || osip_strcasecmp (previous.transport, entry->binding.transport) != 0)
+    _eXosip_registrar_notify (excontext, entry, now);
+  *dest = entry;
+  return OSIP_SUCCESS;
+}
+
+/* build the answer to a REGISTER and update the bindings */
+int
+_eXosip_registrar_answer (struct eXosip_t *excontext, osip_message_t * request, osip_message_t ** answer)
+{
+  struct eXosip_registrar_table *reg = excontext->registrar;
+  struct eXosip_registrar_entry *entry;
+  osip_contact_t *contact = NULL;
+  osip_header_t *header = NULL;
+  char username[64];
+  char aor[256];
+  char key[256];
+  unsigned int hash;
+  time_t now;
+  int expires;
+  int i;
+
+  *answer = NULL;
+  if (request->to == NULL || request->to->url == NULL || request->to->url->host == NULL)
+    return _eXosip_build_response_default (excontext, answer, NULL, 400, request);
+
+  now = osip_getsystemtime (NULL);
+  username[0] = '\0';
+  if (reg->config.get_password != NULL) {
+    int stale;
+    int status = _eXosip_registrar_authenticate (excontext, request, now, username, sizeof (username), &stale);
+
+    if (status != 200) {
+      i = _eXosip_build_response_default (excontext, answer, NULL, status, request);
+      if (i != 0)
+        return i;
+      if (status == 401)
+        _eXosip_registrar_challenge (excontext, *answer, now, stale);
+      return OSIP_SUCCESS;
+    }
+  }
+
+  if (request->to->url->username != NULL)
+    snprintf (aor, sizeof (aor), "%s@%s", request->to->url->username, request->to->url->host);
+  else
+    snprintf (aor, sizeof (aor), "%s", request->to->url->host);
+  _eXosip_registrar_key (aor, key, sizeof (key));
+  hash = _eXosip_registrar_hash (key);
+  entry = _eXosip_registrar_find (reg, key, hash);
+
+  expires = reg->config.max_expires;
+  osip_message_get_expires (request, 0, &header);
+  if (header != NULL)
+    expires = (header->hvalue != NULL) ? _eXosip_registrar_expires (header->hvalue) : -1;
+  osip_message_get_contact (request, 0, &contact);
+  if (contact != NULL && contact->url != NULL) {
+    osip_generic_param_t *param = NULL;
+
+    osip_contact_param_get_byname (contact, "expires", &param);
+    if (param != NULL)
+      expires = (param->gvalue != NULL) ? _eXosip_registrar_expires (param->gvalue) : -1;
+  }
+  if (expires < 0) {
+    OSIP_TRACE (osip_trace (__FILE__, __LINE__, OSIP_WARNING, NULL, "eXosip: registrar: malformed expires (%s)\n", key));
+    return _eXosip_build_response_default (excontext, answer, NULL, 400, request);
+  }
+  /* "Contact: *" only with "Expires: 0" and no other Contact (rfc3261 10.3) */
+  if (contact != NULL && contact->url == NULL && (header == NULL || expires != 0 || osip_list_size (&request->contacts) > 1))
+    return _eXosip_build_response_default (excontext, answer, NULL, 400, request);
+
+  if (contact == NULL) {
+    /* query of the bindings */
+  }
+  else if (contact->url == NULL || expires == 0) {
+    /* "Contact: *", or expires=0 for the contact bound */
+    char *uri = NULL;
+
+    if (contact->url != NULL && entry != NULL)
+      osip_uri_to_str (contact->url, &uri);
+    if (entry != NULL && (contact->url == NULL || (uri != NULL && strcmp (uri, entry->binding.contact) == 0))) {
+      _eXosip_registrar_delete (excontext, entry, now, 1);
+      entry = NULL;
+    }
+    osip_free (uri);
+  }
+  else if (expires < reg->config.min_expires) {
+    char min_expires[16];
+
+    i = _eXosip_build_response_default (excontext, answer, NULL, 423, request);
+    if (i != 0)
+      return i;
+    snprintf (min_expires, sizeof (min_expires), "%i", reg->config.min_expires);
+    osip_message_set_header (*answer, "Min-Expires", min_expires);
+    return OSIP_SUCCESS;
+  }
+  else {
+    if (expires > reg->config.max_expires)
+      expires = reg->config.max_expires;
+    i = _eXosip_registrar_update (excontext, request, contact, key, hash, username, now, expires, &entry);
+    if (i != 0)
+      return i;
+  }
+
+  i = _eXosip_build_response_default (excontext, answer, NULL, 200, request);
+  if (i != 0)
+    return i;
+  if (entry != NULL && entry->expire > now) {
+    char *value = (char *) osip_malloc (strlen (entry->binding.contact) + 32);
+
+    if (value != NULL) {
+      sprintf (value, "<%s>;expires=%i", entry->binding.contact, (int) (entry->expire - now));
+      osip_message_set_contact (*answer, value);
+      osip_free (value);
+    }
+  }
+  return OSIP_SUCCESS;
+}
+
+int
+eXosip_registrar_lookup (struct eXosip_t *excontext, const char *aor, struct eXosip_registrar_binding *binding)
+{
+  struct eXosip_registrar_entry *entry = NULL;
+  char key[256];
+  time_t now;
+
+  if (aor == NULL || binding == NULL)
+    return OSIP_BADPARAMETER;
+  _eXosip_registrar_key (aor, key, sizeof (key));
+
+  eXosip_lock (excontext);
+  now = osip_getsystemtime (NULL);
+  if (excontext->registrar != NULL)
+    entry = _eXosip_registrar_find (excontext->registrar, key, _eXosip_registrar_hash (key));
+  if (entry == NULL || entry->expire <= now) {
+    eXosip_unlock (excontext);
+    return OSIP_NOTFOUND;
+  }
+  memcpy (binding, &entry->binding, sizeof (struct eXosip_registrar_binding));
+  binding->expires = (int) (entry->expire - now);
+  eXosip_unlock (excontext);
+  return OSIP_SUCCESS;
+}
+
+int
+eXosip_registrar_remove (struct eXosip_t *excontext, const char *aor)
+{
+  struct eXosip_registrar_entry *entry = NULL;
+  char key[256];
+
+  if (aor == NULL)
+    return OSIP_BADPARAMETER;
+  _eXosip_registrar_key (aor, key, sizeof (key));
+
+  eXosip_lock (excontext);
+  if (excontext->registrar != NULL)
+    entry = _eXosip_registrar_find (excontext->registrar, key, _eXosip_registrar_hash (key));
+  if (entry == NULL) {
+    eXosip_unlock (excontext);
+    return OSIP_NOTFOUND;
+  }
+  _eXosip_registrar_delete (excontext, entry, osip_getsystemtime (NULL), 0);
+  eXosip_unlock (excontext);
+  return OSIP_SUCCESS;
+}
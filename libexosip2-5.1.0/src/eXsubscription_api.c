@@ -200,6 +200,7 @@ eXosip_subscription_send_initial_request (struct eXosip_t *excontext, osip_messa
   js->s_reg_period = 3600;
   _eXosip_subscription_set_refresh_interval (js, subscribe);
   js->s_out_tr = transaction;
+  _eXosip_deadline_set (excontext, EXOSIP_DEADLINE_SUBSCRIBE, js, osip_getsystemtime (NULL));
 
   sipevent = osip_new_outgoing_sipmessage (subscribe);
   sipevent->transactionid = transaction->transactionid;
@@ -337,6 +338,7 @@ eXosip_subscription_send_refresh_request (struct eXosip_t *excontext, int did, o
   js->s_reg_period = 3600;
   _eXosip_subscription_set_refresh_interval (js, sub);
   osip_list_add (jd->d_out_trs, transaction, 0);
+  _eXosip_deadline_set (excontext, EXOSIP_DEADLINE_SUBSCRIBE, js, osip_getsystemtime (NULL));
 
   sipevent = osip_new_outgoing_sipmessage (sub);
   sipevent->transactionid = transaction->transactionid;
@@ -525,6 +527,7 @@ _eXosip_subscription_send_request_with_credential (struct eXosip_t *excontext, e
     /* add the new tr for the current dialog */
     osip_list_add (jd->d_out_trs, tr, 0);
   }
+  _eXosip_deadline_set (excontext, EXOSIP_DEADLINE_SUBSCRIBE, js, osip_getsystemtime (NULL));
 
   sipevent = osip_new_outgoing_sipmessage (msg);
 
@@ -486,6 +486,11 @@ _tcp_tl_recv (struct eXosip_t *excontext, struct _tcp_stream *sockinfo)
       return OSIP_SUCCESS;
     /* Do we need next line ? */
     /* else if (is_connreset_error(status)) */
+    if (is_connreset_error (status)) {
+      eXosip_lock (excontext);
+      _eXosip_peer_health_failure (excontext, sockinfo->remote_ip, sockinfo->remote_port, 0);
+      eXosip_unlock (excontext);
+    }
     _eXosip_mark_registration_expired (excontext, sockinfo->reg_call_id);
     OSIP_TRACE (osip_trace (__FILE__, __LINE__, OSIP_INFO1, NULL, "socket %s:%i: error %d\n", sockinfo->remote_ip, sockinfo->remote_port, status));
     _tcp_tl_close_sockinfo (sockinfo);
@@ -774,10 +779,12 @@ _tcp_tl_connect_socket (struct eXosip_t *excontext, char *host, int port)
   int sock = -1;
   struct sockaddr selected_ai_addr;
   socklen_t selected_ai_addrlen;
+  char oc_local_address[sizeof (excontext->oc_local_address)];
 
   char src6host[NI_MAXHOST];
 
   memset (src6host, 0, sizeof (src6host));
+  _eXosip_config_get (excontext, excontext->oc_local_address, oc_local_address, sizeof (oc_local_address));
 
   selected_ai_addrlen = 0;
   memset (&selected_ai_addr, 0, sizeof (struct sockaddr));
@@ -875,7 +882,7 @@ _tcp_tl_connect_socket (struct eXosip_t *excontext, char *host, int port)
           OSIP_TRACE (osip_trace (__FILE__, __LINE__, OSIP_WARNING, NULL, "Cannot bind socket node:%s family:%d %s\n", excontext->eXtl_transport.proto_ifs, ai_addr.ss_family, strerror (ex_errno)));
         }
       }
-      else if (excontext->oc_local_address[0] == '\0') {
+      else if (oc_local_address[0] == '\0') {
         if (reserved->ai_addr.ss_family == curinfo->ai_family) {
           struct sockaddr_storage ai_addr;
           int count = 0;
@@ -929,7 +936,7 @@ _tcp_tl_connect_socket (struct eXosip_t *excontext, char *host, int port)
           if (excontext->oc_local_port_current >= excontext->oc_local_port_range[1])
             excontext->oc_local_port_current = excontext->oc_local_port_range[0];
 
-          _eXosip_get_addrinfo (excontext, &oc_addrinfo, excontext->oc_local_address, excontext->oc_local_port_current, IPPROTO_TCP);
+          _eXosip_get_addrinfo (excontext, &oc_addrinfo, oc_local_address, excontext->oc_local_port_current, IPPROTO_TCP);
 
           for (oc_curinfo = oc_addrinfo; oc_curinfo; oc_curinfo = oc_curinfo->ai_next) {
             if (oc_curinfo->ai_protocol && oc_curinfo->ai_protocol != IPPROTO_TCP) {
@@ -945,7 +952,7 @@ _tcp_tl_connect_socket (struct eXosip_t *excontext, char *host, int port)
           }
           res = bind (sock, (const struct sockaddr *) oc_curinfo->ai_addr, (socklen_t) oc_curinfo->ai_addrlen);
           if (res < 0) {
-            OSIP_TRACE (osip_trace (__FILE__, __LINE__, OSIP_WARNING, NULL, "Cannot bind socket node:%s family:%d (port=%i) %s\n", excontext->oc_local_address, oc_curinfo->ai_addr->sa_family, excontext->oc_local_port_current, strerror (ex_errno)));
+            OSIP_TRACE (osip_trace (__FILE__, __LINE__, OSIP_WARNING, NULL, "Cannot bind socket node:%s family:%d (port=%i) %s\n", oc_local_address, oc_curinfo->ai_addr->sa_family, excontext->oc_local_port_current, strerror (ex_errno)));
             _eXosip_freeaddrinfo (oc_addrinfo);
             count++;
             if (excontext->oc_local_port_range[0] != 0)
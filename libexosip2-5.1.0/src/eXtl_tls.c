@@ -2158,10 +2158,12 @@ _tls_tl_connect_socket (struct eXosip_t *excontext, char *host, int port, int re
   int ssl_state = 0;
   struct sockaddr selected_ai_addr;
   socklen_t selected_ai_addrlen;
+  char oc_local_address[sizeof (excontext->oc_local_address)];
 
   char src6host[NI_MAXHOST];
 
   memset (src6host, 0, sizeof (src6host));
+  _eXosip_config_get (excontext, excontext->oc_local_address, oc_local_address, sizeof (oc_local_address));
 
   selected_ai_addrlen = 0;
   memset (&selected_ai_addr, 0, sizeof (struct sockaddr));
@@ -2257,7 +2259,7 @@ _tls_tl_connect_socket (struct eXosip_t *excontext, char *host, int port, int re
           OSIP_TRACE (osip_trace (__FILE__, __LINE__, OSIP_WARNING, NULL, "Cannot bind socket node:%s family:%d %s\n", excontext->eXtl_transport.proto_ifs, ai_addr.ss_family, strerror (ex_errno)));
         }
       }
-      else if (excontext->oc_local_address[0] == '\0') {
+      else if (oc_local_address[0] == '\0') {
         if (reserved->ai_addr.ss_family == curinfo->ai_family) {
           struct sockaddr_storage ai_addr;
           int count = 0;
@@ -2311,7 +2313,7 @@ _tls_tl_connect_socket (struct eXosip_t *excontext, char *host, int port, int re
           if (excontext->oc_local_port_current >= excontext->oc_local_port_range[1])
             excontext->oc_local_port_current = excontext->oc_local_port_range[0];
 
-          _eXosip_get_addrinfo (excontext, &oc_addrinfo, excontext->oc_local_address, excontext->oc_local_port_current, IPPROTO_TCP);
+          _eXosip_get_addrinfo (excontext, &oc_addrinfo, oc_local_address, excontext->oc_local_port_current, IPPROTO_TCP);
 
           for (oc_curinfo = oc_addrinfo; oc_curinfo; oc_curinfo = oc_curinfo->ai_next) {
             if (oc_curinfo->ai_protocol && oc_curinfo->ai_protocol != IPPROTO_TCP) {
@@ -2327,7 +2329,7 @@ _tls_tl_connect_socket (struct eXosip_t *excontext, char *host, int port, int re
           }
           res = bind (sock, (const struct sockaddr *) oc_curinfo->ai_addr, (socklen_t) oc_curinfo->ai_addrlen);
           if (res < 0) {
-            OSIP_TRACE (osip_trace (__FILE__, __LINE__, OSIP_WARNING, NULL, "Cannot bind socket node:%s family:%d (port=%i) %s\n", excontext->oc_local_address, curinfo->ai_addr->sa_family, excontext->oc_local_port_current, strerror (ex_errno)));
+            OSIP_TRACE (osip_trace (__FILE__, __LINE__, OSIP_WARNING, NULL, "Cannot bind socket node:%s family:%d (port=%i) %s\n", oc_local_address, curinfo->ai_addr->sa_family, excontext->oc_local_port_current, strerror (ex_errno)));
             count++;
             if (excontext->oc_local_port_range[0] != 0)
               excontext->oc_local_port_current++;
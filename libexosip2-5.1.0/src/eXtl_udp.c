@@ -305,6 +305,72 @@ _eXosip_transport_set_dscp (struct eXosip_t *excontext, int family, int sock)
 #endif
 }
 
+#if defined(IP_RECVERR)
+/* the socket is also readable with only ICMP errors queued: never block */
+#define UDP_TL_RECV_FLAGS MSG_DONTWAIT
+
+/* With the health tracking of destinations, ICMP errors (port or host
+   unreachable) are queued on the socket instead of being dropped: each
+   one counts as a failure of the destination. */
+static void
+_udp_tl_set_recverr (struct eXosip_t *excontext, int sock, int family)
+{
+  int val = 1;
+
+  if (excontext->peer_health.max_failures <= 0)
+    return;
+  if (family == AF_INET)
+    setsockopt (sock, IPPROTO_IP, IP_RECVERR, (void *) &val, sizeof (val));
+#if defined(IPV6_RECVERR)
+  else if (family == AF_INET6)
+    setsockopt (sock, IPPROTO_IPV6, IPV6_RECVERR, (void *) &val, sizeof (val));
+#endif
+}
+
+/* must be called with eXosip_lock held: the queue has to be drained
+   completely or the socket stays readable. */
+static void
+_udp_tl_read_error_queue (struct eXosip_t *excontext, int sock)
+{
+  int count;
+
+  for (count = 0; count < 64; count++) {
+    struct sockaddr_storage sa;
+    struct msghdr msg;
+    struct iovec iov;
+    char buf[64];
+    char control[512];
+    char host[NI_MAXHOST];
+    char serv[16];
+
+    memset (&msg, 0, sizeof (msg));
+    iov.iov_base = buf;
+    iov.iov_len = sizeof (buf);
+    msg.msg_name = &sa;
+    msg.msg_namelen = sizeof (sa);
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof (control);
+
+    if (recvmsg (sock, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0)
+      return;
+    if (msg.msg_namelen == 0)
+      continue;
+
+    memset (host, 0, sizeof (host));
+    memset (serv, 0, sizeof (serv));
+    _eXosip_getnameinfo ((struct sockaddr *) &sa, msg.msg_namelen, host, sizeof (host), serv, sizeof (serv), NI_NUMERICHOST | NI_NUMERICSERV);
+    if (host[0] == '\0')
+      continue;
+    OSIP_TRACE (osip_trace (__FILE__, __LINE__, OSIP_INFO1, NULL, "ICMP error received for destination %s:%s\n", host, serv));
+    _eXosip_peer_health_failure (excontext, host, atoi (serv), 0);
+  }
+}
+#else
+#define UDP_TL_RECV_FLAGS 0
+#endif
+
 static int
 _udp_tl_open (struct eXosip_t *excontext, int force_family)
 {
@@ -387,6 +453,10 @@ _udp_tl_open (struct eXosip_t *excontext, int force_family)
     }
 #endif
 
+#if defined(IP_RECVERR)
+    _udp_tl_set_recverr (excontext, sock, curinfo->ai_family);
+#endif
+
 #ifdef TSC_SUPPORT
     if (excontext->tunnel_handle) {
       tsc_config config;
@@ -480,11 +550,13 @@ _udp_tl_open_oc (struct eXosip_t *excontext, int force_family)
   struct addrinfo *addrinfo = NULL;
   struct addrinfo *curinfo;
   int sock = -1;
+  char oc_local_address[sizeof (excontext->oc_local_address)];
 
-  if (excontext->oc_local_address[0] == '\0')
+  _eXosip_config_get (excontext, excontext->oc_local_address, oc_local_address, sizeof (oc_local_address));
+  if (oc_local_address[0] == '\0')
     return OSIP_SUCCESS;
 
-  res = _eXosip_get_addrinfo (excontext, &addrinfo, excontext->oc_local_address, excontext->oc_local_port_range[0], excontext->eXtl_transport.proto_num);
+  res = _eXosip_get_addrinfo (excontext, &addrinfo, oc_local_address, excontext->oc_local_port_range[0], excontext->eXtl_transport.proto_num);
   if (res)
     return -1;
 
@@ -545,6 +617,10 @@ _udp_tl_open_oc (struct eXosip_t *excontext, int force_family)
     }
 #endif
 
+#if defined(IP_RECVERR)
+    _udp_tl_set_recverr (excontext, sock, curinfo->ai_family);
+#endif
+
 #ifdef TSC_SUPPORT
     if (excontext->tunnel_handle) {
       tsc_config config;
@@ -734,10 +810,10 @@ udp_tl_read_message (struct eXosip_t *excontext, fd_set * osip_fdset, fd_set * o
       i = tsc_recvfrom (reserved->udp_socket, reserved->buf, udp_message_max_length, 0, (struct sockaddr *) &sa, &slen);
     }
     else {
-      i = recvfrom (reserved->udp_socket, reserved->buf, udp_message_max_length, 0, (struct sockaddr *) &sa, &slen);
+      i = recvfrom (reserved->udp_socket, reserved->buf, udp_message_max_length, UDP_TL_RECV_FLAGS, (struct sockaddr *) &sa, &slen);
     }
 #else
-    i = (int) recvfrom (reserved->udp_socket, reserved->buf, udp_message_max_length, 0, (struct sockaddr *) &sa, &slen);
+    i = (int) recvfrom (reserved->udp_socket, reserved->buf, udp_message_max_length, UDP_TL_RECV_FLAGS, (struct sockaddr *) &sa, &slen);
 #endif
 
     if (i > 32) {
@@ -794,6 +870,11 @@ udp_tl_read_message (struct eXosip_t *excontext, fd_set * osip_fdset, fd_set * o
       if (my_errno == 57) {
         _udp_tl_reset (excontext, reserved->udp_socket_family);
       }
+#if defined(IP_RECVERR)
+      eXosip_lock (excontext);
+      _udp_tl_read_error_queue (excontext, reserved->udp_socket);
+      eXosip_unlock (excontext);
+#endif
     }
     else {
       OSIP_TRACE (osip_trace (__FILE__, __LINE__, OSIP_INFO1, NULL, "Dummy SIP message received\n"));
@@ -818,10 +899,10 @@ udp_tl_read_message (struct eXosip_t *excontext, fd_set * osip_fdset, fd_set * o
       i = tsc_recvfrom (reserved->udp_socket_oc, reserved->buf, udp_message_max_length, 0, (struct sockaddr *) &sa, &slen);
     }
     else {
-      i = recvfrom (reserved->udp_socket_oc, reserved->buf, udp_message_max_length, 0, (struct sockaddr *) &sa, &slen);
+      i = recvfrom (reserved->udp_socket_oc, reserved->buf, udp_message_max_length, UDP_TL_RECV_FLAGS, (struct sockaddr *) &sa, &slen);
     }
 #else
-    i = (int) recvfrom (reserved->udp_socket_oc, reserved->buf, udp_message_max_length, 0, (struct sockaddr *) &sa, &slen);
+    i = (int) recvfrom (reserved->udp_socket_oc, reserved->buf, udp_message_max_length, UDP_TL_RECV_FLAGS, (struct sockaddr *) &sa, &slen);
 #endif
 
     if (i > 32) {
@@ -853,6 +934,11 @@ udp_tl_read_message (struct eXosip_t *excontext, fd_set * osip_fdset, fd_set * o
       if (my_errno == 57) {
         _udp_tl_reset_oc (excontext, reserved->udp_socket_oc_family);
       }
+#if defined(IP_RECVERR)
+      eXosip_lock (excontext);
+      _udp_tl_read_error_queue (excontext, reserved->udp_socket_oc);
+      eXosip_unlock (excontext);
+#endif
     }
     else {
       OSIP_TRACE (osip_trace (__FILE__, __LINE__, OSIP_INFO1, NULL, "Dummy SIP message received\n"));
@@ -1000,6 +1086,90 @@ _udp_tl_update_contact (struct eXosip_t *excontext, osip_message_t * req)
 #define INET6_ADDRSTRLEN 65
 #endif
 
+#ifdef HAVE_WINSOCK2_H
+#define CAST_RECV_LEN(L) ((int)(L))
+#else
+#define CAST_RECV_LEN(L) L
+#endif
+
+/* A retransmission (timer A/E/G, ixt_retransmit) of a message which was
+   not serialized again since it was sent (same sip->message_serial) is
+   written again from sip->message to the address resolved for the first
+   transmission. */
+static int
+_udp_tl_send_cached (struct eXosip_t *excontext, osip_transaction_t * tr, osip_message_t * sip, char *host, int port)
+{
+  struct eXtludp *reserved = (struct eXtludp *) excontext->eXtludp_reserved;
+  struct eXosip_wire_cache *cache = (struct eXosip_wire_cache *) osip_transaction_get_reserved6 (tr);
+  int i;
+
+  if (cache == NULL || cache->sip != sip || sip->message_property != 1 || sip->message == NULL)
+    return OSIP_NOTFOUND;
+  if (cache->serial != sip->message_serial)
+    return OSIP_NOTFOUND;       /* message was modified and serialized again */
+  if (cache->port != port || host == NULL || osip_strcasecmp (cache->host, host) != 0)
+    return OSIP_NOTFOUND;
+  if (reserved->udp_socket_oc >= 0 || cache->sock != reserved->udp_socket)
+    return OSIP_NOTFOUND;
+  if (tr->naptr_record != NULL) {
+    osip_srv_record_t *record = &tr->naptr_record->sipudp_record;
+
+    /* srv failover may select another destination */
+    if (MSG_IS_REGISTER (sip) || tr->naptr_record->naptr_state != OSIP_NAPTR_STATE_SRVDONE || record->index != cache->srv_index || record->srventry[record->index].srv_is_broken.tv_sec > 0)
+      return OSIP_NOTFOUND;
+  }
+
+#ifdef TSC_SUPPORT
+  if (excontext->tunnel_handle)
+    i = tsc_sendto (reserved->udp_socket, sip->message, CAST_RECV_LEN (sip->message_length), 0, (struct sockaddr *) &cache->addr, cache->addrlen);
+  else
+    i = sendto (cache->sock, (const void *) sip->message, CAST_RECV_LEN (sip->message_length), 0, (struct sockaddr *) &cache->addr, cache->addrlen);
+#else
+  i = sendto (cache->sock, (const void *) sip->message, CAST_RECV_LEN (sip->message_length), 0, (struct sockaddr *) &cache->addr, cache->addrlen);
+#endif
+  if (0 > i) {
+    /* let the complete path handle the error and the failover */
+    _eXosip_wire_cache_free (tr);
+    return OSIP_NOTFOUND;
+  }
+
+  OSIP_TRACE (osip_trace (__FILE__, __LINE__, OSIP_INFO1, NULL, "Message retransmitted: (to dest=%s:%i)\n", host, port));
+  return OSIP_SUCCESS;
+}
+
+static void
+_udp_tl_set_cached (osip_transaction_t * tr, osip_message_t * sip, char *host, int port, int sock, struct __eXosip_sockaddr *addr, socklen_t addrlen)
+{
+  struct eXosip_wire_cache *cache = (struct eXosip_wire_cache *) osip_transaction_get_reserved6 (tr);
+
+  if (sip->message_property != 1 || sip->message == NULL || host == NULL)
+    return;
+
+  if (cache == NULL) {
+    cache = (struct eXosip_wire_cache *) osip_malloc (sizeof (struct eXosip_wire_cache));
+    if (cache == NULL)
+      return;
+    memset (cache, 0, sizeof (struct eXosip_wire_cache));
+    osip_transaction_set_reserved6 (tr, cache);
+  }
+
+  if (cache->host == NULL || osip_strcasecmp (cache->host, host) != 0) {
+    osip_free (cache->host);
+    cache->host = osip_strdup (host);
+    if (cache->host == NULL) {
+      _eXosip_wire_cache_free (tr);
+      return;
+    }
+  }
+  cache->sip = sip;
+  cache->serial = sip->message_serial;
+  cache->port = port;
+  cache->sock = sock;
+  memcpy (&cache->addr, addr, addrlen);
+  cache->addrlen = addrlen;
+  cache->srv_index = (tr->naptr_record != NULL) ? tr->naptr_record->sipudp_record.index : 0;
+}
+
 static int
 udp_tl_send_message (struct eXosip_t *excontext, osip_transaction_t * tr, osip_message_t * sip, char *host, int port, int out_socket)
 {
@@ -1033,6 +1203,9 @@ udp_tl_send_message (struct eXosip_t *excontext, osip_transaction_t * tr, osip_m
       port = 5060;
   }
 
+  if (tr != NULL && _udp_tl_send_cached (excontext, tr, sip, host, port) == OSIP_SUCCESS)
+    return OSIP_SUCCESS;
+
   i = -1;
   if (tr == NULL) {
     _eXosip_srv_lookup (excontext, sip, &naptr_record);
@@ -1324,12 +1497,6 @@ udp_tl_send_message (struct eXosip_t *excontext, osip_transaction_t * tr, osip_m
   _udp_tl_transport_set_dscp_qos (excontext, (struct sockaddr *) &addr, len);
 #endif
 
-#ifdef HAVE_WINSOCK2_H
-#define CAST_RECV_LEN(L) ((int)(L))
-#else
-#define CAST_RECV_LEN(L) L
-#endif
-
 #ifdef TSC_SUPPORT
   if (excontext->tunnel_handle)
     i = tsc_sendto (reserved->udp_socket, message, CAST_RECV_LEN (length), 0, (struct sockaddr *) &addr, len);
@@ -1337,6 +1504,14 @@ udp_tl_send_message (struct eXosip_t *excontext, osip_transaction_t * tr, osip_m
     i = sendto (sock, (const void *) message, CAST_RECV_LEN (length), 0, (struct sockaddr *) &addr, len);
 #else
   i = sendto (sock, (const void *) message, CAST_RECV_LEN (length), 0, (struct sockaddr *) &addr, len);
+#endif
+#if defined(IP_RECVERR)
+  if (0 > i && errno == ECONNREFUSED) {
+    /* pending ICMP error, possibly for another destination: sendto has
+       cleared it, the error queue is read with eXosip_lock by
+       udp_tl_read_message */
+    i = sendto (sock, (const void *) message, CAST_RECV_LEN (length), 0, (struct sockaddr *) &addr, len);
+  }
 #endif
   if (0 > i) {
     if (naptr_record != NULL) {
@@ -1354,6 +1529,10 @@ udp_tl_send_message (struct eXosip_t *excontext, osip_transaction_t * tr, osip_m
     return -1;
   }
 
+  /* the transaction layer retransmits to the destination set above */
+  if (tr != NULL)
+    _udp_tl_set_cached (tr, sip, ipbuf, port, sock, &addr, len);
+
   if (excontext->ka_interval > 0) {
     if (MSG_IS_REGISTER (sip)) {
       eXosip_reg_t *reg = NULL;
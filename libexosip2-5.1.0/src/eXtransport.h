@@ -80,10 +80,14 @@ void eXosip_transport_tcp_init (struct eXosip_t *excontext);
 void eXosip_transport_tls_init (struct eXosip_t *excontext);
 void eXosip_transport_dtls_init (struct eXosip_t *excontext);
 
+/* a descriptor above FD_SETSIZE cannot be selected: it is not set (and
+   must not be tested with FD_ISSET) instead of writing past the fd_set */
 #if defined (HAVE_WINSOCK2_H)
 #define eXFD_SET(A, B)   FD_SET((unsigned int) A, B)
+#define eXFD_VALID(A)    1
 #else
-#define eXFD_SET(A, B)   FD_SET(A, B)
+#define eXFD_VALID(A)    ((A) >= 0 && (A) < FD_SETSIZE)
+#define eXFD_SET(A, B)   do { if (eXFD_VALID (A)) FD_SET (A, B); } while (0)
 #endif
 
 #endif
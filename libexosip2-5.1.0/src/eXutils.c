@@ -594,16 +594,235 @@ _eXosip_getnameinfo (const struct sockaddr *sa, socklen_t salen, char *host, soc
 int
 _eXosip_guess_ip_for_via (struct eXosip_t *excontext, int family, char *address, int size)
 {
+  char gateway[sizeof (excontext->ipv4_for_gateway)];
+
   if (family == AF_INET)
-    return _eXosip_guess_ip_for_destination (excontext, family, excontext->ipv4_for_gateway, address, size);
+    _eXosip_config_get (excontext, excontext->ipv4_for_gateway, gateway, sizeof (gateway));
+  else
+    _eXosip_config_get (excontext, excontext->ipv6_for_gateway, gateway, sizeof (gateway));
+  return _eXosip_guess_ip_for_destination (excontext, family, gateway, address, size);
+}
+
+/* Finding the local ip used to reach a destination costs a socket,
+   a bind, a connect, a getsockname and a close for each outgoing request.
+   The result is kept for route_cache_ttl seconds; on linux, the cache is
+   also flushed as soon as the kernel reports a route or address change.
+   eXosip_guess_localip may be called without eXosip_lock: the cache and
+   the netlink socket are protected by route_cache_mutex. */
+
+#define EXOSIP_ROUTE_CACHE_SETS ((MAX_EXOSIP_ROUTE_CACHE + EXOSIP_ROUTE_CACHE_WAYS - 1) / EXOSIP_ROUTE_CACHE_WAYS)
 
-  return _eXosip_guess_ip_for_destination (excontext, family, excontext->ipv6_for_gateway, address, size);
+static void
+_eXosip_route_cache_clear (struct eXosip_t *excontext)
+{
+  if (excontext->route_cache != NULL)
+    memset (excontext->route_cache, 0, EXOSIP_ROUTE_CACHE_SETS * EXOSIP_ROUTE_CACHE_WAYS * sizeof (struct eXosip_route_cache));
+}
+
+#if defined(__linux__)
+#include <errno.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+
+static void
+_eXosip_route_cache_check_netlink (struct eXosip_t *excontext)
+{
+  char buf[4096];
+  int changed = 0;
+  int i;
+
+  if (excontext->route_netlink_sock == -2)
+    return;                     /* not available: rely on ttl only */
+
+  if (excontext->route_netlink_sock < 0) {
+    struct sockaddr_nl snl;
+    int type = SOCK_RAW;
+    int sock;
+
+#if defined(SOCK_CLOEXEC)
+    type = SOCK_CLOEXEC | SOCK_RAW;
+#endif
+    sock = socket (AF_NETLINK, type, NETLINK_ROUTE);
+    if (sock < 0) {
+      excontext->route_netlink_sock = -2;
+      return;
+    }
+    memset (&snl, 0, sizeof (snl));
+    snl.nl_family = AF_NETLINK;
+    snl.nl_groups = RTMGRP_LINK | RTMGRP_IPV4_IFADDR | RTMGRP_IPV4_ROUTE | RTMGRP_IPV6_IFADDR | RTMGRP_IPV6_ROUTE;
+    if (bind (sock, (struct sockaddr *) &snl, sizeof (snl)) < 0) {
+      OSIP_TRACE (osip_trace (__FILE__, __LINE__, OSIP_WARNING, NULL, "eXosip: cannot listen to route changes: local ip cache relies on ttl\n"));
+      _eXosip_closesocket (sock);
+      excontext->route_netlink_sock = -2;
+      return;
+    }
+    excontext->route_netlink_sock = sock;
+    return;
+  }
+
+  for (;;) {
+    i = (int) recv (excontext->route_netlink_sock, buf, sizeof (buf), MSG_DONTWAIT);
+    if (i > 0) {
+      changed = 1;
+      continue;
+    }
+    if (i < 0 && errno == ENOBUFS) {
+      changed = 1;              /* notifications were lost */
+      continue;
+    }
+    break;
+  }
+
+  if (changed) {
+    OSIP_TRACE (osip_trace (__FILE__, __LINE__, OSIP_INFO2, NULL, "eXosip: route or address change: flush local ip cache\n"));
+    _eXosip_route_cache_clear (excontext);
+  }
+}
+#endif
+
+void
+_eXosip_route_cache_flush (struct eXosip_t *excontext)
+{
+#ifndef OSIP_MONOTHREAD
+  osip_mutex_lock ((struct osip_mutex *) excontext->route_cache_mutex);
+#endif
+  _eXosip_route_cache_clear (excontext);
+#ifndef OSIP_MONOTHREAD
+  osip_mutex_unlock ((struct osip_mutex *) excontext->route_cache_mutex);
+#endif
+}
+
+static int
+_eXosip_route_cache_match_bind (const struct eXosip_route_cache *entry, const struct sockaddr_storage *bind_addr)
+{
+  if (bind_addr == NULL)
+    return (entry->has_bind == 0);
+  if (entry->has_bind == 0 || entry->bind_addr.ss_family != bind_addr->ss_family)
+    return 0;
+  if (bind_addr->ss_family == AF_INET6)
+    return (0 == memcmp (&((const struct sockaddr_in6 *) bind_addr)->sin6_addr, &((const struct sockaddr_in6 *) &entry->bind_addr)->sin6_addr, sizeof (struct in6_addr)));
+  return (0 == memcmp (&((const struct sockaddr_in *) bind_addr)->sin_addr, &((const struct sockaddr_in *) &entry->bind_addr)->sin_addr, sizeof (struct in_addr)));
+}
+
+/* first entry of the set of a destination */
+static struct eXosip_route_cache *
+_eXosip_route_cache_set_of (struct eXosip_t *excontext, int family, const struct sockaddr_storage *bind_addr, const char *destination)
+{
+  unsigned int hash = 2166136261U + (unsigned int) family;
+  const unsigned char *p;
+
+  for (p = (const unsigned char *) destination; *p != '\0'; p++)
+    hash = (hash ^ *p) * 16777619U;
+  if (bind_addr != NULL)
+    hash = (hash ^ (unsigned int) bind_addr->ss_family) * 16777619U;
+  return &excontext->route_cache[(hash % EXOSIP_ROUTE_CACHE_SETS) * EXOSIP_ROUTE_CACHE_WAYS];
+}
+
+static int
+_eXosip_route_cache_get (struct eXosip_t *excontext, int family, const struct sockaddr_storage *bind_addr, const char *destination, char *address, int size)
+{
+  time_t now;
+  int way;
+  int err = OSIP_NOTFOUND;
+
+  if (excontext->route_cache_ttl <= 0 || destination == NULL || excontext->tunnel_handle != NULL)
+    return OSIP_NOTFOUND;
+
+#ifndef OSIP_MONOTHREAD
+  osip_mutex_lock ((struct osip_mutex *) excontext->route_cache_mutex);
+#endif
+#if defined(__linux__)
+  _eXosip_route_cache_check_netlink (excontext);
+#endif
+
+  now = osip_getsystemtime (NULL);
+  if (excontext->route_cache != NULL) {
+    struct eXosip_route_cache *set = _eXosip_route_cache_set_of (excontext, family, bind_addr, destination);
+
+    for (way = 0; way < EXOSIP_ROUTE_CACHE_WAYS; way++) {
+      struct eXosip_route_cache *entry = &set[way];
+
+      if (entry->expire <= now || entry->family != family)
+        continue;
+      if (0 != strcmp (entry->destination, destination) || !_eXosip_route_cache_match_bind (entry, bind_addr))
+        continue;
+      snprintf (address, size, "%s", entry->address);
+      err = OSIP_SUCCESS;
+      break;
+    }
+  }
+#ifndef OSIP_MONOTHREAD
+  osip_mutex_unlock ((struct osip_mutex *) excontext->route_cache_mutex);
+#endif
+  return err;
+}
+
+static void
+_eXosip_route_cache_set (struct eXosip_t *excontext, int family, const struct sockaddr_storage *bind_addr, const char *destination, const char *address)
+{
+  struct eXosip_route_cache *set;
+  struct eXosip_route_cache *entry;
+  time_t now;
+  int way;
+
+  if (excontext->route_cache_ttl <= 0 || destination == NULL || excontext->tunnel_handle != NULL)
+    return;
+  if (strlen (destination) >= sizeof (entry->destination) || strlen (address) >= sizeof (entry->address))
+    return;
+
+#ifndef OSIP_MONOTHREAD
+  osip_mutex_lock ((struct osip_mutex *) excontext->route_cache_mutex);
+#endif
+  if (excontext->route_cache == NULL) {
+    excontext->route_cache = (struct eXosip_route_cache *) osip_malloc (EXOSIP_ROUTE_CACHE_SETS * EXOSIP_ROUTE_CACHE_WAYS * sizeof (struct eXosip_route_cache));
+    if (excontext->route_cache == NULL) {
+#ifndef OSIP_MONOTHREAD
+      osip_mutex_unlock ((struct osip_mutex *) excontext->route_cache_mutex);
+#endif
+      return;
+    }
+    _eXosip_route_cache_clear (excontext);
+  }
+
+  now = osip_getsystemtime (NULL);
+  set = _eXosip_route_cache_set_of (excontext, family, bind_addr, destination);
+  entry = NULL;
+  for (way = 0; way < EXOSIP_ROUTE_CACHE_WAYS; way++) {
+    if (set[way].family == family && 0 == strcmp (set[way].destination, destination) && _eXosip_route_cache_match_bind (&set[way], bind_addr)) {
+      entry = &set[way];        /* refresh the same destination */
+      break;
+    }
+  }
+  for (way = 0; entry == NULL && way < EXOSIP_ROUTE_CACHE_WAYS; way++) {
+    if (set[way].expire <= now)
+      entry = &set[way];
+  }
+  if (entry == NULL) {
+    entry = set;
+    for (way = 1; way < EXOSIP_ROUTE_CACHE_WAYS; way++) {
+      if (set[way].expire < entry->expire)
+        entry = &set[way];
+    }
+  }
+
+  memset (entry, 0, sizeof (struct eXosip_route_cache));
+  entry->family = family;
+  if (bind_addr != NULL) {
+    entry->has_bind = 1;
+    memcpy (&entry->bind_addr, bind_addr, sizeof (struct sockaddr_storage));
+  }
+  snprintf (entry->destination, sizeof (entry->destination), "%s", destination);
+  snprintf (entry->address, sizeof (entry->address), "%s", address);
+  entry->expire = now + excontext->route_cache_ttl;
+#ifndef OSIP_MONOTHREAD
+  osip_mutex_unlock ((struct osip_mutex *) excontext->route_cache_mutex);
+#endif
 }
 
 #if defined(HAVE_WINSOCK2_H)
 
-int
-_eXosip_guess_ip_for_destination (struct eXosip_t *excontext, int family, char *destination, char *address, int size)
+static int
+_eXosip_probe_ip_for_destination (struct eXosip_t *excontext, int family, char *destination, char *address, int size)
 {
   SOCKET sock;
 
@@ -613,13 +832,18 @@ _eXosip_guess_ip_for_destination (struct eXosip_t *excontext, int family, char *
 
   struct addrinfo *addrf = NULL;
   int type;
+  char gateway[sizeof (excontext->ipv4_for_gateway)];
 
   address[0] = '\0';
 
-  if (destination == NULL && family == AF_INET)
-    destination = excontext->ipv4_for_gateway;
-  if (destination == NULL && family == AF_INET6)
-    destination = excontext->ipv6_for_gateway;
+  if (destination == NULL && family == AF_INET) {
+    _eXosip_config_get (excontext, excontext->ipv4_for_gateway, gateway, sizeof (gateway));
+    destination = gateway;
+  }
+  if (destination == NULL && family == AF_INET6) {
+    _eXosip_config_get (excontext, excontext->ipv6_for_gateway, gateway, sizeof (gateway));
+    destination = gateway;
+  }
 
 #ifdef TSC_SUPPORT
   if (excontext->tunnel_handle) {
@@ -672,21 +896,26 @@ _eXosip_guess_ip_for_destination (struct eXosip_t *excontext, int family, char *
   return OSIP_SUCCESS;
 }
 
-int
-_eXosip_guess_ip_for_destinationsock (struct eXosip_t *excontext, int family, int proto, struct sockaddr_storage *udp_local_bind, int sock, char *destination, char *address, int size)
+static int
+_eXosip_probe_ip_for_destinationsock (struct eXosip_t *excontext, int family, int proto, struct sockaddr_storage *udp_local_bind, int sock, char *destination, char *address, int size)
 {
   SOCKADDR_STORAGE local_addr;
 
   DWORD local_addr_len;
 
   struct addrinfo *addrf = NULL;
+  char gateway[sizeof (excontext->ipv4_for_gateway)];
 
   address[0] = '\0';
 
-  if (destination == NULL && family == AF_INET)
-    destination = excontext->ipv4_for_gateway;
-  if (destination == NULL && family == AF_INET6)
-    destination = excontext->ipv6_for_gateway;
+  if (destination == NULL && family == AF_INET) {
+    _eXosip_config_get (excontext, excontext->ipv4_for_gateway, gateway, sizeof (gateway));
+    destination = gateway;
+  }
+  if (destination == NULL && family == AF_INET6) {
+    _eXosip_config_get (excontext, excontext->ipv6_for_gateway, gateway, sizeof (gateway));
+    destination = gateway;
+  }
 
 #ifdef TSC_SUPPORT
   if (excontext->tunnel_handle) {
@@ -878,8 +1107,8 @@ _eXosip_default_gateway_ipv6 (struct eXosip_t *excontext, char *destination, cha
   return OSIP_SUCCESS;
 }
 
-int
-_eXosip_guess_ip_for_destination (struct eXosip_t *excontext, int family, char *destination, char *address, int size)
+static int
+_eXosip_probe_ip_for_destination (struct eXosip_t *excontext, int family, char *destination, char *address, int size)
 {
   int err;
 
@@ -1022,8 +1251,8 @@ _eXosip_default_gateway_ipv6sock (struct eXosip_t *excontext, int proto, struct
   return OSIP_SUCCESS;
 }
 
-int
-_eXosip_guess_ip_for_destinationsock (struct eXosip_t *excontext, int family, int proto, struct sockaddr_storage *udp_local_bind, int sock, char *destination, char *address, int size)
+static int
+_eXosip_probe_ip_for_destinationsock (struct eXosip_t *excontext, int family, int proto, struct sockaddr_storage *udp_local_bind, int sock, char *destination, char *address, int size)
 {
   int err;
 
@@ -1042,6 +1271,36 @@ _eXosip_guess_ip_for_destinationsock (struct eXosip_t *excontext, int family, in
 
 #endif
 
+int
+_eXosip_guess_ip_for_destination (struct eXosip_t *excontext, int family, char *destination, char *address, int size)
+{
+  int err;
+
+  if (_eXosip_route_cache_get (excontext, family, NULL, destination, address, size) == OSIP_SUCCESS)
+    return OSIP_SUCCESS;
+  err = _eXosip_probe_ip_for_destination (excontext, family, destination, address, size);
+  if (err == OSIP_SUCCESS)
+    _eXosip_route_cache_set (excontext, family, NULL, destination, address);
+  return err;
+}
+
+int
+_eXosip_guess_ip_for_destinationsock (struct eXosip_t *excontext, int family, int proto, struct sockaddr_storage *udp_local_bind, int sock, char *destination, char *address, int size)
+{
+  int err;
+
+  /* a connected socket already knows its local address */
+  if (udp_local_bind == NULL)
+    return _eXosip_probe_ip_for_destinationsock (excontext, family, proto, udp_local_bind, sock, destination, address, size);
+
+  if (_eXosip_route_cache_get (excontext, family, udp_local_bind, destination, address, size) == OSIP_SUCCESS)
+    return OSIP_SUCCESS;
+  err = _eXosip_probe_ip_for_destinationsock (excontext, family, proto, udp_local_bind, sock, destination, address, size);
+  if (err == OSIP_SUCCESS)
+    _eXosip_route_cache_set (excontext, family, udp_local_bind, destination, address);
+  return err;
+}
+
 char *
 _eXosip_strdup_printf (const char *fmt, ...)
 {
@@ -896,3 +896,151 @@ _eXosip_delete_nonce (struct eXosip_t *excontext, const char *call_id)
   }
   return OSIP_NOTFOUND;
 }
+
+/* copy a (quoted) parameter of an authentication header without quotes */
+char *
+_eXosip_digest_param (const char *value, char *buf, size_t size)
+{
+  size_t len;
+
+  buf[0] = '\0';
+  if (value == NULL)
+    return buf;
+  if (*value == '"')
+    value++;
+  len = strlen (value);
+  if (len > 0 && value[len - 1] == '"')
+    len--;
+  if (len >= size)
+    len = size - 1;
+  memcpy (buf, value, len);
+  buf[len] = '\0';
+  return buf;
+}
+
+/* H(time salt:secret) */
+static void
+_eXosip_digest_nonce_hash (const char *secret, const char *stamp, HASHHEX digest_hex)
+{
+  osip_MD5_CTX Md5Ctx;
+  HASH digest;
+
+  osip_MD5Init (&Md5Ctx);
+  osip_MD5Update (&Md5Ctx, (unsigned char *) stamp, 16);
+  osip_MD5Update (&Md5Ctx, (unsigned char *) ":", 1);
+  osip_MD5Update (&Md5Ctx, (unsigned char *) secret, (unsigned int) strlen (secret));
+  osip_MD5Final ((unsigned char *) digest, &Md5Ctx);
+  CvtHex (digest, digest_hex);
+}
+
+/* nonce of a server challenge: creation time, a random salt (so that each
+   challenge has its own nonce) and H(time salt:secret), so that it can be
+   verified without keeping it */
+void
+_eXosip_digest_nonce_create (const char *secret, time_t now, char *nonce, size_t size)
+{
+  HASHHEX digest_hex;
+  unsigned char salt[4];
+  char stamp[17];
+
+  _eXosip_random_bytes (salt, sizeof (salt));
+  snprintf (stamp, sizeof (stamp), "%08x%02x%02x%02x%02x", (unsigned int) now, salt[0], salt[1], salt[2], salt[3]);
+  _eXosip_digest_nonce_hash (secret, stamp, digest_hex);
+  snprintf (nonce, size, "%s%s", stamp, digest_hex);
+}
+
+/* OSIP_SUCCESS, OSIP_WRONG_STATE for a nonce older than lifetime (stale)
+   or OSIP_BADPARAMETER for a nonce we did not create */
+int
+_eXosip_digest_nonce_check (const char *secret, const char *nonce, time_t now, int lifetime)
+{
+  HASHHEX expected;
+  unsigned int stamp;
+
+  if (nonce == NULL || strlen (nonce) != EXOSIP_DIGEST_NONCE_LEN)
+    return OSIP_BADPARAMETER;
+  if (sscanf (nonce, "%8x", &stamp) != 1)
+    return OSIP_BADPARAMETER;
+  _eXosip_digest_nonce_hash (secret, nonce, expected);
+  if (strcmp (expected, nonce + 16) != 0)
+    return OSIP_BADPARAMETER;
+  if ((unsigned int) now - stamp > (unsigned int) lifetime)
+    return OSIP_WRONG_STATE;
+  return OSIP_SUCCESS;
+}
+
+/* the digest uri must be the request-uri: a response computed for another
+   uri is refused */
+static int
+_eXosip_digest_uri_match (const char *uri, osip_uri_t * req_uri)
+{
+  osip_uri_t *parsed = NULL;
+  char *a = NULL;
+  char *b = NULL;
+  int i;
+
+  i = osip_uri_init (&parsed);
+  if (i != 0)
+    return i;
+  i = osip_uri_parse (parsed, uri);
+  if (i == 0)
+    i = osip_uri_to_str (parsed, &a);
+  if (i == 0)
+    i = osip_uri_to_str (req_uri, &b);
+  if (i == 0 && osip_strcasecmp (a, b) != 0)
+    i = OSIP_UNDEFINED_ERROR;
+  osip_uri_free (parsed);
+  osip_free (a);
+  osip_free (b);
+  return i;
+}
+
+/* verify the response of an Authorization header (MD5 or MD5-sess, with
+   qop "auth" or without qop) for the request-uri req_uri. When qop "auth"
+   was offered in the challenge, a response without qop is refused. */
+int
+_eXosip_digest_check (osip_authorization_t * auth, const char *method, osip_uri_t * req_uri, int qop_offered, const char *passwd)
+{
+  char username[128];
+  char realm[128];
+  char nonce[128];
+  char uri[512];
+  char response[HASHHEXLEN + 1];
+  char cnonce[128];
+  char nc[16];
+  char qop[16];
+  char alg[16];
+  HASHHEX HA1;
+  HASHHEX HA2 = "";
+  HASHHEX Response;
+
+  if (auth == NULL || auth->auth_type == NULL || osip_strcasecmp (auth->auth_type, "Digest") != 0)
+    return OSIP_BADPARAMETER;
+  if (auth->username == NULL || auth->realm == NULL || auth->nonce == NULL || auth->uri == NULL || auth->response == NULL)
+    return OSIP_BADPARAMETER;
+
+  _eXosip_digest_param (auth->username, username, sizeof (username));
+  _eXosip_digest_param (auth->realm, realm, sizeof (realm));
+  _eXosip_digest_param (auth->nonce, nonce, sizeof (nonce));
+  _eXosip_digest_param (auth->uri, uri, sizeof (uri));
+  _eXosip_digest_param (auth->response, response, sizeof (response));
+  _eXosip_digest_param (auth->cnonce, cnonce, sizeof (cnonce));
+  _eXosip_digest_param (auth->nonce_count, nc, sizeof (nc));
+  _eXosip_digest_param (auth->message_qop, qop, sizeof (qop));
+  _eXosip_digest_param (auth->algorithm, alg, sizeof (alg));
+
+  if (alg[0] != '\0' && osip_strcasecmp (alg, "MD5") != 0 && osip_strcasecmp (alg, "MD5-sess") != 0)
+    return OSIP_UNDEFINED_ERROR;
+  if (qop[0] != '\0' && (osip_strcasecmp (qop, "auth") != 0 || cnonce[0] == '\0' || nc[0] == '\0'))
+    return OSIP_UNDEFINED_ERROR;
+  if (qop[0] == '\0' && qop_offered)
+    return OSIP_UNDEFINED_ERROR;
+  if (req_uri == NULL || _eXosip_digest_uri_match (uri, req_uri) != OSIP_SUCCESS)
+    return OSIP_UNDEFINED_ERROR;
+
+  DigestCalcHA1 (alg, username, realm, passwd, nonce, cnonce, HA1);
+  DigestCalcResponse (HA1, nonce, nc, cnonce, qop[0] != '\0' ? qop : NULL, 0, method, uri, HA2, Response);
+  if (osip_strcasecmp (Response, response) != 0)
+    return OSIP_UNDEFINED_ERROR;
+  return OSIP_SUCCESS;
+}
@@ -125,6 +125,21 @@ _eXosip_register_contact_is_modified (struct eXosip_t *excontext, eXosip_reg_t *
   }
 }
 
+static char *
+_eXosip_transaction_destination (osip_transaction_t * tr, int *port)
+{
+  *port = 0;
+  if (tr->ctx_type == ICT && tr->ict_context != NULL) {
+    *port = tr->ict_context->port;
+    return tr->ict_context->destination;
+  }
+  if (tr->ctx_type == NICT && tr->nict_context != NULL) {
+    *port = tr->nict_context->port;
+    return tr->nict_context->destination;
+  }
+  return NULL;
+}
+
 int
 _eXosip_snd_message (struct eXosip_t *excontext, osip_transaction_t * tr, osip_message_t * sip, char *host, int port, int out_socket)
 {
@@ -213,6 +228,13 @@ _eXosip_snd_message (struct eXosip_t *excontext, osip_transaction_t * tr, osip_m
     }
   }
 
+  /* first transmission of a new request */
+  if (tr != NULL && ((tr->ctx_type == ICT && tr->state == ICT_PRE_CALLING) || (tr->ctx_type == NICT && tr->state == NICT_PRE_TRYING))) {
+    i = _eXosip_peer_health_check (excontext, host, port, tr->transactionid);
+    if (i != OSIP_SUCCESS)
+      return i;
+  }
+
   if (excontext->cbsipCallback != NULL) {
     excontext->cbsipCallback (sip, 0);
   }
@@ -523,17 +545,20 @@ cb_rcv1xx (int type, osip_transaction_t * tr, osip_message_t * sip)
       }
       if (jc != NULL) {
         ADD_ELEMENT (jc->c_dialogs, jd);
+        _eXosip_dialog_index_add (excontext, jd, EXOSIP_DIALOG_OWNER_CALL, jc);
         osip_transaction_set_reserved3 (tr, jd);
         _eXosip_update (excontext);
       }
 #ifndef MINISIZE
       else if (js != NULL) {
         ADD_ELEMENT (js->s_dialogs, jd);
+        _eXosip_dialog_index_add (excontext, jd, EXOSIP_DIALOG_OWNER_SUBSCRIBE, js);
         osip_transaction_set_reserved3 (tr, jd);
         _eXosip_update (excontext);
       }
       else if (jn != NULL) {
         ADD_ELEMENT (jn->n_dialogs, jd);
+        _eXosip_dialog_index_add (excontext, jd, EXOSIP_DIALOG_OWNER_NOTIFY, jn);
         osip_transaction_set_reserved3 (tr, jd);
         _eXosip_update (excontext);
       }
@@ -621,6 +646,7 @@ cb_rcv2xx_4invite (osip_transaction_t * tr, osip_message_t * sip)
       return;
     }
     ADD_ELEMENT (jc->c_dialogs, jd);
+    _eXosip_dialog_index_add (excontext, jd, EXOSIP_DIALOG_OWNER_CALL, jc);
     osip_transaction_set_reserved3 (tr, jd);
     _eXosip_update (excontext);
   }
@@ -813,6 +839,7 @@ cb_rcv2xx_4subscribe (osip_transaction_t * tr, osip_message_t * sip)
       return;
     }
     ADD_ELEMENT (js->s_dialogs, jd);
+    _eXosip_dialog_index_add (excontext, jd, EXOSIP_DIALOG_OWNER_SUBSCRIBE, js);
     osip_transaction_set_reserved3 (tr, jd);
     _eXosip_update (excontext);
   }
@@ -1700,6 +1727,7 @@ static void
 cb_transport_error (int type, osip_transaction_t * tr, int error)
 {
   struct eXosip_t *excontext = (struct eXosip_t *) osip_transaction_get_reserved1 (tr);
+  int port;
 
 #ifndef MINISIZE
   eXosip_subscribe_t *js = (eXosip_subscribe_t *) osip_transaction_get_reserved5 (tr);
@@ -1707,6 +1735,11 @@ cb_transport_error (int type, osip_transaction_t * tr, int error)
 #endif
 
   OSIP_TRACE (osip_trace (__FILE__, __LINE__, OSIP_INFO1, NULL, "cb_transport_error (id=%i)\r\n", tr->transactionid));
+  if (type == OSIP_ICT_TRANSPORT_ERROR || type == OSIP_NICT_TRANSPORT_ERROR) {
+    char *host = _eXosip_transaction_destination (tr, &port);
+
+    _eXosip_peer_health_failure (excontext, host, port, tr->transactionid);
+  }
   if (type == OSIP_ICT_TRANSPORT_ERROR) {
     eXosip_call_t *jc = (eXosip_call_t *) osip_transaction_get_reserved2 (tr);
     eXosip_dialog_t *jd = (eXosip_dialog_t *) osip_transaction_get_reserved3 (tr);
@@ -1737,6 +1770,21 @@ cb_transport_error (int type, osip_transaction_t * tr, int error)
 
 }
 
+static void
+cb_timeout (int type, osip_transaction_t * tr, osip_message_t * sip)
+{
+  struct eXosip_t *excontext = (struct eXosip_t *) osip_transaction_get_reserved1 (tr);
+
+  char *host;
+  int port;
+
+  OSIP_TRACE (osip_trace (__FILE__, __LINE__, OSIP_INFO1, NULL, "cb_timeout (id=%i)\r\n", tr->transactionid));
+  if (tr->last_response == NULL) {
+    host = _eXosip_transaction_destination (tr, &port);
+    _eXosip_peer_health_failure (excontext, host, port, tr->transactionid);
+  }
+}
+
 int
 _eXosip_set_callbacks (osip_t * osip)
 {
@@ -1791,6 +1839,9 @@ _eXosip_set_callbacks (osip_t * osip)
   osip_set_transport_error_callback (osip, OSIP_NICT_TRANSPORT_ERROR, &cb_transport_error);
   osip_set_transport_error_callback (osip, OSIP_NIST_TRANSPORT_ERROR, &cb_transport_error);
 
+  osip_set_message_callback (osip, OSIP_ICT_STATUS_TIMEOUT, &cb_timeout);
+  osip_set_message_callback (osip, OSIP_NICT_STATUS_TIMEOUT, &cb_timeout);
+
 #ifndef MINISIZE
   /* those methods are only used for log purpose except cb_transport_error which only apply to complete version */
   osip_set_message_callback (osip, OSIP_ICT_STATUS_2XX_RECEIVED_AGAIN, &cb_rcvresp_retransmission);
@@ -88,6 +88,130 @@ _eXosip_subscription_dialog_find (struct eXosip_t *excontext, int sid, eXosip_su
 
 #endif
 
+/* The dialog index hashes every dialog attached to a call, a subscription
+   or a notification by its Call-ID, so that incoming in-dialog requests
+   and out of transaction 2xx find their dialog without walking all of
+   them. The Call-ID of a dialog never changes, even when eXosip rebuilds
+   jd->d_dialog, so the key is copied once when the dialog is attached. */
+
+static unsigned int
+_eXosip_callid_hash (const char *number, const char *host)
+{
+  unsigned int hash = 2166136261U;
+
+  for (; *number != '\0'; number++)
+    hash = (hash ^ (unsigned char) *number) * 16777619U;
+  if (host != NULL) {
+    hash = (hash ^ (unsigned char) '@') * 16777619U;
+    for (; *host != '\0'; host++)
+      hash = (hash ^ (unsigned char) *host) * 16777619U;
+  }
+  return hash;
+}
+
+static int
+_eXosip_callid_match (const char *key, osip_call_id_t * callid)
+{
+  size_t len = strlen (callid->number);
+
+  if (0 != strncmp (key, callid->number, len))
+    return OSIP_UNDEFINED_ERROR;
+  key += len;
+  if (callid->host == NULL)
+    return (*key == '\0') ? OSIP_SUCCESS : OSIP_UNDEFINED_ERROR;
+  if (*key != '@' || 0 != strcmp (key + 1, callid->host))
+    return OSIP_UNDEFINED_ERROR;
+  return OSIP_SUCCESS;
+}
+
+int
+_eXosip_dialog_index_add (struct eXosip_t *excontext, eXosip_dialog_t * jd, int owner_type, void *owner)
+{
+  unsigned int bucket;
+
+  if (jd == NULL || jd->d_dialog == NULL || jd->d_dialog->call_id == NULL)
+    return OSIP_BADPARAMETER;
+  if (jd->d_callid != NULL)
+    return OSIP_SUCCESS;        /* already indexed */
+
+  jd->d_callid = osip_strdup (jd->d_dialog->call_id);
+  if (jd->d_callid == NULL)
+    return OSIP_NOMEM;
+  jd->d_callid_hash = _eXosip_callid_hash (jd->d_callid, NULL);
+  jd->d_owner_type = owner_type;
+  jd->d_owner = owner;
+
+  bucket = jd->d_callid_hash & (EXOSIP_DIALOG_INDEX_SIZE - 1);
+  jd->d_index_next = excontext->j_dialog_index[bucket];
+  excontext->j_dialog_index[bucket] = jd;
+  return OSIP_SUCCESS;
+}
+
+static void
+_eXosip_dialog_index_remove (struct eXosip_t *excontext, eXosip_dialog_t * jd)
+{
+  eXosip_dialog_t **prev;
+
+  if (jd->d_callid == NULL)
+    return;
+
+  prev = &excontext->j_dialog_index[jd->d_callid_hash & (EXOSIP_DIALOG_INDEX_SIZE - 1)];
+  while (*prev != NULL) {
+    if (*prev == jd) {
+      *prev = jd->d_index_next;
+      break;
+    }
+    prev = &(*prev)->d_index_next;
+  }
+  osip_free (jd->d_callid);
+  jd->d_callid = NULL;
+  jd->d_index_next = NULL;
+}
+
+static eXosip_dialog_t *
+_eXosip_dialog_index_lookup (eXosip_dialog_t * jd, unsigned int hash, int owner_type, osip_call_id_t * callid)
+{
+  for (; jd != NULL; jd = jd->d_index_next) {
+    if (jd->d_callid_hash == hash && jd->d_owner_type == owner_type && 0 == _eXosip_callid_match (jd->d_callid, callid))
+      return jd;
+  }
+  return NULL;
+}
+
+/* return the first dialog of type owner_type with this Call-ID */
+eXosip_dialog_t *
+_eXosip_dialog_index_first (struct eXosip_t *excontext, int owner_type, osip_call_id_t * callid)
+{
+  unsigned int hash;
+
+  if (callid == NULL || callid->number == NULL)
+    return NULL;
+  hash = _eXosip_callid_hash (callid->number, callid->host);
+  return _eXosip_dialog_index_lookup (excontext->j_dialog_index[hash & (EXOSIP_DIALOG_INDEX_SIZE - 1)], hash, owner_type, callid);
+}
+
+eXosip_dialog_t *
+_eXosip_dialog_index_next (eXosip_dialog_t * jd, int owner_type, osip_call_id_t * callid)
+{
+  if (jd == NULL)
+    return NULL;
+  return _eXosip_dialog_index_lookup (jd->d_index_next, jd->d_callid_hash, owner_type, callid);
+}
+
+eXosip_dialog_t *
+_eXosip_dialog_index_find_as_uas (struct eXosip_t *excontext, int owner_type, osip_message_t * request)
+{
+  eXosip_dialog_t *jd;
+
+  if (request == NULL)
+    return NULL;
+  for (jd = _eXosip_dialog_index_first (excontext, owner_type, request->call_id); jd != NULL; jd = _eXosip_dialog_index_next (jd, owner_type, request->call_id)) {
+    if (jd->d_dialog != NULL && osip_dialog_match_as_uas (jd->d_dialog, request) == 0)
+      return jd;
+  }
+  return NULL;
+}
+
 int
 _eXosip_dialog_set_200ok (eXosip_dialog_t * jd, osip_message_t * _200Ok)
 {
@@ -234,6 +358,8 @@ _eXosip_dialog_free (struct eXosip_t *excontext, eXosip_dialog_t * jd)
     osip_list_add (&excontext->j_transactions, tr, 0);
   }
 
+  _eXosip_dialog_index_remove (excontext, jd);
+
   osip_message_free (jd->d_200Ok);
   osip_message_free (jd->d_ack);
 
@@ -342,10 +342,208 @@ _eXosip_report_call_event (struct eXosip_t *excontext, int evt, eXosip_call_t *
   _eXosip_report_event (excontext, je, NULL);
 }
 
+#ifndef OSIP_MONOTHREAD
+
+/* the kind of id is kept in the low bits: cid 1 and sid 1 differ */
+static unsigned int
+_eXosip_event_key (eXosip_event_t * je)
+{
+  if (je->cid > 0)
+    return ((unsigned int) je->cid << 3) | 1;
+  if (je->sid > 0)
+    return ((unsigned int) je->sid << 3) | 2;
+  if (je->nid > 0)
+    return ((unsigned int) je->nid << 3) | 3;
+  if (je->rid > 0)
+    return ((unsigned int) je->rid << 3) | 4;
+  return (unsigned int) je->tid << 3;
+}
+
+/* give the event to the worker of its call/subscription, when a callback
+   is set for its type. On error, the event still belongs to the caller
+   (queued on j_events instead). */
+static int
+_eXosip_event_dispatch (struct eXosip_t *excontext, eXosip_event_t * je)
+{
+  struct eXosip_event_handler *handler = &excontext->event_handler_default;
+  struct eXosip_event_job *job;
+  unsigned int pos;
+  int i;
+
+  if (je->type >= 0 && je->type < EXOSIP_EVENT_COUNT && excontext->event_handlers[je->type].cb != NULL)
+    handler = &excontext->event_handlers[je->type];
+  if (handler->cb == NULL)
+    return OSIP_NOTFOUND;
+
+  job = (struct eXosip_event_job *) osip_malloc (sizeof (struct eXosip_event_job));
+  if (job == NULL)
+    return OSIP_NOMEM;
+  job->je = je;
+  job->handler = *handler;
+
+  /* multiplicative hash: the high bits are mixed, not the low ones */
+  pos = ((_eXosip_event_key (je) * 2654435761u) >> 16) % (unsigned int) excontext->event_workers_count;
+  i = osip_fifo_add (excontext->event_workers[pos].jobs, job);
+  if (i != OSIP_SUCCESS) {
+    OSIP_TRACE (osip_trace (__FILE__, __LINE__, OSIP_WARNING, NULL, "eXosip: cannot dispatch event %i to worker %u: queued for eXosip_event_wait\n", je->type, pos));
+    osip_free (job);
+  }
+  return i;
+}
+
+static void *
+_eXosip_event_worker_thread (void *arg)
+{
+  struct eXosip_event_worker *worker = (struct eXosip_event_worker *) arg;
+  struct eXosip_event_job *job;
+
+  osip_sem_wait ((struct osip_sem *) worker->start);
+  for (;;) {
+    job = (struct eXosip_event_job *) osip_fifo_get (worker->jobs);
+    if (job == &worker->stop_job)
+      break;
+    if (job == NULL) {
+      if (worker->stop)
+        break;
+      continue;
+    }
+    job->handler.cb (worker->excontext, job->je, job->handler.arg);
+    eXosip_event_free (job->je);
+    osip_free (job);
+  }
+  return NULL;
+}
+
+/* run the pending jobs, then stop and release the workers. The workers
+   are always joined before they are released. */
+static void
+_eXosip_event_workers_free (struct eXosip_event_worker *workers, int count)
+{
+  struct eXosip_event_job *job;
+  int pos;
+
+  for (pos = 0; pos < count; pos++) {
+    if (workers[pos].thread == NULL)
+      continue;
+    workers[pos].stop = 1;
+    /* the stop job is not allocated: only the fifo may fail (no memory) */
+    while (osip_fifo_add (workers[pos].jobs, &workers[pos].stop_job) != OSIP_SUCCESS) {
+      OSIP_TRACE (osip_trace (__FILE__, __LINE__, OSIP_WARNING, NULL, "eXosip: cannot stop event worker %i: retrying\n", pos));
+      osip_usleep (10000);
+    }
+    osip_thread_join ((struct osip_thread *) workers[pos].thread);
+    osip_free (workers[pos].thread);
+    workers[pos].thread = NULL;
+  }
+  for (pos = 0; pos < count; pos++) {
+    if (workers[pos].jobs != NULL) {
+      while ((job = (struct eXosip_event_job *) osip_fifo_tryget (workers[pos].jobs)) != NULL) {
+        if (job == &workers[pos].stop_job)
+          continue;
+        eXosip_event_free (job->je);
+        osip_free (job);
+      }
+      osip_fifo_free (workers[pos].jobs);
+    }
+    if (workers[pos].start != NULL)
+      osip_sem_destroy ((struct osip_sem *) workers[pos].start);
+  }
+  osip_free (workers);
+}
+
+/* replace the worker pool: count=0 stops it. Must not be called from a
+   callback (it waits for the workers to complete their queue). */
+int
+_eXosip_event_workers_start (struct eXosip_t *excontext, int count)
+{
+  struct eXosip_event_worker *workers = NULL;
+  struct eXosip_event_worker *old;
+  int old_count;
+  int pos;
+
+  if (count < 0)
+    return OSIP_BADPARAMETER;
+
+  if (count > 0) {
+    workers = (struct eXosip_event_worker *) osip_malloc (sizeof (struct eXosip_event_worker) * count);
+    if (workers == NULL)
+      return OSIP_NOMEM;
+    memset (workers, 0, sizeof (struct eXosip_event_worker) * count);
+    for (pos = 0; pos < count; pos++) {
+      workers[pos].excontext = excontext;
+      workers[pos].jobs = (osip_fifo_t *) osip_malloc (sizeof (osip_fifo_t));
+      if (workers[pos].jobs == NULL)
+        break;
+      osip_fifo_init (workers[pos].jobs);
+      workers[pos].start = (void *) osip_sem_init (0);
+      if (workers[pos].start == NULL)
+        break;
+      workers[pos].thread = (void *) osip_thread_create (20000, _eXosip_event_worker_thread, &workers[pos]);
+      if (workers[pos].thread == NULL)
+        break;
+    }
+    if (pos < count) {
+      OSIP_TRACE (osip_trace (__FILE__, __LINE__, OSIP_ERROR, NULL, "eXosip: Cannot start event worker!\n"));
+      for (pos = 0; pos < count; pos++) {
+        if (workers[pos].thread != NULL)
+          osip_sem_post ((struct osip_sem *) workers[pos].start);
+      }
+      _eXosip_event_workers_free (workers, count);
+      return OSIP_UNDEFINED_ERROR;
+    }
+  }
+
+  /* swap the pools: new events are queued to the new workers, which
+     only start once the old ones have completed their queue, so that
+     the events of a call stay in order */
+  eXosip_lock (excontext);
+  old = excontext->event_workers;
+  old_count = excontext->event_workers_count;
+  excontext->event_workers = workers;
+  excontext->event_workers_count = count;
+  eXosip_unlock (excontext);
+
+  if (old != NULL)
+    _eXosip_event_workers_free (old, old_count);
+  for (pos = 0; pos < count; pos++)
+    osip_sem_post ((struct osip_sem *) workers[pos].start);
+  return OSIP_SUCCESS;
+}
+
+#endif
+
+int
+eXosip_set_event_callback (struct eXosip_t *excontext, int type, CbSipEvent cbsipEvent, void *arg)
+{
+  struct eXosip_event_handler *handler;
+
+  if (excontext == NULL || type < -1 || type >= EXOSIP_EVENT_COUNT)
+    return OSIP_BADPARAMETER;
+
+  eXosip_lock (excontext);
+  handler = (type == -1) ? &excontext->event_handler_default : &excontext->event_handlers[type];
+  handler->cb = cbsipEvent;
+  handler->arg = (cbsipEvent != NULL) ? arg : NULL;
+  eXosip_unlock (excontext);
+  return OSIP_SUCCESS;
+}
+
 int
 _eXosip_event_add (struct eXosip_t *excontext, eXosip_event_t * je)
 {
-  int i = osip_fifo_add (excontext->j_events, (void *) je);
+  int i;
+
+#ifndef OSIP_MONOTHREAD
+  if (excontext->event_workers_count > 0 && _eXosip_event_dispatch (excontext, je) == OSIP_SUCCESS)
+    return OSIP_SUCCESS;
+#endif
+
+  i = osip_fifo_add (excontext->j_events, (void *) je);
+  if (i != OSIP_SUCCESS) {
+    OSIP_TRACE (osip_trace (__FILE__, __LINE__, OSIP_ERROR, NULL, "eXosip: cannot queue event %i: dropped\n", je->type));
+    eXosip_event_free (je);
+    return i;
+  }
 
 #ifndef OSIP_MONOTHREAD
 #if !defined (_WIN32_WCE)
@@ -357,63 +555,67 @@ _eXosip_event_add (struct eXosip_t *excontext, eXosip_event_t * je)
   return i;
 }
 
+/* move up to max_events queued events to the caller's array */
+static int
+_eXosip_event_dequeue (struct eXosip_t *excontext, eXosip_event_t ** events, int max_events)
+{
+  int count;
+
+  for (count = 0; count < max_events; count++) {
+    events[count] = (eXosip_event_t *) osip_fifo_tryget (excontext->j_events);
+    if (events[count] == NULL)
+      break;
+  }
+  return count;
+}
+
 #ifdef OSIP_MONOTHREAD
 
 eXosip_event_t *
 eXosip_event_wait (struct eXosip_t * excontext, int tv_s, int tv_ms)
 {
-  eXosip_event_t *je = NULL;
-
-  je = (eXosip_event_t *) osip_fifo_tryget (excontext->j_events);
-  if (je != NULL)
-    return je;
-
-  eXosip_lock (excontext);
-  _eXosip_retransmit_lost200ok (excontext);
-  eXosip_unlock (excontext);
+  return (eXosip_event_t *) osip_fifo_tryget (excontext->j_events);
+}
 
-  return NULL;
+int
+eXosip_event_wait_batch (struct eXosip_t *excontext, eXosip_event_t ** events, int max_events, int tv_s, int tv_ms)
+{
+  if (excontext == NULL || events == NULL || max_events <= 0)
+    return OSIP_BADPARAMETER;
+  return _eXosip_event_dequeue (excontext, events, max_events);
 }
 
 #else
 
-eXosip_event_t *
-eXosip_event_wait (struct eXosip_t * excontext, int tv_s, int tv_ms)
+/* consume pending wakeups of the event socket without blocking */
+static void
+_eXosip_event_clear_wakeup (struct eXosip_t *excontext)
 {
-  eXosip_event_t *je = NULL;
+  char buf[500];
 
+#if defined (WIN32) || defined (_WIN32_WCE)
   fd_set fdset;
   struct timeval tv;
-  int max, i;
-
-  if (excontext == NULL) {
-    return NULL;
-  }
 
   FD_ZERO (&fdset);
-#if defined (WIN32) || defined (_WIN32_WCE)
   FD_SET ((unsigned int) jpipe_get_read_descr (excontext->j_socketctl_event), &fdset);
-#else
-  FD_SET (jpipe_get_read_descr (excontext->j_socketctl_event), &fdset);
-#endif
-  max = jpipe_get_read_descr (excontext->j_socketctl_event);
-
-  je = (eXosip_event_t *) osip_fifo_tryget (excontext->j_events);
-  if (je != NULL)
-    return je;
-
   tv.tv_sec = 0;
   tv.tv_usec = 0;
-  i = select (max + 1, &fdset, NULL, NULL, &tv);
-  if (FD_ISSET (jpipe_get_read_descr (excontext->j_socketctl_event), &fdset)) {
-    char buf[500];
-
+  if (select (jpipe_get_read_descr (excontext->j_socketctl_event) + 1, &fdset, NULL, NULL, &tv) > 0)
     jpipe_read (excontext->j_socketctl_event, buf, 499);
-  }
+#else
+  /* the read side is non blocking */
+  jpipe_read (excontext->j_socketctl_event, buf, 499);
+#endif
+}
 
-  eXosip_lock (excontext);
-  _eXosip_retransmit_lost200ok (excontext);
-  eXosip_unlock (excontext);
+/* block until the event socket is signaled or the timeout expires */
+static int
+_eXosip_event_wait_wakeup (struct eXosip_t *excontext, int tv_s, int tv_ms)
+{
+  fd_set fdset;
+  struct timeval tv;
+  int max, i;
 
   FD_ZERO (&fdset);
 #if defined (WIN32) || defined (_WIN32_WCE)
@@ -421,30 +623,73 @@ eXosip_event_wait (struct eXosip_t * excontext, int tv_s, int tv_ms)
 #else
   FD_SET (jpipe_get_read_descr (excontext->j_socketctl_event), &fdset);
 #endif
+  max = jpipe_get_read_descr (excontext->j_socketctl_event);
   tv.tv_sec = tv_s;
   tv.tv_usec = tv_ms * 1000;
 
-  if (tv_s == 0 && tv_ms == 0)
-    return NULL;
-
   i = select (max + 1, &fdset, NULL, NULL, &tv);
   if (i <= 0)
-    return OSIP_SUCCESS;
-
-  if (excontext->j_stop_ua)
-    return NULL;
+    return i;
+  if (FD_ISSET (jpipe_get_read_descr (excontext->j_socketctl_event), &fdset))
+    _eXosip_event_clear_wakeup (excontext);
+  return i;
+}
 
-  if (FD_ISSET (jpipe_get_read_descr (excontext->j_socketctl_event), &fdset)) {
-    char buf[500];
+eXosip_event_t *
+eXosip_event_wait (struct eXosip_t * excontext, int tv_s, int tv_ms)
+{
+  eXosip_event_t *je = NULL;
 
-    jpipe_read (excontext->j_socketctl_event, buf, 499);
+  if (excontext == NULL) {
+    return NULL;
   }
 
   je = (eXosip_event_t *) osip_fifo_tryget (excontext->j_events);
   if (je != NULL)
     return je;
 
-  return je;
+  /* an event added after this point signals the socket again */
+  _eXosip_event_clear_wakeup (excontext);
+  je = (eXosip_event_t *) osip_fifo_tryget (excontext->j_events);
+  if (je != NULL)
+    return je;
+
+  if (tv_s == 0 && tv_ms == 0)
+    return NULL;
+
+  if (_eXosip_event_wait_wakeup (excontext, tv_s, tv_ms) <= 0)
+    return NULL;
+
+  if (excontext->j_stop_ua)
+    return NULL;
+
+  return (eXosip_event_t *) osip_fifo_tryget (excontext->j_events);
+}
+
+int
+eXosip_event_wait_batch (struct eXosip_t *excontext, eXosip_event_t ** events, int max_events, int tv_s, int tv_ms)
+{
+  int count;
+
+  if (excontext == NULL || events == NULL || max_events <= 0)
+    return OSIP_BADPARAMETER;
+
+  count = _eXosip_event_dequeue (excontext, events, max_events);
+  if (count > 0)
+    return count;
+
+  _eXosip_event_clear_wakeup (excontext);
+  count = _eXosip_event_dequeue (excontext, events, max_events);
+  if (count > 0 || (tv_s == 0 && tv_ms == 0))
+    return count;
+
+  if (_eXosip_event_wait_wakeup (excontext, tv_s, tv_ms) <= 0)
+    return 0;
+
+  if (excontext->j_stop_ua)
+    return 0;
+
+  return _eXosip_event_dequeue (excontext, events, max_events);
 }
 
 int
@@ -457,26 +702,8 @@ eXosip_event_t *
 eXosip_event_get (struct eXosip_t * excontext)
 {
   eXosip_event_t *je;
-  fd_set fdset;
-  struct timeval tv;
-  int max;
-
-  FD_ZERO (&fdset);
-#if defined (WIN32) || defined (_WIN32_WCE)
-  FD_SET ((unsigned int) jpipe_get_read_descr (excontext->j_socketctl_event), &fdset);
-#else
-  FD_SET (jpipe_get_read_descr (excontext->j_socketctl_event), &fdset);
-#endif
-  max = jpipe_get_read_descr (excontext->j_socketctl_event);
 
-  tv.tv_sec = 0;
-  tv.tv_usec = 0;
-  select (max + 1, &fdset, NULL, NULL, &tv);
-  if (FD_ISSET (jpipe_get_read_descr (excontext->j_socketctl_event), &fdset)) {
-    char buf[500];
-
-    jpipe_read (excontext->j_socketctl_event, buf, 499);
-  }
+  _eXosip_event_clear_wakeup (excontext);
 
   je = (eXosip_event_t *) osip_fifo_get (excontext->j_events);
   return je;
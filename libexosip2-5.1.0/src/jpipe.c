@@ -44,6 +44,11 @@
 
 #include <fcntl.h>
 
+#if defined(__linux__)
+#include <sys/eventfd.h>
+#include <stdint.h>
+#endif
+
 jpipe_t *
 jpipe ()
 {
@@ -52,6 +57,16 @@ jpipe ()
   if (my_pipe == NULL)
     return NULL;
 
+#if defined(__linux__)
+  /* an eventfd is a single descriptor holding a counter: any number of
+     wakeups is consumed with one read. */
+  my_pipe->pipes[0] = eventfd (0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (my_pipe->pipes[0] >= 0) {
+    my_pipe->pipes[1] = my_pipe->pipes[0];
+    return my_pipe;
+  }
+#endif
+
   if (0 != pipe (my_pipe->pipes)) {
     osip_free (my_pipe);
     return NULL;
@@ -61,6 +76,9 @@ jpipe ()
     /* failed for some reason... */
     OSIP_TRACE (osip_trace (__FILE__, __LINE__, OSIP_ERROR, NULL, "cannot set O_NONBLOCK to the pipe[1]!\n"));
   }
+  if (fcntl (my_pipe->pipes[0], F_SETFL, O_NONBLOCK) == -1) {
+    OSIP_TRACE (osip_trace (__FILE__, __LINE__, OSIP_ERROR, NULL, "cannot set O_NONBLOCK to the pipe[0]!\n"));
+  }
 
   return my_pipe;
 }
@@ -71,7 +89,8 @@ jpipe_close (jpipe_t * apipe)
   if (apipe == NULL)
     return OSIP_BADPARAMETER;
   _eXosip_closesocket (apipe->pipes[0]);
-  _eXosip_closesocket (apipe->pipes[1]);
+  if (apipe->pipes[1] != apipe->pipes[0])
+    _eXosip_closesocket (apipe->pipes[1]);
   osip_free (apipe);
   return OSIP_SUCCESS;
 }
@@ -85,6 +104,16 @@ jpipe_write (jpipe_t * apipe, const void *buf, int count)
 {
   if (apipe == NULL)
     return OSIP_BADPARAMETER;
+#if defined(__linux__)
+  if (apipe->pipes[1] == apipe->pipes[0]) {
+    uint64_t one = 1;
+
+    /* the content is meaningless: only the wakeup is kept */
+    if (write (apipe->pipes[1], &one, sizeof (one)) != sizeof (one))
+      return -1;
+    return count;
+  }
+#endif
   return (int) write (apipe->pipes[1], buf, count);
 }
 
@@ -78,6 +78,7 @@ extern "C" {
 
 /**
  * Read in a pipe.
+ * On linux, the pipe is an eventfd: count must be at least 8.
  */
   int jpipe_read (jpipe_t * pipe, void *buf, int count);
 
@@ -99,12 +99,8 @@ _eXosip_pub_find_by_tid (struct eXosip_t *excontext, eXosip_pub_t ** pjp, int ti
 int
 _eXosip_pub_init (struct eXosip_t *excontext, eXosip_pub_t ** pub, const char *aor, const char *exp)
 {
-  static int p_id = 0;
   eXosip_pub_t *jpub;
 
-  if (p_id == INT_MAX)          /* keep it non-negative */
-    p_id = 0;
-
   *pub = NULL;
 
   jpub = (eXosip_pub_t *) osip_malloc (sizeof (eXosip_pub_t));
@@ -114,7 +110,8 @@ _eXosip_pub_init (struct eXosip_t *excontext, eXosip_pub_t ** pub, const char *a
   snprintf (jpub->p_aor, 256, "%s", aor);
 
   jpub->p_period = atoi (exp);
-  jpub->p_id = ++p_id;
+  jpub->p_jitter = osip_build_random_number () % 1000;
+  jpub->p_id = _eXosip_id_new (excontext);
 
   *pub = jpub;
 
@@ -133,6 +130,8 @@ _eXosip_pub_init (struct eXosip_t *excontext, eXosip_pub_t ** pub, const char *a
 void
 _eXosip_pub_free (struct eXosip_t *excontext, eXosip_pub_t * pub)
 {
+  _eXosip_deadline_remove (excontext, EXOSIP_DEADLINE_PUBLISH, pub);
+
   if (pub->p_last_tr != NULL) {
     if (pub->p_last_tr != NULL && pub->p_last_tr->orig_request != NULL && pub->p_last_tr->orig_request->call_id != NULL && pub->p_last_tr->orig_request->call_id->number != NULL)
       _eXosip_delete_nonce (excontext, pub->p_last_tr->orig_request->call_id->number);
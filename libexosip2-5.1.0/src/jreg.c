@@ -46,19 +46,15 @@ void CvtHex (HASH Bin, HASHHEX Hex);
 int
 _eXosip_reg_init (struct eXosip_t *excontext, eXosip_reg_t ** jr, const char *from, const char *proxy, const char *contact)
 {
-  static int r_id = 0;
-
   *jr = (eXosip_reg_t *) osip_malloc (sizeof (eXosip_reg_t));
   if (*jr == NULL)
     return OSIP_NOMEM;
 
-  if (r_id == INT_MAX)          /* keep it non-negative */
-    r_id = 0;
-
   memset (*jr, '\0', sizeof (eXosip_reg_t));
 
-  (*jr)->r_id = ++r_id;
+  (*jr)->r_id = _eXosip_id_new (excontext);
   (*jr)->r_reg_period = 3600;   /* delay between registration */
+  (*jr)->r_jitter = osip_build_random_number () % 1000;
   (*jr)->r_aor = osip_strdup (from);    /* sip identity */
   if ((*jr)->r_aor == NULL) {
     osip_free (*jr);
@@ -134,6 +130,7 @@ _eXosip_reg_init (struct eXosip_t *excontext, eXosip_reg_t ** jr, const char *fr
 void
 _eXosip_reg_free (struct eXosip_t *excontext, eXosip_reg_t * jreg)
 {
+  _eXosip_deadline_remove (excontext, EXOSIP_DEADLINE_REGISTER, jreg);
 
   osip_free (jreg->r_aor);
   osip_free (jreg->r_contact);
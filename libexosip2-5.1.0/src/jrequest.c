@@ -43,37 +43,13 @@
 /* Private functions */
 static int dialog_fill_route_set (osip_dialog_t * dialog, osip_message_t * request);
 
-/* should use cryptographically random identifier is RECOMMENDED.... */
-/* by now this should lead to identical call-id when application are
-   started at the same time...   */
-char *
-_eXosip_malloc_new_random ()
-{
-  char *tmp = (char *) osip_malloc (33);
-  unsigned int number = osip_build_random_number ();
-
-  if (tmp == NULL)
-    return NULL;
-
-  sprintf (tmp, "%u", number);
-  return tmp;
-}
-
-int
-eXosip_generate_random (char *buf, int buf_size)
-{
-  unsigned int number = osip_build_random_number ();
-
-  snprintf (buf, buf_size, "%u", number);
-  return OSIP_SUCCESS;
-}
-
 int
 _eXosip_dialog_add_contact (struct eXosip_t *excontext, osip_message_t * request)
 {
   osip_from_t *a_from;
   char *contact = NULL;
   char scheme[10];
+  char sip_instance[sizeof (excontext->sip_instance)];
   int len;
 
   if (excontext->eXtl_transport.enabled <= 0)
@@ -92,6 +68,8 @@ _eXosip_dialog_add_contact (struct eXosip_t *excontext, osip_message_t * request
   else
     snprintf (scheme, sizeof (scheme), "sip");
 
+  _eXosip_config_get (excontext, excontext->sip_instance, sip_instance, sizeof (sip_instance));
+
   if (a_from->url->username != NULL)
     len = (int) (2 + 4 + (strlen (a_from->url->username) * 3) + 1 + 100 + 6 + 10 + 3 + strlen (excontext->transport));
   else
@@ -99,7 +77,7 @@ _eXosip_dialog_add_contact (struct eXosip_t *excontext, osip_message_t * request
 
   len++;                        /* if using sips instead of sip */
 
-  if (excontext->sip_instance[0] != 0)
+  if (sip_instance[0] != 0)
     len += 65;
 
   contact = (char *) osip_malloc (len + 1);
@@ -128,9 +106,9 @@ _eXosip_dialog_add_contact (struct eXosip_t *excontext, osip_message_t * request
     strcat (contact, excontext->transport);
     strcat (contact, ">");
   }
-  if (excontext->sip_instance[0] != 0) {
+  if (sip_instance[0] != 0) {
     strcat (contact, ";+sip.instance=\"<urn:uuid:");
-    strcat (contact, excontext->sip_instance);
+    strcat (contact, sip_instance);
     strcat (contact, ">\"");
   }
 
@@ -155,6 +133,7 @@ int
 _eXosip_request_add_via (struct eXosip_t *excontext, osip_message_t * request)
 {
   char tmp[200];
+  char branch[EXOSIP_ID_LEN + 1];
 
   if (excontext->eXtl_transport.enabled <= 0)
     return OSIP_NO_NETWORK;
@@ -165,11 +144,13 @@ _eXosip_request_add_via (struct eXosip_t *excontext, osip_message_t * request)
   if (request->call_id == NULL)
     return OSIP_SYNTAXERROR;
 
+  _eXosip_id_format (branch, sizeof (branch));
+
   /* special values to be replaced in transport layer (eXtl_*.c files) */
   if (excontext->use_rport != 0 && excontext->eXtl_transport.proto_family == AF_INET)
-    snprintf (tmp, 200, "SIP/2.0/%s 999.999.999.999:99999;rport;branch=z9hG4bK%u", excontext->transport, osip_build_random_number ());
+    snprintf (tmp, 200, "SIP/2.0/%s 999.999.999.999:99999;rport;branch=z9hG4bK%s", excontext->transport, branch);
   else
-    snprintf (tmp, 200, "SIP/2.0/%s 999.999.999.999:99999;branch=z9hG4bK%u", excontext->transport, osip_build_random_number ());
+    snprintf (tmp, 200, "SIP/2.0/%s 999.999.999.999:99999;branch=z9hG4bK%s", excontext->transport, branch);
 
   osip_message_set_via (request, tmp);
 
@@ -527,7 +508,9 @@ _eXosip_generating_request_out_of_dialog (struct eXosip_t *excontext, osip_messa
     osip_message_set_accept (request, "application/sdp");
   }
 
+  _eXosip_config_rdlock (excontext);
   osip_message_set_user_agent (request, excontext->user_agent);
+  _eXosip_config_rdunlock (excontext);
   /*  else if ... */
   *dest = request;
   return OSIP_SUCCESS;
@@ -778,7 +761,9 @@ _eXosip_build_request_within_dialog (struct eXosip_t *excontext, osip_message_t
     /* TODO... */
   }
 
+  _eXosip_config_rdlock (excontext);
   osip_message_set_user_agent (request, excontext->user_agent);
+  _eXosip_config_rdunlock (excontext);
   /*  else if ... */
   *dest = request;
   return OSIP_SUCCESS;
@@ -894,7 +879,9 @@ _eXosip_generating_cancel (struct eXosip_t *excontext, osip_message_t ** dest, o
   }
 
   osip_message_set_max_forwards (request, "70");        /* a UA should start a request with 70 */
+  _eXosip_config_rdlock (excontext);
   osip_message_set_user_agent (request, excontext->user_agent);
+  _eXosip_config_rdunlock (excontext);
 
   *dest = request;
   return OSIP_SUCCESS;
@@ -166,7 +166,9 @@ _eXosip_build_response_default (struct eXosip_t *excontext, osip_message_t ** de
   }
 #endif
 
+  _eXosip_config_rdlock (excontext);
   osip_message_set_user_agent (response, excontext->user_agent);
+  _eXosip_config_rdunlock (excontext);
 
   *dest = response;
   return OSIP_SUCCESS;
@@ -232,6 +234,7 @@ _eXosip_complete_answer_that_establish_a_dialog (struct eXosip_t *excontext, osi
 
   {
     osip_via_t *via;
+    char sip_instance[sizeof (excontext->sip_instance)];
 
     via = (osip_via_t *) osip_list_get (&response->vias, 0);
     if (via == NULL || via->protocol == NULL)
@@ -247,9 +250,10 @@ _eXosip_complete_answer_that_establish_a_dialog (struct eXosip_t *excontext, osi
       strcat (contact, via->protocol);
       strcat (contact, ">");
     }
-    if (excontext->sip_instance[0] != 0 && strlen (contact) + 64 < 1024) {
+    _eXosip_config_get (excontext, excontext->sip_instance, sip_instance, sizeof (sip_instance));
+    if (sip_instance[0] != 0 && strlen (contact) + 64 < 1024) {
       strcat (contact, ";+sip.instance=\"<urn:uuid:");
-      strcat (contact, excontext->sip_instance);
+      strcat (contact, sip_instance);
       strcat (contact, ">\"");
     }
   }
@@ -376,8 +380,10 @@ _eXosip_insubscription_answer_1xx (struct eXosip_t *excontext, eXosip_notify_t *
       if (i != 0) {
         OSIP_TRACE (osip_trace (__FILE__, __LINE__, OSIP_ERROR, NULL, "eXosip: cannot create dialog!\n"));
       }
-      else
+      else {
         ADD_ELEMENT (jn->n_dialogs, jd);
+        _eXosip_dialog_index_add (excontext, jd, EXOSIP_DIALOG_OWNER_NOTIFY, jn);
+      }
     }
   }
 
@@ -86,6 +86,7 @@ _eXosip_subscription_init (struct eXosip_t *excontext, eXosip_subscribe_t ** js)
   if (*js == NULL)
     return OSIP_NOMEM;
   memset (*js, 0, sizeof (eXosip_subscribe_t));
+  (*js)->s_jitter = osip_build_random_number () % 1000;
 
 #ifndef MINISIZE
   {
@@ -104,6 +105,8 @@ _eXosip_subscription_free (struct eXosip_t *excontext, eXosip_subscribe_t * js)
 {
   eXosip_dialog_t *jd;
 
+  _eXosip_deadline_remove (excontext, EXOSIP_DEADLINE_SUBSCRIBE, js);
+
   if (js->s_inc_tr != NULL && js->s_inc_tr->orig_request != NULL && js->s_inc_tr->orig_request->call_id != NULL && js->s_inc_tr->orig_request->call_id->number != NULL)
     _eXosip_delete_nonce (excontext, js->s_inc_tr->orig_request->call_id->number);
   else if (js->s_out_tr != NULL && js->s_out_tr->orig_request != NULL && js->s_out_tr->orig_request->call_id != NULL && js->s_out_tr->orig_request->call_id->number != NULL)
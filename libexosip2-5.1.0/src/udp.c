@@ -444,6 +444,7 @@ _eXosip_process_new_invite (struct eXosip_t *excontext, osip_transaction_t * tra
   _eXosip_check_allow_header (jd, evt->sip);
 
   ADD_ELEMENT (jc->c_dialogs, jd);
+  _eXosip_dialog_index_add (excontext, jd, EXOSIP_DIALOG_OWNER_CALL, jc);
 
   osip_transaction_set_reserved2 (transaction, jc);
   osip_transaction_set_reserved3 (transaction, jd);
@@ -535,6 +536,7 @@ _eXosip_process_new_subscription (struct eXosip_t *excontext, osip_transaction_t
     return;
   }
   ADD_ELEMENT (jn->n_dialogs, jd);
+  _eXosip_dialog_index_add (excontext, jd, EXOSIP_DIALOG_OWNER_NOTIFY, jn);
 
   osip_transaction_set_reserved4 (transaction, jn);
   osip_transaction_set_reserved3 (transaction, jd);
@@ -860,18 +862,11 @@ _eXosip_process_newrequest (struct eXosip_t *excontext, osip_event_t * evt, int
     return;
   }
 
-  jd = NULL;
   /* first, look for a Dialog in the map of element */
-  for (jc = excontext->j_calls; jc != NULL; jc = jc->next) {
-    for (jd = jc->c_dialogs; jd != NULL; jd = jd->next) {
-      if (jd->d_dialog != NULL) {
-        if (osip_dialog_match_as_uas (jd->d_dialog, evt->sip) == 0)
-          break;
-      }
-    }
-    if (jd != NULL)
-      break;
-  }
+  jc = NULL;
+  jd = _eXosip_dialog_index_find_as_uas (excontext, EXOSIP_DIALOG_OWNER_CALL, evt->sip);
+  if (jd != NULL)
+    jc = (eXosip_call_t *) jd->d_owner;
 
   /* check CSeq */
   if (jd != NULL && transaction != NULL && evt->sip != NULL && evt->sip->cseq != NULL && evt->sip->cseq->number != NULL) {
@@ -1094,18 +1089,11 @@ _eXosip_process_newrequest (struct eXosip_t *excontext, osip_event_t * evt, int
     return;
   }
 #ifndef MINISIZE
-  js = NULL;
   /* first, look for a Dialog in the map of element */
-  for (js = excontext->j_subscribes; js != NULL; js = js->next) {
-    for (jd = js->s_dialogs; jd != NULL; jd = jd->next) {
-      if (jd->d_dialog != NULL) {
-        if (osip_dialog_match_as_uas (jd->d_dialog, evt->sip) == 0)
-          break;
-      }
-    }
-    if (jd != NULL)
-      break;
-  }
+  js = NULL;
+  jd = _eXosip_dialog_index_find_as_uas (excontext, EXOSIP_DIALOG_OWNER_SUBSCRIBE, evt->sip);
+  if (jd != NULL)
+    js = (eXosip_subscribe_t *) jd->d_owner;
 
   if (js != NULL) {
     /* dialog found */
@@ -1170,6 +1158,7 @@ _eXosip_process_newrequest (struct eXosip_t *excontext, osip_event_t * evt, int
         }
 
         ADD_ELEMENT (js->s_dialogs, jd);
+        _eXosip_dialog_index_add (excontext, jd, EXOSIP_DIALOG_OWNER_SUBSCRIBE, js);
         _eXosip_update (excontext);
 
         _eXosip_process_notify_within_dialog (excontext, js, jd, transaction, evt);
@@ -1181,18 +1170,11 @@ _eXosip_process_newrequest (struct eXosip_t *excontext, osip_event_t * evt, int
     return;
   }
 
-  jn = NULL;
   /* first, look for a Dialog in the map of element */
-  for (jn = excontext->j_notifies; jn != NULL; jn = jn->next) {
-    for (jd = jn->n_dialogs; jd != NULL; jd = jd->next) {
-      if (jd->d_dialog != NULL) {
-        if (osip_dialog_match_as_uas (jd->d_dialog, evt->sip) == 0)
-          break;
-      }
-    }
-    if (jd != NULL)
-      break;
-  }
+  jn = NULL;
+  jd = _eXosip_dialog_index_find_as_uas (excontext, EXOSIP_DIALOG_OWNER_NOTIFY, evt->sip);
+  if (jd != NULL)
+    jn = (eXosip_notify_t *) jd->d_owner;
 
   if (jn != NULL) {
     /* dialog found */
@@ -1274,38 +1256,38 @@ _eXosip_process_response_out_of_transaction (struct eXosip_t *excontext, osip_ev
     return;
   }
 
-  /* search for existing dialog: match branch & to tag */
-  for (jc = excontext->j_calls; jc != NULL; jc = jc->next) {
-    /* search for calls matching the to tag */
-    if (jc->c_id >= 1 && jc->c_dialogs != NULL) {
-      for (jd = jc->c_dialogs; jd != NULL; jd = jd->next) {
-        if (jd->d_id >= 1 && jd->d_dialog != NULL) {
-          /* match answer with dialog */
-          osip_generic_param_t *tag;
-
-          osip_from_get_tag (evt->sip->to, &tag);
-
-          if (jd->d_dialog->remote_tag == NULL || tag == NULL)
-            continue;
-          if (jd->d_dialog->remote_tag != NULL && tag != NULL && tag->gvalue != NULL && 0 == strcmp (jd->d_dialog->remote_tag, tag->gvalue))
-            break;
-        }
-      }
-      if (jd != NULL)
+  /* search for existing dialog: match Call-ID & to tag */
+  {
+    osip_call_id_t *callid = evt->sip->call_id;
+    osip_generic_param_t *tag = NULL;
+    eXosip_dialog_t *jd_call;
+
+    osip_to_get_tag (evt->sip->to, &tag);
+    for (jd = _eXosip_dialog_index_first (excontext, EXOSIP_DIALOG_OWNER_CALL, callid); jd != NULL; jd = _eXosip_dialog_index_next (jd, EXOSIP_DIALOG_OWNER_CALL, callid)) {
+      jc = (eXosip_call_t *) jd->d_owner;
+      if (jc->c_id < 1 || jd->d_id < 1 || jd->d_dialog == NULL)
+        continue;
+      /* match answer with dialog */
+      if (jd->d_dialog->remote_tag != NULL && tag != NULL && tag->gvalue != NULL && 0 == strcmp (jd->d_dialog->remote_tag, tag->gvalue))
         break;                  /* found a matching dialog! */
+    }
 
+    if (jd == NULL) {
+      jc = NULL;
       /* check if the From tag of 2xx match the from tag of initial OUTGOING INVITE */
-      if (jc->c_out_tr != NULL && jc->c_out_tr->orig_request != NULL && jc->c_out_tr->orig_request->from != NULL) {
-        osip_generic_param_t *tag_invite;
-        osip_generic_param_t *tag;
+      osip_from_get_tag (evt->sip->from, &tag);
+      for (jd_call = _eXosip_dialog_index_first (excontext, EXOSIP_DIALOG_OWNER_CALL, callid); tag != NULL && jd_call != NULL; jd_call = _eXosip_dialog_index_next (jd_call, EXOSIP_DIALOG_OWNER_CALL, callid)) {
+        eXosip_call_t *jc_call = (eXosip_call_t *) jd_call->d_owner;
 
-        osip_from_get_tag (jc->c_out_tr->orig_request->from, &tag_invite);
-        osip_from_get_tag (evt->sip->from, &tag);
+        if (jc_call->c_id >= 1 && jc_call->c_out_tr != NULL && jc_call->c_out_tr->orig_request != NULL && jc_call->c_out_tr->orig_request->from != NULL) {
+          osip_generic_param_t *tag_invite = NULL;
 
-        if (tag_invite == NULL || tag == NULL)
-          continue;
-        if (tag_invite->gvalue != NULL && tag->gvalue != NULL && 0 == strcmp (tag_invite->gvalue, tag->gvalue))
-          break;
+          osip_from_get_tag (jc_call->c_out_tr->orig_request->from, &tag_invite);
+          if (tag_invite != NULL && tag_invite->gvalue != NULL && tag->gvalue != NULL && 0 == strcmp (tag_invite->gvalue, tag->gvalue)) {
+            jc = jc_call;
+            break;
+          }
+        }
       }
     }
   }
@@ -1542,6 +1524,393 @@ udp_tl_learn_port_from_via (struct eXosip_t *excontext, osip_message_t * sip)
   return;
 }
 
+void
+_eXosip_stateless_cache_flush (struct eXosip_t *excontext)
+{
+  int pos;
+
+  for (pos = 0; pos < EXOSIP_STATELESS_CACHE_SIZE; pos++) {
+    struct eXosip_stateless_answer *sa = &excontext->stateless_answers[pos];
+
+    osip_free (sa->branch);
+    osip_message_free (sa->answer);
+    memset (sa, 0, sizeof (struct eXosip_stateless_answer));
+  }
+}
+
+/* answer an out of dialog non-INVITE request without creating a transaction,
+   if the application callback gives a final status code for it, or if it
+   is a REGISTER and the registrar is enabled. */
+static int
+_eXosip_process_stateless_request (struct eXosip_t *excontext, osip_event_t * evt, int socket)
+{
+  struct eXosip_stateless_answer *sa = NULL;
+  osip_generic_param_t *tag = NULL;
+  osip_generic_param_t *br = NULL;
+  osip_via_t *via;
+  osip_message_t *answer;
+  unsigned int hash = 2166136261U;
+  time_t now;
+  int status;
+  int i;
+
+  if (MSG_IS_INVITE (evt->sip) || MSG_IS_ACK (evt->sip) || MSG_IS_CANCEL (evt->sip))
+    return OSIP_UNDEFINED_ERROR;
+  if (evt->sip->to == NULL || evt->sip->cseq == NULL || evt->sip->cseq->method == NULL)
+    return OSIP_UNDEFINED_ERROR;
+  osip_to_get_tag (evt->sip->to, &tag);
+  if (tag != NULL)
+    return OSIP_UNDEFINED_ERROR;
+
+  now = osip_getsystemtime (NULL);
+  via = (osip_via_t *) osip_list_get (&evt->sip->vias, 0);
+  if (via != NULL)
+    osip_via_param_get_byname (via, "branch", &br);
+  if (br != NULL && br->gvalue != NULL) {
+    const char *p;
+
+    for (p = br->gvalue; *p != '\0'; p++)
+      hash = (hash ^ (unsigned char) *p) * 16777619U;
+    sa = &excontext->stateless_answers[hash % EXOSIP_STATELESS_CACHE_SIZE];
+
+    if (sa->answer != NULL && sa->expire >= now && sa->hash == hash && strcmp (sa->branch, br->gvalue) == 0 && osip_strcasecmp (sa->answer->cseq->method, evt->sip->cseq->method) == 0) {
+      /* retransmission of a request already answered */
+      OSIP_TRACE (osip_trace (__FILE__, __LINE__, OSIP_INFO2, NULL, "eXosip: request retransmission answered without transaction (%s)\n", br->gvalue));
+      _eXosip_snd_message (excontext, NULL, sa->answer, NULL, 0, socket);
+      osip_event_free (evt);
+      return OSIP_SUCCESS;
+    }
+  }
+
+  if (excontext->registrar != NULL && MSG_IS_REGISTER (evt->sip)) {
+    i = _eXosip_registrar_answer (excontext, evt->sip, &answer);
+    if (i != 0)
+      return i;
+  }
+  else {
+    if (excontext->cbsipStateless == NULL)
+      return OSIP_UNDEFINED_ERROR;
+    status = excontext->cbsipStateless (excontext, evt->sip, excontext->cbsipStatelessArg);
+    if (status < 200 || status > 699)
+      return OSIP_UNDEFINED_ERROR;
+
+    i = _eXosip_build_response_default (excontext, &answer, NULL, status, evt->sip);
+    if (i != 0)
+      return i;
+  }
+
+  i = _eXosip_snd_message (excontext, NULL, answer, NULL, 0, socket);
+  if (i != 0) {
+    OSIP_TRACE (osip_trace (__FILE__, __LINE__, OSIP_WARNING, NULL, "eXosip: failed to send answer without transaction\n"));
+  }
+
+  if (sa != NULL) {
+    osip_free (sa->branch);
+    osip_message_free (sa->answer);
+    sa->answer = NULL;
+    sa->branch = osip_strdup (br->gvalue);
+    if (sa->branch != NULL) {
+      sa->hash = hash;
+      /* Timer J */
+      sa->expire = now + 64 * DEFAULT_T1 / 1000;
+      sa->answer = answer;
+      answer = NULL;
+    }
+  }
+  osip_message_free (answer);
+  osip_event_free (evt);
+  return OSIP_SUCCESS;
+}
+
+static int
+_eXosip_is_overloaded (struct eXosip_t *excontext)
+{
+  struct eXosip_overload_control *oc = &excontext->overload;
+
+  if (oc->max_loop_lag > 0 && excontext->loop_lag >= oc->max_loop_lag)
+    return 1;
+  if (oc->max_events > 0 && osip_fifo_size (excontext->j_events) >= oc->max_events)
+    return 1;
+  if (oc->max_server_transactions > 0) {
+    osip_t *osip = excontext->j_osip;
+    int count;
+
+    /* the transaction lists are modified by osip with its own mutexes held */
+#ifndef OSIP_MONOTHREAD
+    osip_mutex_lock (osip->ist_fastmutex);
+#endif
+    count = osip_list_size (&osip->osip_ist_transactions);
+#ifndef OSIP_MONOTHREAD
+    osip_mutex_unlock (osip->ist_fastmutex);
+    osip_mutex_lock (osip->nist_fastmutex);
+#endif
+    count += osip_list_size (&osip->osip_nist_transactions);
+#ifndef OSIP_MONOTHREAD
+    osip_mutex_unlock (osip->nist_fastmutex);
+#endif
+    if (count >= oc->max_server_transactions)
+      return 1;
+  }
+  return 0;
+}
+
+/* reject a new out of dialog request when the overload control thresholds
+   are reached. */
+static int
+_eXosip_process_overload (struct eXosip_t *excontext, osip_event_t * evt, int socket)
+{
+  osip_generic_param_t *tag = NULL;
+  osip_message_t *answer;
+  int i;
+
+  if (MSG_IS_ACK (evt->sip) || MSG_IS_CANCEL (evt->sip) || evt->sip->to == NULL)
+    return OSIP_UNDEFINED_ERROR;
+  osip_to_get_tag (evt->sip->to, &tag);
+  if (tag != NULL)
+    return OSIP_UNDEFINED_ERROR;
+  if (!_eXosip_is_overloaded (excontext))
+    return OSIP_UNDEFINED_ERROR;
+
+  if (excontext->overload.drop > 0) {
+    OSIP_TRACE (osip_trace (__FILE__, __LINE__, OSIP_WARNING, NULL, "eXosip: overload, request dropped\n"));
+#ifndef MINISIZE
+    excontext->statistics.overload_dropped++;
+#endif
+    osip_event_free (evt);
+    return OSIP_SUCCESS;
+  }
+
+  OSIP_TRACE (osip_trace (__FILE__, __LINE__, OSIP_WARNING, NULL, "eXosip: overload, request rejected with 503\n"));
+#ifndef MINISIZE
+  excontext->statistics.overload_rejected++;
+#endif
+  i = _eXosip_build_response_default (excontext, &answer, NULL, 503, evt->sip);
+  if (i == 0) {
+    if (excontext->overload.retry_after > 0) {
+      char retry_after[16];
+
+      snprintf (retry_after, sizeof (retry_after), "%i", excontext->overload.retry_after);
+      osip_message_set_header (answer, "Retry-After", retry_after);
+    }
+    _eXosip_snd_message (excontext, NULL, answer, NULL, 0, socket);
+    osip_message_free (answer);
+  }
+  osip_event_free (evt);
+  return OSIP_SUCCESS;
+}
+
+/* token bucket of the source address: return 0 when the message must be
+   dropped. */
+static int
+_eXosip_rate_limit_accept (struct eXosip_t *excontext, const char *host)
+{
+  struct eXosip_source_bucket *set;
+  struct eXosip_source_bucket *bucket = NULL;
+  struct eXosip_source_bucket *lru;
+  struct timeval now;
+  unsigned int hash = 2166136261U;
+  const char *p;
+  int accept;
+  int way;
+
+  for (p = host; *p != '\0'; p++)
+    hash = (hash ^ (unsigned char) *p) * 16777619U;
+  osip_gettimeofday (&now, NULL);
+
+  eXosip_lock (excontext);
+  set = &excontext->rate_limit_table[(hash % EXOSIP_RATE_LIMIT_SETS) * EXOSIP_RATE_LIMIT_WAYS];
+  lru = set;
+  for (way = 0; way < EXOSIP_RATE_LIMIT_WAYS; way++) {
+    if (set[way].ip[0] != '\0' && set[way].hash == hash && strcmp (set[way].ip, host) == 0) {
+      bucket = &set[way];
+      break;
+    }
+    if (lru->ip[0] != '\0' && (set[way].ip[0] == '\0' || osip_timercmp (&set[way].last, &lru->last, <)))
+      lru = &set[way];
+  }
+
+  if (bucket == NULL) {
+    bucket = lru;
+    memset (bucket, 0, sizeof (struct eXosip_source_bucket));
+    osip_strncpy (bucket->ip, host, sizeof (bucket->ip) - 1);
+    bucket->hash = hash;
+    bucket->tokens = excontext->rate_limit.burst;
+  }
+  else {
+    bucket->tokens += ((now.tv_sec - bucket->last.tv_sec) + (now.tv_usec - bucket->last.tv_usec) / 1000000.0) * excontext->rate_limit.rate;
+    if (bucket->tokens > excontext->rate_limit.burst)
+      bucket->tokens = excontext->rate_limit.burst;
+  }
+  bucket->last = now;
+  bucket->received++;
+
+  accept = 1;
+  if (bucket->tokens >= 1)
+    bucket->tokens -= 1;
+  else {
+    bucket->dropped++;
+#ifndef MINISIZE
+    excontext->statistics.rate_limited++;
+#endif
+    accept = 0;
+  }
+  eXosip_unlock (excontext);
+  return accept;
+}
+
+static int _eXosip_process_incoming_event (struct eXosip_t *excontext, osip_event_t * se, int socket);
+
+/* class 0: responses, ACK, CANCEL and BYE complete existing transactions
+   or dialogs; class 1: other in-dialog requests; class 2: new requests.
+   A request is never processed before a request of the same Call-ID
+   received earlier (the INVITE of a CANCEL, a re-INVITE before a BYE):
+   it is queued in the lowest class where one is still waiting. */
+static int
+_eXosip_inbound_class (struct eXosip_t *excontext, osip_message_t * sip)
+{
+  struct eXosip_inbound_message *msg;
+  osip_generic_param_t *tag = NULL;
+  int cls;
+  int k;
+
+  if (MSG_IS_RESPONSE (sip))
+    return 0;
+  if (MSG_IS_ACK (sip) || MSG_IS_BYE (sip) || MSG_IS_CANCEL (sip))
+    cls = 0;
+  else {
+    if (sip->to != NULL)
+      osip_to_get_tag (sip->to, &tag);
+    cls = (tag != NULL) ? 1 : 2;
+  }
+
+  for (k = EXOSIP_INBOUND_CLASSES - 1; k > cls; k--) {
+    for (msg = excontext->inbound[k].head; msg != NULL; msg = msg->next) {
+      if (osip_call_id_match (msg->evt->sip->call_id, sip->call_id) == 0)
+        return k;
+    }
+  }
+  return cls;
+}
+
+static int
+_eXosip_inbound_add (struct eXosip_t *excontext, osip_event_t * se, int socket)
+{
+  struct eXosip_inbound_queue *queue;
+  struct eXosip_inbound_message *msg;
+
+  msg = (struct eXosip_inbound_message *) osip_malloc (sizeof (struct eXosip_inbound_message));
+  if (msg == NULL)
+    return _eXosip_process_incoming_event (excontext, se, socket);
+  msg->evt = se;
+  msg->socket = socket;
+  msg->next = NULL;
+
+  queue = &excontext->inbound[_eXosip_inbound_class (excontext, se->sip)];
+  if (queue->tail == NULL)
+    queue->head = msg;
+  else
+    queue->tail->next = msg;
+  queue->tail = msg;
+  excontext->inbound_queued++;
+  return OSIP_SUCCESS;
+}
+
+/* process the waiting messages, highest class first. A class waiting
+   for starvation_limit messages is served before the higher ones. */
+static void
+_eXosip_inbound_dispatch (struct eXosip_t *excontext)
+{
+  int limit = excontext->inbound_priority.starvation_limit;
+
+  while (excontext->inbound_queued > 0) {
+    struct eXosip_inbound_queue *queue;
+    struct eXosip_inbound_message *msg;
+    int cls = -1;
+    int k;
+
+    for (k = 0; k < EXOSIP_INBOUND_CLASSES; k++) {
+      if (excontext->inbound[k].head == NULL)
+        continue;
+      if (cls < 0)
+        cls = k;
+      else if (limit > 0 && excontext->inbound[k].skipped >= limit) {
+        cls = k;
+        break;
+      }
+    }
+    for (k = cls + 1; k < EXOSIP_INBOUND_CLASSES; k++) {
+      if (excontext->inbound[k].head != NULL)
+        excontext->inbound[k].skipped++;
+    }
+
+    queue = &excontext->inbound[cls];
+    queue->skipped = 0;
+    msg = queue->head;
+    queue->head = msg->next;
+    if (queue->head == NULL)
+      queue->tail = NULL;
+    excontext->inbound_queued--;
+
+    _eXosip_process_incoming_event (excontext, msg->evt, msg->socket);
+    osip_free (msg);
+  }
+}
+
+/* read the messages already waiting on the sockets (up to batch) and
+   process all of them in priority order. */
+static void
+_eXosip_inbound_read_batch (struct eXosip_t *excontext)
+{
+  int batch = excontext->inbound_priority.batch;        /* may be changed by EXOSIP_OPT_SET_INBOUND_PRIORITY */
+
+#ifdef TSC_SUPPORT
+  if (excontext->tunnel_handle) {
+    _eXosip_inbound_dispatch (excontext);
+    return;
+  }
+#endif
+
+  while (excontext->inbound_queued > 0 && excontext->inbound_queued < batch && excontext->j_stop_ua == 0) {
+    fd_set osip_fdset;
+    fd_set osip_wrset;
+    struct timeval tv;
+    int queued = excontext->inbound_queued;
+    int max = 0;
+
+    FD_ZERO (&osip_fdset);
+    FD_ZERO (&osip_wrset);
+    excontext->eXtl_transport.tl_set_fdset (excontext, &osip_fdset, &osip_wrset, &max);
+    tv.tv_sec = 0;
+    tv.tv_usec = 0;
+    if (select (max + 1, &osip_fdset, &osip_wrset, NULL, &tv) <= 0)
+      break;
+    excontext->eXtl_transport.tl_read_message (excontext, &osip_fdset, &osip_wrset);
+    if (excontext->inbound_queued == queued)
+      break;
+  }
+  _eXosip_inbound_dispatch (excontext);
+}
+
+void
+_eXosip_inbound_flush (struct eXosip_t *excontext)
+{
+  int k;
+
+  for (k = 0; k < EXOSIP_INBOUND_CLASSES; k++) {
+    struct eXosip_inbound_message *msg;
+
+    while (excontext->inbound[k].head != NULL) {
+      msg = excontext->inbound[k].head;
+      excontext->inbound[k].head = msg->next;
+      osip_event_free (msg->evt);
+      osip_free (msg);
+    }
+    excontext->inbound[k].tail = NULL;
+    excontext->inbound[k].skipped = 0;
+  }
+  excontext->inbound_queued = 0;
+}
+
 int
 _eXosip_handle_incoming_message (struct eXosip_t *excontext, char *buf, size_t length, int socket, char *host, int port, char *received_host, int *rport_port)
 {
@@ -1549,6 +1918,15 @@ _eXosip_handle_incoming_message (struct eXosip_t *excontext, char *buf, size_t l
   osip_event_t *se;
   int tmp;
 
+#ifndef OSIP_MONOTHREAD
+  excontext->loop_activity = 1;
+#endif
+
+  if (excontext->rate_limit.rate > 0 && host != NULL && !_eXosip_rate_limit_accept (excontext, host)) {
+    OSIP_TRACE (osip_trace (__FILE__, __LINE__, OSIP_INFO2, NULL, "eXosip: rate limit, message from %s:%i dropped\n", host, port));
+    return OSIP_SUCCESS;
+  }
+
   se = (osip_event_t *) osip_malloc (sizeof (osip_event_t));
   if (se == NULL)
     return OSIP_NOMEM;
@@ -1613,6 +1991,12 @@ _eXosip_handle_incoming_message (struct eXosip_t *excontext, char *buf, size_t l
       se->type = RCV_STATUS_3456XX;
   }
 
+  if (excontext->peer_health.max_failures > 0) {
+    eXosip_lock (excontext);
+    _eXosip_peer_health_alive (excontext, host, port);
+    eXosip_unlock (excontext);
+  }
+
   osip_message_fix_last_via_header (se->sip, host, port);
   _eXosip_handle_rfc5626_ob (se->sip, host, port);
 
@@ -1621,13 +2005,30 @@ _eXosip_handle_incoming_message (struct eXosip_t *excontext, char *buf, size_t l
     udp_tl_learn_port_from_via (excontext, se->sip);
   }
 
+  if (excontext->inbound_priority.batch > 0)
+    return _eXosip_inbound_add (excontext, se, socket);
+  return _eXosip_process_incoming_event (excontext, se, socket);
+}
+
+static int
+_eXosip_process_incoming_event (struct eXosip_t *excontext, osip_event_t * se, int socket)
+{
+  int i;
+
   i = osip_find_transaction_and_add_event (excontext->j_osip, se);
   if (i != 0) {
     /* this event has no transaction, */
     OSIP_TRACE (osip_trace (__FILE__, __LINE__, OSIP_INFO1, NULL, "no transaction for message\n"));
     eXosip_lock (excontext);
-    if (MSG_IS_REQUEST (se->sip))
-      _eXosip_process_newrequest (excontext, se, socket);
+    if (MSG_IS_REQUEST (se->sip)) {
+      i = OSIP_UNDEFINED_ERROR;
+      if (excontext->cbsipStateless != NULL || (excontext->registrar != NULL && MSG_IS_REGISTER (se->sip)))
+        i = _eXosip_process_stateless_request (excontext, se, socket);
+      if (i != OSIP_SUCCESS)
+        i = _eXosip_process_overload (excontext, se, socket);
+      if (i != OSIP_SUCCESS)
+        _eXosip_process_newrequest (excontext, se, socket);
+    }
     else if (MSG_IS_RESPONSE (se->sip))
       _eXosip_process_response_out_of_transaction (excontext, se);
     eXosip_unlock (excontext);
@@ -1639,11 +2040,41 @@ _eXosip_handle_incoming_message (struct eXosip_t *excontext, char *buf, size_t l
   return OSIP_SUCCESS;
 }
 
-#if defined (WIN32) || defined (_WIN32_WCE)
-#define eXFD_SET(A, B)   FD_SET((unsigned int) A, B)
-#else
-#define eXFD_SET(A, B)   FD_SET(A, B)
+/* read the sockets of the context found ready by select */
+void
+_eXosip_read_sockets (struct eXosip_t *excontext, fd_set * osip_fdset, fd_set * osip_wrset)
+{
+  if (excontext->cbsipWakeLock != NULL && excontext->incoming_wake_lock_state == 0)
+    excontext->cbsipWakeLock (++excontext->incoming_wake_lock_state);
+
+  excontext->eXtl_transport.tl_read_message (excontext, osip_fdset, osip_wrset);
+
+  if (excontext->inbound_queued > 0)
+    _eXosip_inbound_read_batch (excontext);
+
+  if (excontext->cbsipWakeLock != NULL && excontext->incoming_wake_lock_state > 0) {
+    osip_t *osip = excontext->j_osip;
+    int count;
+
+    /* the transaction lists are modified by osip with its own mutexes held */
+#ifndef OSIP_MONOTHREAD
+    osip_mutex_lock (osip->ist_fastmutex);
+#endif
+    count = osip_list_size (&osip->osip_ist_transactions);
+#ifndef OSIP_MONOTHREAD
+    osip_mutex_unlock (osip->ist_fastmutex);
+    osip_mutex_lock (osip->nist_fastmutex);
+#endif
+    count += osip_list_size (&osip->osip_nist_transactions);
+#ifndef OSIP_MONOTHREAD
+    osip_mutex_unlock (osip->nist_fastmutex);
 #endif
+    if (count == 0) {
+      excontext->cbsipWakeLock (0);
+      excontext->incoming_wake_lock_state = 0;
+    }
+  }
+}
 
 /* if second==-1 && useconds==-1  -> wait for ever
    if max_message_nb<=0  -> infinite loop....  */
@@ -1769,24 +2200,8 @@ _eXosip_read_message (struct eXosip_t *excontext, int max_message_nb, int sec_ma
       return -2000;             /* error */
 #endif
     }
-    else {
-
-      if (excontext->cbsipWakeLock != NULL && excontext->incoming_wake_lock_state == 0)
-        excontext->cbsipWakeLock (++excontext->incoming_wake_lock_state);
-
-      excontext->eXtl_transport.tl_read_message (excontext, &osip_fdset, &osip_wrset);
-
-    }
-
-    if (excontext->cbsipWakeLock != NULL && excontext->incoming_wake_lock_state > 0) {
-      int count = osip_list_size (&excontext->j_osip->osip_ist_transactions);
-
-      count += osip_list_size (&excontext->j_osip->osip_nist_transactions);
-      if (count == 0) {
-        excontext->cbsipWakeLock (0);
-        excontext->incoming_wake_lock_state = 0;
-      }
-    }
+    else
+      _eXosip_read_sockets (excontext, &osip_fdset, &osip_wrset);
 
     /* avoid infinite select if a message was read at the very end of period */
     if (tv.tv_sec == 0 && tv.tv_usec == 0 && (sec_max != 0 || usec_max != 0)) {
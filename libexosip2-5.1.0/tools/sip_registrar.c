@@ -0,0 +1,392 @@
+/*
+ * SIP registrar test tool
+ *
+ * This program is Free Software, released under the GNU General
+ * Public License v2.0 http://www.gnu.org/licenses/gpl
+ *
+ * This program runs an eXosip context configured as registrar
+ * (EXOSIP_OPT_SET_REGISTRAR) and two client contexts on the loopback
+ * interface. The clients register, answer the digest challenge, refresh
+ * and unregister; the bindings are checked with eXosip_registrar_lookup.
+ *
+ * Requests the registrar must refuse are also sent: a digest username
+ * other than the To user (403), a malformed expires (400), a Contact: *
+ * without Expires: 0 (400) and a replayed nonce count (401).
+ *
+ * The exit status is 0 when every check passed.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include <getopt.h>
+
+#include <eXosip2/eXosip.h>
+
+#define PROG_NAME "sip_registrar"
+#define PROG_VER  "1.0"
+
+#define REGISTRAR_REALM "sip_registrar.test"
+#define REGISTRAR_PASSWORD "secret"
+
+static struct eXosip_t *registrar;
+static struct eXosip_t *client;
+static struct eXosip_t *intruder;
+static int registrar_port = 15094;
+
+static volatile int bindings_changed;
+static int failures;
+
+static void
+usage (void)
+{
+  printf ("Usage: " PROG_NAME " [options]\n"
+          "\n\t[options]\n" "\t-p --port\tnumber (first of the three local UDP ports, default 15094)\n" "\t-d --debug\t(enable eXosip traces)\n" "\t-h --help\n");
+}
+
+static void
+check (int ok, const char *what)
+{
+  if (!ok)
+    failures++;
+  printf ("%s: %s\n", ok ? "ok    " : "FAILED", what);
+}
+
+static int
+registrar_password (struct eXosip_t *excontext, const char *username, const char *realm, char *passwd, int size, void *arg)
+{
+  if (strcmp (username, "alice") != 0 && strcmp (username, "bob") != 0 && strcmp (username, "carol") != 0)
+    return -1;
+  snprintf (passwd, size, "%s", REGISTRAR_PASSWORD);
+  return 0;
+}
+
+static void
+registrar_binding (struct eXosip_t *excontext, const struct eXosip_registrar_binding *binding, void *arg)
+{
+  bindings_changed++;
+}
+
+static struct eXosip_t *
+registrar_context (int port)
+{
+  struct eXosip_t *excontext = eXosip_malloc ();
+
+  if (excontext == NULL)
+    return NULL;
+  if (eXosip_init (excontext) != OSIP_SUCCESS) {
+    osip_free (excontext);
+    return NULL;
+  }
+  if (eXosip_listen_addr (excontext, IPPROTO_UDP, "127.0.0.1", port, AF_INET, 0) != OSIP_SUCCESS) {
+    fprintf (stderr, PROG_NAME ": cannot listen on 127.0.0.1:%i\n", port);
+    eXosip_quit (excontext);
+    osip_free (excontext);
+    return NULL;
+  }
+  eXosip_set_user_agent (excontext, PROG_NAME "/" PROG_VER);
+  return excontext;
+}
+
+/* wait for the final answer of a registration: return its status code
+   (200 for EXOSIP_REGISTRATION_SUCCESS) or -1 after 10 seconds. With
+   retry_auth, a 401 is answered with the credentials of the context. */
+static int
+registration_wait (struct eXosip_t *excontext, int rid, int retry_auth, osip_message_t ** request)
+{
+  int i;
+
+  for (i = 0; i < 100; i++) {
+    eXosip_event_t *je = eXosip_event_wait (excontext, 0, 100);
+    int status;
+
+    if (je == NULL)
+      continue;
+    if (je->rid != rid || (je->type != EXOSIP_REGISTRATION_SUCCESS && je->type != EXOSIP_REGISTRATION_FAILURE)) {
+      eXosip_event_free (je);
+      continue;
+    }
+    status = je->response != NULL ? je->response->status_code : -1;
+    if (je->type == EXOSIP_REGISTRATION_FAILURE && retry_auth && (status == 401 || status == 407)) {
+      retry_auth = 0;
+      eXosip_lock (excontext);
+      eXosip_default_action (excontext, je);
+      eXosip_unlock (excontext);
+      eXosip_event_free (je);
+      continue;
+    }
+    if (request != NULL && je->request != NULL)
+      osip_message_clone (je->request, request);
+    eXosip_event_free (je);
+    return status;
+  }
+  return -1;
+}
+
+static int
+registration_start (struct eXosip_t *excontext, const char *user, int expires, osip_message_t ** reg)
+{
+  char from[64];
+  char proxy[64];
+  int rid;
+
+  snprintf (from, sizeof (from), "sip:%s@127.0.0.1", user);
+  snprintf (proxy, sizeof (proxy), "sip:127.0.0.1:%i", registrar_port);
+  eXosip_lock (excontext);
+  rid = eXosip_register_build_initial_register (excontext, from, proxy, NULL, expires, reg);
+  eXosip_unlock (excontext);
+  return rid;
+}
+
+static int
+registration_send (struct eXosip_t *excontext, int rid, osip_message_t * reg)
+{
+  int i;
+
+  eXosip_lock (excontext);
+  i = eXosip_register_send_register (excontext, rid, reg);
+  eXosip_unlock (excontext);
+  return i;
+}
+
+static int
+registration_refresh (struct eXosip_t *excontext, int rid, int expires)
+{
+  osip_message_t *reg = NULL;
+  int i;
+
+  eXosip_lock (excontext);
+  i = eXosip_register_build_register (excontext, rid, expires, &reg);
+  if (i == OSIP_SUCCESS)
+    i = eXosip_register_send_register (excontext, rid, reg);
+  eXosip_unlock (excontext);
+  return i;
+}
+
+/* send an authenticated REGISTER again, with the same nonce and nonce
+   count, from a new socket: return the status code of the answer */
+static int
+registration_replay (osip_message_t * request)
+{
+  osip_message_t *copy = NULL;
+  osip_via_t *via;
+  osip_generic_param_t *branch = NULL;
+  struct sockaddr_in addr;
+  struct timeval tv;
+  char *buf = NULL;
+  size_t length;
+  char answer[2048];
+  int status = -1;
+  int sock;
+  int n;
+
+  if (osip_message_clone (request, &copy) != OSIP_SUCCESS)
+    return -1;
+  via = (osip_via_t *) osip_list_get (&copy->vias, 0);
+  if (via != NULL)
+    osip_via_param_get_byname (via, "branch", &branch);
+  if (branch == NULL || copy->cseq == NULL) {
+    osip_message_free (copy);
+    return -1;
+  }
+  osip_free (branch->gvalue);
+  branch->gvalue = osip_strdup ("z9hG4bK" PROG_NAME "replay");
+  osip_free (copy->cseq->number);
+  copy->cseq->number = osip_strdup ("1000");
+  osip_message_force_update (copy);
+  n = osip_message_to_str (copy, &buf, &length);
+  osip_message_free (copy);
+  if (n != OSIP_SUCCESS)
+    return -1;
+
+  sock = socket (AF_INET, SOCK_DGRAM, 0);
+  if (sock < 0) {
+    osip_free (buf);
+    return -1;
+  }
+  tv.tv_sec = 5;
+  tv.tv_usec = 0;
+  setsockopt (sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof (tv));
+  memset (&addr, 0, sizeof (addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons ((unsigned short) registrar_port);
+  addr.sin_addr.s_addr = inet_addr ("127.0.0.1");
+  if (sendto (sock, buf, length, 0, (struct sockaddr *) &addr, sizeof (addr)) == (ssize_t) length) {
+    n = (int) recv (sock, answer, sizeof (answer) - 1, 0);
+    if (n > 12 && strncmp (answer, "SIP/2.0 ", 8) == 0)
+      status = atoi (answer + 8);
+  }
+  close (sock);
+  osip_free (buf);
+  return status;
+}
+
+static int
+binding_expires (const char *aor)
+{
+  struct eXosip_registrar_binding binding;
+
+  if (eXosip_registrar_lookup (registrar, aor, &binding) != OSIP_SUCCESS)
+    return -1;
+  return binding.expires;
+}
+
+int
+main (int argc, char *argv[])
+{
+  struct eXosip_registrar config;
+  struct eXosip_registrar_binding binding;
+  osip_message_t *reg = NULL;
+  osip_message_t *accepted = NULL;
+  osip_header_t *expires = NULL;
+  osip_contact_t *contact = NULL;
+  int debug = 0;
+  int changed;
+  int alice;
+  int rid;
+  int i;
+
+  for (;;) {
+    int c;
+    int option_index = 0;
+
+    static struct option long_options[] = {
+      {"port", required_argument, NULL, 'p'},
+      {"debug", no_argument, NULL, 'd'},
+      {"help", no_argument, NULL, 'h'},
+      {NULL, 0, NULL, 0}
+    };
+
+    c = getopt_long (argc, argv, "p:dh", long_options, &option_index);
+    if (c == -1)
+      break;
+
+    switch (c) {
+    case 'p':
+      registrar_port = atoi (optarg);
+      break;
+    case 'd':
+      debug = 1;
+      break;
+    case 'h':
+      usage ();
+      exit (0);
+    default:
+      usage ();
+      exit (1);
+    }
+  }
+
+  if (registrar_port <= 0) {
+    usage ();
+    exit (1);
+  }
+
+  if (debug)
+    TRACE_INITIALIZE (6, NULL);
+
+  registrar = registrar_context (registrar_port);
+  client = registrar_context (registrar_port + 2);
+  intruder = registrar_context (registrar_port + 4);
+  if (registrar == NULL || client == NULL || intruder == NULL)
+    exit (1);
+
+  memset (&config, 0, sizeof (config));
+  snprintf (config.realm, sizeof (config.realm), "%s", REGISTRAR_REALM);
+  config.min_expires = 60;
+  config.max_expires = 3600;
+  config.get_password = registrar_password;
+  config.binding_changed = registrar_binding;
+  check (eXosip_set_option (registrar, EXOSIP_OPT_SET_REGISTRAR, &config) == OSIP_SUCCESS, "registrar enabled");
+
+  /* register: challenge, then authenticated REGISTER */
+  alice = registration_start (client, "alice", 120, &reg);
+  check (alice > 0 && registration_send (client, alice, reg) == OSIP_SUCCESS, "REGISTER sent");
+  check (registration_wait (client, alice, 0, NULL) == 401, "REGISTER without credentials is challenged");
+  check (binding_expires ("sip:alice@127.0.0.1") == -1, "no binding before authentication");
+
+  eXosip_lock (client);
+  eXosip_add_authentication_info (client, "alice", "alice", REGISTRAR_PASSWORD, NULL, NULL);
+  eXosip_add_authentication_info (client, "carol", "carol", REGISTRAR_PASSWORD, NULL, NULL);
+  eXosip_unlock (client);
+  check (registration_refresh (client, alice, 120) == OSIP_SUCCESS, "REGISTER sent again");
+  check (registration_wait (client, alice, 1, NULL) == 200, "authenticated REGISTER is accepted");
+  check (eXosip_registrar_lookup (registrar, "sip:alice@127.0.0.1", &binding) == OSIP_SUCCESS, "binding added");
+  check (strcmp (binding.username, "alice") == 0 && binding.expires > 0 && binding.expires <= 120, "binding authenticated as alice for 120s");
+  check (bindings_changed > 0, "binding_changed called");
+
+  /* refresh */
+  check (registration_refresh (client, alice, 600) == OSIP_SUCCESS, "refresh sent");
+  check (registration_wait (client, alice, 1, &accepted) == 200, "refresh is accepted");
+  i = binding_expires ("sip:alice@127.0.0.1");
+  check (i > 120 && i <= 600, "binding refreshed for 600s");
+
+  /* the same nonce with the same nonce count */
+  check (accepted != NULL && registration_replay (accepted) == 401, "replayed nonce count is challenged again");
+  if (accepted != NULL)
+    osip_message_free (accepted);
+  check (binding_expires ("sip:alice@127.0.0.1") > 120, "binding kept after the replay");
+
+  /* bob's credentials for alice's address of record */
+  eXosip_lock (intruder);
+  eXosip_add_authentication_info (intruder, "bob", "bob", REGISTRAR_PASSWORD, NULL, NULL);
+  eXosip_unlock (intruder);
+  rid = registration_start (intruder, "alice", 120, &reg);
+  check (rid > 0 && registration_send (intruder, rid, reg) == OSIP_SUCCESS, "REGISTER of alice with bob's credentials sent");
+  check (registration_wait (intruder, rid, 1, NULL) == 403, "digest username other than the To user is refused");
+  check (eXosip_registrar_lookup (registrar, "sip:alice@127.0.0.1", &binding) == OSIP_SUCCESS
+         && strcmp (binding.contact, "") != 0 && binding.received_port == registrar_port + 2, "binding of alice unchanged");
+
+  /* Contact: * without Expires: 0 */
+  rid = registration_start (client, "carol", 120, &reg);
+  if (rid > 0) {
+    osip_list_special_free (&reg->contacts, (void (*)(void *)) &osip_contact_free);
+    osip_message_set_contact (reg, "*");
+  }
+  check (rid > 0 && registration_send (client, rid, reg) == OSIP_SUCCESS, "REGISTER with Contact: * and Expires: 120 sent");
+  check (registration_wait (client, rid, 1, NULL) == 400, "Contact: * without Expires: 0 is refused");
+
+  /* unregister */
+  changed = bindings_changed;
+  check (registration_refresh (client, alice, 0) == OSIP_SUCCESS, "unregister sent");
+  check (registration_wait (client, alice, 1, NULL) == 200, "unregister is accepted");
+  check (binding_expires ("sip:alice@127.0.0.1") == -1, "binding removed");
+  check (bindings_changed > changed, "binding_changed called on removal");
+
+  /* malformed expires, without authentication: eXosip rebuilds the
+     Expires header and the Contact when it answers a challenge */
+  config.get_password = NULL;
+  check (eXosip_set_option (registrar, EXOSIP_OPT_SET_REGISTRAR, &config) == OSIP_SUCCESS, "registrar authentication disabled");
+  rid = registration_start (client, "carol", 120, &reg);
+  if (rid > 0 && osip_message_get_expires (reg, 0, &expires) >= 0) {
+    osip_free (expires->hvalue);
+    expires->hvalue = osip_strdup ("soon");
+  }
+  check (rid > 0 && expires != NULL && registration_send (client, rid, reg) == OSIP_SUCCESS, "REGISTER with Expires: soon sent");
+  check (registration_wait (client, rid, 0, NULL) == 400, "malformed Expires header is refused");
+  rid = registration_start (client, "carol", 120, &reg);
+  if (rid > 0 && osip_message_get_contact (reg, 0, &contact) >= 0)
+    osip_contact_param_add (contact, osip_strdup ("expires"), osip_strdup ("1e3"));
+  check (rid > 0 && contact != NULL && registration_send (client, rid, reg) == OSIP_SUCCESS, "REGISTER with expires=1e3 sent");
+  check (registration_wait (client, rid, 0, NULL) == 400, "malformed expires parameter is refused");
+  check (binding_expires ("sip:carol@127.0.0.1") == -1, "no binding for carol");
+
+  eXosip_quit (intruder);
+  osip_free (intruder);
+  eXosip_quit (client);
+  osip_free (client);
+  eXosip_quit (registrar);
+  osip_free (registrar);
+
+  printf ("registrar: %s\n", failures == 0 ? "passed" : "FAILED");
+  return failures == 0 ? 0 : 1;
+}
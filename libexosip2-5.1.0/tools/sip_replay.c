@@ -0,0 +1,855 @@
+/*
+ * SIP capture replay tool
+ *
+ * This program is Free Software, released under the GNU General
+ * Public License v2.0 http://www.gnu.org/licenses/gpl
+ *
+ * This program memory-maps a pcap capture file, extracts the SIP
+ * datagrams (UDP) and stream segments (TCP) sent to a given port,
+ * and injects them into the eXosip stack through the same entry point
+ * used by the transport layers (_eXosip_handle_incoming_message).
+ *
+ * Messages are replayed with their original inter-arrival time, or
+ * faster with the --speed option (0 means "as fast as possible").
+ * Outgoing messages are captured by a stub transport layer: nothing
+ * is sent on the network.
+ *
+ * At the end, the processing latency of each message (parsing +
+ * transaction layer + eXosip processing) is reported per method.
+ *
+ * This tool uses eXosip internals and is only available on POSIX
+ * systems supporting mmap().
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include <getopt.h>
+
+#include <osip2/osip_mt.h>
+#include <eXosip2/eXosip.h>
+
+#include "src/eXosip2.h"
+
+#define PROG_NAME "sip_replay"
+#define PROG_VER  "1.0"
+
+#define PCAP_MAGIC_USEC     0xa1b2c3d4
+#define PCAP_MAGIC_NSEC     0xa1b23c4d
+#define PCAP_MAGIC_USEC_SW  0xd4c3b2a1
+#define PCAP_MAGIC_NSEC_SW  0x4d3cb2a1
+
+#define LINKTYPE_NULL       0
+#define LINKTYPE_ETHERNET   1
+#define LINKTYPE_RAW        101
+#define LINKTYPE_LINUX_SLL  113
+#define LINKTYPE_LINUX_SLL2 276
+
+#ifndef REPLAY_MAX_STREAMS
+#define REPLAY_MAX_STREAMS 256
+#endif
+
+#ifndef REPLAY_STREAM_BUFFER
+#define REPLAY_STREAM_BUFFER (SIP_MESSAGE_MAX_LENGTH * 2)
+#endif
+
+#define REPLAY_MAX_METHODS 32
+
+struct replay_stream {
+  char remote_ip[64];
+  int remote_port;
+  unsigned int next_seq;
+  int seq_known;
+  size_t buflen;
+  char *buf;
+};
+
+struct replay_stat {
+  char name[32];
+  unsigned int count;
+  unsigned int alloc;
+  double *latencies;            /* in micro-seconds */
+};
+
+struct replay_ctx {
+  const unsigned char *map;
+  size_t map_len;
+  int swapped;
+  int nsec;
+  unsigned int linktype;
+
+  int port;
+  double speed;
+  int auto_answer;
+  int verbose;
+  FILE *output;
+
+  struct eXosip_t *excontext;
+  char *scratch;
+
+  double first_ts;
+  double wall_start;
+  double max_lag;
+
+  unsigned int packets;
+  unsigned int injected;
+  unsigned int skipped;
+  unsigned int failed;
+  unsigned int sent;
+  size_t sent_bytes;
+
+  struct replay_stream streams[REPLAY_MAX_STREAMS];
+  struct replay_stat stats[REPLAY_MAX_METHODS];
+  int nstats;
+};
+
+static struct replay_ctx *replay;
+
+static void
+usage (void)
+{
+  printf ("Usage: " PROG_NAME " [options] capture.pcap\n"
+          "\n\t[options]\n"
+          "\t-p --port\tnumber (SIP port of the replayed endpoint, default 5060, 0 for any)\n"
+          "\t-s --speed\tfactor (1 = original timing (default), 10 = ten times faster, 0 = no delay)\n"
+          "\t-o --output\tfile (write messages captured by the stub transport)\n"
+          "\t-a --answer\t(answer 200 OK to incoming out-of-dialog and in-dialog requests)\n" "\t-v --verbose\t(print latency of each message)\n" "\t-d --debug\t(enable eXosip traces)\n" "\t-h --help\n");
+}
+
+static double
+replay_now (void)
+{
+  struct timespec ts;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return (double) ts.tv_sec + (double) ts.tv_nsec / 1000000000.0;
+}
+
+static unsigned int
+replay_u32 (const struct replay_ctx *ctx, const unsigned char *p)
+{
+  unsigned int v;
+
+  memcpy (&v, p, 4);
+  if (ctx->swapped)
+    v = ((v & 0xff) << 24) | ((v & 0xff00) << 8) | ((v >> 8) & 0xff00) | (v >> 24);
+  return v;
+}
+
+static unsigned int
+replay_be16 (const unsigned char *p)
+{
+  return ((unsigned int) p[0] << 8) | p[1];
+}
+
+static unsigned int
+replay_be32 (const unsigned char *p)
+{
+  return ((unsigned int) p[0] << 24) | ((unsigned int) p[1] << 16) | ((unsigned int) p[2] << 8) | p[3];
+}
+
+/* stub transport layer: nothing goes on the wire. */
+
+static int
+stub_tl_init (struct eXosip_t *excontext)
+{
+  return OSIP_SUCCESS;
+}
+
+static int
+stub_tl_free (struct eXosip_t *excontext)
+{
+  return OSIP_SUCCESS;
+}
+
+static int
+stub_tl_open (struct eXosip_t *excontext)
+{
+  return OSIP_SUCCESS;
+}
+
+static int
+stub_tl_set_fdset (struct eXosip_t *excontext, fd_set * osip_fdset, fd_set * osip_wrset, int *fd_max)
+{
+  return OSIP_SUCCESS;
+}
+
+static int
+stub_tl_read_message (struct eXosip_t *excontext, fd_set * osip_fdset, fd_set * osip_wrset)
+{
+  return OSIP_SUCCESS;
+}
+
+static int
+stub_tl_send_message (struct eXosip_t *excontext, osip_transaction_t * tr, osip_message_t * sip, char *host, int port, int out_socket)
+{
+  char *message = NULL;
+  size_t length = 0;
+  int i;
+
+  /* serialize as the real transports do, so that the cost is accounted */
+  i = osip_message_to_str (sip, &message, &length);
+  if (i != 0 || message == NULL)
+    return -1;
+
+  if (tr != NULL && host != NULL) {
+    if (tr->ict_context != NULL)
+      osip_ict_set_destination (tr->ict_context, osip_strdup (host), port);
+    if (tr->nict_context != NULL)
+      osip_nict_set_destination (tr->nict_context, osip_strdup (host), port);
+  }
+
+  replay->sent++;
+  replay->sent_bytes += length;
+  if (replay->output != NULL) {
+    fwrite (message, 1, length, replay->output);
+    fwrite ("\r\n", 1, 2, replay->output);
+  }
+  osip_free (message);
+  return OSIP_SUCCESS;
+}
+
+static int
+stub_tl_get_masquerade_contact (struct eXosip_t *excontext, char *ip, int ip_size, char *port, int port_size)
+{
+  memset (ip, 0, ip_size);
+  memset (port, 0, port_size);
+  return OSIP_SUCCESS;
+}
+
+static struct eXtl_protocol eXtl_stub = {
+  1,
+  5060,
+  "UDP",
+  "0.0.0.0",
+  IPPROTO_UDP,
+  AF_INET,
+  0,
+  0,
+  0,
+
+  &stub_tl_init,
+  &stub_tl_free,
+  &stub_tl_open,
+  &stub_tl_set_fdset,
+  &stub_tl_read_message,
+  &stub_tl_send_message,
+  NULL,
+  NULL,
+  NULL,
+  &stub_tl_get_masquerade_contact,
+  NULL,
+  NULL,
+  NULL
+};
+
+/* statistics */
+
+static struct replay_stat *
+replay_stat_get (struct replay_ctx *ctx, const char *name)
+{
+  int i;
+
+  for (i = 0; i < ctx->nstats; i++) {
+    if (strcmp (ctx->stats[i].name, name) == 0)
+      return &ctx->stats[i];
+  }
+  if (ctx->nstats == REPLAY_MAX_METHODS)
+    return &ctx->stats[REPLAY_MAX_METHODS - 1];
+  snprintf (ctx->stats[ctx->nstats].name, sizeof (ctx->stats[ctx->nstats].name), "%s", name);
+  ctx->nstats++;
+  return &ctx->stats[ctx->nstats - 1];
+}
+
+static void
+replay_stat_add (struct replay_ctx *ctx, const char *name, double latency)
+{
+  struct replay_stat *stat = replay_stat_get (ctx, name);
+
+  if (stat->count == stat->alloc) {
+    unsigned int alloc = stat->alloc == 0 ? 1024 : stat->alloc * 2;
+    double *tmp = (double *) realloc (stat->latencies, alloc * sizeof (double));
+
+    if (tmp == NULL)
+      return;
+    stat->latencies = tmp;
+    stat->alloc = alloc;
+  }
+  stat->latencies[stat->count] = latency;
+  stat->count++;
+}
+
+static int
+replay_cmp_double (const void *a, const void *b)
+{
+  double da = *(const double *) a;
+  double db = *(const double *) b;
+
+  return (da > db) - (da < db);
+}
+
+static void
+replay_stat_report (struct replay_ctx *ctx)
+{
+  int i;
+
+  printf ("\n%-16s %8s %10s %10s %10s %10s %10s %10s\n", "message", "count", "min(us)", "avg(us)", "p50(us)", "p90(us)", "p99(us)", "max(us)");
+  for (i = 0; i < ctx->nstats; i++) {
+    struct replay_stat *stat = &ctx->stats[i];
+    double total = 0;
+    unsigned int k;
+
+    if (stat->count == 0)
+      continue;
+    qsort (stat->latencies, stat->count, sizeof (double), replay_cmp_double);
+    for (k = 0; k < stat->count; k++)
+      total += stat->latencies[k];
+    printf ("%-16s %8u %10.1f %10.1f %10.1f %10.1f %10.1f %10.1f\n", stat->name, stat->count,
+            stat->latencies[0], total / stat->count, stat->latencies[stat->count / 2], stat->latencies[(stat->count * 90) / 100], stat->latencies[(stat->count * 99) / 100], stat->latencies[stat->count - 1]);
+  }
+  printf ("\npackets: %u, injected: %u, rejected by parser: %u, skipped: %u\n", ctx->packets, ctx->injected, ctx->failed, ctx->skipped);
+  printf ("sent by stack: %u messages (%lu bytes)\n", ctx->sent, (unsigned long) ctx->sent_bytes);
+  if (ctx->speed > 0)
+    printf ("max scheduling lag: %.1f ms\n", ctx->max_lag * 1000.0);
+}
+
+/* injection */
+
+static void
+replay_drain_events (struct replay_ctx *ctx)
+{
+  eXosip_event_t *je;
+
+  while ((je = eXosip_event_wait (ctx->excontext, 0, 0)) != NULL) {
+    if (ctx->auto_answer) {
+      eXosip_lock (ctx->excontext);
+      if (je->type == EXOSIP_MESSAGE_NEW)
+        eXosip_message_send_answer (ctx->excontext, je->tid, 200, NULL);
+      else if (je->type == EXOSIP_CALL_MESSAGE_NEW)
+        eXosip_call_send_answer (ctx->excontext, je->tid, 200, NULL);
+      eXosip_unlock (ctx->excontext);
+    }
+    eXosip_event_free (je);
+  }
+}
+
+static void
+replay_inject (struct replay_ctx *ctx, double ts, const char *ip, int port, const unsigned char *payload, size_t len)
+{
+  char name[32];
+  double start;
+  double latency;
+  int i;
+
+  if (len > SIP_MESSAGE_MAX_LENGTH * 4) {
+    ctx->skipped++;
+    return;
+  }
+
+  if (ctx->speed > 0) {
+    double target = ctx->wall_start + (ts - ctx->first_ts) / ctx->speed;
+    double now = replay_now ();
+
+    if (target > now)
+      osip_usleep ((int) ((target - now) * 1000000.0));
+    else if (now - target > ctx->max_lag)
+      ctx->max_lag = now - target;
+  }
+
+  /* transport layers provide a writable, nul terminated buffer */
+  memcpy (ctx->scratch, payload, len);
+  ctx->scratch[len] = '\0';
+
+  if (len > 8 && strncmp (ctx->scratch, "SIP/2.0 ", 8) == 0)
+    snprintf (name, sizeof (name), "%.3s", ctx->scratch + 8);
+  else {
+    size_t k;
+
+    for (k = 0; k < len && k < sizeof (name) - 1 && ctx->scratch[k] != ' '; k++)
+      name[k] = ctx->scratch[k];
+    name[k] = '\0';
+  }
+
+  start = replay_now ();
+  i = _eXosip_handle_incoming_message (ctx->excontext, ctx->scratch, len, -1, (char *) ip, port, NULL, NULL);
+  eXosip_execute (ctx->excontext);
+  latency = (replay_now () - start) * 1000000.0;
+
+  if (i != OSIP_SUCCESS) {
+    ctx->failed++;
+    snprintf (name, sizeof (name), "%s", "(bad)");
+  }
+  ctx->injected++;
+  replay_stat_add (ctx, name, latency);
+  if (ctx->verbose)
+    printf ("%.6f %s:%i %-10s %.1fus\n", ts - ctx->first_ts, ip, port, name, latency);
+
+  replay_drain_events (ctx);
+}
+
+static struct replay_stream *
+replay_stream_get (struct replay_ctx *ctx, const char *ip, int port)
+{
+  struct replay_stream *free_stream = NULL;
+  int pos;
+
+  for (pos = 0; pos < REPLAY_MAX_STREAMS; pos++) {
+    struct replay_stream *stream = &ctx->streams[pos];
+
+    if (stream->buf == NULL) {
+      if (free_stream == NULL)
+        free_stream = stream;
+      continue;
+    }
+    if (stream->remote_port == port && strcmp (stream->remote_ip, ip) == 0)
+      return stream;
+  }
+  if (free_stream == NULL)
+    return NULL;
+  free_stream->buf = (char *) malloc (REPLAY_STREAM_BUFFER);
+  if (free_stream->buf == NULL)
+    return NULL;
+  snprintf (free_stream->remote_ip, sizeof (free_stream->remote_ip), "%s", ip);
+  free_stream->remote_port = port;
+  free_stream->buflen = 0;
+  free_stream->seq_known = 0;
+  return free_stream;
+}
+
+/* value of a Content-Length header starting at p: the buffer is not
+   terminated, so nothing is read at or after end */
+static long
+replay_content_length (const char *p, const char *end)
+{
+  long clen = 0;
+
+  while (p < end && *p != ':' && *p != '\n')
+    p++;
+  if (p >= end || *p != ':')
+    return 0;
+  p++;
+  while (p < end && (*p == ' ' || *p == '\t'))
+    p++;
+  while (p < end && *p >= '0' && *p <= '9' && clen < 100000000) {
+    clen = clen * 10 + (*p - '0');
+    p++;
+  }
+  return clen;
+}
+
+/* return the length of the first complete SIP message in buf, 0 if incomplete */
+static size_t
+replay_stream_message_length (const char *buf, size_t len)
+{
+  const char *end_of_headers = NULL;
+  const char *p;
+  size_t hlen;
+  long clen = 0;
+
+  for (p = buf; p + 3 < buf + len; p++) {
+    if (p[0] == '\r' && p[1] == '\n' && p[2] == '\r' && p[3] == '\n') {
+      end_of_headers = p + 4;
+      break;
+    }
+  }
+  if (end_of_headers == NULL)
+    return 0;
+  hlen = end_of_headers - buf;
+
+  for (p = buf; p < end_of_headers; p++) {
+    if (p != buf && p[-1] != '\n')
+      continue;
+    if (end_of_headers - p > 14 && osip_strncasecmp (p, "content-length", 14) == 0 && (p[14] == ':' || p[14] == ' ' || p[14] == '\t')) {
+      clen = replay_content_length (p + 14, end_of_headers);
+      break;
+    }
+    if ((p[0] == 'l' || p[0] == 'L') && (p[1] == ':' || p[1] == ' ' || p[1] == '\t')) {
+      clen = replay_content_length (p + 1, end_of_headers);
+      break;
+    }
+  }
+  if (clen < 0)
+    clen = 0;
+  if (hlen + (size_t) clen > len)
+    return 0;
+  return hlen + clen;
+}
+
+static void
+replay_stream_segment (struct replay_ctx *ctx, double ts, const char *ip, int port, unsigned int seq, const unsigned char *payload, size_t len)
+{
+  struct replay_stream *stream = replay_stream_get (ctx, ip, port);
+
+  if (stream == NULL) {
+    ctx->skipped++;
+    return;
+  }
+
+  /* drop retransmitted data */
+  if (stream->seq_known) {
+    unsigned int offset = stream->next_seq - seq;
+
+    if ((int) offset > 0) {
+      if (offset >= len)
+        return;
+      payload += offset;
+      len -= offset;
+      seq += offset;
+    }
+  }
+  stream->seq_known = 1;
+  stream->next_seq = seq + (unsigned int) len;
+
+  if (stream->buflen + len > REPLAY_STREAM_BUFFER) {
+    /* garbage: resynchronize */
+    stream->buflen = 0;
+    ctx->skipped++;
+    if (len > REPLAY_STREAM_BUFFER)
+      return;
+  }
+  memcpy (stream->buf + stream->buflen, payload, len);
+  stream->buflen += len;
+
+  for (;;) {
+    size_t start = 0;
+    size_t msglen;
+
+    /* skip keep-alive CRLF */
+    while (start < stream->buflen && (stream->buf[start] == '\r' || stream->buf[start] == '\n'))
+      start++;
+    if (start > 0) {
+      memmove (stream->buf, stream->buf + start, stream->buflen - start);
+      stream->buflen -= start;
+    }
+    msglen = replay_stream_message_length (stream->buf, stream->buflen);
+    if (msglen == 0)
+      break;
+    replay_inject (ctx, ts, ip, port, (const unsigned char *) stream->buf, msglen);
+    memmove (stream->buf, stream->buf + msglen, stream->buflen - msglen);
+    stream->buflen -= msglen;
+  }
+}
+
+static void
+replay_packet (struct replay_ctx *ctx, double ts, const unsigned char *pkt, size_t caplen)
+{
+  const unsigned char *ip_hdr;
+  const unsigned char *l4;
+  unsigned int ethertype = 0;
+  unsigned int proto;
+  size_t l4len;
+  size_t off = 0;
+  char src_ip[64];
+  int src_port;
+  int dst_port;
+
+  switch (ctx->linktype) {
+  case LINKTYPE_ETHERNET:
+    if (caplen < 14)
+      return;
+    ethertype = replay_be16 (pkt + 12);
+    off = 14;
+    while ((ethertype == 0x8100 || ethertype == 0x88a8) && caplen >= off + 4) {
+      ethertype = replay_be16 (pkt + off + 2);
+      off += 4;
+    }
+    break;
+  case LINKTYPE_LINUX_SLL:
+    if (caplen < 16)
+      return;
+    ethertype = replay_be16 (pkt + 14);
+    off = 16;
+    break;
+  case LINKTYPE_LINUX_SLL2:
+    if (caplen < 20)
+      return;
+    ethertype = replay_be16 (pkt);
+    off = 20;
+    break;
+  case LINKTYPE_NULL:
+    if (caplen < 4)
+      return;
+    off = 4;
+    ethertype = ((pkt[4] >> 4) == 6) ? 0x86dd : 0x0800;
+    break;
+  case LINKTYPE_RAW:
+  default:
+    if (caplen < 1)
+      return;
+    ethertype = ((pkt[0] >> 4) == 6) ? 0x86dd : 0x0800;
+    break;
+  }
+
+  if (caplen <= off)
+    return;
+  ip_hdr = pkt + off;
+  caplen -= off;
+
+  if (ethertype == 0x0800) {
+    size_t ihl;
+    size_t total;
+
+    if (caplen < 20 || (ip_hdr[0] >> 4) != 4)
+      return;
+    ihl = (ip_hdr[0] & 0x0f) * 4;
+    total = replay_be16 (ip_hdr + 2);
+    if (ihl < 20 || total < ihl || caplen < total)
+      return;
+    if ((replay_be16 (ip_hdr + 6) & 0x3fff) != 0) {
+      ctx->skipped++;           /* fragments are not reassembled */
+      return;
+    }
+    proto = ip_hdr[9];
+    inet_ntop (AF_INET, ip_hdr + 12, src_ip, sizeof (src_ip));
+    l4 = ip_hdr + ihl;
+    l4len = total - ihl;
+  }
+  else if (ethertype == 0x86dd) {
+    size_t plen;
+
+    if (caplen < 40 || (ip_hdr[0] >> 4) != 6)
+      return;
+    plen = replay_be16 (ip_hdr + 4);
+    if (caplen < 40 + plen)
+      return;
+    proto = ip_hdr[6];
+    inet_ntop (AF_INET6, ip_hdr + 8, src_ip, sizeof (src_ip));
+    l4 = ip_hdr + 40;
+    l4len = plen;
+  }
+  else
+    return;
+
+  if (proto == IPPROTO_UDP) {
+    size_t ulen;
+
+    if (l4len < 8)
+      return;
+    src_port = replay_be16 (l4);
+    dst_port = replay_be16 (l4 + 2);
+    ulen = replay_be16 (l4 + 4);
+    if (ulen < 8 || ulen > l4len)
+      return;
+    if (ctx->port > 0 && dst_port != ctx->port)
+      return;
+    ctx->packets++;
+    if (ulen - 8 <= 32) {
+      ctx->skipped++;           /* keep alive: ignored by transport layer */
+      return;
+    }
+    replay_inject (ctx, ts, src_ip, src_port, l4 + 8, ulen - 8);
+  }
+  else if (proto == IPPROTO_TCP) {
+    size_t doff;
+
+    if (l4len < 20)
+      return;
+    src_port = replay_be16 (l4);
+    dst_port = replay_be16 (l4 + 2);
+    doff = (l4[12] >> 4) * 4;
+    if (doff < 20 || doff > l4len)
+      return;
+    if (ctx->port > 0 && dst_port != ctx->port)
+      return;
+    ctx->packets++;
+    if (l4len == doff)
+      return;
+    replay_stream_segment (ctx, ts, src_ip, src_port, replay_be32 (l4 + 4), l4 + doff, l4len - doff);
+  }
+}
+
+static int
+replay_run (struct replay_ctx *ctx)
+{
+  const unsigned char *p;
+  const unsigned char *end;
+  unsigned int magic;
+
+  if (ctx->map_len < 24) {
+    fprintf (stderr, PROG_NAME ": file too short\n");
+    return -1;
+  }
+  memcpy (&magic, ctx->map, 4);
+  if (magic == PCAP_MAGIC_USEC || magic == PCAP_MAGIC_NSEC)
+    ctx->swapped = 0;
+  else if (magic == PCAP_MAGIC_USEC_SW || magic == PCAP_MAGIC_NSEC_SW)
+    ctx->swapped = 1;
+  else {
+    fprintf (stderr, PROG_NAME ": not a pcap file (pcapng is not supported)\n");
+    return -1;
+  }
+  ctx->nsec = (magic == PCAP_MAGIC_NSEC || magic == PCAP_MAGIC_NSEC_SW);
+  ctx->linktype = replay_u32 (ctx, ctx->map + 20) & 0x0fffffff;
+
+  p = ctx->map + 24;
+  end = ctx->map + ctx->map_len;
+  ctx->first_ts = -1;
+
+  while (p + 16 <= end) {
+    unsigned int sec = replay_u32 (ctx, p);
+    unsigned int frac = replay_u32 (ctx, p + 4);
+    unsigned int caplen = replay_u32 (ctx, p + 8);
+    double ts;
+
+    p += 16;
+    if (caplen > (size_t) (end - p))
+      break;
+    ts = (double) sec + (double) frac / (ctx->nsec ? 1000000000.0 : 1000000.0);
+    if (ctx->first_ts < 0) {
+      ctx->first_ts = ts;
+      ctx->wall_start = replay_now ();
+    }
+    replay_packet (ctx, ts, p, caplen);
+    p += caplen;
+  }
+
+  /* let pending transactions progress once more */
+  eXosip_execute (ctx->excontext);
+  replay_drain_events (ctx);
+  return 0;
+}
+
+int
+main (int argc, char *argv[])
+{
+  struct replay_ctx *ctx;
+  const char *output = NULL;
+  struct stat st;
+  long int read_timeout = 1;
+  int debug = 0;
+  int fd;
+  int c;
+  int i;
+
+  ctx = (struct replay_ctx *) calloc (1, sizeof (struct replay_ctx));
+  if (ctx == NULL)
+    return 1;
+  replay = ctx;
+  ctx->port = 5060;
+  ctx->speed = 1;
+
+  for (;;) {
+#define short_options "p:s:o:avdh"
+    int option_index = 0;
+
+    static struct option long_options[] = {
+      {"port", required_argument, NULL, 'p'},
+      {"speed", required_argument, NULL, 's'},
+      {"output", required_argument, NULL, 'o'},
+      {"answer", no_argument, NULL, 'a'},
+      {"verbose", no_argument, NULL, 'v'},
+      {"debug", no_argument, NULL, 'd'},
+      {"help", no_argument, NULL, 'h'},
+      {NULL, 0, NULL, 0}
+    };
+
+    c = getopt_long (argc, argv, short_options, long_options, &option_index);
+    if (c == -1)
+      break;
+
+    switch (c) {
+    case 'p':
+      ctx->port = atoi (optarg);
+      break;
+    case 's':
+      ctx->speed = atof (optarg);
+      break;
+    case 'o':
+      output = optarg;
+      break;
+    case 'a':
+      ctx->auto_answer = 1;
+      break;
+    case 'v':
+      ctx->verbose = 1;
+      break;
+    case 'd':
+      debug = 1;
+      break;
+    case 'h':
+      usage ();
+      exit (0);
+    default:
+      usage ();
+      exit (1);
+    }
+  }
+
+  if (optind >= argc) {
+    usage ();
+    exit (1);
+  }
+
+  fd = open (argv[optind], O_RDONLY);
+  if (fd < 0 || fstat (fd, &st) != 0) {
+    fprintf (stderr, PROG_NAME ": cannot open %s\n", argv[optind]);
+    exit (1);
+  }
+  ctx->map_len = (size_t) st.st_size;
+  ctx->map = (const unsigned char *) mmap (NULL, ctx->map_len, PROT_READ, MAP_PRIVATE, fd, 0);
+  close (fd);
+  if (ctx->map == MAP_FAILED) {
+    fprintf (stderr, PROG_NAME ": cannot map %s\n", argv[optind]);
+    exit (1);
+  }
+  madvise ((void *) ctx->map, ctx->map_len, MADV_SEQUENTIAL);
+
+  if (output != NULL) {
+    ctx->output = fopen (output, "wb");
+    if (ctx->output == NULL) {
+      fprintf (stderr, PROG_NAME ": cannot open %s\n", output);
+      exit (1);
+    }
+  }
+
+  ctx->scratch = (char *) malloc (SIP_MESSAGE_MAX_LENGTH * 4 + 1);
+  if (ctx->scratch == NULL)
+    exit (1);
+
+  if (debug > 0)
+    TRACE_INITIALIZE (6, NULL);
+
+  ctx->excontext = eXosip_malloc ();
+  if (ctx->excontext == NULL || eXosip_init (ctx->excontext)) {
+    fprintf (stderr, PROG_NAME ": eXosip_init failed\n");
+    exit (1);
+  }
+
+  /* install the stub transport instead of eXosip_listen_addr(): no thread is started */
+  memcpy (&ctx->excontext->eXtl_transport, &eXtl_stub, sizeof (struct eXtl_protocol));
+  ctx->excontext->eXtl_transport.proto_port = ctx->port > 0 ? ctx->port : 5060;
+  ctx->excontext->eXtl_transport.proto_local_port = ctx->excontext->eXtl_transport.proto_port;
+  snprintf (ctx->excontext->transport, sizeof (ctx->excontext->transport), "%s", "UDP");
+  eXosip_set_option (ctx->excontext, EXOSIP_OPT_SET_MAX_READ_TIMEOUT, &read_timeout);
+  eXosip_set_user_agent (ctx->excontext, PROG_NAME "/" PROG_VER);
+
+  i = replay_run (ctx);
+  if (i == 0)
+    replay_stat_report (ctx);
+
+  eXosip_quit (ctx->excontext);
+  osip_free (ctx->excontext);
+
+  for (c = 0; c < REPLAY_MAX_STREAMS; c++)
+    free (ctx->streams[c].buf);
+  for (c = 0; c < ctx->nstats; c++)
+    free (ctx->stats[c].latencies);
+  free (ctx->scratch);
+  if (ctx->output != NULL)
+    fclose (ctx->output);
+  munmap ((void *) ctx->map, ctx->map_len);
+  free (ctx);
+  return i == 0 ? 0 : 1;
+}
@@ -0,0 +1,292 @@
+/*
+ * SIP lock stress tool
+ *
+ * This program is Free Software, released under the GNU General
+ * Public License v2.0 http://www.gnu.org/licenses/gpl
+ *
+ * This program runs two eXosip contexts on the loopback interface.
+ * Several application threads send MESSAGE requests from the first
+ * context to the second one while the eXosip threads of both contexts
+ * process the transactions. Incoming requests are answered from the
+ * event threads (eXosip_event_wait, or event workers with --workers).
+ *
+ * At the end, the number of requests sent and answered is reported with
+ * the time the application threads waited for eXosip_lock: it shows how
+ * long API calls stall behind the eXosip threads.
+ *
+ * The exit status is 0 when every request was answered with a 200 OK.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+#include <getopt.h>
+
+#include <osip2/osip_mt.h>
+#include <eXosip2/eXosip.h>
+
+#define PROG_NAME "sip_stress"
+#define PROG_VER  "1.0"
+
+#define STRESS_MAX_THREADS 64
+
+struct stress_sender {
+  pthread_t thread;
+  int count;
+  int sent;
+  double lock_wait_total;       /* in micro-seconds */
+  double lock_wait_max;
+};
+
+static struct eXosip_t *client;
+static struct eXosip_t *server;
+static int client_port = 15090;
+static int server_port = 15092;
+static volatile int stop_events;
+
+static volatile int received;
+static volatile int answered;
+static volatile int failed;
+
+static void
+usage (void)
+{
+  printf ("Usage: " PROG_NAME " [options]\n"
+          "\n\t[options]\n"
+          "\t-t --threads\tnumber (application threads sending requests, default 8)\n"
+          "\t-n --requests\tnumber (requests sent by each thread, default 250)\n"
+          "\t-w --workers\tnumber (event workers of each context, default 0: eXosip_event_wait)\n"
+          "\t-p --port\tnumber (first of the two local UDP ports, default 15090)\n" "\t-d --debug\t(enable eXosip traces)\n" "\t-h --help\n");
+}
+
+static double
+stress_now (void)
+{
+  struct timespec ts;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return (double) ts.tv_sec * 1000000.0 + (double) ts.tv_nsec / 1000.0;
+}
+
+static void
+stress_event (struct eXosip_t *excontext, eXosip_event_t * je)
+{
+  osip_message_t *answer = NULL;
+
+  switch (je->type) {
+  case EXOSIP_MESSAGE_NEW:
+    __sync_add_and_fetch (&received, 1);
+    eXosip_lock (excontext);
+    if (eXosip_message_build_answer (excontext, je->tid, 200, &answer) == OSIP_SUCCESS)
+      eXosip_message_send_answer (excontext, je->tid, 200, answer);
+    eXosip_unlock (excontext);
+    break;
+  case EXOSIP_MESSAGE_ANSWERED:
+    __sync_add_and_fetch (&answered, 1);
+    break;
+  case EXOSIP_MESSAGE_REQUESTFAILURE:
+    __sync_add_and_fetch (&failed, 1);
+    break;
+  default:
+    break;
+  }
+}
+
+static void
+stress_event_cb (struct eXosip_t *excontext, eXosip_event_t * je, void *arg)
+{
+  stress_event (excontext, je);
+}
+
+static void *
+stress_event_thread (void *arg)
+{
+  struct eXosip_t *excontext = (struct eXosip_t *) arg;
+  eXosip_event_t *je;
+
+  while (!stop_events) {
+    je = eXosip_event_wait (excontext, 0, 50);
+    if (je == NULL)
+      continue;
+    stress_event (excontext, je);
+    eXosip_event_free (je);
+  }
+  return NULL;
+}
+
+static void *
+stress_sender_thread (void *arg)
+{
+  struct stress_sender *sender = (struct stress_sender *) arg;
+  char to[64];
+  char from[64];
+  int k;
+
+  snprintf (to, sizeof (to), "sip:b@127.0.0.1:%i", server_port);
+  snprintf (from, sizeof (from), "sip:a@127.0.0.1:%i", client_port);
+
+  for (k = 0; k < sender->count; k++) {
+    osip_message_t *request = NULL;
+    double start = stress_now ();
+    double wait;
+
+    eXosip_lock (client);
+    wait = stress_now () - start;
+    sender->lock_wait_total += wait;
+    if (wait > sender->lock_wait_max)
+      sender->lock_wait_max = wait;
+    if (eXosip_message_build_request (client, &request, "MESSAGE", to, from, NULL) == OSIP_SUCCESS && eXosip_message_send_request (client, request) > 0)
+      sender->sent++;
+    eXosip_unlock (client);
+
+    if (k % 50 == 49)
+      usleep (20000);           /* stay below the default rate limits */
+  }
+  return NULL;
+}
+
+static struct eXosip_t *
+stress_context (int port, int workers)
+{
+  struct eXosip_t *excontext = eXosip_malloc ();
+
+  if (excontext == NULL)
+    return NULL;
+  if (eXosip_init (excontext) != OSIP_SUCCESS) {
+    osip_free (excontext);
+    return NULL;
+  }
+  if (eXosip_listen_addr (excontext, IPPROTO_UDP, "127.0.0.1", port, AF_INET, 0) != OSIP_SUCCESS) {
+    fprintf (stderr, PROG_NAME ": cannot listen on 127.0.0.1:%i\n", port);
+    eXosip_quit (excontext);
+    osip_free (excontext);
+    return NULL;
+  }
+  eXosip_set_user_agent (excontext, PROG_NAME "/" PROG_VER);
+  if (workers > 0) {
+    eXosip_set_option (excontext, EXOSIP_OPT_SET_EVENT_WORKERS, &workers);
+    eXosip_set_event_callback (excontext, -1, stress_event_cb, NULL);
+  }
+  return excontext;
+}
+
+int
+main (int argc, char *argv[])
+{
+  struct stress_sender senders[STRESS_MAX_THREADS];
+  pthread_t event_threads[2];
+  int threads = 8;
+  int requests = 250;
+  int workers = 0;
+  int debug = 0;
+  int sent = 0;
+  double lock_wait_total = 0;
+  double lock_wait_max = 0;
+  double start, elapsed;
+  int i;
+
+  for (;;) {
+    int c;
+    int option_index = 0;
+
+    static struct option long_options[] = {
+      {"threads", required_argument, NULL, 't'},
+      {"requests", required_argument, NULL, 'n'},
+      {"workers", required_argument, NULL, 'w'},
+      {"port", required_argument, NULL, 'p'},
+      {"debug", no_argument, NULL, 'd'},
+      {"help", no_argument, NULL, 'h'},
+      {NULL, 0, NULL, 0}
+    };
+
+    c = getopt_long (argc, argv, "t:n:w:p:dh", long_options, &option_index);
+    if (c == -1)
+      break;
+
+    switch (c) {
+    case 't':
+      threads = atoi (optarg);
+      break;
+    case 'n':
+      requests = atoi (optarg);
+      break;
+    case 'w':
+      workers = atoi (optarg);
+      break;
+    case 'p':
+      client_port = atoi (optarg);
+      server_port = client_port + 2;
+      break;
+    case 'd':
+      debug = 1;
+      break;
+    case 'h':
+      usage ();
+      exit (0);
+    default:
+      usage ();
+      exit (1);
+    }
+  }
+
+  if (threads <= 0 || threads > STRESS_MAX_THREADS || requests <= 0 || workers < 0 || client_port <= 0) {
+    usage ();
+    exit (1);
+  }
+
+  if (debug)
+    TRACE_INITIALIZE (6, NULL);
+
+  client = stress_context (client_port, workers);
+  server = stress_context (server_port, workers);
+  if (client == NULL || server == NULL)
+    exit (1);
+
+  if (workers == 0) {
+    pthread_create (&event_threads[0], NULL, stress_event_thread, client);
+    pthread_create (&event_threads[1], NULL, stress_event_thread, server);
+  }
+
+  start = stress_now ();
+  memset (senders, 0, sizeof (senders));
+  for (i = 0; i < threads; i++) {
+    senders[i].count = requests;
+    pthread_create (&senders[i].thread, NULL, stress_sender_thread, &senders[i]);
+  }
+  for (i = 0; i < threads; i++) {
+    pthread_join (senders[i].thread, NULL);
+    sent += senders[i].sent;
+    lock_wait_total += senders[i].lock_wait_total;
+    if (senders[i].lock_wait_max > lock_wait_max)
+      lock_wait_max = senders[i].lock_wait_max;
+  }
+
+  /* timer F (32s) bounds the wait of a lost request */
+  for (i = 0; i < 400 && answered + failed < sent; i++)
+    usleep (100000);
+  elapsed = stress_now () - start;
+
+  stop_events = 1;
+  if (workers == 0) {
+    pthread_join (event_threads[0], NULL);
+    pthread_join (event_threads[1], NULL);
+  }
+
+  printf ("threads=%i sent=%i received=%i answered=%i failed=%i elapsed=%.0f ms\n", threads, sent, received, answered, failed, elapsed / 1000.0);
+  printf ("eXosip_lock wait: average=%.1f us max=%.1f us\n", sent > 0 ? lock_wait_total / sent : 0.0, lock_wait_max);
+
+  eXosip_quit (client);
+  osip_free (client);
+  eXosip_quit (server);
+  osip_free (server);
+  return (sent == threads * requests && answered == sent) ? 0 : 1;
+}
@@ -236,7 +236,7 @@ extern "C" {
     struct timeval timer_k_start;                 /**< Timer K */
     char *destination;                            /**< IP used to send requests */
     int port;                                     /**< port of next hop */
-
+    int t1;                                       /**< Timer T1 of the transaction (ms) */
   };
 
 /**
@@ -404,6 +404,11 @@ extern "C" {
     void *reserved4;                    /**< User Defined Pointer. */
     void *reserved5;                    /**< User Defined Pointer. */
     void *reserved6;                    /**< User Defined Pointer. */
+
+    osip_transaction_t *ready_next;     /**< next transaction in the ready queue */
+    int ready;                          /**< transaction is in the ready queue */
+    struct timeval rtt_start;           /**< first transmission of the request (tv_sec=-1 when not measured) */
+    int rtt_retransmitted;              /**< request was retransmitted before the first response */
   };
 
 
@@ -556,6 +561,33 @@ extern "C" {
  */
   typedef struct osip osip_t;
 
+/**
+ * Structure for the queue of transactions with pending events.
+ * @struct osip_ready_queue
+ */
+  struct osip_ready_queue {
+    osip_transaction_t *head;           /**< first transaction with pending events */
+    osip_transaction_t *tail;           /**< last transaction with pending events */
+  };
+
+/**
+ * Structure for the round trip time measured with one destination.
+ * @struct osip_peer_rtt
+ */
+  struct osip_peer_rtt {
+    char host[65];                      /**< destination host */
+    int port;                           /**< destination port */
+    unsigned int hash;                  /**< hash of host and port */
+    int srtt;                           /**< smoothed round trip time (ms) */
+    int rttvar;                         /**< round trip time variation (ms) */
+    struct timeval last;                /**< last sample (LRU eviction) */
+    int backoff;                        /**< T1 doublings since the last valid sample */
+  };
+
+#define OSIP_PEER_RTT_SETS 64
+#define OSIP_PEER_RTT_WAYS 4
+#define OSIP_PEER_RTT_MAX_BACKOFF 6
+
 /**
  * Structure for osip handling.
  * @struct osip
@@ -591,6 +623,15 @@ extern "C" {
     void *osip_nict_hastable;                             /**< htable of nict transactions */
     void *osip_nist_hastable;                             /**< htable of nist transactions */
 
+    struct osip_ready_queue ict_ready;          /**< ict transactions with pending events */
+    struct osip_ready_queue ist_ready;          /**< ist transactions with pending events */
+    struct osip_ready_queue nict_ready;         /**< nict transactions with pending events */
+    struct osip_ready_queue nist_ready;         /**< nist transactions with pending events */
+
+    int t1_min;                                 /**< lower bound of the adaptive T1 (ms) */
+    int t1_max;                                 /**< upper bound of the adaptive T1 (ms), 0 when disabled */
+    struct osip_peer_rtt *peer_rtt;             /**< round trip times of the last destinations */
+    void *peer_rtt_mutex;                       /**< mutex for the round trip time table */
   };
 
 /**
@@ -617,6 +658,29 @@ extern "C" {
  */
   int osip_set_transport_error_callback (osip_t * osip, int type, osip_transport_error_cb_t cb);
 
+/**
+ * Enable the adaptive T1 of client transactions over unreliable transport.
+ * The delay between a request and its first response is measured for each
+ * destination and the smoothed estimate (srtt + 4*rttvar) is used as T1
+ * for timer A and E of the next transactions to this destination.
+ * When the request was retransmitted, the delay is ambiguous: it is not
+ * used and T1 is doubled for the next transactions until a valid measure
+ * (Karn). Destinations without a measure use DEFAULT_T1.
+ * RFC3261 only allows a T1 smaller than 500ms within closed private networks.
+ * @param osip The element to work on.
+ * @param t1_min The minimum value of T1 (ms), at least 1.
+ * @param t1_max The maximum value of T1 (ms), or 0 to disable.
+ */
+  int osip_set_adaptive_t1 (osip_t * osip, int t1_min, int t1_max);
+
+/**
+ * Get the T1 value used for the next transactions to a destination.
+ * @param osip The element to work on.
+ * @param host The destination host.
+ * @param port The destination port.
+ */
+  int osip_get_peer_t1 (osip_t * osip, const char *host, int port);
+
 /**
  * Structure for osip event handling.
  * A osip_event_t element will have a type and will be related
@@ -693,6 +757,8 @@ extern "C" {
 
 /**
  * Add a SIP event in the fifo of a osip_transaction_t element.
+ * Events must be added with this method (and not directly in the fifo)
+ * so that the transaction is executed by osip_*_execute.
  * @param transaction The element to work on.
  * @param evt The event to add.
  */
@@ -109,6 +109,8 @@ extern "C" {
     size_t message_length;                        /**< internal value */
 
     void *application_data;                       /**< can be used by upper layer*/
+
+    unsigned long message_serial;                 /**< internal value: unique number given each time "message" is rebuilt */
   };
 
 #ifndef SIP_MESSAGE_MAX_LENGTH
@@ -27,12 +27,36 @@
 
 #ifndef DOXYGEN
 
+typedef void (*osip_fsm_method_t) (void *, void *);
+
 typedef struct osip_statemachine osip_statemachine_t;
 
+/* transition table of a transaction type: one row per state, from
+   first_state, and one column per event type. */
 struct osip_statemachine {
-  struct _transition_t *transitions;
+  state_t first_state;
+  int nb_states;
+  const osip_fsm_method_t (*methods)[UNKNOWN_EVT];
 };
 
+/* A row of a transition table lists one method (or 0) for each event type,
+   in the type_t order. A row with a missing or extra column does not
+   compile. */
+#define OSIP_FSM_ROW(a, b, d, e, f, k, g, h, i, j, rcv_invite, rcv_ack, rcv_request, rcv_1xx, rcv_2xx, rcv_3456xx, snd_invite, snd_ack, snd_request, snd_1xx, snd_2xx, snd_3456xx, kill) \
+  { (osip_fsm_method_t) (a), (osip_fsm_method_t) (b), (osip_fsm_method_t) (d), (osip_fsm_method_t) (e), (osip_fsm_method_t) (f), \
+    (osip_fsm_method_t) (k), (osip_fsm_method_t) (g), (osip_fsm_method_t) (h), (osip_fsm_method_t) (i), (osip_fsm_method_t) (j), \
+    (osip_fsm_method_t) (rcv_invite), (osip_fsm_method_t) (rcv_ack), (osip_fsm_method_t) (rcv_request), \
+    (osip_fsm_method_t) (rcv_1xx), (osip_fsm_method_t) (rcv_2xx), (osip_fsm_method_t) (rcv_3456xx), \
+    (osip_fsm_method_t) (snd_invite), (osip_fsm_method_t) (snd_ack), (osip_fsm_method_t) (snd_request), \
+    (osip_fsm_method_t) (snd_1xx), (osip_fsm_method_t) (snd_2xx), (osip_fsm_method_t) (snd_3456xx), \
+    (osip_fsm_method_t) (kill) }
+
+/* compile time assertion */
+#define OSIP_FSM_CHECK(name, expr) typedef char name[(expr) ? 1 : -1]
+
+/* OSIP_FSM_ROW has one parameter per event type */
+OSIP_FSM_CHECK (osip_fsm_row_size, UNKNOWN_EVT == 23);
+
 /**
  * Allocate a sipevent.
  * NOTE: THIS IS AN INTERNAL METHOD ONLY
@@ -46,16 +70,6 @@ osip_event_t *__osip_event_new (type_t type, int transactionid);
 type_t evt_set_type_incoming_sipmessage (osip_message_t * sip);
 type_t evt_set_type_outgoing_sipmessage (osip_message_t * sip);
 
-typedef struct _transition_t transition_t;
-
-struct _transition_t {
-  state_t state;
-  type_t type;
-  void (*method) (void *, void *);
-  struct _transition_t *next;
-  struct _transition_t *parent;
-};
-
 int fsm_callmethod (type_t type, state_t state, osip_statemachine_t * statemachine, void *sipevent, void *transaction);
 
 
@@ -22,34 +22,23 @@
 #include <osip2/osip.h>
 #include "fsm.h"
 
-static transition_t *fsm_findmethod (type_t type, state_t state, osip_statemachine_t * statemachine);
-
-/* find the transition for state and type in statemachine */
-/* return NULL; if transition is not found.               */
-static transition_t *
-fsm_findmethod (type_t type, state_t state, osip_statemachine_t * statemachine)
-{
-  transition_t *transition;
-
-  for (transition = statemachine->transitions; transition != NULL; transition = transition->next) {
-    if (transition->type == type && transition->state == state)
-      return transition;
-  }
-  return NULL;
-}
-
 /* call the right execution method.          */
 /*   return -1 when event must be discarded  */
 int
 fsm_callmethod (type_t type, state_t state, osip_statemachine_t * statemachine, void *sipevent, void *transaction)
 {
-  transition_t *transition;
+  osip_fsm_method_t method;
+
+  if ((int) type < 0 || type >= UNKNOWN_EVT)
+    return OSIP_UNDEFINED_ERROR;
+  if (state < statemachine->first_state || (int) (state - statemachine->first_state) >= statemachine->nb_states)
+    return OSIP_UNDEFINED_ERROR;
 
-  transition = fsm_findmethod (type, state, statemachine);
-  if (transition == NULL) {
+  method = statemachine->methods[state - statemachine->first_state][type];
+  if (method == NULL) {
     /* No transition found for this event */
     return OSIP_UNDEFINED_ERROR;        /* error */
   }
-  transition->method (transaction, sipevent);
+  method (transaction, sipevent);
   return OSIP_SUCCESS;          /* ok */
 }
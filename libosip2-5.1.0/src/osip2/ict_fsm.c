@@ -23,67 +23,62 @@
 #include "fsm.h"
 #include "xixt.h"
 
-transition_t ict_transition[11] = {
-  {
-   ICT_PRE_CALLING,
-   SND_REQINVITE,
-   (void (*)(void *, void *)) &ict_snd_invite,
-   &ict_transition[1], NULL}
-  ,
-  {
-   ICT_CALLING,
-   TIMEOUT_A,
-   (void (*)(void *, void *)) &osip_ict_timeout_a_event,
-   &ict_transition[2], NULL}
-  ,
-  {
-   ICT_CALLING,
-   TIMEOUT_B,
-   (void (*)(void *, void *)) &osip_ict_timeout_b_event,
-   &ict_transition[3], NULL}
-  ,
-  {ICT_CALLING,
-   RCV_STATUS_1XX,
-   (void (*)(void *, void *)) &ict_rcv_1xx,
-   &ict_transition[4], NULL}
-  ,
-  {ICT_CALLING,
-   RCV_STATUS_2XX,
-   (void (*)(void *, void *)) &ict_rcv_2xx,
-   &ict_transition[5], NULL}
+/* [state - ICT_PRE_CALLING][event type]: one method, or 0 when the event is discarded */
+static const osip_fsm_method_t ict_methods[][UNKNOWN_EVT] = {
+  /* ICT_PRE_CALLING */
+  OSIP_FSM_ROW (/* timers A, B, D, E, F, K, G, H, I, J */
+                0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+                /* RCV_: REQINVITE, REQACK, REQUEST, STATUS_1XX, STATUS_2XX, STATUS_3456XX */
+                0, 0, 0, 0, 0, 0,
+                /* SND_: REQINVITE, REQACK, REQUEST, STATUS_1XX, STATUS_2XX, STATUS_3456XX */
+                ict_snd_invite, 0, 0, 0, 0, 0,
+                /* KILL_TRANSACTION */
+                0)
   ,
-  {ICT_CALLING,
-   RCV_STATUS_3456XX,
-   (void (*)(void *, void *)) &ict_rcv_3456xx,
-   &ict_transition[6], NULL}
+  /* ICT_CALLING */
+  OSIP_FSM_ROW (/* timers A, B, D, E, F, K, G, H, I, J */
+                osip_ict_timeout_a_event, osip_ict_timeout_b_event, 0, 0, 0, 0, 0, 0, 0, 0,
+                /* RCV_: REQINVITE, REQACK, REQUEST, STATUS_1XX, STATUS_2XX, STATUS_3456XX */
+                0, 0, 0, ict_rcv_1xx, ict_rcv_2xx, ict_rcv_3456xx,
+                /* SND_: REQINVITE, REQACK, REQUEST, STATUS_1XX, STATUS_2XX, STATUS_3456XX */
+                0, 0, 0, 0, 0, 0,
+                /* KILL_TRANSACTION */
+                0)
   ,
-  {ICT_PROCEEDING,
-   RCV_STATUS_1XX,
-   (void (*)(void *, void *)) &ict_rcv_1xx,
-   &ict_transition[7], NULL}
+  /* ICT_PROCEEDING */
+  OSIP_FSM_ROW (/* timers A, B, D, E, F, K, G, H, I, J */
+                0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+                /* RCV_: REQINVITE, REQACK, REQUEST, STATUS_1XX, STATUS_2XX, STATUS_3456XX */
+                0, 0, 0, ict_rcv_1xx, ict_rcv_2xx, ict_rcv_3456xx,
+                /* SND_: REQINVITE, REQACK, REQUEST, STATUS_1XX, STATUS_2XX, STATUS_3456XX */
+                0, 0, 0, 0, 0, 0,
+                /* KILL_TRANSACTION */
+                0)
   ,
-  {ICT_PROCEEDING,
-   RCV_STATUS_2XX,
-   (void (*)(void *, void *)) &ict_rcv_2xx,
-   &ict_transition[8], NULL}
+  /* ICT_COMPLETED */
+  OSIP_FSM_ROW (/* timers A, B, D, E, F, K, G, H, I, J */
+                0, 0, osip_ict_timeout_d_event, 0, 0, 0, 0, 0, 0, 0,
+                /* RCV_: REQINVITE, REQACK, REQUEST, STATUS_1XX, STATUS_2XX, STATUS_3456XX */
+                0, 0, 0, 0, 0, ict_retransmit_ack,
+                /* SND_: REQINVITE, REQACK, REQUEST, STATUS_1XX, STATUS_2XX, STATUS_3456XX */
+                0, 0, 0, 0, 0, 0,
+                /* KILL_TRANSACTION */
+                0)
   ,
-  {ICT_PROCEEDING,
-   RCV_STATUS_3456XX,
-   (void (*)(void *, void *)) &ict_rcv_3456xx,
-   &ict_transition[9], NULL}
-  ,
-  {ICT_COMPLETED,
-   RCV_STATUS_3456XX,
-   (void (*)(void *, void *)) &ict_retransmit_ack,
-   &ict_transition[10], NULL}
-  ,
-  {ICT_COMPLETED,
-   TIMEOUT_D,
-   (void (*)(void *, void *)) &osip_ict_timeout_d_event,
-   NULL, NULL}
+  /* ICT_TERMINATED */
+  OSIP_FSM_ROW (/* timers A, B, D, E, F, K, G, H, I, J */
+                0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+                /* RCV_: REQINVITE, REQACK, REQUEST, STATUS_1XX, STATUS_2XX, STATUS_3456XX */
+                0, 0, 0, 0, 0, 0,
+                /* SND_: REQINVITE, REQACK, REQUEST, STATUS_1XX, STATUS_2XX, STATUS_3456XX */
+                0, 0, 0, 0, 0, 0,
+                /* KILL_TRANSACTION */
+                0)
 };
 
-osip_statemachine_t ict_fsm = { ict_transition };
+OSIP_FSM_CHECK (ict_methods_complete, sizeof (ict_methods) / sizeof (ict_methods[0]) == ICT_TERMINATED - ICT_PRE_CALLING + 1);
+
+osip_statemachine_t ict_fsm = { ICT_PRE_CALLING, sizeof (ict_methods) / sizeof (ict_methods[0]), ict_methods };
 
 static void
 ict_handle_transport_error (osip_transaction_t * ict, int err)
@@ -137,6 +132,8 @@ ict_snd_invite (osip_transaction_t * ict, osip_event_t * evt)
   }
 #endif
 
+  __osip_transaction_rtt_start (ict, &ict->ict_context->timer_a_length, &ict->ict_context->timer_a_start);
+
   __osip_message_callback (OSIP_ICT_INVITE_SENT, ict, ict->orig_request);
   __osip_transaction_set_state (ict, ICT_CALLING);
 }
@@ -148,6 +145,7 @@ osip_ict_timeout_a_event (osip_transaction_t * ict, osip_event_t * evt)
   int i;
 
   /* reset timer */
+  ict->rtt_retransmitted = 1;
   ict->ict_context->timer_a_length = ict->ict_context->timer_a_length * 2;
   osip_gettimeofday (&ict->ict_context->timer_a_start, NULL);
   add_gettimeofday (&ict->ict_context->timer_a_start, ict->ict_context->timer_a_length);
@@ -204,6 +202,8 @@ osip_ict_timeout_b_event (osip_transaction_t * ict, osip_event_t * evt)
 void
 ict_rcv_1xx (osip_transaction_t * ict, osip_event_t * evt)
 {
+  __osip_transaction_rtt_sample (ict);
+
   /* leave this answer to the core application */
 
   if (ict->last_response != NULL) {
@@ -217,6 +217,8 @@ ict_rcv_1xx (osip_transaction_t * ict, osip_event_t * evt)
 void
 ict_rcv_2xx (osip_transaction_t * ict, osip_event_t * evt)
 {
+  __osip_transaction_rtt_sample (ict);
+
   /* leave this answer to the core application */
 
   if (ict->last_response != NULL) {
@@ -362,6 +364,8 @@ ict_rcv_3456xx (osip_transaction_t * ict, osip_event_t * evt)
   int i;
   osip_t *osip = (osip_t *) ict->config;
 
+  __osip_transaction_rtt_sample (ict);
+
   /* leave this answer to the core application */
 
   if (ict->last_response != NULL)
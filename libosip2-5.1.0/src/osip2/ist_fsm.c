@@ -22,75 +22,62 @@
 
 #include "fsm.h"
 
-transition_t ist_transition[11] = {
-  {
-   IST_PRE_PROCEEDING,
-   RCV_REQINVITE,
-   (void (*)(void *, void *)) &ist_rcv_invite,
-   &ist_transition[1], NULL}
+/* [state - IST_PRE_PROCEEDING][event type]: one method, or 0 when the event is discarded */
+static const osip_fsm_method_t ist_methods[][UNKNOWN_EVT] = {
+  /* IST_PRE_PROCEEDING */
+  OSIP_FSM_ROW (/* timers A, B, D, E, F, K, G, H, I, J */
+                0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+                /* RCV_: REQINVITE, REQACK, REQUEST, STATUS_1XX, STATUS_2XX, STATUS_3456XX */
+                ist_rcv_invite, 0, 0, 0, 0, 0,
+                /* SND_: REQINVITE, REQACK, REQUEST, STATUS_1XX, STATUS_2XX, STATUS_3456XX */
+                0, 0, 0, 0, 0, 0,
+                /* KILL_TRANSACTION */
+                0)
   ,
-  {
-   IST_PROCEEDING,
-   RCV_REQINVITE,
-   (void (*)(void *, void *)) &ist_rcv_invite,
-   &ist_transition[2], NULL}
+  /* IST_PROCEEDING */
+  OSIP_FSM_ROW (/* timers A, B, D, E, F, K, G, H, I, J */
+                0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+                /* RCV_: REQINVITE, REQACK, REQUEST, STATUS_1XX, STATUS_2XX, STATUS_3456XX */
+                ist_rcv_invite, 0, 0, 0, 0, 0,
+                /* SND_: REQINVITE, REQACK, REQUEST, STATUS_1XX, STATUS_2XX, STATUS_3456XX */
+                0, 0, 0, ist_snd_1xx, ist_snd_2xx, ist_snd_3456xx,
+                /* KILL_TRANSACTION */
+                0)
   ,
-  {
-   IST_COMPLETED,
-   RCV_REQINVITE,
-   (void (*)(void *, void *)) &ist_rcv_invite,
-   &ist_transition[3], NULL}
+  /* IST_COMPLETED */
+  OSIP_FSM_ROW (/* timers A, B, D, E, F, K, G, H, I, J */
+                0, 0, 0, 0, 0, 0, osip_ist_timeout_g_event, osip_ist_timeout_h_event, 0, 0,
+                /* RCV_: REQINVITE, REQACK, REQUEST, STATUS_1XX, STATUS_2XX, STATUS_3456XX */
+                ist_rcv_invite, ist_rcv_ack, 0, 0, 0, 0,
+                /* SND_: REQINVITE, REQACK, REQUEST, STATUS_1XX, STATUS_2XX, STATUS_3456XX */
+                0, 0, 0, 0, 0, 0,
+                /* KILL_TRANSACTION */
+                0)
   ,
-  {
-   IST_COMPLETED,
-   TIMEOUT_G,
-   (void (*)(void *, void *)) &osip_ist_timeout_g_event,
-   &ist_transition[4], NULL}
+  /* IST_CONFIRMED */
+  OSIP_FSM_ROW (/* timers A, B, D, E, F, K, G, H, I, J */
+                0, 0, 0, 0, 0, 0, 0, 0, osip_ist_timeout_i_event, 0,
+                /* RCV_: REQINVITE, REQACK, REQUEST, STATUS_1XX, STATUS_2XX, STATUS_3456XX */
+                0, ist_rcv_ack, 0, 0, 0, 0,
+                /* SND_: REQINVITE, REQACK, REQUEST, STATUS_1XX, STATUS_2XX, STATUS_3456XX */
+                0, 0, 0, 0, 0, 0,
+                /* KILL_TRANSACTION */
+                0)
   ,
-  {
-   IST_COMPLETED,
-   TIMEOUT_H,
-   (void (*)(void *, void *)) &osip_ist_timeout_h_event,
-   &ist_transition[5], NULL}
-  ,
-  {
-   IST_PROCEEDING,
-   SND_STATUS_1XX,
-   (void (*)(void *, void *)) &ist_snd_1xx,
-   &ist_transition[6], NULL}
-  ,
-  {
-   IST_PROCEEDING,
-   SND_STATUS_2XX,
-   (void (*)(void *, void *)) &ist_snd_2xx,
-   &ist_transition[7], NULL}
-  ,
-  {
-   IST_PROCEEDING,
-   SND_STATUS_3456XX,
-   (void (*)(void *, void *)) &ist_snd_3456xx,
-   &ist_transition[8], NULL}
-  ,
-  {
-   IST_COMPLETED,
-   RCV_REQACK,
-   (void (*)(void *, void *)) &ist_rcv_ack,
-   &ist_transition[9], NULL}
-  ,
-  {
-   IST_CONFIRMED,
-   RCV_REQACK,
-   (void (*)(void *, void *)) &ist_rcv_ack,
-   &ist_transition[10], NULL}
-  ,
-  {
-   IST_CONFIRMED,
-   TIMEOUT_I,
-   (void (*)(void *, void *)) &osip_ist_timeout_i_event,
-   NULL, NULL}
+  /* IST_TERMINATED */
+  OSIP_FSM_ROW (/* timers A, B, D, E, F, K, G, H, I, J */
+                0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+                /* RCV_: REQINVITE, REQACK, REQUEST, STATUS_1XX, STATUS_2XX, STATUS_3456XX */
+                0, 0, 0, 0, 0, 0,
+                /* SND_: REQINVITE, REQACK, REQUEST, STATUS_1XX, STATUS_2XX, STATUS_3456XX */
+                0, 0, 0, 0, 0, 0,
+                /* KILL_TRANSACTION */
+                0)
 };
 
-osip_statemachine_t ist_fsm = { ist_transition };
+OSIP_FSM_CHECK (ist_methods_complete, sizeof (ist_methods) / sizeof (ist_methods[0]) == IST_TERMINATED - IST_PRE_PROCEEDING + 1);
+
+osip_statemachine_t ist_fsm = { IST_PRE_PROCEEDING, sizeof (ist_methods) / sizeof (ist_methods[0]), ist_methods };
 
 static void
 ist_handle_transport_error (osip_transaction_t * ist, int err)
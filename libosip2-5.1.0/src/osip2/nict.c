@@ -36,6 +36,7 @@ __osip_nict_init (osip_nict_t ** nict, osip_t * osip, osip_message_t * request)
     return OSIP_NOMEM;
 
   memset (*nict, 0, sizeof (osip_nict_t));
+  (*nict)->t1 = DEFAULT_T1;
   /* for REQUEST retransmissions */
   {
     osip_via_t *via;
@@ -22,81 +22,62 @@
 
 #include "fsm.h"
 
-transition_t nict_transition[12] = {
-  {
-   NICT_PRE_TRYING,
-   SND_REQUEST,
-   (void (*)(void *, void *)) &nict_snd_request,
-   &nict_transition[1], NULL}
+/* [state - NICT_PRE_TRYING][event type]: one method, or 0 when the event is discarded */
+static const osip_fsm_method_t nict_methods[][UNKNOWN_EVT] = {
+  /* NICT_PRE_TRYING */
+  OSIP_FSM_ROW (/* timers A, B, D, E, F, K, G, H, I, J */
+                0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+                /* RCV_: REQINVITE, REQACK, REQUEST, STATUS_1XX, STATUS_2XX, STATUS_3456XX */
+                0, 0, 0, 0, 0, 0,
+                /* SND_: REQINVITE, REQACK, REQUEST, STATUS_1XX, STATUS_2XX, STATUS_3456XX */
+                0, 0, nict_snd_request, 0, 0, 0,
+                /* KILL_TRANSACTION */
+                0)
   ,
-  {
-   NICT_TRYING,
-   TIMEOUT_F,
-   (void (*)(void *, void *)) &osip_nict_timeout_f_event,
-   &nict_transition[2], NULL}
+  /* NICT_TRYING */
+  OSIP_FSM_ROW (/* timers A, B, D, E, F, K, G, H, I, J */
+                0, 0, 0, osip_nict_timeout_e_event, osip_nict_timeout_f_event, 0, 0, 0, 0, 0,
+                /* RCV_: REQINVITE, REQACK, REQUEST, STATUS_1XX, STATUS_2XX, STATUS_3456XX */
+                0, 0, 0, nict_rcv_1xx, nict_rcv_23456xx, nict_rcv_23456xx,
+                /* SND_: REQINVITE, REQACK, REQUEST, STATUS_1XX, STATUS_2XX, STATUS_3456XX */
+                0, 0, 0, 0, 0, 0,
+                /* KILL_TRANSACTION */
+                0)
   ,
-  {
-   NICT_TRYING,
-   TIMEOUT_E,
-   (void (*)(void *, void *)) &osip_nict_timeout_e_event,
-   &nict_transition[3], NULL}
+  /* NICT_PROCEEDING */
+  OSIP_FSM_ROW (/* timers A, B, D, E, F, K, G, H, I, J */
+                0, 0, 0, osip_nict_timeout_e_event, osip_nict_timeout_f_event, 0, 0, 0, 0, 0,
+                /* RCV_: REQINVITE, REQACK, REQUEST, STATUS_1XX, STATUS_2XX, STATUS_3456XX */
+                0, 0, 0, nict_rcv_1xx, nict_rcv_23456xx, nict_rcv_23456xx,
+                /* SND_: REQINVITE, REQACK, REQUEST, STATUS_1XX, STATUS_2XX, STATUS_3456XX */
+                0, 0, 0, 0, 0, 0,
+                /* KILL_TRANSACTION */
+                0)
   ,
-  {
-   NICT_TRYING,
-   RCV_STATUS_1XX,
-   (void (*)(void *, void *)) &nict_rcv_1xx,
-   &nict_transition[4], NULL}
+  /* NICT_COMPLETED */
+  OSIP_FSM_ROW (/* timers A, B, D, E, F, K, G, H, I, J */
+                0, 0, 0, 0, 0, osip_nict_timeout_k_event, 0, 0, 0, 0,
+                /* RCV_: REQINVITE, REQACK, REQUEST, STATUS_1XX, STATUS_2XX, STATUS_3456XX */
+                0, 0, 0, 0, 0, 0,
+                /* SND_: REQINVITE, REQACK, REQUEST, STATUS_1XX, STATUS_2XX, STATUS_3456XX */
+                0, 0, 0, 0, 0, 0,
+                /* KILL_TRANSACTION */
+                0)
   ,
-  {
-   NICT_TRYING,
-   RCV_STATUS_2XX,
-   (void (*)(void *, void *)) &nict_rcv_23456xx,
-   &nict_transition[5], NULL}
-  ,
-  {
-   NICT_TRYING,
-   RCV_STATUS_3456XX,
-   (void (*)(void *, void *)) &nict_rcv_23456xx,
-   &nict_transition[6], NULL}
-  ,
-  {
-   NICT_PROCEEDING,
-   TIMEOUT_F,
-   (void (*)(void *, void *)) &osip_nict_timeout_f_event,
-   &nict_transition[7], NULL}
-  ,
-  {
-   NICT_PROCEEDING,
-   TIMEOUT_E,
-   (void (*)(void *, void *)) &osip_nict_timeout_e_event,
-   &nict_transition[8], NULL}
-  ,
-  {
-   NICT_PROCEEDING,
-   RCV_STATUS_1XX,
-   (void (*)(void *, void *)) &nict_rcv_1xx,
-   &nict_transition[9], NULL}
-  ,
-  {
-   NICT_PROCEEDING,
-   RCV_STATUS_2XX,
-   (void (*)(void *, void *)) &nict_rcv_23456xx,
-   &nict_transition[10], NULL}
-  ,
-  {
-   NICT_PROCEEDING,
-   RCV_STATUS_3456XX,
-   (void (*)(void *, void *)) &nict_rcv_23456xx,
-   &nict_transition[11], NULL}
-  ,
-  {
-   NICT_COMPLETED,
-   TIMEOUT_K,
-   (void (*)(void *, void *)) &osip_nict_timeout_k_event,
-   NULL, NULL}
+  /* NICT_TERMINATED */
+  OSIP_FSM_ROW (/* timers A, B, D, E, F, K, G, H, I, J */
+                0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+                /* RCV_: REQINVITE, REQACK, REQUEST, STATUS_1XX, STATUS_2XX, STATUS_3456XX */
+                0, 0, 0, 0, 0, 0,
+                /* SND_: REQINVITE, REQACK, REQUEST, STATUS_1XX, STATUS_2XX, STATUS_3456XX */
+                0, 0, 0, 0, 0, 0,
+                /* KILL_TRANSACTION */
+                0)
 };
 
-osip_statemachine_t nict_fsm = { nict_transition };
+OSIP_FSM_CHECK (nict_methods_complete, sizeof (nict_methods) / sizeof (nict_methods[0]) == NICT_TERMINATED - NICT_PRE_TRYING + 1);
+
+osip_statemachine_t nict_fsm = { NICT_PRE_TRYING, sizeof (nict_methods) / sizeof (nict_methods[0]), nict_methods };
 
 static void
 nict_handle_transport_error (osip_transaction_t * nict, int err)
@@ -173,6 +154,7 @@ nict_snd_request (osip_transaction_t * nict, osip_event_t * evt)
       }
     }
 #endif
+    __osip_transaction_rtt_start (nict, &nict->nict_context->timer_e_length, &nict->nict_context->timer_e_start);
     if (nict->nict_context->timer_e_length > 0) {
       osip_gettimeofday (&nict->nict_context->timer_e_start, NULL);
       add_gettimeofday (&nict->nict_context->timer_e_start, nict->nict_context->timer_e_length);
@@ -191,8 +173,9 @@ osip_nict_timeout_e_event (osip_transaction_t * nict, osip_event_t * evt)
   int i;
 
   /* reset timer */
+  nict->rtt_retransmitted = 1;
   if (nict->state == NICT_TRYING) {
-    if (nict->nict_context->timer_e_length < DEFAULT_T1)
+    if (nict->nict_context->timer_e_length < nict->nict_context->t1)
       nict->nict_context->timer_e_length = nict->nict_context->timer_e_length + DEFAULT_T1_TCP_PROGRESS;
     else
       nict->nict_context->timer_e_length = nict->nict_context->timer_e_length * 2;
@@ -266,6 +249,8 @@ osip_nict_timeout_k_event (osip_transaction_t * nict, osip_event_t * evt)
 void
 nict_rcv_1xx (osip_transaction_t * nict, osip_event_t * evt)
 {
+  __osip_transaction_rtt_sample (nict);
+
   /* leave this answer to the core application */
 
   if (nict->last_response != NULL) {
@@ -287,6 +272,8 @@ nict_rcv_1xx (osip_transaction_t * nict, osip_event_t * evt)
 void
 nict_rcv_23456xx (osip_transaction_t * nict, osip_event_t * evt)
 {
+  __osip_transaction_rtt_sample (nict);
+
   /* leave this answer to the core application */
 
   if (nict->last_response != NULL) {
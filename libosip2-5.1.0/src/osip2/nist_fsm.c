@@ -22,69 +22,62 @@
 
 #include "fsm.h"
 
-transition_t nist_transition[10] = {
-  {
-   NIST_PRE_TRYING,
-   RCV_REQUEST,
-   (void (*)(void *, void *)) &nist_rcv_request,
-   &nist_transition[1], NULL}
+/* [state - NIST_PRE_TRYING][event type]: one method, or 0 when the event is discarded */
+static const osip_fsm_method_t nist_methods[][UNKNOWN_EVT] = {
+  /* NIST_PRE_TRYING */
+  OSIP_FSM_ROW (/* timers A, B, D, E, F, K, G, H, I, J */
+                0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+                /* RCV_: REQINVITE, REQACK, REQUEST, STATUS_1XX, STATUS_2XX, STATUS_3456XX */
+                0, 0, nist_rcv_request, 0, 0, 0,
+                /* SND_: REQINVITE, REQACK, REQUEST, STATUS_1XX, STATUS_2XX, STATUS_3456XX */
+                0, 0, 0, 0, 0, 0,
+                /* KILL_TRANSACTION */
+                0)
   ,
-  {
-   NIST_TRYING,
-   SND_STATUS_1XX,
-   (void (*)(void *, void *)) &nist_snd_1xx,
-   &nist_transition[2], NULL}
+  /* NIST_TRYING */
+  OSIP_FSM_ROW (/* timers A, B, D, E, F, K, G, H, I, J */
+                0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+                /* RCV_: REQINVITE, REQACK, REQUEST, STATUS_1XX, STATUS_2XX, STATUS_3456XX */
+                0, 0, 0, 0, 0, 0,
+                /* SND_: REQINVITE, REQACK, REQUEST, STATUS_1XX, STATUS_2XX, STATUS_3456XX */
+                0, 0, 0, nist_snd_1xx, nist_snd_23456xx, nist_snd_23456xx,
+                /* KILL_TRANSACTION */
+                0)
   ,
-  {
-   NIST_TRYING,
-   SND_STATUS_2XX,
-   (void (*)(void *, void *)) &nist_snd_23456xx,
-   &nist_transition[3], NULL}
+  /* NIST_PROCEEDING */
+  OSIP_FSM_ROW (/* timers A, B, D, E, F, K, G, H, I, J */
+                0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+                /* RCV_: REQINVITE, REQACK, REQUEST, STATUS_1XX, STATUS_2XX, STATUS_3456XX */
+                0, 0, nist_rcv_request, 0, 0, 0,
+                /* SND_: REQINVITE, REQACK, REQUEST, STATUS_1XX, STATUS_2XX, STATUS_3456XX */
+                0, 0, 0, nist_snd_1xx, nist_snd_23456xx, nist_snd_23456xx,
+                /* KILL_TRANSACTION */
+                0)
   ,
-  {
-   NIST_TRYING,
-   SND_STATUS_3456XX,
-   (void (*)(void *, void *)) &nist_snd_23456xx,
-   &nist_transition[4], NULL}
+  /* NIST_COMPLETED */
+  OSIP_FSM_ROW (/* timers A, B, D, E, F, K, G, H, I, J */
+                0, 0, 0, 0, 0, 0, 0, 0, 0, osip_nist_timeout_j_event,
+                /* RCV_: REQINVITE, REQACK, REQUEST, STATUS_1XX, STATUS_2XX, STATUS_3456XX */
+                0, 0, nist_rcv_request, 0, 0, 0,
+                /* SND_: REQINVITE, REQACK, REQUEST, STATUS_1XX, STATUS_2XX, STATUS_3456XX */
+                0, 0, 0, 0, 0, 0,
+                /* KILL_TRANSACTION */
+                0)
   ,
-  {
-   NIST_PROCEEDING,
-   SND_STATUS_1XX,
-   (void (*)(void *, void *)) &nist_snd_1xx,
-   &nist_transition[5], NULL}
-  ,
-  {
-   NIST_PROCEEDING,
-   SND_STATUS_2XX,
-   (void (*)(void *, void *)) &nist_snd_23456xx,
-   &nist_transition[6], NULL}
-  ,
-  {
-   NIST_PROCEEDING,
-   SND_STATUS_3456XX,
-   (void (*)(void *, void *)) &nist_snd_23456xx,
-   &nist_transition[7], NULL}
-  ,
-  {
-   NIST_PROCEEDING,
-   RCV_REQUEST,
-   (void (*)(void *, void *)) &nist_rcv_request,
-   &nist_transition[8], NULL}
-  ,
-  {
-   NIST_COMPLETED,
-   TIMEOUT_J,
-   (void (*)(void *, void *)) &osip_nist_timeout_j_event,
-   &nist_transition[9], NULL}
-  ,
-  {
-   NIST_COMPLETED,
-   RCV_REQUEST,
-   (void (*)(void *, void *)) &nist_rcv_request,
-   NULL, NULL}
+  /* NIST_TERMINATED */
+  OSIP_FSM_ROW (/* timers A, B, D, E, F, K, G, H, I, J */
+                0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+                /* RCV_: REQINVITE, REQACK, REQUEST, STATUS_1XX, STATUS_2XX, STATUS_3456XX */
+                0, 0, 0, 0, 0, 0,
+                /* SND_: REQINVITE, REQACK, REQUEST, STATUS_1XX, STATUS_2XX, STATUS_3456XX */
+                0, 0, 0, 0, 0, 0,
+                /* KILL_TRANSACTION */
+                0)
 };
 
-osip_statemachine_t nist_fsm = { nist_transition };
+OSIP_FSM_CHECK (nist_methods_complete, sizeof (nist_methods) / sizeof (nist_methods[0]) == NIST_TERMINATED - NIST_PRE_TRYING + 1);
+
+osip_statemachine_t nist_fsm = { NIST_PRE_TRYING, sizeof (nist_methods) / sizeof (nist_methods[0]), nist_methods };
 
 static void
 nist_handle_transport_error (osip_transaction_t * nist, int err)
@@ -377,6 +377,87 @@ s_hash (const unsigned char *p)
 }
 #endif
 
+/* the ready queue of a transaction type is protected by its fastmutex */
+static struct osip_ready_queue *
+__osip_ready_queue_get (osip_t * osip, osip_fsm_type_t ctx_type, void **fastmutex)
+{
+  if (ctx_type == ICT) {
+    *fastmutex = osip->ict_fastmutex;
+    return &osip->ict_ready;
+  }
+  if (ctx_type == IST) {
+    *fastmutex = osip->ist_fastmutex;
+    return &osip->ist_ready;
+  }
+  if (ctx_type == NICT) {
+    *fastmutex = osip->nict_fastmutex;
+    return &osip->nict_ready;
+  }
+  *fastmutex = osip->nist_fastmutex;
+  return &osip->nist_ready;
+}
+
+static void
+__osip_ready_queue_remove (struct osip_ready_queue *queue, osip_transaction_t * tr)
+{
+  osip_transaction_t *prev = NULL;
+  osip_transaction_t *cur;
+
+  if (!tr->ready)
+    return;
+  for (cur = queue->head; cur != NULL; prev = cur, cur = cur->ready_next) {
+    if (cur == tr) {
+      if (prev == NULL)
+        queue->head = tr->ready_next;
+      else
+        prev->ready_next = tr->ready_next;
+      if (queue->tail == tr)
+        queue->tail = prev;
+      break;
+    }
+  }
+  tr->ready_next = NULL;
+  tr->ready = 0;
+}
+
+int
+__osip_transaction_add_event (osip_t * osip, osip_transaction_t * tr, osip_event_t * evt, int locked)
+{
+  struct osip_ready_queue *queue;
+  void *fastmutex;
+  int i;
+
+  queue = __osip_ready_queue_get (osip, tr->ctx_type, &fastmutex);
+#ifndef OSIP_MONOTHREAD
+  if (!locked)
+    osip_mutex_lock (fastmutex);
+#endif
+  i = osip_fifo_add (tr->transactionff, evt);
+  if (i != OSIP_SUCCESS) {
+    /* the event still belongs to the caller: do not mark the transaction ready */
+#ifndef OSIP_MONOTHREAD
+    if (!locked)
+      osip_mutex_unlock (fastmutex);
+#endif
+    OSIP_TRACE (osip_trace (__FILE__, __LINE__, OSIP_ERROR, NULL, "cannot queue event for transaction %i\n", tr->transactionid));
+    return i;
+  }
+  if (!tr->ready) {
+    tr->ready = 1;
+    tr->ready_next = NULL;
+    if (queue->tail != NULL)
+      queue->tail->ready_next = tr;
+    else
+      queue->head = tr;
+    queue->tail = tr;
+  }
+#ifndef OSIP_MONOTHREAD
+  if (!locked)
+    osip_mutex_unlock (fastmutex);
+#endif
+  return OSIP_SUCCESS;
+}
+
 int
 __osip_add_ict (osip_t * osip, osip_transaction_t * ict)
 {
@@ -525,6 +606,8 @@ __osip_remove_ict_transaction (osip_t * osip, osip_transaction_t * ict)
   osip_mutex_lock (osip->ict_fastmutex);
 #endif
 
+  __osip_ready_queue_remove (&osip->ict_ready, ict);
+
 #if defined(HAVE_DICT_DICT_H)
   {
     osip_generic_param_t *b_request = NULL;
@@ -570,6 +653,8 @@ __osip_remove_ist_transaction (osip_t * osip, osip_transaction_t * ist)
   osip_mutex_lock (osip->ist_fastmutex);
 #endif
 
+  __osip_ready_queue_remove (&osip->ist_ready, ist);
+
 #if defined(HAVE_DICT_DICT_H)
   {
     osip_generic_param_t *b_request = NULL;
@@ -616,6 +701,8 @@ __osip_remove_nict_transaction (osip_t * osip, osip_transaction_t * nict)
   osip_mutex_lock (osip->nict_fastmutex);
 #endif
 
+  __osip_ready_queue_remove (&osip->nict_ready, nict);
+
 #if defined(HAVE_DICT_DICT_H)
   {
     osip_generic_param_t *b_request = NULL;
@@ -662,6 +749,8 @@ __osip_remove_nist_transaction (osip_t * osip, osip_transaction_t * nist)
   osip_mutex_lock (osip->nist_fastmutex);
 #endif
 
+  __osip_ready_queue_remove (&osip->nist_ready, nist);
+
 #if defined(HAVE_DICT_DICT_H)
   {
     osip_generic_param_t *b_request = NULL;
@@ -800,7 +889,9 @@ __osip_find_transaction (osip_t * osip, osip_event_t * evt, int consume)
   transaction = osip_transaction_find (transactions, evt);
   if (consume == 1) {           /* we add the event before releasing the mutex!! */
     if (transaction != NULL) {
-      osip_transaction_add_event (transaction, evt);
+      evt->transactionid = transaction->transactionid;
+      if (__osip_transaction_add_event (osip, transaction, evt, 1) != OSIP_SUCCESS)
+        osip_event_free (evt);  /* consumed: drop it, a retransmission will follow */
 #ifndef OSIP_MONOTHREAD
       osip_mutex_unlock (mut);
 #endif
@@ -988,6 +1079,7 @@ osip_init (osip_t ** osip)
 
   (*osip)->ixt_fastmutex = osip_mutex_init ();
   (*osip)->id_mutex = osip_mutex_init ();
+  (*osip)->peer_rtt_mutex = osip_mutex_init ();
 #endif
 
   osip_list_init (&(*osip)->osip_ict_transactions);
@@ -1019,8 +1111,11 @@ osip_release (osip_t * osip)
 
   osip_mutex_destroy (osip->ixt_fastmutex);
   osip_mutex_destroy (osip->id_mutex);
+  osip_mutex_destroy (osip->peer_rtt_mutex);
 #endif
 
+  if (osip->peer_rtt != NULL)
+    osip_free (osip->peer_rtt);
   osip_free (osip);
 }
 
@@ -1038,229 +1133,76 @@ osip_get_application_context (osip_t * osip)
   return osip->application_context;
 }
 
-int
-osip_ict_execute (osip_t * osip)
+/* execute the pending events of the transactions in a ready queue: only
+   the transactions which were ready when this pass started are visited. */
+static int
+__osip_ready_queue_execute (struct osip_ready_queue *queue, void *fastmutex)
 {
   osip_transaction_t *transaction;
   osip_event_t *se;
-  int more_event;
-  osip_list_iterator_t iterator;
-  void **array;
-  int len;
-  int index = 0;
+  int len = 0;
 
-  /* list must be copied because osip_transaction_execute() may change it */
 #ifndef OSIP_MONOTHREAD
-  osip_mutex_lock (osip->ict_fastmutex);
+  osip_mutex_lock (fastmutex);
 #endif
-  len = osip_list_size (&osip->osip_ict_transactions);
-  if (0 >= len) {
+  for (transaction = queue->head; transaction != NULL; transaction = transaction->ready_next)
+    len++;
 #ifndef OSIP_MONOTHREAD
-    osip_mutex_unlock (osip->ict_fastmutex);
+  osip_mutex_unlock (fastmutex);
 #endif
-    return OSIP_SUCCESS;
-  }
-  array = osip_malloc (sizeof (void *) * len);
-  if (array == NULL) {
+
+  for (; len > 0; len--) {
+    /* osip_transaction_execute() may add events, or remove transactions
+       from the queue: pop one transaction at a time */
 #ifndef OSIP_MONOTHREAD
-    osip_mutex_unlock (osip->ict_fastmutex);
+    osip_mutex_lock (fastmutex);
 #endif
-    return OSIP_NOMEM;          /* OSIP_SUCCESS; */
-  }
-  transaction = (osip_transaction_t *) osip_list_get_first (&osip->osip_ict_transactions, &iterator);
-  while (osip_list_iterator_has_elem (iterator)) {
-    array[index++] = transaction;
-    transaction = (osip_transaction_t *) osip_list_get_next (&iterator);
-  }
+    transaction = queue->head;
+    if (transaction != NULL) {
+      queue->head = transaction->ready_next;
+      if (queue->head == NULL)
+        queue->tail = NULL;
+      transaction->ready_next = NULL;
+      transaction->ready = 0;
+    }
 #ifndef OSIP_MONOTHREAD
-  osip_mutex_unlock (osip->ict_fastmutex);
+    osip_mutex_unlock (fastmutex);
 #endif
+    if (transaction == NULL)
+      break;
 
-  for (index = 0; index < len; ++index) {
-    transaction = (osip_transaction_t *) array[index];
-    more_event = 1;
-    do {
+    se = (osip_event_t *) osip_fifo_tryget (transaction->transactionff);
+    while (se != NULL) {
+      osip_transaction_execute (transaction, se);
       se = (osip_event_t *) osip_fifo_tryget (transaction->transactionff);
-      if (se == NULL)           /* no more event for this transaction */
-        more_event = 0;
-      else
-        osip_transaction_execute (transaction, se);
     }
-    while (more_event == 1);
   }
 
-  osip_free (array);
-
   return OSIP_SUCCESS;
 }
 
 int
-osip_ist_execute (osip_t * osip)
+osip_ict_execute (osip_t * osip)
 {
-  osip_transaction_t *transaction;
-  osip_event_t *se;
-  int more_event;
-  osip_list_iterator_t iterator;
-  void **array;
-  int len;
-  int index = 0;
-
-  /* list must be copied because osip_transaction_execute() may change it */
-#ifndef OSIP_MONOTHREAD
-  osip_mutex_lock (osip->ist_fastmutex);
-#endif
-  len = osip_list_size (&osip->osip_ist_transactions);
-  if (0 >= len) {
-#ifndef OSIP_MONOTHREAD
-    osip_mutex_unlock (osip->ist_fastmutex);
-#endif
-    return OSIP_SUCCESS;
-  }
-  array = osip_malloc (sizeof (void *) * len);
-  if (array == NULL) {
-#ifndef OSIP_MONOTHREAD
-    osip_mutex_unlock (osip->ist_fastmutex);
-#endif
-    return OSIP_NOMEM;          /* OSIP_SUCCESS; */
-  }
-  transaction = (osip_transaction_t *) osip_list_get_first (&osip->osip_ist_transactions, &iterator);
-  while (osip_list_iterator_has_elem (iterator)) {
-    array[index++] = transaction;
-    transaction = (osip_transaction_t *) osip_list_get_next (&iterator);
-  }
-#ifndef OSIP_MONOTHREAD
-  osip_mutex_unlock (osip->ist_fastmutex);
-#endif
-
-  for (index = 0; index < len; ++index) {
-    transaction = (osip_transaction_t *) array[index];
-    more_event = 1;
-    do {
-      se = (osip_event_t *) osip_fifo_tryget (transaction->transactionff);
-      if (se == NULL)           /* no more event for this transaction */
-        more_event = 0;
-      else
-        osip_transaction_execute (transaction, se);
-    }
-    while (more_event == 1);
-
-  }
-
-  osip_free (array);
+  return __osip_ready_queue_execute (&osip->ict_ready, osip->ict_fastmutex);
+}
 
-  return OSIP_SUCCESS;
+int
+osip_ist_execute (osip_t * osip)
+{
+  return __osip_ready_queue_execute (&osip->ist_ready, osip->ist_fastmutex);
 }
 
 int
 osip_nict_execute (osip_t * osip)
 {
-  osip_transaction_t *transaction;
-  osip_event_t *se;
-  int more_event;
-  osip_list_iterator_t iterator;
-  void **array;
-  int len;
-  int index = 0;
-
-  /* list must be copied because osip_transaction_execute() may change it */
-#ifndef OSIP_MONOTHREAD
-  osip_mutex_lock (osip->nict_fastmutex);
-#endif
-  len = osip_list_size (&osip->osip_nict_transactions);
-  if (0 >= len) {
-#ifndef OSIP_MONOTHREAD
-    osip_mutex_unlock (osip->nict_fastmutex);
-#endif
-    return OSIP_SUCCESS;
-  }
-  array = osip_malloc (sizeof (void *) * len);
-  if (array == NULL) {
-#ifndef OSIP_MONOTHREAD
-    osip_mutex_unlock (osip->nict_fastmutex);
-#endif
-    return OSIP_NOMEM;          /* OSIP_SUCCESS; */
-  }
-  transaction = (osip_transaction_t *) osip_list_get_first (&osip->osip_nict_transactions, &iterator);
-  while (osip_list_iterator_has_elem (iterator)) {
-    array[index++] = transaction;
-    transaction = (osip_transaction_t *) osip_list_get_next (&iterator);
-  }
-#ifndef OSIP_MONOTHREAD
-  osip_mutex_unlock (osip->nict_fastmutex);
-#endif
-
-  for (index = 0; index < len; ++index) {
-    transaction = (osip_transaction_t *) array[index];
-    more_event = 1;
-    do {
-      se = (osip_event_t *) osip_fifo_tryget (transaction->transactionff);
-      if (se == NULL)           /* no more event for this transaction */
-        more_event = 0;
-      else
-        osip_transaction_execute (transaction, se);
-    }
-    while (more_event == 1);
-  }
-
-  osip_free (array);
-
-  return OSIP_SUCCESS;
+  return __osip_ready_queue_execute (&osip->nict_ready, osip->nict_fastmutex);
 }
 
 int
 osip_nist_execute (osip_t * osip)
 {
-  osip_transaction_t *transaction;
-  osip_event_t *se;
-  int more_event;
-  osip_list_iterator_t iterator;
-  void **array;
-  int len;
-  int index = 0;
-
-  /* list must be copied because osip_transaction_execute() may change it */
-#ifndef OSIP_MONOTHREAD
-  osip_mutex_lock (osip->nist_fastmutex);
-#endif
-  len = osip_list_size (&osip->osip_nist_transactions);
-  if (0 >= len) {
-#ifndef OSIP_MONOTHREAD
-    osip_mutex_unlock (osip->nist_fastmutex);
-#endif
-    return OSIP_SUCCESS;
-  }
-  array = osip_malloc (sizeof (void *) * len);
-  if (array == NULL) {
-#ifndef OSIP_MONOTHREAD
-    osip_mutex_unlock (osip->nist_fastmutex);
-#endif
-    return OSIP_NOMEM;          /* OSIP_SUCCESS; */
-  }
-  transaction = (osip_transaction_t *) osip_list_get_first (&osip->osip_nist_transactions, &iterator);
-  while (osip_list_iterator_has_elem (iterator)) {
-    array[index++] = transaction;
-    transaction = (osip_transaction_t *) osip_list_get_next (&iterator);
-  }
-#ifndef OSIP_MONOTHREAD
-  osip_mutex_unlock (osip->nist_fastmutex);
-#endif
-
-  for (index = 0; index < len; ++index) {
-    transaction = (osip_transaction_t *) array[index];
-    more_event = 1;
-    do {
-      se = (osip_event_t *) osip_fifo_tryget (transaction->transactionff);
-      if (se == NULL)           /* no more event for this transaction */
-        more_event = 0;
-      else
-        osip_transaction_execute (transaction, se);
-    }
-    while (more_event == 1);
-  }
-
-  osip_free (array);
-
-  return OSIP_SUCCESS;
+  return __osip_ready_queue_execute (&osip->nist_ready, osip->nist_fastmutex);
 }
 
 void
@@ -1429,6 +1371,14 @@ osip_timers_gettimeout (osip_t * osip, struct timeval *lower_tv)
   return;
 }
 
+/* queue a timer event: a timeout that cannot be queued fires on a later tick */
+static void
+__osip_timers_add_event (osip_t * osip, osip_transaction_t * tr, osip_event_t * evt)
+{
+  if (__osip_transaction_add_event (osip, tr, evt, 1) != OSIP_SUCCESS)
+    osip_event_free (evt);
+}
+
 void
 osip_timers_ict_execute (osip_t * osip)
 {
@@ -1449,15 +1399,15 @@ osip_timers_ict_execute (osip_t * osip)
     else {
       evt = __osip_ict_need_timer_b_event (tr->ict_context, tr->state, tr->transactionid);
       if (evt != NULL)
-        osip_fifo_add (tr->transactionff, evt);
+        __osip_timers_add_event (osip, tr, evt);
       else {
         evt = __osip_ict_need_timer_a_event (tr->ict_context, tr->state, tr->transactionid);
         if (evt != NULL)
-          osip_fifo_add (tr->transactionff, evt);
+          __osip_timers_add_event (osip, tr, evt);
         else {
           evt = __osip_ict_need_timer_d_event (tr->ict_context, tr->state, tr->transactionid);
           if (evt != NULL)
-            osip_fifo_add (tr->transactionff, evt);
+            __osip_timers_add_event (osip, tr, evt);
         }
       }
     }
@@ -1484,15 +1434,15 @@ osip_timers_ist_execute (osip_t * osip)
 
     evt = __osip_ist_need_timer_i_event (tr->ist_context, tr->state, tr->transactionid);
     if (evt != NULL)
-      osip_fifo_add (tr->transactionff, evt);
+      __osip_timers_add_event (osip, tr, evt);
     else {
       evt = __osip_ist_need_timer_h_event (tr->ist_context, tr->state, tr->transactionid);
       if (evt != NULL)
-        osip_fifo_add (tr->transactionff, evt);
+        __osip_timers_add_event (osip, tr, evt);
       else {
         evt = __osip_ist_need_timer_g_event (tr->ist_context, tr->state, tr->transactionid);
         if (evt != NULL)
-          osip_fifo_add (tr->transactionff, evt);
+          __osip_timers_add_event (osip, tr, evt);
       }
     }
     tr = (osip_transaction_t *) osip_list_get_next (&iterator);
@@ -1518,15 +1468,15 @@ osip_timers_nict_execute (osip_t * osip)
 
     evt = __osip_nict_need_timer_k_event (tr->nict_context, tr->state, tr->transactionid);
     if (evt != NULL)
-      osip_fifo_add (tr->transactionff, evt);
+      __osip_timers_add_event (osip, tr, evt);
     else {
       evt = __osip_nict_need_timer_f_event (tr->nict_context, tr->state, tr->transactionid);
       if (evt != NULL)
-        osip_fifo_add (tr->transactionff, evt);
+        __osip_timers_add_event (osip, tr, evt);
       else {
         evt = __osip_nict_need_timer_e_event (tr->nict_context, tr->state, tr->transactionid);
         if (evt != NULL)
-          osip_fifo_add (tr->transactionff, evt);
+          __osip_timers_add_event (osip, tr, evt);
       }
     }
     tr = (osip_transaction_t *) osip_list_get_next (&iterator);
@@ -1553,7 +1503,7 @@ osip_timers_nist_execute (osip_t * osip)
 
     evt = __osip_nist_need_timer_j_event (tr->nist_context, tr->state, tr->transactionid);
     if (evt != NULL)
-      osip_fifo_add (tr->transactionff, evt);
+      __osip_timers_add_event (osip, tr, evt);
     tr = (osip_transaction_t *) osip_list_get_next (&iterator);
   }
 #ifndef OSIP_MONOTHREAD
@@ -1644,3 +1594,195 @@ osip_set_transport_error_callback (osip_t * config, int type, osip_transport_err
   config->tp_error_callbacks[type] = cb;
   return OSIP_SUCCESS;
 }
+
+int
+osip_set_adaptive_t1 (osip_t * osip, int t1_min, int t1_max)
+{
+  if (osip == NULL || t1_min < 0 || t1_max < 0)
+    return OSIP_BADPARAMETER;
+  if (t1_max > 0 && (t1_min < 1 || t1_max < t1_min))
+    return OSIP_BADPARAMETER;
+
+  if (t1_max > 0 && osip->peer_rtt == NULL) {
+    osip->peer_rtt = (struct osip_peer_rtt *) osip_malloc (OSIP_PEER_RTT_SETS * OSIP_PEER_RTT_WAYS * sizeof (struct osip_peer_rtt));
+    if (osip->peer_rtt == NULL)
+      return OSIP_NOMEM;
+    memset (osip->peer_rtt, 0, OSIP_PEER_RTT_SETS * OSIP_PEER_RTT_WAYS * sizeof (struct osip_peer_rtt));
+  }
+  osip->t1_min = t1_min;
+  osip->t1_max = t1_max;
+  return OSIP_SUCCESS;
+}
+
+/* entry of a destination in its set of the table, or the least recently
+   measured entry of the set (reset) when create is 1. */
+static struct osip_peer_rtt *
+__osip_peer_rtt_find (osip_t * osip, const char *host, int port, int create)
+{
+  struct osip_peer_rtt *set;
+  struct osip_peer_rtt *lru;
+  unsigned int hash = 2166136261U;
+  const char *p;
+  int way;
+
+  for (p = host; *p != '\0'; p++)
+    hash = (hash ^ (unsigned char) *p) * 16777619U;
+  hash = (hash ^ (unsigned int) port) * 16777619U;
+
+  set = &osip->peer_rtt[(hash % OSIP_PEER_RTT_SETS) * OSIP_PEER_RTT_WAYS];
+  lru = set;
+  for (way = 0; way < OSIP_PEER_RTT_WAYS; way++) {
+    if (set[way].host[0] != '\0' && set[way].hash == hash && set[way].port == port && strcmp (set[way].host, host) == 0)
+      return &set[way];
+    if (lru->host[0] != '\0' && (set[way].host[0] == '\0' || osip_timercmp (&set[way].last, &lru->last, <)))
+      lru = &set[way];
+  }
+  if (create == 0)
+    return NULL;
+
+  memset (lru, 0, sizeof (struct osip_peer_rtt));
+  osip_strncpy (lru->host, host, sizeof (lru->host) - 1);
+  lru->port = port;
+  lru->hash = hash;
+  lru->srtt = -1;
+  return lru;
+}
+
+int
+osip_get_peer_t1 (osip_t * osip, const char *host, int port)
+{
+  struct osip_peer_rtt *peer;
+  int t1 = DEFAULT_T1;
+
+  if (osip == NULL || host == NULL || osip->t1_max <= 0 || osip->peer_rtt == NULL)
+    return DEFAULT_T1;
+
+#ifndef OSIP_MONOTHREAD
+  osip_mutex_lock (osip->peer_rtt_mutex);
+#endif
+  peer = __osip_peer_rtt_find (osip, host, port, 0);
+  if (peer != NULL) {
+    /* RTO of RFC6298, doubled for each ambiguous sample (Karn) */
+    if (peer->srtt >= 0) {
+      t1 = peer->srtt + 4 * peer->rttvar;
+      if (t1 < osip->t1_min)
+        t1 = osip->t1_min;
+    }
+    if (t1 < 1)
+      t1 = 1;
+    t1 <<= peer->backoff;
+    if (t1 > osip->t1_max)
+      t1 = osip->t1_max;
+  }
+#ifndef OSIP_MONOTHREAD
+  osip_mutex_unlock (osip->peer_rtt_mutex);
+#endif
+  return t1;
+}
+
+static int
+__osip_transaction_is_unreliable (osip_transaction_t * tr)
+{
+  char *proto;
+
+  if (tr->topvia == NULL)
+    return 0;
+  proto = via_get_protocol (tr->topvia);
+  if (proto == NULL)
+    return 0;
+  return (osip_strcasecmp (proto, "TCP") != 0 && osip_strcasecmp (proto, "TLS") != 0 && osip_strcasecmp (proto, "SCTP") != 0);
+}
+
+void
+__osip_transaction_rtt_start (osip_transaction_t * tr, int *timer_length, struct timeval *timer_start)
+{
+  osip_t *osip = (osip_t *) tr->config;
+  char *host = NULL;
+  int port = 0;
+  int t1;
+
+  tr->rtt_start.tv_sec = -1;
+  tr->rtt_retransmitted = 0;
+  if (osip == NULL || osip->t1_max <= 0 || *timer_length <= 0)
+    return;
+  if (!__osip_transaction_is_unreliable (tr))
+    return;
+
+  if (tr->ctx_type == ICT && tr->ict_context != NULL) {
+    host = tr->ict_context->destination;
+    port = tr->ict_context->port;
+  }
+  else if (tr->ctx_type == NICT && tr->nict_context != NULL) {
+    host = tr->nict_context->destination;
+    port = tr->nict_context->port;
+  }
+  if (host == NULL)
+    return;
+
+  t1 = osip_get_peer_t1 (osip, host, port);
+  if (tr->ctx_type == NICT)
+    tr->nict_context->t1 = t1;
+
+  osip_gettimeofday (&tr->rtt_start, NULL);
+  *timer_length = t1;
+  *timer_start = tr->rtt_start;
+  add_gettimeofday (timer_start, t1);
+}
+
+void
+__osip_transaction_rtt_sample (osip_transaction_t * tr)
+{
+  osip_t *osip = (osip_t *) tr->config;
+  struct osip_peer_rtt *peer;
+  struct timeval now;
+  char *host = NULL;
+  int port = 0;
+  int rtt;
+
+  if (tr->rtt_start.tv_sec == -1)
+    return;
+  osip_gettimeofday (&now, NULL);
+  rtt = (now.tv_sec - tr->rtt_start.tv_sec) * 1000 + (now.tv_usec - tr->rtt_start.tv_usec) / 1000;
+  tr->rtt_start.tv_sec = -1;
+
+  if (osip == NULL || osip->t1_max <= 0 || osip->peer_rtt == NULL || rtt < 0)
+    return;
+
+  if (tr->ctx_type == ICT && tr->ict_context != NULL) {
+    host = tr->ict_context->destination;
+    port = tr->ict_context->port;
+  }
+  else if (tr->ctx_type == NICT && tr->nict_context != NULL) {
+    host = tr->nict_context->destination;
+    port = tr->nict_context->port;
+  }
+  if (host == NULL)
+    return;
+
+#ifndef OSIP_MONOTHREAD
+  osip_mutex_lock (osip->peer_rtt_mutex);
+#endif
+  peer = __osip_peer_rtt_find (osip, host, port, 1);
+  if (tr->rtt_retransmitted) {
+    /* the response may answer any retransmission (Karn): no sample, the
+       next transactions keep the backed off T1 until a valid sample */
+    if (peer->backoff < OSIP_PEER_RTT_MAX_BACKOFF)
+      peer->backoff++;
+  }
+  else if (peer->srtt < 0) {
+    peer->srtt = rtt;
+    peer->rttvar = rtt / 2;
+    peer->backoff = 0;
+  }
+  else {
+    /* RFC6298: alpha=1/8, beta=1/4 */
+    peer->rttvar = (3 * peer->rttvar + abs (peer->srtt - rtt)) / 4;
+    peer->srtt = (7 * peer->srtt + rtt) / 8;
+    peer->backoff = 0;
+  }
+  peer->last = now;
+#ifndef OSIP_MONOTHREAD
+  osip_mutex_unlock (osip->peer_rtt_mutex);
+#endif
+  OSIP_TRACE (osip_trace (__FILE__, __LINE__, OSIP_INFO3, NULL, "rtt to %s:%i: %i ms (srtt=%i rttvar=%i)\n", host, port, rtt, peer->srtt, peer->rttvar));
+}
@@ -151,12 +151,31 @@ osip_dialog_update_tag_as_uac (osip_dialog_t * dialog, osip_message_t * response
   return OSIP_SUCCESS;
 }
 
+/* compare the Call-ID of a dialog with the Call-ID of a message
+   without building the "number@host" string. */
+static int
+__osip_dialog_call_id_match (const char *dlg_call_id, const osip_call_id_t * callid)
+{
+  size_t len;
+
+  if (callid->number == NULL)
+    return OSIP_BADPARAMETER;
+  len = strlen (callid->number);
+  if (0 != strncmp (dlg_call_id, callid->number, len))
+    return OSIP_UNDEFINED_ERROR;
+  dlg_call_id += len;
+  if (callid->host == NULL)
+    return (*dlg_call_id == '\0') ? OSIP_SUCCESS : OSIP_UNDEFINED_ERROR;
+  if (*dlg_call_id != '@' || 0 != strcmp (dlg_call_id + 1, callid->host))
+    return OSIP_UNDEFINED_ERROR;
+  return OSIP_SUCCESS;
+}
+
 int
 osip_dialog_match_as_uac (osip_dialog_t * dlg, osip_message_t * answer)
 {
   osip_generic_param_t *tag_param_local;
   osip_generic_param_t *tag_param_remote;
-  char *tmp;
   int i;
 
   if (dlg == NULL || dlg->call_id == NULL)
@@ -177,16 +196,10 @@ osip_dialog_match_as_uac (osip_dialog_t * dlg, osip_message_t * answer)
      Personnaly, I would recommend to discard 1xx>=101 answers without To tags!
      Just my own feelings.
    */
-  i = osip_call_id_to_str (answer->call_id, &tmp);
+  i = __osip_dialog_call_id_match (dlg->call_id, answer->call_id);
   if (i != 0)
     return i;
 
-  if (0 != strcmp (dlg->call_id, tmp)) {
-    osip_free (tmp);
-    return OSIP_UNDEFINED_ERROR;
-  }
-  osip_free (tmp);
-
   /* for INCOMING RESPONSE:
      To: remote_uri;remote_tag
      From: local_uri;local_tag           <- LOCAL TAG ALWAYS EXIST
@@ -232,21 +245,15 @@ osip_dialog_match_as_uas (osip_dialog_t * dlg, osip_message_t * request)
 {
   osip_generic_param_t *tag_param_remote;
   int i;
-  char *tmp;
 
   if (dlg == NULL || dlg->call_id == NULL)
     return OSIP_BADPARAMETER;
   if (request == NULL || request->call_id == NULL || request->from == NULL || request->to == NULL)
     return OSIP_BADPARAMETER;
 
-  i = osip_call_id_to_str (request->call_id, &tmp);
+  i = __osip_dialog_call_id_match (dlg->call_id, request->call_id);
   if (i != 0)
     return i;
-  if (0 != strcmp (dlg->call_id, tmp)) {
-    osip_free (tmp);
-    return OSIP_UNDEFINED_ERROR;
-  }
-  osip_free (tmp);
 
   /* for INCOMING REQUEST:
      To: local_uri;local_tag           <- LOCAL TAG ALWAYS EXIST
@@ -129,6 +129,7 @@ osip_transaction_init (osip_transaction_t ** transaction, osip_fsm_type_t ctx_ty
   memset (*transaction, 0, sizeof (osip_transaction_t));
 
   (*transaction)->birth_time = osip_getsystemtime (NULL);
+  (*transaction)->rtt_start.tv_sec = -1;
 
   osip_id_mutex_lock (osip);
   (*transaction)->transactionid = osip->transactionid++;
@@ -326,8 +327,9 @@ osip_transaction_add_event (osip_transaction_t * transaction, osip_event_t * evt
   if (transaction == NULL)
     return OSIP_BADPARAMETER;
   evt->transactionid = transaction->transactionid;
-  osip_fifo_add (transaction->transactionff, evt);
-  return OSIP_SUCCESS;
+  if (transaction->config == NULL)
+    return osip_fifo_add (transaction->transactionff, evt);
+  return __osip_transaction_add_event (transaction->config, transaction, evt, 0);
 }
 
 int
@@ -41,11 +41,20 @@ osip_fifo_init (osip_fifo_t * ff)
 int
 osip_fifo_add (osip_fifo_t * ff, void *el)
 {
+  int i;
+
 #ifndef OSIP_MONOTHREAD
   osip_mutex_lock (ff->qislocked);
 #endif
 
-  osip_list_add (&ff->queue, el, -1);   /* insert at end of queue */
+  i = osip_list_add (&ff->queue, el, -1);   /* insert at end of queue */
+  if (i < 0) {
+    /* the element was not added: it still belongs to the caller */
+#ifndef OSIP_MONOTHREAD
+    osip_mutex_unlock (ff->qislocked);
+#endif
+    return i;
+  }
   ff->state = osip_ok;
 
 #ifndef OSIP_MONOTHREAD
@@ -59,11 +68,20 @@ osip_fifo_add (osip_fifo_t * ff, void *el)
 int
 osip_fifo_insert (osip_fifo_t * ff, void *el)
 {
+  int i;
+
 #ifndef OSIP_MONOTHREAD
   osip_mutex_lock (ff->qislocked);
 #endif
 
-  osip_list_add (&ff->queue, el, 0);    /* insert at end of queue */
+  i = osip_list_add (&ff->queue, el, 0);    /* insert at beginning of queue */
+  if (i < 0) {
+    /* the element was not added: it still belongs to the caller */
+#ifndef OSIP_MONOTHREAD
+    osip_mutex_unlock (ff->qislocked);
+#endif
+    return i;
+  }
   ff->state = osip_ok;
 
 #ifndef OSIP_MONOTHREAD
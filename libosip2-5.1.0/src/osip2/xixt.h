@@ -278,6 +278,35 @@ extern "C" {
  */
   int __osip_add_nist (osip_t * osip, osip_transaction_t * nist);
 
+/**
+ * Add an event in the fifo of a transaction and, if needed, append the
+ * transaction to the ready queue of its type.
+ * NOTE: THIS IS AN INTERNAL METHOD ONLY
+ * @param osip The element to work on.
+ * @param tr The transaction.
+ * @param evt The event to add.
+ * @param locked 1 if the fastmutex of the transaction type is already locked.
+ */
+  int __osip_transaction_add_event (osip_t * osip, osip_transaction_t * tr, osip_event_t * evt, int locked);
+
+/**
+ * Start the round trip time measure of a client transaction after the
+ * first transmission of its request and, with the adaptive T1, restart
+ * the retransmission timer with the T1 of the destination.
+ * NOTE: THIS IS AN INTERNAL METHOD ONLY
+ * @param tr The transaction.
+ * @param timer_length The length of timer A or E.
+ * @param timer_start The start time of timer A or E.
+ */
+  void __osip_transaction_rtt_start (osip_transaction_t * tr, int *timer_length, struct timeval *timer_start);
+
+/**
+ * Measure the round trip time of a client transaction on the first response.
+ * NOTE: THIS IS AN INTERNAL METHOD ONLY
+ * @param tr The transaction.
+ */
+  void __osip_transaction_rtt_sample (osip_transaction_t * tr);
+
 /**
  * Remove a ict transaction from the ict list of transaction.
  * @param osip The element to work on.
@@ -66,6 +66,19 @@ osip_message_set_authentication_info (osip_message_t * sip, const char *hvalue)
   return OSIP_SUCCESS;
 }
 
+static const __osip_auth_param_t authentication_info_params[] = {
+  {OSIP_AUTH_PARAM_NEXTNONCE, 1, offsetof (osip_authentication_info_t, nextnonce)},
+  {OSIP_AUTH_PARAM_CNONCE, 1, offsetof (osip_authentication_info_t, cnonce)},
+  {OSIP_AUTH_PARAM_RSPAUTH, 1, offsetof (osip_authentication_info_t, rspauth)},
+  {OSIP_AUTH_PARAM_NC, 0, offsetof (osip_authentication_info_t, nonce_count)},
+  {OSIP_AUTH_PARAM_QOP, 0, offsetof (osip_authentication_info_t, qop_options)},
+  {OSIP_AUTH_PARAM_SNUM, 1, offsetof (osip_authentication_info_t, snum)},
+  {OSIP_AUTH_PARAM_SRAND, 1, offsetof (osip_authentication_info_t, srand)},
+  {OSIP_AUTH_PARAM_TARGETNAME, 1, offsetof (osip_authentication_info_t, targetname)},
+  {OSIP_AUTH_PARAM_REALM, 1, offsetof (osip_authentication_info_t, realm)},
+  {OSIP_AUTH_PARAM_OPAQUE, 1, offsetof (osip_authentication_info_t, opaque)}
+};
+
 /* fills the authentication_info strucuture.                      */
 /* INPUT : char *hvalue | value of header.         */
 /* OUTPUT: osip_message_t *sip | structure to save results. */
@@ -78,8 +91,6 @@ int
 osip_authentication_info_parse (osip_authentication_info_t * ainfo, const char *hvalue)
 {
   const char *space, *hack;
-  const char *next = NULL;
-  int i;
 
   space = strchr (hvalue, ' ');
   hack = strchr (hvalue, '=');
@@ -92,128 +103,7 @@ osip_authentication_info_parse (osip_authentication_info_t * ainfo, const char *
   else
     space = hvalue;
 
-  for (;;) {
-    int parse_ok = 0;
-
-    i = __osip_quoted_string_set ("nextnonce", space, &(ainfo->nextnonce), &next);
-    if (i != 0)
-      return i;
-    if (next == NULL)
-      return OSIP_SUCCESS;      /* end of header detected! */
-    else if (next != space) {
-      space = next;
-      parse_ok++;
-    }
-    i = __osip_quoted_string_set ("cnonce", space, &(ainfo->cnonce), &next);
-    if (i != 0)
-      return i;
-    if (next == NULL)
-      return OSIP_SUCCESS;      /* end of header detected! */
-    else if (next != space) {
-      space = next;
-      parse_ok++;
-    }
-    i = __osip_quoted_string_set ("rspauth", space, &(ainfo->rspauth), &next);
-    if (i != 0)
-      return i;
-    if (next == NULL)
-      return OSIP_SUCCESS;      /* end of header detected! */
-    else if (next != space) {
-      space = next;
-      parse_ok++;
-    }
-    i = __osip_token_set ("nc", space, &(ainfo->nonce_count), &next);
-    if (i != 0)
-      return i;
-    if (next == NULL)
-      return OSIP_SUCCESS;      /* end of header detected! */
-    else if (next != space) {
-      space = next;
-      parse_ok++;
-    }
-    i = __osip_token_set ("qop", space, &(ainfo->qop_options), &next);
-    if (i != 0)
-      return i;
-    if (next == NULL)
-      return OSIP_SUCCESS;      /* end of header detected! */
-    else if (next != space) {
-      space = next;
-      parse_ok++;
-    }
-    i = __osip_quoted_string_set ("snum", space, &(ainfo->snum), &next);
-    if (i != 0)
-      return i;
-    if (next == NULL)
-      return OSIP_SUCCESS;      /* end of header detected! */
-    else if (next != space) {
-      space = next;
-      parse_ok++;
-    }
-    i = __osip_quoted_string_set ("srand", space, &(ainfo->srand), &next);
-    if (i != 0)
-      return i;
-    if (next == NULL)
-      return OSIP_SUCCESS;      /* end of header detected! */
-    else if (next != space) {
-      space = next;
-      parse_ok++;
-    }
-    i = __osip_quoted_string_set ("targetname", space, &(ainfo->targetname), &next);
-    if (i != 0)
-      return i;
-    if (next == NULL)
-      return OSIP_SUCCESS;      /* end of header detected! */
-    else if (next != space) {
-      space = next;
-      parse_ok++;
-    }
-    i = __osip_quoted_string_set ("realm", space, &(ainfo->realm), &next);
-    if (i != 0)
-      return i;
-    if (next == NULL)
-      return OSIP_SUCCESS;      /* end of header detected! */
-    else if (next != space) {
-      space = next;
-      parse_ok++;
-    }
-    i = __osip_quoted_string_set ("opaque", space, &(ainfo->opaque), &next);
-    if (i != 0)
-      return i;
-    if (next == NULL)
-      return OSIP_SUCCESS;      /* end of header detected! */
-    else if (next != space) {
-      space = next;
-      parse_ok++;
-    }
-    if (0 == parse_ok) {
-      const char *quote1, *quote2, *tmp;
-
-      /* CAUTION */
-      /* parameter not understood!!! I'm too lazy to handle IT */
-      /* let's simply bypass it */
-      if (strlen (space) < 1)
-        return OSIP_SUCCESS;
-      tmp = strchr (space + 1, ',');
-      if (tmp == NULL)          /* it was the last header */
-        return OSIP_SUCCESS;
-      quote1 = __osip_quote_find (space);
-      if ((quote1 != NULL) && (quote1 < tmp)) { /* this may be a quoted string! */
-        quote2 = __osip_quote_find (quote1 + 1);
-        if (quote2 == NULL)
-          return OSIP_SYNTAXERROR;      /* bad header format... */
-        if (tmp < quote2)       /* the comma is inside the quotes! */
-          space = strchr (quote2, ',');
-        else
-          space = tmp;
-        if (space == NULL)      /* it was the last header */
-          return OSIP_SUCCESS;
-      }
-      else
-        space = tmp;
-      /* continue parsing... */
-    }
-  }
-  return OSIP_SUCCESS;          /* ok */
+  return __osip_auth_params_parse (ainfo, authentication_info_params, sizeof (authentication_info_params) / sizeof (authentication_info_params[0]), space);
 }
 
 /* returns the authentication_info header.            */
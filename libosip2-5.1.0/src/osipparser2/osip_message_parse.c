@@ -24,10 +24,108 @@
 #include "parser.h"
 
 static void osip_util_replace_all_lws (char *sip_message);
-static int osip_message_set__header (osip_message_t * sip, const char *hname, const char *hvalue);
+static int osip_message_set__header (osip_message_t * sip, const __osip_message_config_t * config, const char *hname, const char *hvalue);
 static int msg_headers_parse (osip_message_t * sip, const char *start_of_header, const char **body);
 static int msg_osip_body_parse (osip_message_t * sip, const char *start_of_buf, const char **next_body, size_t length);
 
+/* Delimiter scanning:
+   __osip_scan_chars (str, accept) returns a pointer to the first char of
+   str that is either '\0' or one of the (up to 4) chars of accept. This is
+   strcspn() for a small set of delimiters: x86 CPUs use 16 (SSE2) or 32
+   (AVX2) bytes strides, the best kernel being selected on first use. Loads
+   are aligned so that they never cross a page boundary. */
+
+#if !defined(OSIP_NO_SIMD) && !defined(__SANITIZE_ADDRESS__) && defined(__GNUC__) && (defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__)))
+#define OSIP_SCAN_SSE2
+#include <stdint.h>
+#include <emmintrin.h>
+#if defined(__clang__) || (__GNUC__ > 4) || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)
+#define OSIP_SCAN_AVX2
+#include <immintrin.h>
+#endif
+#endif
+
+typedef const char *(*__osip_scan_chars_t) (const char *str, const char *accept);
+
+static const char *
+__osip_scan_chars_c (const char *str, const char *accept)
+{
+  return str + strcspn (str, accept);
+}
+
+#ifdef OSIP_SCAN_SSE2
+static const char *
+__osip_scan_chars_sse2 (const char *str, const char *accept)
+{
+  const char *p = (const char *) ((uintptr_t) str & ~(uintptr_t) 15);
+  __m128i c0 = _mm_set1_epi8 (accept[0]);
+  __m128i c1 = _mm_set1_epi8 (accept[1] ? accept[1] : accept[0]);
+  __m128i c2 = _mm_set1_epi8 (accept[1] && accept[2] ? accept[2] : accept[0]);
+  __m128i c3 = _mm_set1_epi8 (accept[1] && accept[2] && accept[3] ? accept[3] : accept[0]);
+  __m128i zero = _mm_setzero_si128 ();
+  __m128i v;
+  unsigned int mask;
+
+  v = _mm_load_si128 ((const __m128i *) p);
+  mask = _mm_movemask_epi8 (_mm_or_si128 (_mm_or_si128 (_mm_cmpeq_epi8 (v, zero), _mm_cmpeq_epi8 (v, c0)), _mm_or_si128 (_mm_or_si128 (_mm_cmpeq_epi8 (v, c1), _mm_cmpeq_epi8 (v, c2)), _mm_cmpeq_epi8 (v, c3))));
+  mask &= 0xffffU << (str - p);
+  while (mask == 0) {
+    p += 16;
+    v = _mm_load_si128 ((const __m128i *) p);
+    mask = _mm_movemask_epi8 (_mm_or_si128 (_mm_or_si128 (_mm_cmpeq_epi8 (v, zero), _mm_cmpeq_epi8 (v, c0)), _mm_or_si128 (_mm_or_si128 (_mm_cmpeq_epi8 (v, c1), _mm_cmpeq_epi8 (v, c2)), _mm_cmpeq_epi8 (v, c3))));
+  }
+  return p + __builtin_ctz (mask);
+}
+#endif
+
+#ifdef OSIP_SCAN_AVX2
+__attribute__ ((target ("avx2")))
+static const char *
+__osip_scan_chars_avx2 (const char *str, const char *accept)
+{
+  const char *p = (const char *) ((uintptr_t) str & ~(uintptr_t) 31);
+  __m256i c0 = _mm256_set1_epi8 (accept[0]);
+  __m256i c1 = _mm256_set1_epi8 (accept[1] ? accept[1] : accept[0]);
+  __m256i c2 = _mm256_set1_epi8 (accept[1] && accept[2] ? accept[2] : accept[0]);
+  __m256i c3 = _mm256_set1_epi8 (accept[1] && accept[2] && accept[3] ? accept[3] : accept[0]);
+  __m256i zero = _mm256_setzero_si256 ();
+  __m256i v;
+  unsigned int mask;
+
+  v = _mm256_load_si256 ((const __m256i *) p);
+  mask = (unsigned int) _mm256_movemask_epi8 (_mm256_or_si256 (_mm256_or_si256 (_mm256_cmpeq_epi8 (v, zero), _mm256_cmpeq_epi8 (v, c0)), _mm256_or_si256 (_mm256_or_si256 (_mm256_cmpeq_epi8 (v, c1), _mm256_cmpeq_epi8 (v, c2)), _mm256_cmpeq_epi8 (v, c3))));
+  mask &= 0xffffffffU << (str - p);
+  while (mask == 0) {
+    p += 32;
+    v = _mm256_load_si256 ((const __m256i *) p);
+    mask = (unsigned int) _mm256_movemask_epi8 (_mm256_or_si256 (_mm256_or_si256 (_mm256_cmpeq_epi8 (v, zero), _mm256_cmpeq_epi8 (v, c0)), _mm256_or_si256 (_mm256_or_si256 (_mm256_cmpeq_epi8 (v, c1), _mm256_cmpeq_epi8 (v, c2)), _mm256_cmpeq_epi8 (v, c3))));
+  }
+  return p + __builtin_ctz (mask);
+}
+#endif
+
+static const char *__osip_scan_chars_init (const char *str, const char *accept);
+
+static __osip_scan_chars_t __osip_scan_chars = &__osip_scan_chars_init;
+
+/* selects the kernel on first use: concurrent calls would store the same value */
+static const char *
+__osip_scan_chars_init (const char *str, const char *accept)
+{
+  __osip_scan_chars_t scan = &__osip_scan_chars_c;
+
+#ifdef OSIP_SCAN_SSE2
+  scan = &__osip_scan_chars_sse2;
+#endif
+#ifdef OSIP_SCAN_AVX2
+  __builtin_cpu_init ();
+  if (__builtin_cpu_supports ("avx2"))
+    scan = &__osip_scan_chars_avx2;
+#endif
+  __osip_scan_chars = scan;
+  return scan (str, accept);
+}
+
 
 static int
 __osip_message_startline_parsereq (osip_message_t * dest, const char *buf, const char **headers)
@@ -292,7 +390,9 @@ osip_util_replace_all_lws (char *sip_message)
   /* end_of_message = sip_message + strlen (sip_message); */
 
   tmp = sip_message;
-  for (; tmp[0] != '\0'; tmp++) {
+  for (;; tmp++) {
+    /* LWS and end of headers always start with CR or LF */
+    tmp = (char *) __osip_scan_chars (tmp, "\r\n");
     if (('\0' == tmp[0])
         || ('\0' == tmp[1]) || ('\0' == tmp[2]) || ('\0' == tmp[3]))
       return;
@@ -328,13 +428,10 @@ __osip_find_next_crlf (const char *start_of_header, const char **end_of_header)
 
   *end_of_header = NULL;        /* AMD fix */
 
-  while (('\r' != *soh) && ('\n' != *soh)) {
-    if (*soh)
-      soh++;
-    else {
-      OSIP_TRACE (osip_trace (__FILE__, __LINE__, OSIP_ERROR, NULL, "Final CRLF is missing\n"));
-      return OSIP_SYNTAXERROR;
-    }
+  soh = __osip_scan_chars (soh, "\r\n");
+  if (*soh == '\0') {
+    OSIP_TRACE (osip_trace (__FILE__, __LINE__, OSIP_ERROR, NULL, "Final CRLF is missing\n"));
+    return OSIP_SYNTAXERROR;
   }
 
   if (('\r' == soh[0]) && ('\n' == soh[1]))
@@ -395,20 +492,17 @@ __osip_find_next_crlfcrlf (const char *start_of_part, const char **end_of_part)
 }
 
 static int
-osip_message_set__header (osip_message_t * sip, const char *hname, const char *hvalue)
+osip_message_set__header (osip_message_t * sip, const __osip_message_config_t * config, const char *hname, const char *hvalue)
 {
-  int my_index;
-
   if (hname == NULL)
     return OSIP_SYNTAXERROR;
 
   /* some headers are analysed completely      */
   /* this method is used for selective parsing */
-  my_index = __osip_message_is_known_header (hname);
-  if (my_index >= 0) {          /* ok */
+  if (config != NULL && config->setheader != NULL) {    /* ok */
     int ret;
 
-    ret = __osip_message_call_method (my_index, sip, hvalue);
+    ret = __osip_message_call_method (config, sip, hvalue);
     if (ret != 0)
       return ret;
     return OSIP_SUCCESS;
@@ -431,12 +525,15 @@ osip_message_set_multiple_header (osip_message_t * sip, char *hname, char *hvalu
   char *beg;                    /* beg of a header */
   char *end;                    /* end of a header */
   int inquotes, inuri;          /* state for inside/outside of double-qoutes or URI */
+  const __osip_message_config_t *config;
 
-  /* Find header based upon lowercase comparison */
-  osip_tolower (hname);
+  /* Find header based upon case insensitive comparison */
+  config = __osip_message_get_config (hname);
+  if (config == NULL || config->setheader == NULL)
+    osip_tolower (hname);       /* unknown headers are stored in lowercase */
 
   if (hvalue == NULL) {
-    i = osip_message_set__header (sip, hname, hvalue);
+    i = osip_message_set__header (sip, config, hname, hvalue);
     if (i != 0)
       return i;
     return OSIP_SUCCESS;
@@ -450,8 +547,8 @@ osip_message_set_multiple_header (osip_message_t * sip, char *hname, char *hvalu
      header  =  "header-name" HCOLON header-value *(COMMA header-value)
      We cannot guess for any other headers and thus, we will handle other headers as one header.
    */
-  if (comma == NULL || __osip_message_is_header_comma_separated (hname) != OSIP_SUCCESS) {
-    i = osip_message_set__header (sip, hname, hvalue);
+  if (comma == NULL || __osip_message_is_header_comma_separated (config, hname) != OSIP_SUCCESS) {
+    i = osip_message_set__header (sip, config, hname, hvalue);
     if (i != 0)
       return i;
     return OSIP_SUCCESS;
@@ -462,6 +559,7 @@ osip_message_set_multiple_header (osip_message_t * sip, char *hname, char *hvalu
   inuri = 0;
   /* Seach for a comma that is not within quotes or a URI */
   for (;; ptr++) {
+    ptr = (char *) __osip_scan_chars (ptr, "\"<>,");
     switch (*ptr) {
     case '"':
       /* Check that the '"' is not escaped */
@@ -515,7 +613,7 @@ osip_message_set_multiple_header (osip_message_t * sip, char *hname, char *hvalu
           return OSIP_NOMEM;
         osip_clrncpy (avalue, beg, end - beg);
         /* really store the header in the sip structure */
-        i = osip_message_set__header (sip, hname, avalue);
+        i = osip_message_set__header (sip, config, hname, avalue);
         osip_free (avalue);
         if (i != 0)
           return i;
@@ -19,15 +19,78 @@
 
 #include <osipparser2/internal.h>
 
+#include <stddef.h>
+
 #include <osipparser2/osip_port.h>
 #include <osipparser2/osip_parser.h>
 
+#if defined(WIN32) || defined(_WIN32_WCE)
+#include <windows.h>            /* InterlockedIncrement */
+#endif
+
 #define MIME_MAX_BOUNDARY_LEN 70
 
 extern const char *osip_protocol_version;
 
-static int strcat_simple_header (char **_string, size_t * malloc_size, char **_message, void *ptr_header, char *header_name, size_t size_of_header, int (*xxx_to_str) (void *, char **), char **next);
-static int strcat_headers_one_per_line (char **_string, size_t * malloc_size, char **_message, osip_list_t * headers, char *header, size_t size_of_header, int (*xxx_to_str) (void *, char **), char **next);
+
+/* One line of the serialized message: "name", then "value", then CRLF.
+   The value is either borrowed from the header structure or owned by
+   the fragment (allocated by one of the osip_xxx_to_str() methods). */
+typedef struct {
+  const char *name;
+  size_t name_length;
+  const char *value;
+  size_t value_length;
+  char *allocated;
+  int generic;                  /* name is a raw hname: capitalize and append ": " */
+} __osip_fragment_t;
+
+#define OSIP_FRAGMENT_STACK_SIZE 48
+
+struct __osip_to_str_table {
+  const char *header_name;
+  size_t header_length;
+  size_t offset;                /* offset of the header in osip_message_t */
+  int is_list;
+  int (*to_str) (void *, char **);
+};
+
+#define HLIST(name, field, f) { name, sizeof (name) - 1, offsetof (osip_message_t, field), 1, (int (*)(void *, char **)) &f }
+#define HSIMPLE(name, field, f) { name, sizeof (name) - 1, offsetof (osip_message_t, field), 0, (int (*)(void *, char **)) &f }
+
+/* headers are written in this order, before the unknown headers. */
+static const struct __osip_to_str_table to_str_table[] = {
+  HLIST ("Via: ", vias, osip_via_to_str),
+  HLIST ("Record-Route: ", record_routes, osip_record_route_to_str),
+  HLIST ("Route: ", routes, osip_route_to_str),
+  HSIMPLE ("From: ", from, osip_from_to_str),
+  HSIMPLE ("To: ", to, osip_to_to_str),
+  HSIMPLE ("Call-ID: ", call_id, osip_call_id_to_str),
+  HSIMPLE ("CSeq: ", cseq, osip_cseq_to_str),
+  HLIST ("Contact: ", contacts, osip_contact_to_str),
+  HLIST ("Authorization: ", authorizations, osip_authorization_to_str),
+  HLIST ("WWW-Authenticate: ", www_authenticates, osip_www_authenticate_to_str),
+  HLIST ("Proxy-Authenticate: ", proxy_authenticates, osip_www_authenticate_to_str),
+  HLIST ("Proxy-Authorization: ", proxy_authorizations, osip_authorization_to_str),
+  HLIST ("Call-Info: ", call_infos, osip_call_info_to_str),
+  HSIMPLE ("Content-Type: ", content_type, osip_content_type_to_str),
+  HSIMPLE ("Mime-Version: ", mime_version, osip_content_length_to_str),
+#ifndef MINISIZE
+  HLIST ("Allow: ", allows, osip_allow_to_str),
+  HLIST ("Content-Encoding: ", content_encodings, osip_content_encoding_to_str),
+  HLIST ("Alert-Info: ", alert_infos, osip_call_info_to_str),
+  HLIST ("Error-Info: ", error_infos, osip_call_info_to_str),
+  HLIST ("Accept: ", accepts, osip_accept_to_str),
+  HLIST ("Accept-Encoding: ", accept_encodings, osip_accept_encoding_to_str),
+  HLIST ("Accept-Language: ", accept_languages, osip_accept_language_to_str),
+  HLIST ("Authentication-Info: ", authentication_infos, osip_authentication_info_to_str),
+  HLIST ("Proxy-Authentication-Info: ", proxy_authentication_infos, osip_authentication_info_to_str),
+  HLIST ("SecurityInfo: ", securityinfos, osip_securityinfo_to_str),
+  HLIST ("Note: ", notes, osip_note_to_str),
+#endif
+  {NULL, 0, 0, 0, NULL}
+};
+
 
 
 static int
@@ -151,134 +214,130 @@ osip_message_get_uri (const osip_message_t * sip)
   return sip->req_uri;
 }
 
+
+static void
+__osip_fragments_free (__osip_fragment_t * fragments, int nb_fragments)
+{
+  int pos;
+
+  for (pos = 0; pos < nb_fragments; pos++)
+    osip_free (fragments[pos].allocated);
+}
+
+/* serialize one known header into a fragment; the name is not copied. */
 static int
-strcat_simple_header (char **_string, size_t * malloc_size, char **_message, void *ptr_header, char *header_name, size_t size_of_header, int (*xxx_to_str) (void *, char **), char **next)
+__osip_fragment_set (__osip_fragment_t * fragment, const struct __osip_to_str_table *entry, void *header)
 {
-  char *string;
-  char *message;
-  char *tmp;
   int i;
 
-  string = *_string;
-  message = *_message;
-
-  if (ptr_header != NULL) {
-    if (*malloc_size < message - string + 100 + size_of_header)
-      /* take some memory avoid to osip_realloc too much often */
-    {                           /* should not happen often */
-      size_t size = message - string;
-
-      *malloc_size = message - string + size_of_header + 100;
-      string = osip_realloc (string, *malloc_size);
-      if (string == NULL) {
-        osip_free (*_string);   /* pointer for string */
-        *_string = NULL;
-        *_message = NULL;
-        return OSIP_NOMEM;
-      }
-      *_string = string;
-      message = string + size;
-    }
-    message = osip_strn_append (message, header_name, size_of_header);
-
-    i = xxx_to_str (ptr_header, &tmp);
-    if (i != 0) {
-      *_string = string;
-      *_message = message;
-      *next = NULL;
+  fragment->name = entry->header_name;
+  fragment->name_length = entry->header_length;
+  fragment->generic = 0;
+  fragment->allocated = NULL;
+  if (entry->to_str == (int (*)(void *, char **)) &osip_content_length_to_str) {
+    /* Mime-Version: borrow the value instead of duplicating it */
+    fragment->value = ((osip_content_length_t *) header)->value;
+    if (fragment->value == NULL)
+      return OSIP_BADPARAMETER;
+  }
+  else {
+    i = entry->to_str (header, &fragment->allocated);
+    if (i != 0)
       return i;
-    }
-    if (*malloc_size < message - string + strlen (tmp) + 100) {
-      size_t size = message - string;
-
-      *malloc_size = message - string + strlen (tmp) + 100;
-      string = osip_realloc (string, *malloc_size);
-      if (string == NULL) {
-        osip_free (*_string);   /* pointer for string */
-        *_string = NULL;
-        *_message = NULL;
-        return OSIP_NOMEM;
-      }
-      *_string = string;
-      message = string + size;
-    }
-
-    message = osip_str_append (message, tmp);
-    osip_free (tmp);
-    message = osip_strn_append (message, OSIP_CRLF, 2);
+    fragment->value = fragment->allocated;
   }
-  *_string = string;
-  *_message = message;
-  *next = message;
+  fragment->value_length = strlen (fragment->value);
   return OSIP_SUCCESS;
 }
 
 static int
-strcat_headers_one_per_line (char **_string, size_t * malloc_size, char **_message, osip_list_t * headers, char *header, size_t size_of_header, int (*xxx_to_str) (void *, char **), char **next)
+__osip_message_count_headers (const osip_message_t * sip)
 {
-  char *string;
-  char *message;
-  char *tmp;
-  int i;
-  osip_list_iterator_t it;
-  void *elt = osip_list_get_first (headers, &it);
-
-  string = *_string;
-  message = *_message;
+  const struct __osip_to_str_table *entry;
+  int count = osip_list_size (&sip->headers);
+
+  for (entry = to_str_table; entry->header_name != NULL; entry++) {
+    if (entry->is_list)
+      count += osip_list_size ((const osip_list_t *) ((const char *) sip + entry->offset));
+    else
+      count++;
+  }
+  return count;
+}
 
-  while (elt != OSIP_SUCCESS) {
+/* collect every header line of the message, in wire order. */
+static int
+__osip_message_get_fragments (osip_message_t * sip, __osip_fragment_t * fragments, int *nb_fragments)
+{
+  const struct __osip_to_str_table *entry;
+  osip_list_iterator_t it;
+  osip_header_t *header;
+  void *elt;
+  int i;
 
-    if (*malloc_size < message - string + 100 + size_of_header)
-      /* take some memory avoid to osip_realloc too much often */
-    {                           /* should not happen often */
-      size_t size = message - string;
+  *nb_fragments = 0;
+  for (entry = to_str_table; entry->header_name != NULL; entry++) {
+    void *field = (char *) sip + entry->offset;
 
-      *malloc_size = message - string + size_of_header + 100;
-      string = osip_realloc (string, *malloc_size);
-      if (string == NULL) {
-        osip_free (*_string);   /* pointer for string */
-        *_string = NULL;
-        *_message = NULL;
-        return OSIP_NOMEM;
-      }
-      *_string = string;
-      message = string + size;
-    }
-    osip_strncpy (message, header, size_of_header);
-    i = xxx_to_str (elt, &tmp);
-    if (i != 0) {
-      *_string = string;
-      *_message = message;
-      *next = NULL;
-      return i;
+    if (!entry->is_list) {
+      elt = *(void **) field;
+      if (elt == NULL)
+        continue;
+      i = __osip_fragment_set (&fragments[*nb_fragments], entry, elt);
+      if (i != 0)
+        return i;
+      (*nb_fragments)++;
+      continue;
     }
-    message = message + strlen (message);
 
-    if (*malloc_size < message - string + strlen (tmp) + 100) {
-      size_t size = message - string;
-
-      *malloc_size = message - string + strlen (tmp) + 100;
-      string = osip_realloc (string, *malloc_size);
-      if (string == NULL) {
-        osip_free (*_string);   /* pointer for string */
-        *_string = NULL;
-        *_message = NULL;
-        return OSIP_NOMEM;
-      }
-      *_string = string;
-      message = string + size;
+    elt = osip_list_get_first ((osip_list_t *) field, &it);
+    while (elt != OSIP_SUCCESS) {
+      i = __osip_fragment_set (&fragments[*nb_fragments], entry, elt);
+      if (i != 0)
+        return i;
+      (*nb_fragments)++;
+      elt = osip_list_get_next (&it);
     }
-    message = osip_str_append (message, tmp);
-    osip_free (tmp);
-    message = osip_strn_append (message, OSIP_CRLF, 2);
-    elt = osip_list_get_next (&it);
   }
-  *_string = string;
-  *_message = message;
-  *next = message;
+
+  /* unknown headers are written without any intermediate string */
+  header = (osip_header_t *) osip_list_get_first (&sip->headers, &it);
+  while (header != OSIP_SUCCESS) {
+    __osip_fragment_t *fragment = &fragments[*nb_fragments];
+
+    if (header->hname == NULL)
+      return OSIP_BADPARAMETER;
+    fragment->name = header->hname;
+    fragment->name_length = strlen (header->hname);
+    fragment->value = (header->hvalue != NULL) ? header->hvalue : "";
+    fragment->value_length = strlen (fragment->value);
+    fragment->allocated = NULL;
+    fragment->generic = 1;
+    (*nb_fragments)++;
+    header = (osip_header_t *) osip_list_get_next (&it);
+  }
   return OSIP_SUCCESS;
 }
 
+static char *
+__osip_fragment_write (char *message, const __osip_fragment_t * fragment)
+{
+  memcpy (message, fragment->name, fragment->name_length);
+  if (fragment->generic) {
+    if (message[0] >= 'a' && message[0] <= 'z')
+      message[0] = (message[0] - 32);
+    message[fragment->name_length] = ':';
+    message[fragment->name_length + 1] = ' ';
+    message += 2;
+  }
+  message += fragment->name_length;
+  memcpy (message, fragment->value, fragment->value_length);
+  message += fragment->value_length;
+  *message++ = '\r';
+  *message++ = '\n';
+  return message;
+}
+
  /* return values:
     1: structure and buffer "message" are identical.
     2: buffer "message" is not up to date with the structure info (call osip_message_to_str to update it).
@@ -301,40 +360,34 @@ osip_message_force_update (osip_message_t * sip)
   return OSIP_SUCCESS;
 }
 
-static int
-_osip_message_realloc (char **message, char **dest, size_t needed, size_t * malloc_size)
-{
-  size_t size = *message - *dest;
-
-  if (*malloc_size < (size_t) (size + needed + 100)) {
-    *malloc_size = size + needed + 100;
-    *dest = osip_realloc (*dest, *malloc_size);
-    if (*dest == NULL)
-      return OSIP_NOMEM;
-    *message = *dest + size;
-  }
 
-  return OSIP_SUCCESS;
-}
+/* last serial given to a serialized message (see message_serial) */
+static volatile long osip_message_serials = 0;
 
 static int
 _osip_message_to_str (osip_message_t * sip, char **dest, size_t * message_length, int sipfrag)
 {
-  size_t malloc_size;
-  size_t total_length = 0;
-
-  /* Added at SIPit day1 */
-  char *start_of_bodies;
-  char *content_length_to_modify = NULL;
+  __osip_fragment_t stack_fragments[OSIP_FRAGMENT_STACK_SIZE];
+  __osip_fragment_t *fragments = stack_fragments;
+  int nb_fragments = 0;
+  int max_fragments;
+
+  char **body_strs = NULL;
+  size_t *body_lengths = NULL;
+  int nb_bodies = 0;
+
+  char *startline = NULL;
+  size_t startline_length = 0;
+  char boundary[MIME_MAX_BOUNDARY_LEN + 5];
+  size_t boundary_length = 0;
+  char content_length[16];
+  size_t content_length_length = 0;
+  size_t bodies_length = 0;
+  size_t total_length;
 
   char *message;
-  char *next;
-  char *tmp;
   int pos;
   int i;
-  char *boundary = NULL;
-
-  malloc_size = SIP_MESSAGE_MAX_LENGTH;
 
   *dest = NULL;
   if (sip == NULL)
@@ -359,235 +412,34 @@ _osip_message_to_str (osip_message_t * sip, char **dest, size_t * message_length
     }
   }
 
-  message = (char *) osip_malloc (SIP_MESSAGE_MAX_LENGTH);      /* ???? message could be > 4000  */
-  if (message == NULL)
-    return OSIP_NOMEM;
-  *dest = message;
-
-  /* add the first line of message */
-  i = __osip_message_startline_to_str (sip, &tmp);
+  /* first pass: serialize what cannot be written directly and measure
+     the exact size of the message. */
+  i = __osip_message_startline_to_str (sip, &startline);
   if (i != 0) {
-    if (!sipfrag) {
-      osip_free (*dest);
-      *dest = NULL;
-      return i;
-    }
-
     /* A start-line isn't required for message/sipfrag parts. */
+    if (!sipfrag)
+      return i;
+    startline = NULL;
   }
-  else {
-    size_t message_len = strlen (tmp);
+  else
+    startline_length = strlen (startline) + 2;
 
-    if (_osip_message_realloc (&message, dest, message_len + 3, &malloc_size) < 0) {
-      osip_free (tmp);
-      *dest = NULL;
+  max_fragments = __osip_message_count_headers (sip);
+  if (max_fragments > OSIP_FRAGMENT_STACK_SIZE) {
+    fragments = (__osip_fragment_t *) osip_malloc (max_fragments * sizeof (__osip_fragment_t));
+    if (fragments == NULL) {
+      osip_free (startline);
       return OSIP_NOMEM;
     }
-
-    message = osip_str_append (message, tmp);
-    osip_free (tmp);
-    message = osip_strn_append (message, OSIP_CRLF, 2);
   }
 
-  {
-    struct to_str_table {
-      char header_name[30];
-      int header_length;
-      osip_list_t *header_list;
-      void *header_data;
-      int (*to_str) (void *, char **);
-    }
-#ifndef MINISIZE
-    table[27] =
-#else
-    table[16] =
-#endif
-    {
-      {
-      "Via: ", 5, NULL, NULL, (int (*)(void *, char **)) &osip_via_to_str}, {
-      "Record-Route: ", 14, NULL, NULL, (int (*)(void *, char **)) &osip_record_route_to_str}, {
-      "Route: ", 7, NULL, NULL, (int (*)(void *, char **)) &osip_route_to_str}, {
-      "From: ", 6, NULL, NULL, (int (*)(void *, char **)) &osip_from_to_str}, {
-      "To: ", 4, NULL, NULL, (int (*)(void *, char **)) &osip_to_to_str}, {
-      "Call-ID: ", 9, NULL, NULL, (int (*)(void *, char **)) &osip_call_id_to_str}, {
-      "CSeq: ", 6, NULL, NULL, (int (*)(void *, char **)) &osip_cseq_to_str}, {
-      "Contact: ", 9, NULL, NULL, (int (*)(void *, char **)) &osip_contact_to_str}, {
-      "Authorization: ", 15, NULL, NULL, (int (*)(void *, char **)) &osip_authorization_to_str}, {
-      "WWW-Authenticate: ", 18, NULL, NULL, (int (*)(void *, char **)) &osip_www_authenticate_to_str}, {
-      "Proxy-Authenticate: ", 20, NULL, NULL, (int (*)(void *, char **)) &osip_www_authenticate_to_str}, {
-      "Proxy-Authorization: ", 21, NULL, NULL, (int (*)(void *, char **)) &osip_authorization_to_str}, {
-      "Call-Info: ", 11, NULL, NULL, (int (*)(void *, char **)) &osip_call_info_to_str}, {
-      "Content-Type: ", 14, NULL, NULL, (int (*)(void *, char **)) &osip_content_type_to_str}, {
-      "Mime-Version: ", 14, NULL, NULL, (int (*)(void *, char **)) &osip_content_length_to_str},
-#ifndef MINISIZE
-      {
-      "Allow: ", 7, NULL, NULL, (int (*)(void *, char **)) &osip_allow_to_str}, {
-      "Content-Encoding: ", 18, NULL, NULL, (int (*)(void *, char **)) &osip_content_encoding_to_str}, {
-      "Alert-Info: ", 12, NULL, NULL, (int (*)(void *, char **)) &osip_call_info_to_str}, {
-      "Error-Info: ", 12, NULL, NULL, (int (*)(void *, char **)) &osip_call_info_to_str}, {
-      "Accept: ", 8, NULL, NULL, (int (*)(void *, char **)) &osip_accept_to_str}, {
-      "Accept-Encoding: ", 17, NULL, NULL, (int (*)(void *, char **)) &osip_accept_encoding_to_str}, {
-      "Accept-Language: ", 17, NULL, NULL, (int (*)(void *, char **)) &osip_accept_language_to_str}, {
-      "Authentication-Info: ", 21, NULL, NULL, (int (*)(void *, char **)) &osip_authentication_info_to_str}, {
-      "Proxy-Authentication-Info: ", 27, NULL, NULL, (int (*)(void *, char **)) &osip_authentication_info_to_str}, {
-      "SecurityInfo: ", 14, NULL, NULL, (int (*)(void *, char **)) &osip_securityinfo_to_str}, {
-      "Note: ", 6, NULL, NULL, (int (*)(void *, char **)) &osip_note_to_str},
-#endif
-      { {
-      '\0'}, 0, NULL, NULL, NULL}
-    };
-    table[0].header_list = &sip->vias;
-    table[1].header_list = &sip->record_routes;
-    table[2].header_list = &sip->routes;
-    table[3].header_data = sip->from;
-    table[4].header_data = sip->to;
-    table[5].header_data = sip->call_id;
-    table[6].header_data = sip->cseq;
-    table[7].header_list = &sip->contacts;
-    table[8].header_list = &sip->authorizations;
-    table[9].header_list = &sip->www_authenticates;
-    table[10].header_list = &sip->proxy_authenticates;
-    table[11].header_list = &sip->proxy_authorizations;
-    table[12].header_list = &sip->call_infos;
-    table[13].header_data = sip->content_type;
-    table[14].header_data = sip->mime_version;
-#ifndef MINISIZE
-    table[15].header_list = &sip->allows;
-    table[16].header_list = &sip->content_encodings;
-    table[17].header_list = &sip->alert_infos;
-    table[18].header_list = &sip->error_infos;
-    table[19].header_list = &sip->accepts;
-    table[20].header_list = &sip->accept_encodings;
-    table[21].header_list = &sip->accept_languages;
-    table[22].header_list = &sip->authentication_infos;
-    table[23].header_list = &sip->proxy_authentication_infos;
-    table[24].header_list = &sip->securityinfos;
-    table[25].header_list = &sip->notes;
-#endif
-
-    pos = 0;
-    while (table[pos].header_name[0] != '\0') {
-      if (table[13].header_list == NULL)
-        i = strcat_simple_header (dest, &malloc_size, &message, table[pos].header_data, table[pos].header_name, table[pos].header_length, ((int (*)(void *, char **))
-                                                                                                                                           table[pos].to_str), &next);
-      i = strcat_headers_one_per_line (dest, &malloc_size, &message, table[pos].header_list, table[pos].header_name, table[pos].header_length, ((int (*)(void *, char **))
-                                                                                                                                                table[pos].to_str), &next);
-      if (i != 0) {
-        osip_free (*dest);
-        *dest = NULL;
-        return i;
-      }
-      message = next;
-
-      pos++;
-    }
-  }
-
-  {
-    osip_list_iterator_t it;
-    osip_header_t *header = (osip_header_t *) osip_list_get_first (&sip->headers, &it);
-
-    while (header != OSIP_SUCCESS) {
-
-      size_t header_len = 0;
-
-      i = osip_header_to_str (header, &tmp);
-      if (i != 0) {
-        osip_free (*dest);
-        *dest = NULL;
-        return i;
-      }
-
-      header_len = strlen (tmp);
-
-      if (_osip_message_realloc (&message, dest, header_len + 3, &malloc_size) < 0) {
-        osip_free (tmp);
-        *dest = NULL;
-        return OSIP_NOMEM;
-      }
-
-      message = osip_str_append (message, tmp);
-      osip_free (tmp);
-      message = osip_strn_append (message, OSIP_CRLF, 2);
-
-      header = (osip_header_t *) osip_list_get_next (&it);
-    }
-  }
-
-  /* we have to create the body before adding the contentlength */
-  /* add enough lenght for "Content-Length: " */
-
-  if (_osip_message_realloc (&message, dest, 16, &malloc_size) < 0)
-    return OSIP_NOMEM;
-
-  if (sipfrag && osip_list_eol (&sip->bodies, 0)) {
-    /* end of headers */
-    osip_strncpy (message, OSIP_CRLF, 2);
-    message = message + 2;
-
-    /* same remark as at the beginning of the method */
-    sip->message_property = 1;
-    sip->message = osip_strdup (*dest);
-    sip->message_length = message - *dest;
-    if (message_length != NULL)
-      *message_length = message - *dest;
-
-    return OSIP_SUCCESS;        /* it's all done */
-  }
-
-  osip_strncpy (message, "Content-Length: ", 16);
-  message = message + 16;
-
-  /* SIPit Day1
-     ALWAYS RECALCULATE?
-     if (sip->contentlength!=NULL)
-     {
-     i = osip_content_length_to_str(sip->contentlength, &tmp);
-     if (i!=0) {
-     osip_free(*dest);
-     *dest = NULL;
-     return i;
-     }
-     osip_strncpy(message,tmp,strlen(tmp));
-     osip_free(tmp);
-     }
-     else
-     { */
-  if (osip_list_eol (&sip->bodies, 0))  /* no body */
-    message = osip_strn_append (message, "0", 1);
-  else {
-    /* BUG: p130 (rfc2543bis-04)
-       "No SP after last token or quoted string"
-
-       In fact, if extra spaces exist: the stack can't be used
-       to make user-agent that wants to make authentication...
-       This should be changed...
-     */
-
-    content_length_to_modify = message;
-    message = osip_str_append (message, "     ");
-  }
-  /*  } */
-
-  message = osip_strn_append (message, OSIP_CRLF, 2);
-
-
-  /* end of headers */
-  message = osip_strn_append (message, OSIP_CRLF, 2);
-
-  start_of_bodies = message;
-  total_length = start_of_bodies - *dest;
-
-  if (osip_list_eol (&sip->bodies, 0)) {
-    /* same remark as at the beginning of the method */
-    sip->message_property = 1;
-    sip->message = osip_strdup (*dest);
-    sip->message_length = total_length;
-    if (message_length != NULL)
-      *message_length = total_length;
+  i = __osip_message_get_fragments (sip, fragments, &nb_fragments);
+  if (i != 0)
+    goto error;
 
-    return OSIP_SUCCESS;        /* it's all done */
-  }
+  total_length = startline_length;
+  for (pos = 0; pos < nb_fragments; pos++)
+    total_length += fragments[pos].name_length + (fragments[pos].generic ? 2 : 0) + fragments[pos].value_length + 2;
 
   if (sip->mime_version != NULL && sip->content_type && sip->content_type->type && !osip_strcasecmp (sip->content_type->type, "multipart")) {
     osip_generic_param_t *ct_param = NULL;
@@ -598,121 +450,147 @@ _osip_message_to_str (osip_message_t * sip, char **dest, size_t * message_length
       size_t len = strlen (ct_param->gvalue);
 
       if (len > MIME_MAX_BOUNDARY_LEN) {
-        osip_free (*dest);
-        *dest = NULL;
-        return OSIP_SYNTAXERROR;
+        i = OSIP_SYNTAXERROR;
+        goto error;
       }
 
-      boundary = osip_malloc (len + 5);
-      if (boundary == NULL) {
-        osip_free (*dest);
-        *dest = NULL;
-        return OSIP_NOMEM;
+      memcpy (boundary, "\r\n--", 4);
+      if (len >= 2 && ct_param->gvalue[0] == '"' && ct_param->gvalue[len - 1] == '"') {
+        memcpy (boundary + 4, ct_param->gvalue + 1, len - 2);
+        boundary_length = len + 2;
+      }
+      else {
+        memcpy (boundary + 4, ct_param->gvalue, len);
+        boundary_length = len + 4;
       }
-
-      osip_strncpy (boundary, OSIP_CRLF, 2);
-      osip_strncpy (boundary + 2, "--", 2);
-
-      if (ct_param->gvalue[0] == '"' && ct_param->gvalue[len - 1] == '"')
-        osip_strncpy (boundary + 4, ct_param->gvalue + 1, len - 2);
-      else
-        osip_strncpy (boundary + 4, ct_param->gvalue, len);
     }
   }
 
-  {
+  nb_bodies = osip_list_size (&sip->bodies);
+  if (nb_bodies > 0) {
     osip_list_iterator_t it;
-    osip_body_t *body = (osip_body_t *) osip_list_get_first (&sip->bodies, &it);
+    osip_body_t *body;
+
+    body_strs = (char **) osip_malloc (nb_bodies * (sizeof (char *) + sizeof (size_t)));
+    if (body_strs == NULL) {
+      i = OSIP_NOMEM;
+      goto error;
+    }
+    body_lengths = (size_t *) (body_strs + nb_bodies);
+    memset (body_strs, 0, nb_bodies * sizeof (char *));
 
+    pos = 0;
+    body = (osip_body_t *) osip_list_get_first (&sip->bodies, &it);
     while (body != OSIP_SUCCESS) {
-      size_t body_length;
+      i = osip_body_to_str (body, &body_strs[pos], &body_lengths[pos]);
+      if (i != 0)
+        goto error;
+      if (boundary_length > 0)
+        bodies_length += boundary_length + 2;
+      bodies_length += body_lengths[pos];
+      pos++;
+      body = (osip_body_t *) osip_list_get_next (&it);
+    }
+    if (boundary_length > 0)
+      bodies_length += boundary_length + 4;
+  }
 
-      if (boundary) {
-        /* Needs at most 77 bytes,
-           last realloc allocate at least 100 bytes extra */
-        message = osip_str_append (message, boundary);
-        message = osip_strn_append (message, OSIP_CRLF, 2);
-      }
+  if (sipfrag && nb_bodies == 0)
+    total_length += 2;          /* end of headers */
+  else {
+    /* the Content-Length value keeps its historical 5 characters padding */
+    if (nb_bodies == 0)
+      content_length_length = snprintf (content_length, sizeof (content_length), "0");
+    else
+      content_length_length = snprintf (content_length, sizeof (content_length), "%5i", (int) bodies_length);
+    total_length += 16 + content_length_length + 2 + 2 + bodies_length;
+  }
 
-      i = osip_body_to_str (body, &tmp, &body_length);
-      if (i != 0) {
-        osip_free (*dest);
-        *dest = NULL;
-        if (boundary)
-          osip_free (boundary);
-        return i;
-      }
+  /* second pass: write everything in a single buffer of the exact size. */
+  message = (char *) osip_malloc (total_length + 1);
+  if (message == NULL) {
+    i = OSIP_NOMEM;
+    goto error;
+  }
+  *dest = message;
 
-      if (malloc_size < message - *dest + 100 + body_length) {
-        size_t size = message - *dest;
-        int offset_of_body;
-        int offset_content_length_to_modify = 0;
-
-        offset_of_body = (int) (start_of_bodies - *dest);
-        if (content_length_to_modify != NULL)
-          offset_content_length_to_modify = (int) (content_length_to_modify - *dest);
-        malloc_size = message - *dest + body_length + 100;
-        *dest = osip_realloc (*dest, malloc_size);
-        if (*dest == NULL) {
-          osip_free (tmp);      /* fixed 09/Jun/2005 */
-          if (boundary)
-            osip_free (boundary);
-          return OSIP_NOMEM;
-        }
-        start_of_bodies = *dest + offset_of_body;
-        if (content_length_to_modify != NULL)
-          content_length_to_modify = *dest + offset_content_length_to_modify;
-        message = *dest + size;
-      }
+  if (startline != NULL) {
+    memcpy (message, startline, startline_length - 2);
+    message += startline_length - 2;
+    message = osip_strn_append (message, OSIP_CRLF, 2);
+    osip_free (startline);
+    startline = NULL;
+  }
 
-      memcpy (message, tmp, body_length);
-      message[body_length] = '\0';
-      osip_free (tmp);
-      message = message + body_length;
+  for (pos = 0; pos < nb_fragments; pos++)
+    message = __osip_fragment_write (message, &fragments[pos]);
 
-      body = (osip_body_t *) osip_list_get_next (&it);
-    }
+  if (sipfrag && nb_bodies == 0) {
+    /* end of headers */
+    message = osip_strn_append (message, OSIP_CRLF, 2);
   }
+  else {
+    message = osip_strn_append (message, "Content-Length: ", 16);
+    message = osip_strn_append (message, content_length, content_length_length);
+    message = osip_strn_append (message, OSIP_CRLF, 2);
 
-  if (boundary) {
-    /* Needs at most 79 bytes,
-       last realloc allocate at least 100 bytes extra */
-    message = osip_str_append (message, boundary);
-    message = osip_strn_append (message, "--", 2);
+    /* end of headers */
     message = osip_strn_append (message, OSIP_CRLF, 2);
 
-    osip_free (boundary);
-    boundary = NULL;
-  }
+    for (pos = 0; pos < nb_bodies; pos++) {
+      if (boundary_length > 0) {
+        memcpy (message, boundary, boundary_length);
+        message = osip_strn_append (message + boundary_length, OSIP_CRLF, 2);
+      }
+      memcpy (message, body_strs[pos], body_lengths[pos]);
+      message += body_lengths[pos];
+    }
 
-  if (content_length_to_modify == NULL) {
-    osip_free (*dest);
-    *dest = NULL;
-    return OSIP_SYNTAXERROR;
+    if (boundary_length > 0) {
+      memcpy (message, boundary, boundary_length);
+      message = osip_strn_append (message + boundary_length, "--" OSIP_CRLF, 4);
+    }
   }
+  *message = '\0';
 
-  /* we NOW have the length of bodies: */
-  {
-    size_t size = message - start_of_bodies;
-    char tmp2[15];
-
-    total_length += size;
-    snprintf (tmp2, 15, "%i", (int) size);
-    /* do not use osip_strncpy here! */
-    memcpy (content_length_to_modify + 5 - strlen (tmp2), tmp2, strlen (tmp2));
-  }
+  __osip_fragments_free (fragments, nb_fragments);
+  if (fragments != stack_fragments)
+    osip_free (fragments);
+  for (pos = 0; pos < nb_bodies; pos++)
+    osip_free (body_strs[pos]);
+  osip_free (body_strs);
 
   /* same remark as at the beginning of the method */
   sip->message_property = 1;
   sip->message = osip_malloc (total_length + 1);
   if (sip->message != NULL) {
-    memcpy (sip->message, *dest, total_length);
-    sip->message[total_length] = '\0';
+    memcpy (sip->message, *dest, total_length + 1);
     sip->message_length = total_length;
-    if (message_length != NULL)
-      *message_length = total_length;
   }
+  /* unique across messages: a buffer freed and allocated again at the same
+     address for another content never gets the same serial */
+#if defined(__GNUC__)
+  sip->message_serial = (unsigned long) __sync_add_and_fetch (&osip_message_serials, 1);
+#elif defined(WIN32) || defined(_WIN32_WCE)
+  sip->message_serial = (unsigned long) InterlockedIncrement (&osip_message_serials);
+#else
+  sip->message_serial = (unsigned long) ++osip_message_serials;
+#endif
+  if (message_length != NULL)
+    *message_length = total_length;
   return OSIP_SUCCESS;
+
+error:
+  osip_free (startline);
+  __osip_fragments_free (fragments, nb_fragments);
+  if (fragments != stack_fragments)
+    osip_free (fragments);
+  if (body_strs != NULL) {
+    for (pos = 0; pos < nb_bodies; pos++)
+      osip_free (body_strs[pos]);
+    osip_free (body_strs);
+  }
+  return i;
 }
 
 int
@@ -23,25 +23,9 @@
 #include <osipparser2/osip_parser.h>
 #include "parser.h"
 
-static __osip_message_config_t pconfig[NUMBER_OF_HEADERS];
+/* headers added with parser_add_comma_separated_header() */
 static __osip_message_config_commaseparated_t pconfig_commasep[NUMBER_OF_HEADERS_COMMASEPARATED];
 
-/* The size of the hash table seems large for a limited number of possible entries
- * The 'problem' is that the header name are too much alike for the osip_hash() function
- * which gives a poor deviation.
- * Anyway, this mechanism improves the search time (from binary seach (log(n)) to 1).
- */
-
-#ifndef HASH_TABLE_SIZE
-#ifdef __amd64__
-#define HASH_TABLE_SIZE 150
-#else
-#define HASH_TABLE_SIZE 150     /* set this to the hash table size, 150 is the
-                                   first size where no conflicts occur */
-#endif
-
-static int hdr_ref_table[HASH_TABLE_SIZE];      /* the hashtable contains indices to the pconfig table    */
-
 /*
   list of compact header:
   i: Call-ID   => ok
@@ -55,263 +39,336 @@ static int hdr_ref_table[HASH_TABLE_SIZE];      /* the hashtable contains indice
   t: To   => ok
   v: Via   => ok
 */
-/* This method must be called before using the parser */
-int
-parser_init (void)
-{
-  int i = 0;
-  int hname_length = sizeof (pconfig_commasep[0].hname);
-
-  memset (pconfig_commasep, 0, sizeof (pconfig_commasep));
-  /* rfc3261 */
-  snprintf (pconfig_commasep[i++].hname, hname_length, "%s", "Accept");
-  snprintf (pconfig_commasep[i++].hname, hname_length, "%s", "a");
-  snprintf (pconfig_commasep[i++].hname, hname_length, "%s", "Accept-Encoding");
-  snprintf (pconfig_commasep[i++].hname, hname_length, "%s", "Accept-Language");
-  snprintf (pconfig_commasep[i++].hname, hname_length, "%s", "Alert-Info");
-  snprintf (pconfig_commasep[i++].hname, hname_length, "%s", "Allow");
-  snprintf (pconfig_commasep[i++].hname, hname_length, "%s", "Authentication-Info");
-  snprintf (pconfig_commasep[i++].hname, hname_length, "%s", "Call-Info");
-  snprintf (pconfig_commasep[i++].hname, hname_length, "%s", "Contact");
-  snprintf (pconfig_commasep[i++].hname, hname_length, "%s", "m");
-  snprintf (pconfig_commasep[i++].hname, hname_length, "%s", "Content-Encoding");
-  snprintf (pconfig_commasep[i++].hname, hname_length, "%s", "e");
-  snprintf (pconfig_commasep[i++].hname, hname_length, "%s", "Content-Language");
-  snprintf (pconfig_commasep[i++].hname, hname_length, "%s", "Error-Info");
-  snprintf (pconfig_commasep[i++].hname, hname_length, "%s", "In-Reply-To");
-  snprintf (pconfig_commasep[i++].hname, hname_length, "%s", "Proxy-Require");
-  snprintf (pconfig_commasep[i++].hname, hname_length, "%s", "Record-Route");
-  snprintf (pconfig_commasep[i++].hname, hname_length, "%s", "Require");
-  snprintf (pconfig_commasep[i++].hname, hname_length, "%s", "Route");
-  snprintf (pconfig_commasep[i++].hname, hname_length, "%s", "Supported");
-  snprintf (pconfig_commasep[i++].hname, hname_length, "%s", "k");
-  snprintf (pconfig_commasep[i++].hname, hname_length, "%s", "Unsupported");
-  snprintf (pconfig_commasep[i++].hname, hname_length, "%s", "Via");
-  snprintf (pconfig_commasep[i++].hname, hname_length, "%s", "v");
-  snprintf (pconfig_commasep[i++].hname, hname_length, "%s", "Warning");
-
-  /* rfc3313 */
-  snprintf (pconfig_commasep[i++].hname, hname_length, "%s", "P-Media-Authorization");
-
-  /* rfc3325 */
-  snprintf (pconfig_commasep[i++].hname, hname_length, "%s", "P-Asserted-Identity");
-  snprintf (pconfig_commasep[i++].hname, hname_length, "%s", "P-Preferred-Identity");
-
-  /* rfc3326 */
-  snprintf (pconfig_commasep[i++].hname, hname_length, "%s", "Reason");
-
-  /* rfc3327 */
-  snprintf (pconfig_commasep[i++].hname, hname_length, "%s", "Path");
-
-  /* rfc3329 */
-  snprintf (pconfig_commasep[i++].hname, hname_length, "%s", "Security-Client");
-  snprintf (pconfig_commasep[i++].hname, hname_length, "%s", "Security-Server");
-  snprintf (pconfig_commasep[i++].hname, hname_length, "%s", "Security-Verify");
-
-  /* rfc3608 */
-  snprintf (pconfig_commasep[i++].hname, hname_length, "%s", "Service-Route");
-
-  /* rfc3841 */
-  snprintf (pconfig_commasep[i++].hname, hname_length, "%s", "Request-Disposition");
-  snprintf (pconfig_commasep[i++].hname, hname_length, "%s", "d");
-  snprintf (pconfig_commasep[i++].hname, hname_length, "%s", "Accept-Contact");
-  snprintf (pconfig_commasep[i++].hname, hname_length, "%s", "a");
-  snprintf (pconfig_commasep[i++].hname, hname_length, "%s", "Reject-Contact");
-  snprintf (pconfig_commasep[i++].hname, hname_length, "%s", "j");
-
-  /* rfc4412 */
-  snprintf (pconfig_commasep[i++].hname, hname_length, "%s", "Resource-Priority");
-  snprintf (pconfig_commasep[i++].hname, hname_length, "%s", "Accept-Resource-Priority");
 
-  /* rfc5009 */
-  snprintf (pconfig_commasep[i++].hname, hname_length, "%s", "P-Early-Media");
-
-  /* rfc5318 */
-  snprintf (pconfig_commasep[i++].hname, hname_length, "%s", "P-Refused-URI-List");
-
-  /* rfc5360 */
-  snprintf (pconfig_commasep[i++].hname, hname_length, "%s", "Permission-Missing");
-  snprintf (pconfig_commasep[i++].hname, hname_length, "%s", "Trigger-Consent");
-
-  /* rfc6050 */
-  snprintf (pconfig_commasep[i++].hname, hname_length, "%s", "P-Asserted-Service");
-  snprintf (pconfig_commasep[i++].hname, hname_length, "%s", "P-Preferred-Service");
-
-  /* rfc6086 */
-  snprintf (pconfig_commasep[i++].hname, hname_length, "%s", "Recv-Info");
-
-  /* rfc6665 */
-  snprintf (pconfig_commasep[i++].hname, hname_length, "%s", "Allow-Events");
-  snprintf (pconfig_commasep[i++].hname, hname_length, "%s", "u");
-
-  /* rfc6794 */
-  snprintf (pconfig_commasep[i++].hname, hname_length, "%s", "Policy-ID");
-  snprintf (pconfig_commasep[i++].hname, hname_length, "%s", "Policy-Contact");
-
-  /* rfc6809 */
-  snprintf (pconfig_commasep[i++].hname, hname_length, "%s", "Feature-Caps");
-
-  /* rfc7044 */
-  snprintf (pconfig_commasep[i++].hname, hname_length, "%s", "History-Info");
-  snprintf (pconfig_commasep[i++].hname, hname_length, "%s", "Accept");
-
-  /* rfc7315 */
-  snprintf (pconfig_commasep[i++].hname, hname_length, "%s", "P-Associated-URI");
-  snprintf (pconfig_commasep[i++].hname, hname_length, "%s", "P-Visited-Network-ID");
-  snprintf (pconfig_commasep[i++].hname, hname_length, "%s", "P-Access-Network-Info");
-  snprintf (pconfig_commasep[i++].hname, hname_length, "%s", "P-Charging-Function-Addresses");
+/* The table below is a perfect hash over all header names known by the
+ * parser (with a dedicated parser and/or allowed on multiple lines with
+ * a COMMA separator), including compact forms.
+ *
+ * key = (length + asso[name[0]] + asso[name[2]] + asso[name[length-1]]) % HNAME_HASH_SIZE
+ * (name[2] is replaced by the last char for names shorter than 3 chars)
+ *
+ * asso[] gives the same value for upper and lower case letters, so that
+ * a single probe followed by a case insensitive compare is required. When
+ * adding a new header name, add its entry anywhere in pconfig[] and rebuild
+ * both tables with osip_parser_cfg_gen.c (see usage in that file): it
+ * searches new asso[] values until no two names share the same key.
+ *
+ * list of comma separated headers, as of 21/03/2018:
+ * rfc3261 Accept, a, Accept-Encoding, Accept-Language, Alert-Info, Allow, Authentication-Info,
+ * Proxy-Require,Call-Info, Contact, m, Content-Encoding, e ,Content-Language, Error-Info, In-Reply-To,
+ * Record-Route, Require, Route, Supported, k, Unsupported, Via, v, Warning
+ * rfc3313 P-Media-Authorization
+ * rfc3325 P-Asserted-Identity, P-Preferred-Identity
+ * rfc3326 Reason
+ * rfc3327 Path
+ * rfc3329 Security-Client, Security-Server, Security-Verify
+ * rfc3608 Service-Route
+ * rfc3841 Request-Disposition, d, Accept-Contact, a, Reject-Contact, j
+ * rfc4412 Resource-Priority, Accept-Resource-Priority
+ * rfc5009 P-Early-Media
+ * rfc5318 P-Refused-URI-List
+ * rfc5360 Permission-Missing, Trigger-Consent
+ * rfc6050 P-Asserted-Service, P-Preferred-Service
+ * rfc6086 Recv-Info
+ * rfc6665 Allow-Events, u
+ * rfc6794 Policy-ID, Policy-Contact
+ * rfc6809 Feature-Caps
+ * rfc7044 History-Info, Accept
+ * rfc7315 P-Associated-URI, P-Visited-Network-ID, P-Access-Network-Info, P-Charging-Function-Addresses
+ * rfc7433 User-to-User
+ */
 
-  /* rfc7433 */
-  snprintf (pconfig_commasep[i++].hname, hname_length, "%s", "User-to-User");
+#define HNAME_HASH_SIZE 256
 
-  i = 0;
-#ifndef MINISIZE
-  pconfig[i].hname = ACCEPT;
-  pconfig[i].ignored_when_invalid = 1;
-  pconfig[i++].setheader = (&osip_message_set_accept);
-  pconfig[i].hname = ACCEPT_ENCODING;
-  pconfig[i].ignored_when_invalid = 1;
-  pconfig[i++].setheader = (&osip_message_set_accept_encoding);
-  pconfig[i].hname = ACCEPT_LANGUAGE;
-  pconfig[i].ignored_when_invalid = 1;
-  pconfig[i++].setheader = (&osip_message_set_accept_language);
-  pconfig[i].hname = ALERT_INFO;
-  pconfig[i].ignored_when_invalid = 1;
-  pconfig[i++].setheader = (&osip_message_set_alert_info);
-  pconfig[i].hname = ALLOW;
-  pconfig[i].ignored_when_invalid = 1;
-  pconfig[i++].setheader = (&osip_message_set_allow);
-  pconfig[i].hname = AUTHENTICATION_INFO;
-  pconfig[i].ignored_when_invalid = 1;
-  pconfig[i++].setheader = (&osip_message_set_authentication_info);
-#endif
-  pconfig[i].hname = AUTHORIZATION;
-  pconfig[i].ignored_when_invalid = 1;
-  pconfig[i++].setheader = (&osip_message_set_authorization);
-  pconfig[i].hname = CONTENT_TYPE_SHORT;        /* "l" */
-  pconfig[i].ignored_when_invalid = 0;
-  pconfig[i++].setheader = (&osip_message_set_content_type);
-  pconfig[i].hname = CALL_ID;
-  pconfig[i].ignored_when_invalid = 0;
-  pconfig[i++].setheader = (&osip_message_set_call_id);
-#ifndef MINISIZE
-  pconfig[i].hname = CALL_INFO;
-  pconfig[i].ignored_when_invalid = 1;
-  pconfig[i++].setheader = (&osip_message_set_call_info);
-#endif
-  pconfig[i].hname = CONTACT;
-  pconfig[i].ignored_when_invalid = 0;
-  pconfig[i++].setheader = (&osip_message_set_contact);
-#ifndef MINISIZE
-  pconfig[i].hname = CONTENT_ENCODING;
-  pconfig[i].ignored_when_invalid = 1;
-  pconfig[i++].setheader = (&osip_message_set_content_encoding);
-#endif
-  pconfig[i].hname = CONTENT_LENGTH;
-  pconfig[i].ignored_when_invalid = 0;
-  pconfig[i++].setheader = (&osip_message_set_content_length);
-  pconfig[i].hname = CONTENT_TYPE;
-  pconfig[i].ignored_when_invalid = 0;
-  pconfig[i++].setheader = (&osip_message_set_content_type);
-  pconfig[i].hname = CSEQ;
-  pconfig[i].ignored_when_invalid = 0;
-  pconfig[i++].setheader = (&osip_message_set_cseq);
-#ifndef MINISIZE
-  pconfig[i].hname = CONTENT_ENCODING_SHORT;    /* "e" */
-  pconfig[i].ignored_when_invalid = 1;
-  pconfig[i++].setheader = (&osip_message_set_content_encoding);
-  pconfig[i].hname = ERROR_INFO;
-  pconfig[i].ignored_when_invalid = 1;
-  pconfig[i++].setheader = (&osip_message_set_error_info);
-#endif
-  pconfig[i].hname = FROM_SHORT;        /* "f" */
-  pconfig[i].ignored_when_invalid = 0;
-  pconfig[i++].setheader = (&osip_message_set_from);
-  pconfig[i].hname = FROM;
-  pconfig[i].ignored_when_invalid = 0;
-  pconfig[i++].setheader = (&osip_message_set_from);
-  pconfig[i].hname = CALL_ID_SHORT;     /* "i" */
-  pconfig[i].ignored_when_invalid = 0;
-  pconfig[i++].setheader = (&osip_message_set_call_id);
-  pconfig[i].hname = CONTENT_LENGTH_SHORT;      /* "l" */
-  pconfig[i].ignored_when_invalid = 0;
-  pconfig[i++].setheader = (&osip_message_set_content_length);
-  pconfig[i].hname = CONTACT_SHORT;     /* "m" */
-  pconfig[i].ignored_when_invalid = 0;
-  pconfig[i++].setheader = (&osip_message_set_contact);
-  pconfig[i].hname = MIME_VERSION;
-  pconfig[i].ignored_when_invalid = 1;
-  pconfig[i++].setheader = (&osip_message_set_mime_version);
-  pconfig[i].hname = PROXY_AUTHENTICATE;
-  pconfig[i].ignored_when_invalid = 1;
-  pconfig[i++].setheader = (&osip_message_set_proxy_authenticate);
 #ifndef MINISIZE
-  pconfig[i].hname = PROXY_AUTHENTICATION_INFO;
-  pconfig[i].ignored_when_invalid = 1;
-  pconfig[i++].setheader = (&osip_message_set_proxy_authentication_info);
-#endif
-  pconfig[i].hname = PROXY_AUTHORIZATION;
-  pconfig[i].ignored_when_invalid = 1;
-  pconfig[i++].setheader = (&osip_message_set_proxy_authorization);
-  pconfig[i].hname = RECORD_ROUTE;
-  pconfig[i].ignored_when_invalid = 1;  /* best effort - but should be 0 */
-  pconfig[i++].setheader = (&osip_message_set_record_route);
-  pconfig[i].hname = ROUTE;
-  pconfig[i].ignored_when_invalid = 1;  /* best effort - but should be 0 */
-  pconfig[i++].setheader = (&osip_message_set_route);
-  pconfig[i].hname = TO_SHORT;
-  pconfig[i].ignored_when_invalid = 0;
-  pconfig[i++].setheader = (&osip_message_set_to);
-  pconfig[i].hname = TO;
-  pconfig[i].ignored_when_invalid = 0;
-  pconfig[i++].setheader = (&osip_message_set_to);
-  pconfig[i].hname = VIA_SHORT;
-  pconfig[i].ignored_when_invalid = 0;
-  pconfig[i++].setheader = (&osip_message_set_via);
-  pconfig[i].hname = VIA;
-  pconfig[i].ignored_when_invalid = 0;
-  pconfig[i++].setheader = (&osip_message_set_via);
-  pconfig[i].hname = WWW_AUTHENTICATE;
-  pconfig[i].ignored_when_invalid = 1;
-  pconfig[i++].setheader = (&osip_message_set_www_authenticate);
-#ifndef MINISIZE
-  pconfig[i].hname = SECURITYINFO;
-  pconfig[i].ignored_when_invalid = 1;
-  pconfig[i++].setheader = (&osip_message_set_securityinfo);
-#endif
-#ifndef MINISIZE
-        pconfig[i].hname = NOTE;
-        pconfig[i].ignored_when_invalid = 1;
-        pconfig[i++].setheader = (&osip_message_set_note);
+#define HNAME_SETHEADER(f) (f)
+#else
+#define HNAME_SETHEADER(f) NULL
 #endif
 
-  /* build up hash table for fast header lookup */
-
-  /* initialize the table */
-  for (i = 0; i < HASH_TABLE_SIZE; i++) {
-    hdr_ref_table[i] = -1;      /* -1 -> no entry */
-  }
-
-  for (i = 0; i < NUMBER_OF_HEADERS; i++) {
-    unsigned long hash;
-
-    /* calculate hash value using lower case */
-    /* Fixed: do not lower constant... osip_tolower( pconfig[i].hname ); */
-    hash = osip_hash (pconfig[i].hname);
-    hash = hash % HASH_TABLE_SIZE;
-
-    if (hdr_ref_table[hash] == -1) {
-      /* store reference(index) to pconfig table */
-      hdr_ref_table[hash] = i;
-    }
-    else {
-      /* oops, conflict!-> change the hash table or use another hash function size */
-
-      OSIP_TRACE (osip_trace (__FILE__, __LINE__, OSIP_ERROR, NULL, "conflict with current hashtable size\n"));
-      return OSIP_UNDEFINED_ERROR;
-    }
-  }
+static const unsigned char hname_asso[256] = {
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 255, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 176, 0, 60, 51, 241, 14, 162, 94, 224, 129, 18, 24, 40, 20, 146,
+  187, 106, 203, 78, 234, 142, 187, 253, 0, 217, 0, 0, 0, 0, 0, 0,
+  0, 176, 0, 60, 51, 241, 14, 162, 94, 224, 129, 18, 24, 40, 20, 146,
+  187, 106, 203, 78, 234, 142, 187, 253, 0, 217, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
+};
+
+static const __osip_message_config_t pconfig[HNAME_HASH_SIZE] = {
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {"content-encoding", 16, HNAME_SETHEADER (&osip_message_set_content_encoding), 1, 1},
+  {"resource-priority", 17, NULL, 0, 1},
+  {"record-route", 12, &osip_message_set_record_route, 1, 1},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {"path", 4, NULL, 0, 1},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {"p-media-authorization", 21, NULL, 0, 1},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {"policy-id", 9, NULL, 0, 1},
+  {"to", 2, &osip_message_set_to, 0, 0},
+  {"a", 1, NULL, 0, 1},
+  {"p-access-network-info", 21, NULL, 0, 1},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {"service-route", 13, NULL, 0, 1},
+  {"feature-caps", 12, NULL, 0, 1},
+  {NULL, 0, NULL, 0, 0},
+  {"unsupported", 11, NULL, 0, 1},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {"via", 3, &osip_message_set_via, 0, 1},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {"allow-events", 12, NULL, 0, 1},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {"securityinfo", 12, HNAME_SETHEADER (&osip_message_set_securityinfo), 1, 0},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {"f", 1, &osip_message_set_from, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {"require", 7, NULL, 0, 1},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {"v", 1, &osip_message_set_via, 0, 1},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {"k", 1, NULL, 0, 1},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {"permission-missing", 18, NULL, 0, 1},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {"alert-info", 10, HNAME_SETHEADER (&osip_message_set_alert_info), 1, 1},
+  {NULL, 0, NULL, 0, 0},
+  {"authentication-info", 19, HNAME_SETHEADER (&osip_message_set_authentication_info), 1, 1},
+  {NULL, 0, NULL, 0, 0},
+  {"contact", 7, &osip_message_set_contact, 0, 1},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {"reject-contact", 14, NULL, 0, 1},
+  {"supported", 9, NULL, 0, 1},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {"l", 1, &osip_message_set_content_length, 0, 0},
+  {"history-info", 12, NULL, 0, 1},
+  {"proxy-require", 13, NULL, 0, 1},
+  {NULL, 0, NULL, 0, 0},
+  {"content-type", 12, &osip_message_set_content_type, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {"route", 5, &osip_message_set_route, 1, 1},
+  {"proxy-authenticate", 18, &osip_message_set_proxy_authenticate, 1, 0},
+  {"content-language", 16, NULL, 0, 1},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {"user-to-user", 12, NULL, 0, 1},
+  {"p-asserted-identity", 19, NULL, 0, 1},
+  {"error-info", 10, HNAME_SETHEADER (&osip_message_set_error_info), 1, 1},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {"p-associated-uri", 16, NULL, 0, 1},
+  {"request-disposition", 19, NULL, 0, 1},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {"p-charging-function-addresses", 29, NULL, 0, 1},
+  {"p-preferred-identity", 20, NULL, 0, 1},
+  {"security-server", 15, NULL, 0, 1},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {"p-early-media", 13, NULL, 0, 1},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {"p-asserted-service", 18, NULL, 0, 1},
+  {NULL, 0, NULL, 0, 0},
+  {"mime-version", 12, &osip_message_set_mime_version, 1, 0},
+  {"warning", 7, NULL, 0, 1},
+  {"security-verify", 15, NULL, 0, 1},
+  {NULL, 0, NULL, 0, 0},
+  {"proxy-authorization", 19, &osip_message_set_proxy_authorization, 1, 0},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {"m", 1, &osip_message_set_contact, 0, 1},
+  {"p-preferred-service", 19, NULL, 0, 1},
+  {NULL, 0, NULL, 0, 0},
+  {"in-reply-to", 11, NULL, 0, 1},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {"p-refused-uri-list", 18, NULL, 0, 1},
+  {"security-client", 15, NULL, 0, 1},
+  {"j", 1, NULL, 0, 1},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {"call-id", 7, &osip_message_set_call_id, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {"reason", 6, NULL, 0, 1},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {"d", 1, NULL, 0, 1},
+  {"cseq", 4, &osip_message_set_cseq, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {"accept-encoding", 15, HNAME_SETHEADER (&osip_message_set_accept_encoding), 1, 1},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {"i", 1, &osip_message_set_call_id, 0, 0},
+  {"recv-info", 9, NULL, 0, 1},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {"u", 1, NULL, 0, 1},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {"c", 1, &osip_message_set_content_type, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {"authorization", 13, &osip_message_set_authorization, 1, 0},
+  {"content-length", 14, &osip_message_set_content_length, 0, 0},
+  {"p-visited-network-id", 20, NULL, 0, 1},
+  {NULL, 0, NULL, 0, 0},
+  {"t", 1, &osip_message_set_to, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {"trigger-consent", 15, NULL, 0, 1},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {"allow", 5, HNAME_SETHEADER (&osip_message_set_allow), 1, 1},
+  {"policy-contact", 14, NULL, 0, 1},
+  {"from", 4, &osip_message_set_from, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {"e", 1, HNAME_SETHEADER (&osip_message_set_content_encoding), 1, 1},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {"accept", 6, HNAME_SETHEADER (&osip_message_set_accept), 1, 1},
+  {"accept-resource-priority", 24, NULL, 0, 1},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {"accept-contact", 14, NULL, 0, 1},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {"accept-language", 15, HNAME_SETHEADER (&osip_message_set_accept_language), 1, 1},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {"call-info", 9, HNAME_SETHEADER (&osip_message_set_call_info), 1, 1},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {"note", 4, HNAME_SETHEADER (&osip_message_set_note), 1, 0},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {"proxy-authentication-info", 25, HNAME_SETHEADER (&osip_message_set_proxy_authentication_info), 1, 0},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {"www-authenticate", 16, &osip_message_set_www_authenticate, 1, 0},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0},
+  {NULL, 0, NULL, 0, 0}
+};
 
+/* This method must be called before using the parser */
+int
+parser_init (void)
+{
+  /* nothing to do: the header table is built at compile time */
   return OSIP_SUCCESS;
 }
 
@@ -329,11 +386,34 @@ parser_add_comma_separated_header (const char *hname)
   return OSIP_UNDEFINED_ERROR;
 }
 
+const __osip_message_config_t *
+__osip_message_get_config (const char *hname)
+{
+  const __osip_message_config_t *config;
+  size_t length;
+  unsigned int key;
+
+  length = strlen (hname);
+  if (length == 0)
+    return NULL;
+
+  key = (unsigned int) length + hname_asso[(unsigned char) hname[0]] + hname_asso[(unsigned char) hname[length > 2 ? 2 : length - 1]]
+    + hname_asso[(unsigned char) hname[length - 1]];
+  config = &pconfig[key & (HNAME_HASH_SIZE - 1)];
+
+  if (config->hname_length != length || osip_strncasecmp (config->hname, hname, length) != 0)
+    return NULL;
+  return config;
+}
+
 int
-__osip_message_is_header_comma_separated (const char *hname)
+__osip_message_is_header_comma_separated (const __osip_message_config_t * config, const char *hname)
 {
   int i;
 
+  if (config != NULL && config->comma_separated)
+    return OSIP_SUCCESS;
+
   for (i = 0; i < NUMBER_OF_HEADERS_COMMASEPARATED; i++) {
     if (pconfig_commasep[i].hname[0] == '\0')
       break;
@@ -343,40 +423,17 @@ __osip_message_is_header_comma_separated (const char *hname)
   return OSIP_UNDEFINED_ERROR;
 }
 
-/* improved look-up mechanism
-   precondition: hname is all lowercase */
-int
-__osip_message_is_known_header (const char *hname)
-{
-  unsigned long hash;
-  int result = -1;
-
-  int index;
-
-  hash = osip_hash (hname);
-  hash = hash % HASH_TABLE_SIZE;
-  index = hdr_ref_table[hash];
-
-  if ((index != -1) && (0 == strcmp (pconfig[index].hname, hname))) {
-    result = index;
-  }
-
-  return result;
-}
-
-#endif
-
 /* This method calls the method that is able to parse the header */
 int
-__osip_message_call_method (int i, osip_message_t * dest, const char *hvalue)
+__osip_message_call_method (const __osip_message_config_t * config, osip_message_t * dest, const char *hvalue)
 {
   int err;
 
-  err = pconfig[i].setheader (dest, hvalue);
+  err = config->setheader (dest, hvalue);
   if (err < 0) {
-    OSIP_TRACE (osip_trace (__FILE__, __LINE__, OSIP_WARNING, NULL, "Could not set header: %s: %s\n", pconfig[i].hname, hvalue));
+    OSIP_TRACE (osip_trace (__FILE__, __LINE__, OSIP_WARNING, NULL, "Could not set header: %s: %s\n", config->hname, hvalue));
   }
-  if (pconfig[i].ignored_when_invalid == 1)
+  if (config->ignored_when_invalid == 1)
     return OSIP_SUCCESS;
   return err;
 }
@@ -0,0 +1,308 @@
+/*
+  The oSIP library implements the Session Initiation Protocol (SIP -rfc3261-)
+  Copyright (C) 2001-2018 Aymeric MOIZARD amoizard@antisip.com
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+/* Generator of the header name perfect hash of osip_parser_cfg.c.
+ *
+ * This program is not part of the library. It reads osip_parser_cfg.c on
+ * stdin, collects every named entry of pconfig[] (whatever its position),
+ * searches hname_asso[] values for which no two names share the same key
+ * and writes osip_parser_cfg.c back on stdout with both tables rebuilt:
+ *
+ *   cc -o osip_parser_cfg_gen osip_parser_cfg_gen.c
+ *   ./osip_parser_cfg_gen < osip_parser_cfg.c > osip_parser_cfg.c.new
+ *   mv osip_parser_cfg.c.new osip_parser_cfg.c
+ *
+ * To support a new header name, add a line such as
+ *   {"x-new-header", 12, NULL, 0, 1},
+ * anywhere inside pconfig[] (replacing a NULL entry or not) and run the
+ * generator. The length field is recomputed. When the current hname_asso[]
+ * is still collision free, it is kept unchanged so that the output is
+ * stable.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#define HNAME_HASH_SIZE 256
+#define MAX_HEADERS HNAME_HASH_SIZE
+#define MAX_LINES 4096
+#define MAX_LINE 1024
+
+struct hname_entry {
+  char name[64];
+  size_t length;
+  char tail[MAX_LINE];          /* ", setter, ignored_when_invalid, comma_separated}" */
+};
+
+static char *lines[MAX_LINES];
+static int nb_lines;
+
+static struct hname_entry entries[MAX_HEADERS];
+static int nb_entries;
+
+static unsigned char asso[256];
+
+static unsigned int
+hname_key (const struct hname_entry *e)
+{
+  const unsigned char *n = (const unsigned char *) e->name;
+  size_t length = e->length;
+
+  return ((unsigned int) length + asso[n[0]] + asso[n[length > 2 ? 2 : length - 1]] + asso[n[length - 1]]) % HNAME_HASH_SIZE;
+}
+
+/* number of names sharing their key with another name */
+static int
+hname_collisions (void)
+{
+  int count[HNAME_HASH_SIZE];
+  int collisions = 0;
+  int i;
+
+  memset (count, 0, sizeof (count));
+  for (i = 0; i < nb_entries; i++)
+    count[hname_key (&entries[i])]++;
+  for (i = 0; i < HNAME_HASH_SIZE; i++)
+    if (count[i] > 1)
+      collisions += count[i];
+  return collisions;
+}
+
+static void
+asso_set (int c, unsigned char value)
+{
+  asso[tolower (c)] = value;
+  asso[toupper (c)] = value;
+}
+
+/* hill climbing: change the value of one char used by a colliding name,
+   keep the change when it does not increase the number of collisions */
+static int
+hname_search (void)
+{
+  long round;
+  int current = hname_collisions ();
+
+  srand (5060);
+  for (round = 0; current > 0 && round < 10000000L; round++) {
+    int count[HNAME_HASH_SIZE];
+    const struct hname_entry *e;
+    unsigned char saved;
+    int c, pos, i, next;
+
+    memset (count, 0, sizeof (count));
+    for (i = 0; i < nb_entries; i++)
+      count[hname_key (&entries[i])]++;
+    do {
+      e = &entries[rand () % nb_entries];
+    } while (count[hname_key (e)] < 2);
+
+    pos = rand () % 3;
+    if (pos == 0)
+      c = (unsigned char) e->name[0];
+    else if (pos == 1)
+      c = (unsigned char) e->name[e->length > 2 ? 2 : e->length - 1];
+    else
+      c = (unsigned char) e->name[e->length - 1];
+
+    saved = asso[c];
+    asso_set (c, (unsigned char) (rand () % 256));
+    next = hname_collisions ();
+    if (next <= current)
+      current = next;
+    else
+      asso_set (c, saved);
+  }
+  return current;
+}
+
+static int
+read_lines (void)
+{
+  char buf[MAX_LINE];
+
+  while (fgets (buf, sizeof (buf), stdin) != NULL) {
+    if (nb_lines == MAX_LINES)
+      return -1;
+    lines[nb_lines] = strdup (buf);
+    if (lines[nb_lines] == NULL)
+      return -1;
+    nb_lines++;
+  }
+  return 0;
+}
+
+static int
+find_line (const char *prefix, int from)
+{
+  int i;
+
+  for (i = from; i < nb_lines; i++)
+    if (strncmp (lines[i], prefix, strlen (prefix)) == 0)
+      return i;
+  return -1;
+}
+
+static int
+parse_asso (int first, int last)
+{
+  int i, n = 0;
+
+  for (i = first + 1; i < last; i++) {
+    char *p = lines[i];
+
+    while (*p != '\0') {
+      char *end;
+      long v = strtol (p, &end, 10);
+
+      if (end == p) {
+        p++;
+        continue;
+      }
+      if (n == 256)
+        return -1;
+      asso[n++] = (unsigned char) v;
+      p = end;
+    }
+  }
+  return n == 256 ? 0 : -1;
+}
+
+static int
+parse_pconfig (int first, int last)
+{
+  int i, j;
+
+  for (i = first + 1; i < last; i++) {
+    char *p = strstr (lines[i], "{\"");
+    char *q, *tail;
+    struct hname_entry *e;
+
+    if (p == NULL)
+      continue;
+    p += 2;
+    q = strchr (p, '"');
+    if (q == NULL || q == p || (size_t) (q - p) >= sizeof (entries[0].name))
+      return -1;
+    tail = strchr (q, ',');
+    if (tail != NULL)
+      tail = strchr (tail + 1, ',');
+    if (tail == NULL || strchr (tail, '}') == NULL)
+      return -1;
+    if (nb_entries == MAX_HEADERS)
+      return -1;
+    e = &entries[nb_entries];
+    memcpy (e->name, p, q - p);
+    e->name[q - p] = '\0';
+    e->length = (size_t) (q - p);
+    for (j = 0; e->name[j] != '\0'; j++)
+      e->name[j] = (char) tolower ((unsigned char) e->name[j]);
+    snprintf (e->tail, sizeof (e->tail), "%.*s", (int) (strchr (tail, '}') - tail + 1), tail);
+    for (j = 0; j < nb_entries; j++) {
+      if (strcmp (entries[j].name, e->name) == 0) {
+        fprintf (stderr, "duplicate header name: %s\n", e->name);
+        return -1;
+      }
+    }
+    nb_entries++;
+  }
+  return 0;
+}
+
+static void
+write_asso (void)
+{
+  int i;
+
+  printf ("static const unsigned char hname_asso[256] = {\n");
+  for (i = 0; i < 256; i++) {
+    if (i % 16 == 0)
+      printf ("  ");
+    printf ("%d", asso[i]);
+    if (i == 255)
+      printf ("\n");
+    else if (i % 16 == 15)
+      printf (",\n");
+    else
+      printf (", ");
+  }
+  printf ("};\n");
+}
+
+static void
+write_pconfig (void)
+{
+  const struct hname_entry *slot[HNAME_HASH_SIZE];
+  int i;
+
+  memset (slot, 0, sizeof (slot));
+  for (i = 0; i < nb_entries; i++)
+    slot[hname_key (&entries[i])] = &entries[i];
+
+  printf ("static const __osip_message_config_t pconfig[HNAME_HASH_SIZE] = {\n");
+  for (i = 0; i < HNAME_HASH_SIZE; i++) {
+    if (slot[i] == NULL)
+      printf ("  {NULL, 0, NULL, 0, 0}");
+    else
+      printf ("  {\"%s\", %d%s", slot[i]->name, (int) slot[i]->length, slot[i]->tail);
+    printf (i == HNAME_HASH_SIZE - 1 ? "\n" : ",\n");
+  }
+  printf ("};\n");
+}
+
+int
+main (void)
+{
+  int asso_first, asso_last, pconfig_first, pconfig_last;
+  int i;
+
+  if (read_lines () != 0) {
+    fprintf (stderr, "cannot read input\n");
+    return 1;
+  }
+  asso_first = find_line ("static const unsigned char hname_asso[256]", 0);
+  asso_last = asso_first < 0 ? -1 : find_line ("};", asso_first);
+  pconfig_first = find_line ("static const __osip_message_config_t pconfig[HNAME_HASH_SIZE]", 0);
+  pconfig_last = pconfig_first < 0 ? -1 : find_line ("};", pconfig_first);
+  if (asso_last < 0 || pconfig_last < 0 || pconfig_first < asso_last) {
+    fprintf (stderr, "hname_asso[] or pconfig[] not found\n");
+    return 1;
+  }
+  if (parse_asso (asso_first, asso_last) != 0 || parse_pconfig (pconfig_first, pconfig_last) != 0) {
+    fprintf (stderr, "cannot parse hname_asso[] or pconfig[]\n");
+    return 1;
+  }
+
+  if (hname_search () != 0) {
+    fprintf (stderr, "no perfect hash found for %d header names\n", nb_entries);
+    return 1;
+  }
+
+  for (i = 0; i < asso_first; i++)
+    fputs (lines[i], stdout);
+  write_asso ();
+  for (i = asso_last + 1; i < pconfig_first; i++)
+    fputs (lines[i], stdout);
+  write_pconfig ();
+  for (i = pconfig_last + 1; i < nb_lines; i++)
+    fputs (lines[i], stdout);
+  return 0;
+}
@@ -62,6 +62,33 @@ osip_message_set_securityinfo (osip_message_t * sip, const char *hvalue)
   return OSIP_SUCCESS;
 }
 
+static const __osip_auth_param_t securityinfo_params[] = {
+  {OSIP_AUTH_PARAM_USERNAME, 1, offsetof (osip_securityinfo_t, username)},
+  {OSIP_AUTH_PARAM_REALM, 1, offsetof (osip_securityinfo_t, realm)},
+  {OSIP_AUTH_PARAM_NONCE, 1, offsetof (osip_securityinfo_t, nonce)},
+  {OSIP_AUTH_PARAM_URI, 1, offsetof (osip_securityinfo_t, uri)},
+  {OSIP_AUTH_PARAM_RESPONSE, 1, offsetof (osip_securityinfo_t, response)},
+  {OSIP_AUTH_PARAM_DIGEST, 1, offsetof (osip_securityinfo_t, digest)},
+  {OSIP_AUTH_PARAM_ALGORITHM, 0, offsetof (osip_securityinfo_t, algorithm)},
+  {OSIP_AUTH_PARAM_CNONCE, 1, offsetof (osip_securityinfo_t, cnonce)},
+  {OSIP_AUTH_PARAM_OPAQUE, 1, offsetof (osip_securityinfo_t, opaque)},
+  {OSIP_AUTH_PARAM_QOP, 0, offsetof (osip_securityinfo_t, message_qop)},
+  {OSIP_AUTH_PARAM_NC, 0, offsetof (osip_securityinfo_t, nonce_count)},
+  {OSIP_AUTH_PARAM_VERSION, 0, offsetof (osip_securityinfo_t, version)},
+  {OSIP_AUTH_PARAM_TARGETNAME, 1, offsetof (osip_securityinfo_t, targetname)},
+  {OSIP_AUTH_PARAM_GSSAPI_DATA, 1, offsetof (osip_securityinfo_t, gssapi_data)},
+  {OSIP_AUTH_PARAM_CRAND, 1, offsetof (osip_securityinfo_t, crand)},
+  {OSIP_AUTH_PARAM_CNUM, 1, offsetof (osip_securityinfo_t, cnum)},
+  {OSIP_AUTH_PARAM_RANDOM1, 1, offsetof (osip_securityinfo_t, random1)},
+  {OSIP_AUTH_PARAM_RANDOM2, 1, offsetof (osip_securityinfo_t, random2)},
+  {OSIP_AUTH_PARAM_DEVICEID, 1, offsetof (osip_securityinfo_t, deviceid)},
+  {OSIP_AUTH_PARAM_SERVERID, 1, offsetof (osip_securityinfo_t, serverid)},
+  {OSIP_AUTH_PARAM_SIGN1, 1, offsetof (osip_securityinfo_t, sign1)},
+  {OSIP_AUTH_PARAM_KEYVERSION, 1, offsetof (osip_securityinfo_t, keyversion)},
+  {OSIP_AUTH_PARAM_CRYPTKEY, 1, offsetof (osip_securityinfo_t, cryptkey)},
+  {OSIP_AUTH_PARAM_SIGN2, 1, offsetof (osip_securityinfo_t, sign2)}
+};
+
 /* fills the www-securityinfo structure.           */
 /* INPUT : char *hvalue | value of header.         */
 /* OUTPUT: osip_message_t *sip | structure to save results. */
@@ -74,8 +101,6 @@ int
 osip_securityinfo_parse (osip_securityinfo_t * secu, const char *hvalue)
 {
   const char *space;
-  const char *next = NULL;
-  int i;
 
   space = strchr (hvalue, ' '); /* SEARCH FOR SPACE */
   if (space == NULL)
@@ -88,259 +113,7 @@ osip_securityinfo_parse (osip_securityinfo_t * secu, const char *hvalue)
     return OSIP_NOMEM;
   osip_strncpy (secu->auth_type, hvalue, space - hvalue);
 
-  for (;;) {
-    int parse_ok = 0;
-
-    i = __osip_quoted_string_set ("username", space, &(secu->username), &next);
-    if (i != 0)
-      return i;
-    if (next == NULL)
-      return OSIP_SUCCESS;      /* end of header detected! */
-    else if (next != space) {
-      space = next;
-      parse_ok++;
-    }
-    i = __osip_quoted_string_set ("realm", space, &(secu->realm), &next);
-    if (i != 0)
-      return i;
-    if (next == NULL)
-      return OSIP_SUCCESS;
-    else if (next != space) {
-      space = next;
-      parse_ok++;
-    }
-    i = __osip_quoted_string_set ("nonce", space, &(secu->nonce), &next);
-    if (i != 0)
-      return i;
-    if (next == NULL)
-      return OSIP_SUCCESS;      /* end of header detected! */
-    else if (next != space) {
-      space = next;
-      parse_ok++;
-    }
-    i = __osip_quoted_string_set ("uri", space, &(secu->uri), &next);
-    if (i != 0)
-      return i;
-    if (next == NULL)
-      return OSIP_SUCCESS;      /* end of header detected! */
-    else if (next != space) {
-      space = next;
-      parse_ok++;
-    }
-    i = __osip_quoted_string_set ("response", space, &(secu->response), &next);
-    if (i != 0)
-      return i;
-    if (next == NULL)
-      return OSIP_SUCCESS;      /* end of header detected! */
-    else if (next != space) {
-      space = next;
-      parse_ok++;
-    }
-    i = __osip_quoted_string_set ("digest", space, &(secu->digest), &next);
-    if (i != 0)
-      return i;
-    if (next == NULL)
-      return OSIP_SUCCESS;      /* end of header detected! */
-    else if (next != space) {
-      space = next;
-      parse_ok++;
-    }
-    i = __osip_token_set ("algorithm", space, &(secu->algorithm), &next);
-    if (i != 0)
-      return i;
-    if (next == NULL)
-      return OSIP_SUCCESS;      /* end of header detected! */
-    else if (next != space) {
-      space = next;
-      parse_ok++;
-    }
-    i = __osip_quoted_string_set ("cnonce", space, &(secu->cnonce), &next);
-    if (i != 0)
-      return i;
-    if (next == NULL)
-      return OSIP_SUCCESS;      /* end of header detected! */
-    else if (next != space) {
-      space = next;
-      parse_ok++;
-    }
-    i = __osip_quoted_string_set ("opaque", space, &(secu->opaque), &next);
-    if (i != 0)
-      return i;
-    if (next == NULL)
-      return OSIP_SUCCESS;      /* end of header detected! */
-    else if (next != space) {
-      space = next;
-      parse_ok++;
-    }
-    i = __osip_token_set ("qop", space, &(secu->message_qop), &next);
-    if (i != 0)
-      return i;
-    if (next == NULL)
-      return OSIP_SUCCESS;      /* end of header detected! */
-    else if (next != space) {
-      space = next;
-      parse_ok++;
-    }
-    i = __osip_token_set ("nc", space, &(secu->nonce_count), &next);
-    if (i != 0)
-      return i;
-    if (next == NULL)
-      return OSIP_SUCCESS;      /* end of header detected! */
-    else if (next != space) {
-      space = next;
-      parse_ok++;
-    }
-    i = __osip_token_set ("version", space, &(secu->version), &next);
-    if (i!=0)
-      return i;
-    if (next == NULL)
-      return OSIP_SUCCESS;               /* end of header detected! */
-    else if (next != space) {
-        space = next;
-        parse_ok++;
-    }
-    i = __osip_quoted_string_set ("targetname", space, &(secu->targetname), &next);
-    if (i!=0)
-      return i;
-    if (next == NULL)
-      return OSIP_SUCCESS;               /* end of header detected! */
-    else if (next != space) {
-        space = next;
-        parse_ok++;
-    }
-    i = __osip_quoted_string_set ("gssapi-data", space, &(secu->gssapi_data), &next);
-    if (i!=0)
-      return i;
-    if (next == NULL)
-      return OSIP_SUCCESS;               /* end of header detected! */
-    else if (next != space) {
-        space = next;
-        parse_ok++;
-    }
-    i = __osip_quoted_string_set ("crand", space, &(secu->crand), &next);
-    if (i!=0)
-      return i;
-    if (next == NULL)
-      return OSIP_SUCCESS;               /* end of header detected! */
-    else if (next != space) {
-        space = next;
-        parse_ok++;
-    }
-    i = __osip_quoted_string_set ("cnum", space, &(secu->cnum), &next);
-    if (i!=0)
-      return i;
-    if (next == NULL)
-      return OSIP_SUCCESS;               /* end of header detected! */
-    else if (next != space) {
-        space = next;
-        parse_ok++;
-    }
-    i = __osip_quoted_string_set ("random1", space, &(secu->random1), &next);
-    if (i != 0)
-      return i;
-    if (next == NULL)
-      return OSIP_SUCCESS;      /* end of header detected! */
-    else if (next != space) {
-      space = next;
-      parse_ok++;
-    }
-    i = __osip_quoted_string_set ("random2", space, &(secu->random2), &next);
-    if (i != 0)
-      return i;
-    if (next == NULL)
-      return OSIP_SUCCESS;      /* end of header detected! */
-    else if (next != space) {
-      space = next;
-      parse_ok++;
-    }
-    i = __osip_quoted_string_set ("deviceid", space, &(secu->deviceid), &next);
-    if (i != 0)
-      return i;
-    if (next == NULL)
-      return OSIP_SUCCESS;      /* end of header detected! */
-    else if (next != space) {
-      space = next;
-      parse_ok++;
-    }
-    i = __osip_quoted_string_set ("serverid", space, &(secu->serverid), &next);
-    if (i != 0)
-      return i;
-    if (next == NULL)
-      return OSIP_SUCCESS;      /* end of header detected! */
-    else if (next != space) {
-      space = next;
-      parse_ok++;
-    }
-    i = __osip_quoted_string_set ("sign1", space, &(secu->sign1), &next);
-    if (i != 0)
-      return i;
-    if (next == NULL)
-      return OSIP_SUCCESS;      /* end of header detected! */
-    else if (next != space) {
-      space = next;
-      parse_ok++;
-    }
-    i = __osip_quoted_string_set ("keyversion", space, &(secu->keyversion), &next);
-    if (i != 0)
-      return i;
-    if (next == NULL)
-      return OSIP_SUCCESS;      /* end of header detected! */
-    else if (next != space) {
-      space = next;
-      parse_ok++;
-    }
-    i = __osip_quoted_string_set ("cryptkey", space, &(secu->cryptkey), &next);
-    if (i != 0)
-      return i;
-    if (next == NULL)
-      return OSIP_SUCCESS;      /* end of header detected! */
-    else if (next != space) {
-      space = next;
-      parse_ok++;
-    }
-    i = __osip_quoted_string_set ("sign2", space, &(secu->sign2), &next);
-    if (i != 0)
-      return i;
-    if (next == NULL)
-      return OSIP_SUCCESS;      /* end of header detected! */
-    else if (next != space) {
-      space = next;
-      parse_ok++;
-    }
-    /* nothing was recognized:
-       here, we should handle a list of unknown tokens where:
-       token1 = ( token2 | quoted_text ) */
-    /* TODO */
-
-    if (0 == parse_ok) {
-      const char *quote1, *quote2, *tmp;
-
-      /* CAUTION */
-      /* parameter not understood!!! I'm too lazy to handle IT */
-      /* let's simply bypass it */
-      if (strlen (space) < 1)
-        return OSIP_SUCCESS;
-      tmp = strchr (space + 1, ',');
-      if (tmp == NULL)          /* it was the last header */
-        return OSIP_SUCCESS;
-      quote1 = __osip_quote_find (space);
-      if ((quote1 != NULL) && (quote1 < tmp)) { /* this may be a quoted string! */
-        quote2 = __osip_quote_find (quote1 + 1);
-        if (quote2 == NULL)
-          return OSIP_SYNTAXERROR;      /* bad header format... */
-        if (tmp < quote2)       /* the comma is inside the quotes! */
-          space = strchr (quote2, ',');
-        else
-          space = tmp;
-        if (space == NULL)      /* it was the last header */
-          return OSIP_SUCCESS;
-      }
-      else
-        space = tmp;
-      /* continue parsing... */
-    }
-  }
-  return OSIP_SUCCESS;          /* ok */
+  return __osip_auth_params_parse (secu, securityinfo_params, sizeof (securityinfo_params) / sizeof (securityinfo_params[0]), space);
 }
 
 #ifndef MINISIZE
@@ -62,156 +62,224 @@ osip_message_set_www_authenticate (osip_message_t * sip, const char *hvalue)
   return OSIP_SUCCESS;
 }
 
+/* Attributes of authentication headers are dispatched with a perfect hash
+   on (length, first char, last char). The words are checked once with a
+   case insensitive compare, so any other key maps to an empty slot or to
+   a different word. */
+#define AUTH_PARAM_MIN_WORD_LENGTH 2
+#define AUTH_PARAM_MAX_WORD_LENGTH 11
+#define AUTH_PARAM_HASH_SIZE 64
+
+static const unsigned char auth_param_asso[256] = {
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 41, 54, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 19, 0, 7, 42, 52, 0, 52, 4, 4, 0, 7, 0, 23, 18, 48,
+  34, 57, 59, 26, 15, 52, 27, 0, 0, 26, 0, 0, 0, 0, 0, 0,
+  0, 19, 0, 7, 42, 52, 0, 52, 4, 4, 0, 7, 0, 23, 18, 48,
+  34, 57, 59, 26, 15, 52, 27, 0, 0, 26, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
+};
+
+static const struct {
+  const char *word;
+  size_t length;
+  int name;
+} auth_param_wordlist[AUTH_PARAM_HASH_SIZE] = {
+  {NULL, 0, -1},
+  {"cnonce", 6, OSIP_AUTH_PARAM_CNONCE},
+  {"domain", 6, OSIP_AUTH_PARAM_DOMAIN},
+  {NULL, 0, -1},
+  {NULL, 0, -1},
+  {NULL, 0, -1},
+  {"rspauth", 7, OSIP_AUTH_PARAM_RSPAUTH},
+  {NULL, 0, -1},
+  {"sign1", 5, OSIP_AUTH_PARAM_SIGN1},
+  {"srand", 5, OSIP_AUTH_PARAM_SRAND},
+  {NULL, 0, -1},
+  {"nonce", 5, OSIP_AUTH_PARAM_NONCE},
+  {"serverid", 8, OSIP_AUTH_PARAM_SERVERID},
+  {"targetname", 10, OSIP_AUTH_PARAM_TARGETNAME},
+  {NULL, 0, -1},
+  {"nextnonce", 9, OSIP_AUTH_PARAM_NEXTNONCE},
+  {NULL, 0, -1},
+  {NULL, 0, -1},
+  {"gssapi-data", 11, OSIP_AUTH_PARAM_GSSAPI_DATA},
+  {"stale", 5, OSIP_AUTH_PARAM_STALE},
+  {NULL, 0, -1},
+  {"sign2", 5, OSIP_AUTH_PARAM_SIGN2},
+  {NULL, 0, -1},
+  {"realm", 5, OSIP_AUTH_PARAM_REALM},
+  {NULL, 0, -1},
+  {NULL, 0, -1},
+  {NULL, 0, -1},
+  {"nc", 2, OSIP_AUTH_PARAM_NC},
+  {"deviceid", 8, OSIP_AUTH_PARAM_DEVICEID},
+  {NULL, 0, -1},
+  {"qop", 3, OSIP_AUTH_PARAM_QOP},
+  {NULL, 0, -1},
+  {NULL, 0, -1},
+  {NULL, 0, -1},
+  {"cnum", 4, OSIP_AUTH_PARAM_CNUM},
+  {"keyversion", 10, OSIP_AUTH_PARAM_KEYVERSION},
+  {NULL, 0, -1},
+  {NULL, 0, -1},
+  {NULL, 0, -1},
+  {NULL, 0, -1},
+  {NULL, 0, -1},
+  {"cryptkey", 8, OSIP_AUTH_PARAM_CRYPTKEY},
+  {"opaque", 6, OSIP_AUTH_PARAM_OPAQUE},
+  {"random1", 7, OSIP_AUTH_PARAM_RANDOM1},
+  {NULL, 0, -1},
+  {NULL, 0, -1},
+  {NULL, 0, -1},
+  {NULL, 0, -1},
+  {"username", 8, OSIP_AUTH_PARAM_USERNAME},
+  {NULL, 0, -1},
+  {NULL, 0, -1},
+  {"algorithm", 9, OSIP_AUTH_PARAM_ALGORITHM},
+  {"version", 7, OSIP_AUTH_PARAM_VERSION},
+  {"snum", 4, OSIP_AUTH_PARAM_SNUM},
+  {"crand", 5, OSIP_AUTH_PARAM_CRAND},
+  {"response", 8, OSIP_AUTH_PARAM_RESPONSE},
+  {"random2", 7, OSIP_AUTH_PARAM_RANDOM2},
+  {NULL, 0, -1},
+  {NULL, 0, -1},
+  {"uri", 3, OSIP_AUTH_PARAM_URI},
+  {NULL, 0, -1},
+  {NULL, 0, -1},
+  {NULL, 0, -1},
+  {"digest", 6, OSIP_AUTH_PARAM_DIGEST}
+};
+
+static int
+__osip_auth_param_lookup (const char *name, size_t length)
+{
+  unsigned int key;
+
+  if (length < AUTH_PARAM_MIN_WORD_LENGTH || length > AUTH_PARAM_MAX_WORD_LENGTH)
+    return -1;
+
+  key = (unsigned int) (length + auth_param_asso[(unsigned char) name[0]] + auth_param_asso[(unsigned char) name[length - 1]]);
+  key &= (AUTH_PARAM_HASH_SIZE - 1);
+
+  if (auth_param_wordlist[key].length != length)
+    return -1;
+  if (osip_strncasecmp (name, auth_param_wordlist[key].word, length) != 0)
+    return -1;
+  return auth_param_wordlist[key].name;
+}
+
+/* parse the list of auth-param of an authentication header:
+   str points right after the auth-scheme.
+   Values of known attributes are copied into the char * members of
+   header described by params. Unknown attributes are skipped. When an
+   attribute appears more than once, the first value is kept. */
 int
-__osip_quoted_string_set (const char *name, const char *str, char **result, const char **next)
-{
-  *next = str;
-  if (*result != NULL)
-    return OSIP_SUCCESS;        /* already parsed */
-  *next = NULL;
-  while ((' ' == *str) || ('\t' == *str) || (',' == *str))
-    if (*str)
+__osip_auth_params_parse (void *header, const __osip_auth_param_t * params, int nb_params, const char *str)
+{
+  for (;;) {
+    const char *name;
+    const char *value;
+    const char *value_end;
+    size_t name_length;
+    int name_id;
+    int pos;
+
+    while (*str == ' ' || *str == '\t' || *str == ',' || *str == '\r' || *str == '\n')
       str++;
-    else
-      return OSIP_SYNTAXERROR;  /* bad header format */
-
-  if (osip_strncasecmp (name, str, strlen (name)) == 0) {
-    const char *quote1;
-    const char *quote2;
-    const char *tmp;
-    const char *hack = strchr (str, '=');
-
-    if (hack == NULL)
-      return OSIP_SYNTAXERROR;
-
-    while (' ' == *(hack - 1))  /* get rid of extra spaces */
-      hack--;
-    if ((size_t) (hack - str) != strlen (name)) {
-      *next = str;
-      return OSIP_SUCCESS;
-    }
+    if (*str == '\0')
+      return OSIP_SUCCESS;      /* end of header detected! */
 
-    quote1 = __osip_quote_find (str);
-    if (quote1 == NULL)
-      return OSIP_SYNTAXERROR;  /* bad header format... */
-    quote2 = __osip_quote_find (quote1 + 1);
-    if (quote2 == NULL)
-      return OSIP_SYNTAXERROR;  /* bad header format... */
-    if (quote2 - quote1 == 1) {
-      /* this is a special case! The quote contains nothing! */
-      /* example:   Digest opaque="",cnonce=""               */
-      /* in this case, we just forget the parameter... this  */
-      /* this should prevent from user manipulating empty    */
-      /* strings */
-      tmp = quote2 + 1;         /* next element start here */
-      tmp += strspn (tmp, " \t");
-      tmp += strspn (tmp, "\n\r");
-      *next = NULL;
-      if (*tmp == '\0')         /* end of header detected */
-        return OSIP_SUCCESS;
-      if (*tmp != '\t' && *tmp != ' ')
-        /* LWS here ? */
-        *next = tmp;
-      else {                    /* it is: skip it... */
-        tmp += strspn (tmp, " \t");
-        if (*tmp == '\0')       /* end of header detected */
-          return OSIP_SUCCESS;
-        *next = tmp;
-      }
-      return OSIP_SUCCESS;
+    name = str;
+    while (*str != '\0' && *str != '=' && *str != ' ' && *str != '\t' && *str != ',')
+      str++;
+    name_length = str - name;
+
+    str += strspn (str, " \t\r\n");
+    if (*str != '=') {
+      /* not an auth-param: bypass it up to the next comma */
+      if (strchr (str, '=') == NULL)
+        return OSIP_SYNTAXERROR;        /* bad header format */
+      str = strchr (str, ',');
+      if (str == NULL)
+        return OSIP_SUCCESS;    /* it was the last parameter */
+      continue;
     }
-    *result = (char *) osip_malloc (quote2 - quote1 + 3);
-    if (*result == NULL)
-      return OSIP_NOMEM;
-    osip_strncpy (*result, quote1, quote2 - quote1 + 1);
-    tmp = quote2 + 1;           /* next element start here */
-    tmp += strspn (tmp, " \t");
-    tmp += strspn (tmp, "\n\r");
-    *next = NULL;
-    if (*tmp == '\0')           /* end of header detected */
-      return OSIP_SUCCESS;
-    if (*tmp != '\t' && *tmp != ' ')
-      /* LWS here ? */
-      *next = tmp;
-    else {                      /* it is: skip it... */
-      tmp += strspn (tmp, " \t");
-      if (*tmp == '\0')         /* end of header detected */
-        return OSIP_SUCCESS;
-      *next = tmp;
+    str++;
+    str += strspn (str, " \t\r\n");
+
+    value = str;
+    if (*str == '"') {
+      value_end = __osip_quote_find (str + 1);
+      if (value_end == NULL)
+        return OSIP_SYNTAXERROR;        /* bad header format... */
+      value_end++;
     }
-  }
-  else
-    *next = str;                /* wrong header asked! */
-  return OSIP_SUCCESS;
-}
-
-int
-__osip_token_set (const char *name, const char *str, char **result, const char **next)
-{
-  const char *beg;
-  const char *tmp;
-
-  *next = str;
-  if (*result != NULL)
-    return OSIP_SUCCESS;        /* already parsed */
-  *next = NULL;
-
-  beg = strchr (str, '=');
-  if (beg == NULL)
-    return OSIP_SYNTAXERROR;    /* bad header format... */
-
-  if (strlen (str) < 6)
-    return OSIP_SUCCESS;        /* end of header... */
-
-  while ((' ' == *str) || ('\t' == *str) || (',' == *str))
-    if (*str)
-      str++;
-    else
-      return OSIP_SYNTAXERROR;  /* bad header format */
-
-  if (osip_strncasecmp (name, str, strlen (name)) == 0) {
-    const char *end;
-
-    //end = strchr (str, ',');
-    end = strchr (beg, '"');
-    if(NULL != end)
-    {
-        end = strchr (end + 1, '"');
+    else {
+      /* a token ends with a comma or with LWS */
+      value_end = str + strcspn (str, ", \t\r\n");
     }
-
-    if (end == NULL)
-      end = str + strlen (str); /* This is the end of the header */
-
-    if (end - beg < 2)
-      return OSIP_SYNTAXERROR;
-    *result = (char *) osip_malloc (end - beg);
-    if (*result == NULL)
-      return OSIP_NOMEM;
-    //osip_clrncpy (*result, beg + 1, end - beg - 1);
-    osip_clrncpy (*result, beg + 1, end - beg);
-
-    /* make sure the element does not contain more parameter */
-    tmp = (*end) ? (end + 1) : end;
-    tmp += strspn (tmp, " \t");
-    tmp += strspn (tmp, "\n\r");
-    *next = NULL;
-    if (*tmp == '\0')           /* end of header detected */
-      return OSIP_SUCCESS;
-    if (*tmp != '\t' && *tmp != ' ')
-      /* LWS here ? */
-      *next = tmp;
-    else {                      /* it is: skip it... */
-      tmp += strspn (tmp, " \t");
-      if (*tmp == '\0')         /* end of header detected */
-        return OSIP_SUCCESS;
-      *next = tmp;
+    /* comma between parameters are sometimes missing */
+    str = value_end;
+
+    name_id = __osip_auth_param_lookup (name, name_length);
+    if (name_id < 0)
+      continue;                 /* parameter not understood: bypass it */
+
+    for (pos = 0; pos < nb_params; pos++) {
+      char **result;
+
+      if ((int) params[pos].name != name_id)
+        continue;
+
+      result = (char **) ((char *) header + params[pos].offset);
+      if (*result != NULL)
+        break;                  /* already parsed */
+
+      if (params[pos].quoted && value_end - value == 2 && *value == '"') {
+        /* this is a special case! The quote contains nothing! */
+        /* example:   Digest opaque="",cnonce=""               */
+        /* in this case, we just forget the parameter... this  */
+        /* this should prevent from user manipulating empty    */
+        /* strings */
+        break;
+      }
+      if (value_end == value)
+        return OSIP_SYNTAXERROR;
+
+      *result = (char *) osip_malloc (value_end - value + 1);
+      if (*result == NULL)
+        return OSIP_NOMEM;
+      osip_strncpy (*result, value, value_end - value);
+      break;
     }
   }
-  else
-    *next = str;                /* next element start here */
   return OSIP_SUCCESS;
 }
 
+static const __osip_auth_param_t www_authenticate_params[] = {
+  {OSIP_AUTH_PARAM_REALM, 1, offsetof (osip_www_authenticate_t, realm)},
+  {OSIP_AUTH_PARAM_DOMAIN, 1, offsetof (osip_www_authenticate_t, domain)},
+  {OSIP_AUTH_PARAM_NONCE, 1, offsetof (osip_www_authenticate_t, nonce)},
+  {OSIP_AUTH_PARAM_OPAQUE, 1, offsetof (osip_www_authenticate_t, opaque)},
+  {OSIP_AUTH_PARAM_STALE, 0, offsetof (osip_www_authenticate_t, stale)},
+  {OSIP_AUTH_PARAM_ALGORITHM, 0, offsetof (osip_www_authenticate_t, algorithm)},
+  {OSIP_AUTH_PARAM_QOP, 1, offsetof (osip_www_authenticate_t, qop_options)},
+  {OSIP_AUTH_PARAM_VERSION, 0, offsetof (osip_www_authenticate_t, version)},
+  {OSIP_AUTH_PARAM_TARGETNAME, 1, offsetof (osip_www_authenticate_t, targetname)},
+  {OSIP_AUTH_PARAM_GSSAPI_DATA, 1, offsetof (osip_www_authenticate_t, gssapi_data)},
+  {OSIP_AUTH_PARAM_RANDOM1, 1, offsetof (osip_www_authenticate_t, random1)}
+};
+
 /* fills the www-authenticate strucuture.                      */
 /* INPUT : char *hvalue | value of header.         */
 /* OUTPUT: osip_message_t *sip | structure to save results. */
@@ -224,8 +292,6 @@ int
 osip_www_authenticate_parse (osip_www_authenticate_t * wwwa, const char *hvalue)
 {
   const char *space;
-  const char *next = NULL;
-  int i;
 
   space = strchr (hvalue, ' '); /* SEARCH FOR SPACE */
   if (space == NULL)
@@ -238,139 +304,7 @@ osip_www_authenticate_parse (osip_www_authenticate_t * wwwa, const char *hvalue)
     return OSIP_NOMEM;
   osip_strncpy (wwwa->auth_type, hvalue, space - hvalue);
 
-  for (;;) {
-    int parse_ok = 0;
-
-    i = __osip_quoted_string_set ("realm", space, &(wwwa->realm), &next);
-    if (i != 0)
-      return i;
-    if (next == NULL)
-      return OSIP_SUCCESS;      /* end of header detected! */
-    else if (next != space) {
-      space = next;
-      parse_ok++;
-    }
-    i = __osip_quoted_string_set ("domain", space, &(wwwa->domain), &next);
-    if (i != 0)
-      return i;
-    if (next == NULL)
-      return OSIP_SUCCESS;      /* end of header detected! */
-    else if (next != space) {
-      space = next;
-      parse_ok++;
-    }
-    i = __osip_quoted_string_set ("nonce", space, &(wwwa->nonce), &next);
-    if (i != 0)
-      return i;
-    if (next == NULL)
-      return OSIP_SUCCESS;      /* end of header detected! */
-    else if (next != space) {
-      space = next;
-      parse_ok++;
-    }
-    i = __osip_quoted_string_set ("opaque", space, &(wwwa->opaque), &next);
-    if (i != 0)
-      return i;
-    if (next == NULL)
-      return OSIP_SUCCESS;      /* end of header detected! */
-    else if (next != space) {
-      space = next;
-      parse_ok++;
-    }
-    i = __osip_token_set ("stale", space, &(wwwa->stale), &next);
-    if (i != 0)
-      return i;
-    if (next == NULL)
-      return OSIP_SUCCESS;      /* end of header detected! */
-    else if (next != space) {
-      space = next;
-      parse_ok++;
-    }
-    i = __osip_token_set ("algorithm", space, &(wwwa->algorithm), &next);
-    if (i != 0)
-      return i;
-    if (next == NULL)
-      return OSIP_SUCCESS;      /* end of header detected! */
-    else if (next != space) {
-      space = next;
-      parse_ok++;
-    }
-    i = __osip_quoted_string_set ("qop", space, &(wwwa->qop_options), &next);
-    if (i != 0)
-      return i;
-    if (next == NULL)
-      return OSIP_SUCCESS;      /* end of header detected! */
-    else if (next != space) {
-      space = next;
-      parse_ok++;
-    }
-    i = __osip_token_set ("version", space, &(wwwa->version), &next);
-    if (i != 0)
-      return i;
-    if (next == NULL)
-      return OSIP_SUCCESS;      /* end of header detected! */
-    else if (next != space) {
-      space = next;
-      parse_ok++;
-    }
-    i = __osip_quoted_string_set ("targetname", space, &(wwwa->targetname), &next);
-    if (i != 0)
-      return i;
-    if (next == NULL)
-      return OSIP_SUCCESS;      /* end of header detected! */
-    else if (next != space) {
-      space = next;
-      parse_ok++;
-    }
-    i = __osip_quoted_string_set ("gssapi-data", space, &(wwwa->gssapi_data), &next);
-    if (i != 0)
-      return i;
-    if (next == NULL)
-      return OSIP_SUCCESS;               /* end of header detected! */
-    else if (next != space)
-      {
-        space = next;
-        parse_ok++;
-      }
-       i = __osip_quoted_string_set ("random1", space, &(wwwa->random1), &next);
-    if (i!=0)
-      return i;
-    if (next == NULL)
-      return OSIP_SUCCESS;               /* end of header detected! */
-    else if (next != space)
-      {
-        space = next;
-        parse_ok++;
-      }
-    if (0 == parse_ok) {
-      const char *quote1, *quote2, *tmp;
-
-      /* CAUTION */
-      /* parameter not understood!!! I'm too lazy to handle IT */
-      /* let's simply bypass it */
-      if (strlen (space) < 1)
-        return OSIP_SUCCESS;
-      tmp = strchr (space + 1, ',');
-      if (tmp == NULL)          /* it was the last header */
-        return OSIP_SUCCESS;
-      quote1 = __osip_quote_find (space);
-      if ((quote1 != NULL) && (quote1 < tmp)) { /* this may be a quoted string! */
-        quote2 = __osip_quote_find (quote1 + 1);
-        if (quote2 == NULL)
-          return OSIP_SYNTAXERROR;      /* bad header format... */
-        if (tmp < quote2)       /* the comma is inside the quotes! */
-          space = strchr (quote2, ',');
-        else
-          space = tmp;
-        if (space == NULL)      /* it was the last header */
-          return OSIP_SUCCESS;
-      }
-      else
-        space = tmp;
-      /* continue parsing... */
-    }
-  }
-  return OSIP_SUCCESS;          /* ok */
+  return __osip_auth_params_parse (wwwa, www_authenticate_params, sizeof (www_authenticate_params) / sizeof (www_authenticate_params[0]), space);
 }
 
 #ifndef MINISIZE
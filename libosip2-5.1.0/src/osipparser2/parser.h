@@ -21,13 +21,9 @@
 #ifndef _MSG_H_
 #define _MSG_H_
 
-#ifndef DOXYGEN
+#include <stddef.h>
 
-#ifndef MINISIZE
-#define NUMBER_OF_HEADERS 35
-#else
-#define NUMBER_OF_HEADERS 22
-#endif
+#ifndef DOXYGEN
 
 #ifndef NUMBER_OF_HEADERS_COMMASEPARATED
 #define NUMBER_OF_HEADERS_COMMASEPARATED 256
@@ -35,25 +31,67 @@
 
 /* internal type for parser's config */
 typedef struct ___osip_message_config_t {
-  char *hname;
+  const char *hname;
+  size_t hname_length;
   int (*setheader) (osip_message_t *, const char *);
   int ignored_when_invalid;
+  int comma_separated;
 } __osip_message_config_t;
 
 typedef struct ___osip_message_config_commaseparated_t {
   char hname[256];
 } __osip_message_config_commaseparated_t;
 
-int __osip_message_call_method (int i, osip_message_t * dest, const char *hvalue);
-int __osip_message_is_header_comma_separated (const char *hname);
-int __osip_message_is_known_header (const char *hname);
+const __osip_message_config_t *__osip_message_get_config (const char *hname);
+int __osip_message_call_method (const __osip_message_config_t * config, osip_message_t * dest, const char *hvalue);
+int __osip_message_is_header_comma_separated (const __osip_message_config_t * config, const char *hname);
 
 int __osip_find_next_occurence (const char *str, const char *buf, const char **index_of_str, const char *end_of_buf);
 int __osip_find_next_crlf (const char *start_of_header, const char **end_of_header);
 int __osip_find_next_crlfcrlf (const char *start_of_part, const char **end_of_part);
 
-int __osip_quoted_string_set (const char *name, const char *str, char **result, const char **next);
-int __osip_token_set (const char *name, const char *str, char **result, const char **next);
+/* attributes known by the authentication headers parser */
+typedef enum {
+  OSIP_AUTH_PARAM_ALGORITHM,
+  OSIP_AUTH_PARAM_CNONCE,
+  OSIP_AUTH_PARAM_CNUM,
+  OSIP_AUTH_PARAM_CRAND,
+  OSIP_AUTH_PARAM_CRYPTKEY,
+  OSIP_AUTH_PARAM_DEVICEID,
+  OSIP_AUTH_PARAM_DIGEST,
+  OSIP_AUTH_PARAM_DOMAIN,
+  OSIP_AUTH_PARAM_GSSAPI_DATA,
+  OSIP_AUTH_PARAM_KEYVERSION,
+  OSIP_AUTH_PARAM_NC,
+  OSIP_AUTH_PARAM_NEXTNONCE,
+  OSIP_AUTH_PARAM_NONCE,
+  OSIP_AUTH_PARAM_OPAQUE,
+  OSIP_AUTH_PARAM_QOP,
+  OSIP_AUTH_PARAM_RANDOM1,
+  OSIP_AUTH_PARAM_RANDOM2,
+  OSIP_AUTH_PARAM_REALM,
+  OSIP_AUTH_PARAM_RESPONSE,
+  OSIP_AUTH_PARAM_RSPAUTH,
+  OSIP_AUTH_PARAM_SERVERID,
+  OSIP_AUTH_PARAM_SIGN1,
+  OSIP_AUTH_PARAM_SIGN2,
+  OSIP_AUTH_PARAM_SNUM,
+  OSIP_AUTH_PARAM_SRAND,
+  OSIP_AUTH_PARAM_STALE,
+  OSIP_AUTH_PARAM_TARGETNAME,
+  OSIP_AUTH_PARAM_URI,
+  OSIP_AUTH_PARAM_USERNAME,
+  OSIP_AUTH_PARAM_VERSION
+} __osip_auth_param_name_t;
+
+/* internal type describing where an attribute is stored in a header structure */
+typedef struct ___osip_auth_param_t {
+  __osip_auth_param_name_t name;
+  int quoted;                   /* quoted-string: keep quotes, ignore empty value */
+  size_t offset;                /* offsetof() of the (char *) member */
+} __osip_auth_param_t;
+
+int __osip_auth_params_parse (void *header, const __osip_auth_param_t * params, int nb_params, const char *str);
 
 
 int __osip_generic_param_parseall (osip_list_t * gen_params, const char *params);
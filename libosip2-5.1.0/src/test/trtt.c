@@ -0,0 +1,192 @@
+/*
+  The oSIP library implements the Session Initiation Protocol (SIP -rfc3261-)
+  Copyright (C) 2001-2018 Aymeric MOIZARD amoizard@antisip.com
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+/* test of the adaptive T1 (round trip time estimator of RFC6298).
+   The delay of each sample is simulated by moving the start of the
+   measure back in time, so that the test does not sleep. */
+
+#ifdef ENABLE_MPATROL
+#include <mpatrol.h>
+#endif
+
+#include <osip2/internal.h>
+#include <osip2/osip.h>
+
+#include "xixt.h"
+
+#define RTT_HOST "192.0.2.1"
+#define RTT_PORT 5070
+
+/* delays are measured in ms by osip_gettimeofday: allow a few ms of
+   execution time on each sample */
+#define RTT_MARGIN 5
+
+static int failures;
+
+static void
+check (int ok, const char *what)
+{
+  if (!ok)
+    failures++;
+  printf ("%s: %s\n", ok ? "ok    " : "FAILED", what);
+}
+
+static osip_transaction_t *
+rtt_transaction (osip_t * osip, const char *transport)
+{
+  osip_transaction_t *tr;
+  osip_message_t *sip;
+  char buf[512];
+
+  snprintf (buf, sizeof (buf),
+            "MESSAGE sip:bob@" RTT_HOST ":%i SIP/2.0\r\n"
+            "Via: SIP/2.0/%s 192.0.2.2:5060;branch=z9hG4bK%s\r\n"
+            "From: <sip:alice@192.0.2.2>;tag=1\r\n"
+            "To: <sip:bob@" RTT_HOST ">\r\n" "Call-ID: rtt-%s@192.0.2.2\r\n" "CSeq: 1 MESSAGE\r\n" "Max-Forwards: 70\r\n" "Content-Length: 0\r\n\r\n", RTT_PORT, transport, transport, transport);
+
+  if (osip_message_init (&sip) != 0)
+    return NULL;
+  if (osip_message_parse (sip, buf, strlen (buf)) != 0 || osip_transaction_init (&tr, NICT, osip, sip) != 0) {
+    osip_message_free (sip);
+    return NULL;
+  }
+  return tr;
+}
+
+static struct osip_peer_rtt *
+rtt_peer (osip_t * osip)
+{
+  int i;
+
+  for (i = 0; i < OSIP_PEER_RTT_SETS * OSIP_PEER_RTT_WAYS; i++) {
+    if (strcmp (osip->peer_rtt[i].host, RTT_HOST) == 0 && osip->peer_rtt[i].port == RTT_PORT)
+      return &osip->peer_rtt[i];
+  }
+  return NULL;
+}
+
+/* start a measure, answer it after delay ms: return the T1 used for
+   timer E, or -1 when no measure was started */
+static int
+rtt_sample (osip_transaction_t * tr, int delay, int retransmitted)
+{
+  struct timeval timer_start;
+  int timer_length = DEFAULT_T1;
+
+  __osip_transaction_rtt_start (tr, &timer_length, &timer_start);
+  if (tr->rtt_start.tv_sec == -1)
+    return -1;
+
+  tr->rtt_retransmitted = retransmitted;
+  tr->rtt_start.tv_sec -= delay / 1000;
+  tr->rtt_start.tv_usec -= (delay % 1000) * 1000;
+  if (tr->rtt_start.tv_usec < 0) {
+    tr->rtt_start.tv_sec--;
+    tr->rtt_start.tv_usec += 1000000;
+  }
+  __osip_transaction_rtt_sample (tr);
+  return timer_length;
+}
+
+static int
+in_range (int value, int expected)
+{
+  return (value >= expected && value <= expected + RTT_MARGIN);
+}
+
+int
+main (int argc, char **argv)
+{
+  osip_t *osip;
+  osip_transaction_t *tr;
+  osip_transaction_t *tcp;
+  struct osip_peer_rtt *peer;
+  int srtt, rttvar;
+  int i;
+
+  if (osip_init (&osip) != 0) {
+    fprintf (stdout, "Failed to initialize osip.\n");
+    return 1;
+  }
+
+  tr = rtt_transaction (osip, "UDP");
+  tcp = rtt_transaction (osip, "TCP");
+  if (tr == NULL || tcp == NULL) {
+    fprintf (stdout, "Failed to build the transactions.\n");
+    return 1;
+  }
+
+  check (rtt_sample (tr, 200, 0) == -1, "no measure when adaptive T1 is disabled");
+  check (osip_set_adaptive_t1 (osip, 500, 100) == OSIP_BADPARAMETER, "t1_max below t1_min is refused");
+  check (osip_set_adaptive_t1 (osip, 0, 100) == OSIP_BADPARAMETER, "t1_min below 1ms is refused");
+  check (osip_set_adaptive_t1 (osip, 100, 2000) == OSIP_SUCCESS, "adaptive T1 enabled (100ms-2000ms)");
+  check (osip_get_peer_t1 (osip, RTT_HOST, RTT_PORT) == DEFAULT_T1, "T1 of an unknown destination is DEFAULT_T1");
+  check (rtt_sample (tcp, 200, 0) == -1, "no measure over a reliable transport");
+
+  /* first sample: SRTT = R, RTTVAR = R/2 */
+  check (rtt_sample (tr, 200, 0) == DEFAULT_T1, "first measure uses DEFAULT_T1");
+  peer = rtt_peer (osip);
+  check (peer != NULL, "destination added to the table");
+  if (peer == NULL)
+    return 1;
+  check (in_range (peer->srtt, 200) && in_range (peer->rttvar, 100), "first sample: srtt=R rttvar=R/2");
+  check (in_range (osip_get_peer_t1 (osip, RTT_HOST, RTT_PORT), 600), "T1 = srtt + 4*rttvar");
+
+  /* next samples: RTTVAR = 3/4 RTTVAR + 1/4 |SRTT - R|, SRTT = 7/8 SRTT + 1/8 R */
+  srtt = peer->srtt;
+  rttvar = peer->rttvar;
+  check (rtt_sample (tr, 100, 0) == srtt + 4 * rttvar, "next measure uses the estimated T1");
+  check (in_range (peer->rttvar, (3 * rttvar + abs (srtt - 100)) / 4 - RTT_MARGIN) && in_range (peer->srtt, (7 * srtt + 100) / 8), "second sample updates rttvar and srtt");
+
+  /* Karn: a response to a retransmitted request is ambiguous */
+  srtt = peer->srtt;
+  rttvar = peer->rttvar;
+  rtt_sample (tr, 20, 1);
+  check (peer->srtt == srtt && peer->rttvar == rttvar, "retransmitted request: no sample");
+  check (osip_get_peer_t1 (osip, RTT_HOST, RTT_PORT) == 2 * (srtt + 4 * rttvar), "retransmitted request: T1 is doubled");
+  rtt_sample (tr, 1500, 1);
+  check (peer->srtt == srtt && peer->rttvar == rttvar, "retransmitted request: long delay is not used either");
+  check (osip_get_peer_t1 (osip, RTT_HOST, RTT_PORT) == 2000, "backed off T1 is limited to t1_max");
+  rtt_sample (tr, srtt, 0);
+  check (peer->backoff == 0 && osip_get_peer_t1 (osip, RTT_HOST, RTT_PORT) < 2000, "valid sample ends the backoff");
+
+  /* bounds */
+  check (osip_set_adaptive_t1 (osip, 100, 200) == OSIP_SUCCESS, "adaptive T1 bounds set to 100ms-200ms");
+  check (osip_get_peer_t1 (osip, RTT_HOST, RTT_PORT) == 200, "T1 is limited to t1_max");
+  for (i = 0; i < 64; i++)
+    rtt_sample (tr, 1, 0);
+  check (peer->srtt <= 1 + RTT_MARGIN, "srtt converges to the measured delay");
+  check (osip_get_peer_t1 (osip, RTT_HOST, RTT_PORT) == 100, "T1 is limited to t1_min");
+
+  /* LAN peer: srtt = rttvar = 0 must not give T1 = 0 */
+  check (osip_set_adaptive_t1 (osip, 1, 1000) == OSIP_SUCCESS, "adaptive T1 bounds set to 1ms-1000ms");
+  for (i = 0; i < 64; i++)
+    rtt_sample (tr, 0, 0);
+  check (osip_get_peer_t1 (osip, RTT_HOST, RTT_PORT) >= 1, "T1 is at least 1ms");
+
+  check (osip_set_adaptive_t1 (osip, 0, 0) == OSIP_SUCCESS, "adaptive T1 disabled");
+  check (osip_get_peer_t1 (osip, RTT_HOST, RTT_PORT) == DEFAULT_T1, "T1 is DEFAULT_T1 when disabled");
+
+  osip_transaction_free (tr);
+  osip_transaction_free (tcp);
+  osip_release (osip);
+
+  printf ("adaptive T1: %s\n", failures == 0 ? "passed" : "FAILED");
+  return failures == 0 ? 0 : 1;
+}